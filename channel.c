@@ -68,6 +68,7 @@ ChSlot *channel;
 ChSlot *activeChannel;
 DevSlot *activeDevice;
 u8 channelCount;
+u32 channelFunctions = 0;
 
 /*
 **  -----------------
@@ -99,7 +100,7 @@ void channelInit(u8 count)
     **  Allocate channel structures.
     */
     channelCount = count;
-    channel = calloc(MaxChannels, sizeof(ChSlot));
+    channel = memAllocAligned(MaxChannels * sizeof(ChSlot));
     if (channel == NULL)
         {
         fprintf(stderr, "Failed to allocate channel control blocks\n");
@@ -188,7 +189,7 @@ void channelTerminate(void)
     /*
     **  Free all channel control blocks.
     */
-    free(channel);
+    memFreeAligned(channel);
     }
 
 /*--------------------------------------------------------------------------
@@ -315,6 +316,15 @@ void channelFunction(PpWord funcCode)
             }
         }
 
+    /*
+    **  Count device activity for virtual time, the console refresh does
+    **  not count.
+    */
+    if (activeDevice != NULL && activeDevice->devType != DtConsole)
+        {
+        channelFunctions += 1;
+        }
+
     if (activeDevice == NULL || status == FcDeclined)
         {
         /*
@@ -0,0 +1,551 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: clone.c
+**
+**  Description:
+**      Clone the running emulated system into a new emulator process.
+**      The clone is forked at a major cycle boundary and shares CM, ECS
+**      and PP memory copy-on-write with its parent. Systems using ECS
+**      shared with other emulators can't be cloned. It runs on private
+**      copies of the files the parent has open for writing, listens on
+**      TCP ports moved by an offset and has neither console window nor
+**      operator interface.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#if defined(__APPLE__)
+#include <sys/param.h>
+#endif
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#endif
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxCloneFiles       256
+#define MaxCloneFd          65536
+#define CloneCopySize       (1024 * 1024)
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct cloneFile
+    {
+    int             fd;                 /* file descriptor */
+    int             flags;              /* open flags */
+    char            path[256];          /* path of open file */
+    char            copy[512];          /* path of private copy */
+    } CloneFile;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+#if !defined(_WIN32)
+static bool cloneFindFiles(void);
+static bool cloneGetPath(int fd, char *path, int size);
+static bool cloneCopyFiles(char *dir);
+static void cloneSetup(char *dir);
+static bool cloneCopyFile(char *from, char *to);
+static void cloneTerminate(int sig);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+u16 clonePortOffset = 100;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static u16 cloneCount = 0;
+#if !defined(_WIN32)
+static CloneFile cloneFiles[MaxCloneFiles];
+static int cloneFileCount;
+#endif
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Clone the running system into a new process.
+**
+**                  Called from the main emulation thread between two major
+**                  cycles, so PPs and channels are quiescent. The CPU
+**                  threads of a multiprocessor are held while the files
+**                  open for writing are copied and the process is forked,
+**                  so the copies match the memory the clone starts with.
+**
+**  Parameters:     Name        Description.
+**                  dir         directory for the files of the clone
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cloneSystem(char *dir)
+    {
+#if defined(_WIN32)
+    (void)dir;
+    printf("Cloning is not supported on this platform\n");
+#else
+    char cloneDir[256];
+    struct stat st;
+    pid_t pid;
+
+    /*
+    **  A shared ECS segment would be inherited shared rather than
+    **  copy-on-write and the clone would write into the ECS of its parent.
+    */
+    if (*ecsSharedName != '\0')
+        {
+        printf("Cloning is not supported with shared ECS\n");
+        return;
+        }
+
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+        printf("%s is not a directory\n", dir);
+        return;
+        }
+
+    sprintf(cloneDir, "%.200s/clone%02d", dir, cloneCount + 1);
+    if (mkdir(cloneDir, 0755) != 0 && errno != EEXIST)
+        {
+        printf("Can't create %s\n", cloneDir);
+        return;
+        }
+
+    if (!cloneFindFiles())
+        {
+        return;
+        }
+
+    /*
+    **  Make sure nothing buffered is written by both processes.
+    */
+    fflush(NULL);
+
+    cpuHold(TRUE);
+    if (!cloneCopyFiles(cloneDir))
+        {
+        cpuHold(FALSE);
+        return;
+        }
+
+    pid = fork();
+    cpuHold(FALSE);
+
+    if (pid < 0)
+        {
+        printf("Failed to fork clone: %s\n", strerror(errno));
+        return;
+        }
+
+    cloneCount += 1;
+
+    if (pid > 0)
+        {
+        printf("Clone %d started as process %d in %s, ports moved by %d\n",
+            cloneCount, (int)pid, cloneDir, cloneCount * clonePortOffset);
+        return;
+        }
+
+    /*
+    **  This is the clone.
+    */
+    cloneSetup(cloneDir);
+    windowClone();
+    cpuClone();
+    npuNetClone((u16)(cloneCount * clonePortOffset));
+    mux6676Clone((u16)(cloneCount * clonePortOffset));
+    tpMuxClone((u16)(cloneCount * clonePortOffset));
+
+    printf("Clone %d of process %d running\n", cloneCount, (int)getppid());
+    fflush(stdout);
+#endif
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+#if !defined(_WIN32)
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Record the regular files the emulator has open.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if all could be identified, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cloneFindFiles(void)
+    {
+    CloneFile *cf;
+    struct stat st;
+    long maxFd;
+    int fd;
+
+    maxFd = sysconf(_SC_OPEN_MAX);
+    if (maxFd < 0 || maxFd > MaxCloneFd)
+        {
+        maxFd = MaxCloneFd;
+        }
+
+    cloneFileCount = 0;
+    for (fd = 3; fd < maxFd; fd++)
+        {
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+            {
+            continue;
+            }
+
+        if (cloneFileCount == MaxCloneFiles)
+            {
+            printf("Too many open files to clone\n");
+            return(FALSE);
+            }
+
+        cf = cloneFiles + cloneFileCount;
+        cf->fd = fd;
+        cf->flags = fcntl(fd, F_GETFL);
+        if (!cloneGetPath(fd, cf->path, sizeof(cf->path)))
+            {
+            printf("Can't determine the path of open file %d\n", fd);
+            return(FALSE);
+            }
+
+        cloneFileCount += 1;
+        }
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the path of an open file.
+**
+**  Parameters:     Name        Description.
+**                  fd          file descriptor
+**                  path        buffer for the path
+**                  size        size of buffer
+**
+**  Returns:        TRUE if found, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cloneGetPath(int fd, char *path, int size)
+    {
+#if defined(__APPLE__)
+    char buffer[MAXPATHLEN];
+
+    if (fcntl(fd, F_GETPATH, buffer) < 0 || (int)strlen(buffer) >= size)
+        {
+        return(FALSE);
+        }
+
+    strcpy(path, buffer);
+    return(TRUE);
+#else
+    char link[40];
+    int len;
+
+#if defined(__linux__)
+    sprintf(link, "/proc/self/fd/%d", fd);
+#else
+    sprintf(link, "/proc/self/path/%d", fd);
+#endif
+    len = (int)readlink(link, path, size - 1);
+    if (len <= 0)
+        {
+        return(FALSE);
+        }
+
+    path[len] = '\0';
+    return(path[0] == '/');
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy the files open for writing into the clone
+**                  directory.
+**
+**                  Called in the parent before forking, so the copies are
+**                  taken before the parent writes to the files again.
+**
+**  Parameters:     Name        Description.
+**                  dir         clone directory
+**
+**  Returns:        TRUE if all were copied, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cloneCopyFiles(char *dir)
+    {
+    CloneFile *cf;
+    struct stat st;
+    char *name;
+    int i;
+
+    for (i = 0, cf = cloneFiles; i < cloneFileCount; i++, cf++)
+        {
+        if ((cf->flags & O_ACCMODE) == O_RDONLY)
+            {
+            continue;
+            }
+
+        name = strrchr(cf->path, '/') + 1;
+        sprintf(cf->copy, "%.400s/%s", dir, name);
+        if (stat(cf->copy, &st) == 0)
+            {
+            sprintf(cf->copy, "%.400s/%d.%s", dir, cf->fd, name);
+            }
+
+        if (!cloneCopyFile(cf->path, cf->copy))
+            {
+            printf("Failed to copy %s to %s\n", cf->path, cf->copy);
+            return(FALSE);
+            }
+        }
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Detach the clone from the files, sockets and terminal
+**                  of its parent.
+**
+**                  Files open for reading are opened again so the clone
+**                  has its own file position. Files open for writing are
+**                  replaced by the copies the parent made before forking.
+**                  Sockets are replaced by sockets whose peer is closed,
+**                  so their connections are seen as dropped.
+**
+**  Parameters:     Name        Description.
+**                  dir         clone directory
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cloneSetup(char *dir)
+    {
+    CloneFile *cf;
+    struct stat st;
+    char path[512];
+    off_t pos;
+    long maxFd;
+    int sv[2];
+    int fd;
+    int newFd;
+    int i;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, cloneTerminate);
+    signal(SIGTERM, cloneTerminate);
+
+    /*
+    **  No operator interface and output to a console log.
+    */
+    fd = open("/dev/null", O_RDONLY);
+    dup2(fd, 0);
+    close(fd);
+
+    sprintf(path, "%.400s/console.txt", dir);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+        {
+        dup2(fd, 1);
+        dup2(fd, 2);
+        close(fd);
+        }
+
+    /*
+    **  Use own files.
+    */
+    for (i = 0, cf = cloneFiles; i < cloneFileCount; i++, cf++)
+        {
+        pos = lseek(cf->fd, 0, SEEK_CUR);
+
+        if ((cf->flags & O_ACCMODE) == O_RDONLY)
+            {
+            newFd = open(cf->path, O_RDONLY);
+            }
+        else
+            {
+            newFd = open(cf->copy, cf->flags & (O_ACCMODE | O_APPEND));
+            }
+
+        if (newFd < 0)
+            {
+            fprintf(stderr, "Failed to open %s\n", cf->path);
+            exit(1);
+            }
+
+        dup2(newFd, cf->fd);
+        close(newFd);
+        lseek(cf->fd, pos, SEEK_SET);
+        }
+
+    /*
+    **  Drop connections and listening sockets of the parent.
+    */
+    maxFd = sysconf(_SC_OPEN_MAX);
+    if (maxFd < 0 || maxFd > MaxCloneFd)
+        {
+        maxFd = MaxCloneFd;
+        }
+
+    for (fd = 3; fd < maxFd; fd++)
+        {
+        if (fstat(fd, &st) != 0 || !S_ISSOCK(st.st_mode))
+            {
+            continue;
+            }
+
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0)
+            {
+            dup2(sv[0], fd);
+            close(sv[0]);
+            close(sv[1]);
+            }
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy a file, sharing its blocks where the file system
+**                  supports it.
+**
+**  Parameters:     Name        Description.
+**                  from        source path
+**                  to          destination path
+**
+**  Returns:        TRUE if copied, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cloneCopyFile(char *from, char *to)
+    {
+    static char buffer[CloneCopySize];
+    bool result = TRUE;
+    ssize_t len;
+    int inFd;
+    int outFd;
+
+    inFd = open(from, O_RDONLY);
+    if (inFd < 0)
+        {
+        return(FALSE);
+        }
+
+    outFd = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0)
+        {
+        close(inFd);
+        return(FALSE);
+        }
+
+#if defined(__linux__) && defined(FICLONE)
+    if (ioctl(outFd, FICLONE, inFd) == 0)
+        {
+        close(inFd);
+        close(outFd);
+        return(TRUE);
+        }
+#endif
+
+    while ((len = read(inFd, buffer, sizeof(buffer))) > 0)
+        {
+        if (write(outFd, buffer, len) != len)
+            {
+            result = FALSE;
+            break;
+            }
+        }
+
+    if (len < 0)
+        {
+        result = FALSE;
+        }
+
+    close(inFd);
+    close(outFd);
+
+    return(result);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Shut down a clone on a signal.
+**
+**  Parameters:     Name        Description.
+**                  sig         signal number
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cloneTerminate(int sig)
+    {
+    (void)sig;
+    emulationActive = FALSE;
+    }
+
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
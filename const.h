@@ -73,6 +73,11 @@
 */
 #define CcCycleTime             0
 
+/*
+**  Co-simulate the CPU fast paths against the reference implementation
+*/
+#define CcCoSim                 0
+
 /*
 **  Device types.
 */
@@ -121,6 +126,8 @@
 #define MaxEquipment            010
 #define MaxDeadStart            020
 #define MaxChannels             040
+#define MaxCpus                 2
+#define MaxPpus                 024
 
 #define MaxIwStack              12
 
@@ -219,6 +226,16 @@
 #define MaskActive              0x4000 
 #define MaskFull                0x2000
 
+/*
+**  Thread registration status.
+*/
+#define ThreadRegOk             0
+#define ThreadRegOvfl           1
+#define ThreadRegDupl           2
+#define ThreadRegCores          3
+#define ThreadRegPolicy         4
+#define ThreadRegLevel          5
+
 /*
 **  ----------------------
 **  Public Macro Functions
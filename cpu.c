@@ -34,6 +34,18 @@
 #include "const.h"
 #include "types.h"
 #include "proto.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /*
 **  -----------------
@@ -58,12 +70,57 @@
 #define EcsBankSize             (131072 - 5120)
 #define EsmBankSize             131072
 
+/*
+**  Maximum number of instruction words a CPU thread executes between
+**  checks for PP exchange requests.
+*/
+#define CpuBatchSize            1000
+
+/*
+**  Value of the magic word of a shared ECS segment once it is initialised,
+**  the time an attaching emulator waits for that and the maximum number
+**  of emulators attached to a segment.
+*/
+#define EcsSharedMagic          0x45435332
+#define EcsSharedWait           10
+#define EcsSharedUsers          16
+
+/*
+**  Co-simulation limits: CM words written and instructions decoded in one
+**  instruction word.
+*/
+#if CcCoSim == 1
+#define CoSimMaxWrites          1024
+#define CoSimMaxOps             4
+#endif
+
 /*
 **  -----------------------
 **  Private Macro Functions
 **  -----------------------
 */
 
+/*
+**  Atomic operations on 32 bit words which also work between processes
+**  sharing memory.
+*/
+#if defined(_WIN32)
+#define AtomicCas32(p, o, n)    (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#define AtomicAdd32(p, v)       ((u32)InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v)) + (u32)(v))
+#else
+#define AtomicCas32(p, o, n)    __sync_bool_compare_and_swap((p), (o), (n))
+#define AtomicAdd32(p, v)       __sync_add_and_fetch((p), (v))
+#endif
+
+/*
+**  Record the old value of a CM word before the CPU stores into it.
+*/
+#if CcCoSim == 1
+#define CoSimSave(word)         if (coSimJournaling) cpuCoSimSave(word)
+#else
+#define CoSimSave(word)
+#endif
+
 /*
 **  -----------------------------------------
 **  Private Typedef and Structure Definitions
@@ -75,16 +132,69 @@ typedef struct opDispatch
     u8   length;
     } OpDispatch;
 
+/*
+**  CPU core compiled for one model: the instruction loop and the opcodes
+**  which fetch instruction words.
+*/
+typedef struct cpuCore
+    {
+    void (*step)(void);
+    void (*op0x[7])(void);              /* opcodes 01 to 07 */
+    } CpuCore;
+
+/*
+**  Header of an ECS segment shared between emulator processes. The ECS
+**  words follow the header. The process IDs let an emulator recognise
+**  creators and users which ended without detaching.
+*/
+typedef struct ecsShared
+    {
+    volatile u32    magic;              /* EcsSharedMagic once initialised */
+    u32             words;              /* ECS size in words */
+    volatile u32    flagRegister;       /* ECS flag register */
+    volatile u32    creator;            /* process ID of creator */
+    volatile u32    users[EcsSharedUsers]; /* process IDs of attached emulators */
+    } EcsShared;
+
+#if CcCoSim == 1
+/*
+**  CM word written during a co-simulated instruction word.
+*/
+typedef struct coSimWrite
+    {
+    CpWord          *word;              /* host address of word */
+    CpWord          old;                /* value before the store */
+    CpWord          fast;               /* value stored by the fast engine */
+    } CoSimWrite;
+
+/*
+**  Instruction decoded during a co-simulated instruction word.
+*/
+typedef struct coSimOp
+    {
+    u32             p;                  /* address of instruction word */
+    u8              opFm;
+    u8              opI;
+    u8              opJ;
+    u8              opK;
+    u32             opAddress;
+    } CoSimOp;
+#endif
+
 /*
 **  ---------------------------
 **  Private Function Prototypes
 **  ---------------------------
 */
 static void cpuOpIllegal(void);
-static bool cpuCheckOpAddress(u32 address, u32 *location);
+static void cpuSelectCore(ModelType model);
+ForceInline void cpuStepModel(ModelFeatures mf);
+ForceInline bool cpuCheckOpAddressModel(u32 address, u32 *location, ModelFeatures mf);
+ForceInline void cpuFetchOpWordModel(u32 address, CpWord *data, ModelFeatures mf);
 static void cpuFetchOpWord(u32 address, CpWord *data);
 static void cpuVoidIwStack(u32 branchAddr);
 static bool cpuReadMem(u32 address, CpWord *data);
+static void cpuSetField(void);
 static bool cpuWriteMem(u32 address, CpWord *data);
 static void cpuRegASemantics(void);
 static u32 cpuAddRa(u32 op);
@@ -103,6 +213,28 @@ static void cpuCmuCompareCollated(void);
 static void cpuCmuCompareUncollated(void);
 static void cpuFloatCheck(CpWord value);
 static void cpuFloatExceptionHandler(void);
+static bool cpuEnterMonitor(void);
+static void cpuExchangeToMonitor(void);
+static void cpuCreateThread(CpuContext *cc);
+#if defined(_WIN32)
+static void cpuThread(void *param);
+#else
+static void *cpuThread(void *param);
+#endif
+static void cpuLock(CpuContext *cc);
+static void cpuUnlock(CpuContext *cc);
+static void cpuLockInterlock(void);
+static void cpuUnlockInterlock(void);
+static void cpuSharedEcsAttach(size_t size);
+static bool cpuSharedEcsDetach(void);
+static void cpuSharedEcsJoin(void);
+static int cpuSharedEcsPrune(void);
+static bool cpuSharedEcsAlive(u32 pid);
+#if CcCoSim == 1
+static void cpuCoSimSave(CpWord *word);
+static bool cpuCoSimCompare(CpuContext *fast, char *what);
+static void cpuCoSimReport(CpuContext *before, CpuContext *fast, char *what);
+#endif
 
 static void cpOp00(void);
 static void cpOp01(void);
@@ -112,6 +244,13 @@ static void cpOp04(void);
 static void cpOp05(void);
 static void cpOp06(void);
 static void cpOp07(void);
+ForceInline void cpOp01Model(ModelFeatures mf);
+ForceInline void cpOp02Model(ModelFeatures mf);
+ForceInline void cpOp03Model(ModelFeatures mf);
+ForceInline void cpOp04Model(ModelFeatures mf);
+ForceInline void cpOp05Model(ModelFeatures mf);
+ForceInline void cpOp06Model(ModelFeatures mf);
+ForceInline void cpOp07Model(ModelFeatures mf);
 static void cpOp10(void);
 static void cpOp11(void);
 static void cpOp12(void);
@@ -177,10 +316,14 @@ static void cpOp77(void);
 CpWord *cpMem;
 CpWord *extMem;
 u32 ecsFlagRegister;
-CpuContext cpu;
-bool cpuStopped = TRUE;
+CpuContext *cpus;
+u8 cpuCount = 1;
+ThreadLocal CpuContext *activeCpu;
 u32 cpuMaxMemory;
 u32 extMaxMemory;
+#if CcCoSim == 1
+u32 cpuCoSimInterval = 1;
+#endif
 
 /*
 **  -----------------
@@ -189,29 +332,90 @@ u32 extMaxMemory;
 */
 static FILE *cmHandle;
 static FILE *ecsHandle;
-static u8 opOffset;
-static CpWord opWord;
-static u8 opFm;
-static u8 opI;
-static u8 opJ;
-static u8 opK;
-static u8 opLength;
-static u32 opAddress;
-static u32 oldRegP;
-static CpWord acc60;
-static u32 acc18;
-static u32 acc21;
-static u32 acc24;
-static bool floatException = FALSE;
+
+/*
+**  The ECS flag register is either the local one or the one in the
+**  header of a shared ECS segment.
+*/
+static volatile u32 *ecsFlags = &ecsFlagRegister;
+static EcsShared *ecsShared = NULL;
+static size_t ecsSharedSize;
+static bool ecsSharedCreator = FALSE;
+static u32 ecsSharedPid;
+static int ecsSharedSlot;
+#if defined(_WIN32)
+static HANDLE ecsMapping;
+#else
+static char ecsSharedPath[80];
+#endif
+
+/*
+**  Decoded fields and intermediate results of the instruction being
+**  executed. Each CPU thread has its own copy.
+*/
+static ThreadLocal u8 opFm;
+static ThreadLocal u8 opI;
+static ThreadLocal u8 opJ;
+static ThreadLocal u8 opK;
+static ThreadLocal u8 opLength;
+static ThreadLocal u32 opAddress;
+static ThreadLocal u32 oldRegP;
+static ThreadLocal CpWord acc60;
+static ThreadLocal u32 acc18;
+static ThreadLocal u32 acc24;
+static ThreadLocal bool floatException = FALSE;
 
 static int debugCount = 0;
 
-#if CcSMM_EJT
-static int skipStep = 0;
+/*
+**  Width of the RA adder, resolved once for the configured model so that
+**  address relocation does not test the model on every memory access.
+*/
+static u32 raMask = Mask18;
+static u32 raOverflow = Overflow18;
+
+/*
+**  Co-simulation state. Only a single CPU, run by the main thread, is
+**  co-simulated.
+*/
+#if CcCoSim == 1
+static bool coSimJournaling = FALSE;
+static bool coSimReference = FALSE;
+static bool coSimUnchecked;
+static int coSimPass;
+static CoSimWrite coSimJournal[2][CoSimMaxWrites];
+static int coSimWrites[2];
+static CoSimOp coSimOps[CoSimMaxOps];
+static int coSimOpCount;
+static u32 coSimCount = 0;
+static u32 coSimDivergences = 0;
+static FILE *coSimF = NULL;
 #endif
 
 /*
-**  Opcode decode and dispatch table.
+**  With more than one CPU each runs in its own thread. The CPU mutex is
+**  held while a CPU executes a batch of instructions so a PP can exchange
+**  it between batches. A thread waiting for the mutex counts itself in
+**  waiters, which ends the current batch early and makes the CPU thread
+**  stand back until the waiter has the mutex. The interlock mutex
+**  serialises entry into monitor mode between the CPUs.
+*/
+#if defined(_WIN32)
+static struct CacheAligned { CRITICAL_SECTION mutex; volatile u32 waiters; } cpuMutex[MaxCpus];
+static CRITICAL_SECTION cpuInterlockMutex;
+#else
+static struct CacheAligned { pthread_mutex_t mutex; volatile u32 waiters; } cpuMutex[MaxCpus];
+static pthread_mutex_t cpuInterlockMutex;
+#endif
+
+/*
+**  Instruction loop of the configured model.
+*/
+static void (*cpuStepVariant)(void);
+
+/*
+**  Opcode decode and dispatch table. The entries of opcodes 01 to 07 are
+**  replaced by those of the configured model.
 */
 static OpDispatch decodeCpuOpcode[] =
     {
@@ -299,18 +503,46 @@ static u8 cpOp01Length[8] = { 30, 30, 30, 30, 15, 15, 15, 15 };
 **                  model       CPU model string
 **                  memory      configured central memory
 **                  emBanks     configured number of extended memory banks
+**                  emType      type of extended memory
+**                  numCpus     number of CPUs
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
+void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType, u8 numCpus)
     {
     u32 extBanksSize;
+    u8 i;
+
+    /*
+    **  Use the CPU core compiled for the model.
+    */
+    cpuSelectCore(modelType);
+
+    /*
+    **  Allocate CPU contexts. The main thread drives CPU 0 unless the
+    **  CPUs get their own threads.
+    */
+    cpus = memAllocAligned(numCpus * sizeof(CpuContext));
+    if (cpus == NULL)
+        {
+        fprintf(stderr, "Failed to allocate CPU context\n");
+        exit(1);
+        }
+
+    for (i = 0; i < numCpus; i++)
+        {
+        cpus[i].id = i;
+        cpus[i].isStopped = TRUE;
+        }
+
+    cpuCount = numCpus;
+    activeCpu = cpus;
 
     /*
     **  Allocate configured central memory.
     */
-    cpMem = calloc(memory, sizeof(CpWord));
+    cpMem = memAlloc((size_t)memory * sizeof(CpWord), "CM");
     if (cpMem == NULL)
         {
         fprintf(stderr, "Failed to allocate CPU memory\n");
@@ -319,6 +551,20 @@ void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
 
     cpuMaxMemory = memory;
 
+    /*
+    **  Select the RA adder width of this model.
+    */
+    if ((features & IsSeries800) != 0)
+        {
+        raMask = Mask21;
+        raOverflow = Overflow21;
+        }
+    else
+        {
+        raMask = Mask18;
+        raOverflow = Overflow18;
+        }
+
     switch (emType)
         {
     case ECS:
@@ -331,16 +577,23 @@ void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
         }
 
     /*
-    **  Allocate configured ECS memory.
+    **  Allocate configured ECS memory, optionally shared with other
+    **  emulators.
     */
-    extMem = calloc(emBanks * extBanksSize, sizeof(CpWord));
-    if (extMem == NULL)
+    extMaxMemory = emBanks * extBanksSize;
+    if (*ecsSharedName != '\0')
         {
-        fprintf(stderr, "Failed to allocate ECS memory\n");
-        exit(1);
+        cpuSharedEcsAttach((size_t)extMaxMemory * sizeof(CpWord));
+        }
+    else if (extMaxMemory != 0)
+        {
+        extMem = memAlloc((size_t)extMaxMemory * sizeof(CpWord), "ECS");
+        if (extMem == NULL)
+            {
+            fprintf(stderr, "Failed to allocate ECS memory\n");
+            exit(1);
+            }
         }
-
-    extMaxMemory = emBanks * extBanksSize;
 
     /*
     **  Optionally read in persistent CM and ECS contents.
@@ -388,9 +641,10 @@ void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
         if (ecsHandle != NULL)
             {
             /*
-            **  Read ECS contents.
+            **  Read ECS contents unless another emulator already did.
             */
-            if (fread(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
+            if (   (ecsShared == NULL || ecsSharedCreator)
+                && fread(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
                 {
                 printf("Unexpected length of ECS backing file, clearing ECS\n");
                 memset(extMem, 0, extMaxMemory);
@@ -410,10 +664,41 @@ void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
             }
         }
 
+    /*
+    **  Let other emulators attach to a newly created shared ECS.
+    */
+    if (ecsShared != NULL && ecsSharedCreator)
+        {
+        ecsShared->words = extMaxMemory;
+        (void)AtomicCas32(&ecsShared->magic, 0, EcsSharedMagic);
+        }
+
+    /*
+    **  Start a thread for each CPU in a multiprocessor.
+    */
+    if (cpuCount > 1)
+        {
+    #if defined(_WIN32)
+        InitializeCriticalSection(&cpuInterlockMutex);
+    #else
+        pthread_mutex_init(&cpuInterlockMutex, NULL);
+    #endif
+
+        for (i = 0; i < cpuCount; i++)
+            {
+        #if defined(_WIN32)
+            InitializeCriticalSection(&cpuMutex[i].mutex);
+        #else
+            pthread_mutex_init(&cpuMutex[i].mutex, NULL);
+        #endif
+            cpuCreateThread(cpus + i);
+            }
+        }
+
     /*
     **  Print a friendly message.
     */
-    printf("CPU model %s initialised (CM: %o, ECS: %o)\n", model, cpuMaxMemory, extMaxMemory);
+    printf("CPU model %s initialised (CPUs: %d, CM: %o, ECS: %o)\n", model, cpuCount, cpuMaxMemory, extMaxMemory);
     }
 
 /*--------------------------------------------------------------------------
@@ -426,6 +711,19 @@ void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType)
 **------------------------------------------------------------------------*/
 void cpuTerminate(void)
     {
+    bool lastUser;
+    u8 i;
+
+    /*
+    **  Wait for the CPU threads to finish their current batch. Once
+    **  released at the end they see that emulation has ended and exit
+    **  without executing another instruction.
+    */
+    for (i = 0; i < cpuCount; i++)
+        {
+        cpuLock(cpus + i);
+        }
+
     /*
     **  Optionally save CM.
     */
@@ -441,14 +739,19 @@ void cpuTerminate(void)
         }
 
     /*
-    **  Optionally save ECS.
+    **  Optionally save ECS. Shared ECS is saved by the last emulator
+    **  which detaches from it.
     */
+    lastUser = ecsShared == NULL || cpuSharedEcsDetach();
     if (ecsHandle != NULL)
         {
-        fseek(ecsHandle, 0, SEEK_SET);
-        if (fwrite(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
+        if (lastUser)
             {
-            fprintf(stderr, "Error writing ECS backing file\n");
+            fseek(ecsHandle, 0, SEEK_SET);
+            if (fwrite(extMem, sizeof(CpWord), extMaxMemory, ecsHandle) != extMaxMemory)
+                {
+                fprintf(stderr, "Error writing ECS backing file\n");
+                }
             }
 
         fclose(ecsHandle);
@@ -457,8 +760,25 @@ void cpuTerminate(void)
     /*
     **  Free allocated memory.
     */
-    free(cpMem);
-    free(extMem);
+    memFree(cpMem, (size_t)cpuMaxMemory * sizeof(CpWord));
+    if (ecsShared != NULL)
+        {
+    #if defined(_WIN32)
+        UnmapViewOfFile(ecsShared);
+        CloseHandle(ecsMapping);
+    #else
+        munmap(ecsShared, ecsSharedSize);
+    #endif
+        }
+    else
+        {
+        memFree(extMem, (size_t)extMaxMemory * sizeof(CpWord));
+        }
+
+    for (i = 0; i < cpuCount; i++)
+        {
+        cpuUnlock(cpus + i);
+        }
     }
 
 /*--------------------------------------------------------------------------
@@ -471,7 +791,7 @@ void cpuTerminate(void)
 **------------------------------------------------------------------------*/
 u32 cpuGetP(void)
     {
-    return((cpu.regP) & Mask18);
+    return((activeCpu->regP) & Mask18);
     }
 
 /*--------------------------------------------------------------------------
@@ -500,7 +820,10 @@ void cpuPpReadMem(u32 address, CpWord *data)
         }
     else
         {
-        address %= cpuMaxMemory;
+        if (address >= cpuMaxMemory)
+            {
+            address %= cpuMaxMemory;
+            }
         *data = cpMem[address] & Mask60;
         }
     }
@@ -527,7 +850,10 @@ void cpuPpWriteMem(u32 address, CpWord data)
         }
     else
         {
-        address %= cpuMaxMemory;
+        if (address >= cpuMaxMemory)
+            {
+            address %= cpuMaxMemory;
+            }
         cpMem[address] = data & Mask60;
         }
     }
@@ -549,13 +875,13 @@ bool cpuExchangeJump(u32 addr)
     /*
     **  Only perform exchange jump on instruction boundary or when stopped.
     */
-    if (opOffset != 60 && !cpuStopped)
+    if (activeCpu->opOffset != 60 && !activeCpu->isStopped)
         {
         return(FALSE);
         }
 
 #if CcDebug == 1
-    traceExchange(&cpu, addr, "Old");
+    traceExchange(activeCpu, addr, "Old");
 #endif
 
     /*
@@ -574,87 +900,92 @@ bool cpuExchangeJump(u32 addr)
         return(TRUE);
         }
 
+#if CcCoSim == 1
+    coSimUnchecked = TRUE;
+#endif
+
     /*
     **  Save current context.
     */
-    tmp = cpu;
+    tmp = *activeCpu;
 
     /*
     **  Setup new context.
     */
     mem = cpMem + addr;
 
-    cpu.regP     = (u32)((*mem >> 36) & Mask18);
-    cpu.regA[0]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[0]  = 0;
+    activeCpu->regP     = (u32)((*mem >> 36) & Mask18);
+    activeCpu->regA[0]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[0]  = 0;
 
     mem += 1;
-    cpu.regRaCm  = (u32)((*mem >> 36) & Mask24);
-    cpu.regA[1]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[1]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regRaCm  = (u32)((*mem >> 36) & Mask24);
+    activeCpu->regA[1]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[1]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
-    cpu.regFlCm  = (u32)((*mem >> 36) & Mask24);
-    cpu.regA[2]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[2]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regFlCm  = (u32)((*mem >> 36) & Mask24);
+    activeCpu->regA[2]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[2]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
-    cpu.exitMode = (u32)((*mem >> 36) & Mask24);
-    cpu.regA[3]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[3]  = (u32)((*mem      ) & Mask18);
+    activeCpu->exitMode = (u32)((*mem >> 36) & Mask24);
+    activeCpu->regA[3]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[3]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
     if (   (features & IsSeries800) != 0
-        && (cpu.exitMode & EmFlagExpandedAddress) != 0)
+        && (activeCpu->exitMode & EmFlagExpandedAddress) != 0)
         {
-        cpu.regRaEcs = (u32)((*mem >> 30) & Mask30Ecs);
+        activeCpu->regRaEcs = (u32)((*mem >> 30) & Mask30Ecs);
         }
     else
         {
-        cpu.regRaEcs = (u32)((*mem >> 36) & Mask24Ecs);
+        activeCpu->regRaEcs = (u32)((*mem >> 36) & Mask24Ecs);
         }
 
-    cpu.regA[4]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[4]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regA[4]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[4]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
     if (   (features & IsSeries800) != 0
-        && (cpu.exitMode & EmFlagExpandedAddress) != 0)
+        && (activeCpu->exitMode & EmFlagExpandedAddress) != 0)
         {
-        cpu.regFlEcs = (u32)((*mem >> 30) & Mask30Ecs);
+        activeCpu->regFlEcs = (u32)((*mem >> 30) & Mask30Ecs);
         }
     else
         {
-        cpu.regFlEcs = (u32)((*mem >> 36) & Mask24Ecs);
+        activeCpu->regFlEcs = (u32)((*mem >> 36) & Mask24Ecs);
         }
 
-    cpu.regA[5]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[5]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regA[5]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[5]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
-    cpu.regMa    = (u32)((*mem >> 36) & Mask24);
-    cpu.regA[6]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[6]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regMa    = (u32)((*mem >> 36) & Mask24);
+    activeCpu->regA[6]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[6]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
-    cpu.regSpare = (u32)((*mem >> 36) & Mask24);
-    cpu.regA[7]  = (u32)((*mem >> 18) & Mask18);
-    cpu.regB[7]  = (u32)((*mem      ) & Mask18);
+    activeCpu->regSpare = (u32)((*mem >> 36) & Mask24);
+    activeCpu->regA[7]  = (u32)((*mem >> 18) & Mask18);
+    activeCpu->regB[7]  = (u32)((*mem      ) & Mask18);
 
     mem += 1;
-    cpu.regX[0]  = *mem++ & Mask60;
-    cpu.regX[1]  = *mem++ & Mask60;
-    cpu.regX[2]  = *mem++ & Mask60;
-    cpu.regX[3]  = *mem++ & Mask60;
-    cpu.regX[4]  = *mem++ & Mask60;
-    cpu.regX[5]  = *mem++ & Mask60;
-    cpu.regX[6]  = *mem++ & Mask60;
-    cpu.regX[7]  = *mem++ & Mask60;
-
-    cpu.exitCondition = EcNone;
+    activeCpu->regX[0]  = *mem++ & Mask60;
+    activeCpu->regX[1]  = *mem++ & Mask60;
+    activeCpu->regX[2]  = *mem++ & Mask60;
+    activeCpu->regX[3]  = *mem++ & Mask60;
+    activeCpu->regX[4]  = *mem++ & Mask60;
+    activeCpu->regX[5]  = *mem++ & Mask60;
+    activeCpu->regX[6]  = *mem++ & Mask60;
+    activeCpu->regX[7]  = *mem++ & Mask60;
+
+    activeCpu->exitCondition = EcNone;
+    cpuSetField();
 
 #if CcDebug == 1
-    traceExchange(&cpu, addr, "New");
+    traceExchange(activeCpu, addr, "New");
 #endif
 
     /*
@@ -706,17 +1037,24 @@ bool cpuExchangeJump(u32 addr)
         cpuVoidIwStack(~0);
         }
 
+    /*
+    **  Account the CPU to the new exchange package.
+    */
+    cpuStatsExchange(activeCpu, addr);
+
     /*
     **  Activate CPU.
     */
-    cpuStopped = FALSE;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->isStopped = FALSE;
+    activeCpu->monitorPending = FALSE;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
 
     return(TRUE);
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Execute next instruction in the CPU.
+**  Purpose:        Execute next instruction in the CPU, using the core
+**                  compiled for the configured model.
 **
 **  Parameters:     Name        Description.
 **
@@ -725,104 +1063,110 @@ bool cpuExchangeJump(u32 addr)
 **------------------------------------------------------------------------*/
 void cpuStep(void)
     {
-    if (cpuStopped)
+    cpuStepVariant();
+    }
+
+#if CcCoSim == 1
+/*--------------------------------------------------------------------------
+**  Purpose:        Execute next instruction word in the CPU with the fast
+**                  paths and verify the result against the reference
+**                  implementation.
+**
+**                  Every cpuCoSimInterval words the word is executed with
+**                  the job field fast paths, the stores are undone and it
+**                  is executed again with all addresses checked and
+**                  relocated the long way. The CPU context and the CM
+**                  words stored by either run must be identical. The
+**                  result of the reference run is kept.
+**
+**                  Words which exchange, stop the CPU, access ECS/UEM or
+**                  read the clock can't be repeated and are only executed
+**                  once.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuCoSimStep(void)
+    {
+    CpuContext before;
+    CpuContext fast;
+    bool beforeFloatException;
+    char what[120];
+    int i;
+
+    if (   cpuCoSimInterval == 0
+        || activeCpu->isStopped
+        || activeCpu->skipStep != 0
+        || ++coSimCount < cpuCoSimInterval)
         {
+        cpuStep();
         return;
         }
 
-#if CcSMM_EJT
-    if (skipStep != 0)
+    coSimCount = 0;
+    before = *activeCpu;
+    beforeFloatException = floatException;
+
+    /*
+    **  Fast run.
+    */
+    coSimUnchecked = FALSE;
+    coSimWrites[0] = 0;
+    coSimWrites[1] = 0;
+    coSimOpCount = 0;
+    coSimPass = 0;
+    coSimJournaling = TRUE;
+    cpuStep();
+    coSimJournaling = FALSE;
+
+    if (   coSimUnchecked
+        || activeCpu->isStopped
+        || activeCpu->monitorMode != before.monitorMode
+        || activeCpu->regRaCm != before.regRaCm
+        || activeCpu->regFlCm != before.regFlCm)
         {
-        skipStep -= 1;
         return;
         }
-#endif
 
     /*
-    **  Execute one CM word atomically.
+    **  Undo the stores in reverse order and restore the context.
     */
-    do
+    fast = *activeCpu;
+    for (i = 0; i < coSimWrites[0]; i++)
         {
-        /*
-        **  Decode based on type.
-        */
-        opFm = (u8)((opWord >> (opOffset -  6)) & Mask6);
-        opI  = (u8)((opWord >> (opOffset -  9)) & Mask3);
-        opJ  = (u8)((opWord >> (opOffset - 12)) & Mask3);
-        opLength = decodeCpuOpcode[opFm].length;
-
-        if (opLength == 0)
-            {
-            opLength = cpOp01Length[opI];
-            }
-
-        if (opLength == 15)
-            {
-            opK       = (u8)((opWord >> (opOffset - 15)) & Mask3);
-            opAddress = 0;
-
-            opOffset -= 15;
-            }
-        else
-            {
-            if (opOffset == 15)
-                {
-                /*
-                **  Invalid packing is handled as illegal instruction.
-                */
-                cpuOpIllegal();
-                return;
-                }
-
-            opK       = 0;
-            opAddress = (u32)((opWord >> (opOffset - 30)) & Mask18);
-
-            opOffset -= 30;
-            }
-
-        oldRegP = cpu.regP;
-
-        /*
-        **  Force B0 to 0.
-        */
-        cpu.regB[0] = 0;
+        coSimJournal[0][i].fast = *coSimJournal[0][i].word;
+        }
 
-        /*
-        **  Execute instruction.
-        */
-        decodeCpuOpcode[opFm].execute();
+    for (i = coSimWrites[0] - 1; i >= 0; i--)
+        {
+        *coSimJournal[0][i].word = coSimJournal[0][i].old;
+        }
 
-        /*
-        **  Force B0 to 0.
-        */
-        cpu.regB[0] = 0;
+    *activeCpu = before;
+    floatException = beforeFloatException;
 
-#if CcDebug == 1
-        traceCpu(oldRegP, opFm, opI, opJ, opK, opAddress);
-#endif
+    /*
+    **  Reference run.
+    */
+    coSimOpCount = 0;
+    coSimPass = 1;
+    coSimReference = TRUE;
+    cpuSetField();
+    coSimJournaling = TRUE;
+    cpuStep();
+    coSimJournaling = FALSE;
+    coSimReference = FALSE;
+    cpuSetField();
 
-        if (cpuStopped)
-            {
-            if (opOffset == 0)
-                {
-                cpu.regP = (cpu.regP + 1) & Mask18;
-                }
-#if CcDebug == 1
-            traceCpuPrint("Stopped\n");
+    if (cpuCoSimCompare(&fast, what))
+        {
+        cpuCoSimReport(&before, &fast, what);
+        }
+    }
 #endif
-            return;
-            }
 
-        /*
-        **  Fetch next instruction word if necessary.
-        */
-        if (opOffset == 0)
-            {
-            cpu.regP = (cpu.regP + 1) & Mask18;
-            cpuFetchOpWord(cpu.regP, &opWord);
-            }
-        } while (opOffset != 60);
-    }
 
 /*--------------------------------------------------------------------------
 **  Purpose:        Perform ECS flag register operation.
@@ -837,73 +1181,154 @@ bool cpuEcsFlagRegister(u32 ecsAddress)
     {
     u32 flagFunction = (ecsAddress >> 21) & Mask3;
     u32 flagWord = ecsAddress & Mask18;
+    u32 oldFlags;
+    u32 newFlags;
 
-    switch (flagFunction)
+    /*
+    **  The test and the update must be one operation for all CPUs and PPs,
+    **  including those of other emulators sharing ECS, so the new value is
+    **  only stored if the register did not change in the meantime.
+    */
+    do
         {
-    case 4:
-        /*
-        **  Ready/Select.
-        */
-        if ((ecsFlagRegister & flagWord ) != 0)
+        oldFlags = *ecsFlags;
+
+        switch (flagFunction)
             {
+        case 4:
             /*
-            **  Error exit.
+            **  Ready/Select.
             */
-            return(FALSE);
-            }
+            if ((oldFlags & flagWord) != 0)
+                {
+                /*
+                **  Error exit.
+                */
+                return(FALSE);
+                }
 
-        ecsFlagRegister |= flagWord;
-        break;
+            newFlags = oldFlags | flagWord;
+            break;
 
-    case 5:
-        /*
-        **  Selective set.
-        */
-        ecsFlagRegister |= flagWord;
-        break;
+        case 5:
+            /*
+            **  Selective set.
+            */
+            newFlags = oldFlags | flagWord;
+            break;
 
-    case 6:
-        /*
-        **  Status.
-        */
-        if ((ecsFlagRegister & flagWord ) != 0)
-            {
+        case 6:
             /*
-            **  Error exit.
+            **  Status.
             */
-            return(FALSE);
+            return((oldFlags & flagWord) == 0);
+
+        case 7:
+            /*
+            **  Selective clear,
+            */
+            newFlags = (oldFlags & ~flagWord) & Mask18;
+            break;
+
+        default:
+            return(TRUE);
             }
+        } while (!AtomicCas32(ecsFlags, oldFlags, newFlags));
 
-        break;
+    return(TRUE);
+    }
 
-    case 7:
-        /*
-        **  Selective clear,
-        */
-        ecsFlagRegister = (ecsFlagRegister & ~flagWord) & Mask18;
-        break;
-        }
+/*--------------------------------------------------------------------------
+**  Purpose:        Exchange jump a CPU on request of a PP (EXN).
+**
+**  Parameters:     Name        Description.
+**                  cpuNum      CPU number
+**                  addr        Exchange jump address.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuPpExchangeJump(u8 cpuNum, u32 addr)
+    {
+    CpuContext *savedCpu = activeCpu;
+
+    activeCpu = cpus + cpuNum;
+    cpuLock(activeCpu);
 
     /*
-    **  Normal exit.
+    **  Perform the exchange, but wait until the last parcel of the
+    **  current instruction word has been executed.
     */
-    return(TRUE);
+    while (!cpuExchangeJump(addr))
+        {
+        cpuStep();
+        }
+
+    cpuUnlock(activeCpu);
+    activeCpu = savedCpu;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Exchange jump a CPU into monitor mode on request of a
+**                  PP (MXN or MAN).
+**
+**                  Only one CPU may be in monitor mode at a time, so the
+**                  request is passed if any CPU is in monitor mode.
+**                  Otherwise the selected CPU is exchanged.
+**
+**  Parameters:     Name        Description.
+**                  cpuNum      CPU number
+**                  addr        Exchange jump address (MXN).
+**                  useMa       TRUE to exchange to the CPU's monitor
+**                              address (MAN), FALSE to use addr.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuPpMonitorExchangeJump(u8 cpuNum, u32 addr, bool useMa)
+    {
+    CpuContext *savedCpu = activeCpu;
+
+    activeCpu = cpus + cpuNum;
+    cpuLock(activeCpu);
+
+    if (!activeCpu->monitorMode && cpuEnterMonitor())
+        {
+        if (useMa)
+            {
+            addr = activeCpu->regMa & Mask18;
+            }
+
+        while (!cpuExchangeJump(addr))
+            {
+            cpuStep();
+            }
+        }
+
+    cpuUnlock(activeCpu);
+    activeCpu = savedCpu;
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Transfer on 60 bit word to/from DDP/ECS.
+**  Purpose:        Transfer a block of 60 bit words to/from DDP/ECS.
 **
 **  Parameters:     Name        Description.
-**                  ecsAddress  ECS word address
-**                  data        Pointer to 60 bit word
+**                  ecsAddress  ECS word address of first word
+**                  data        Pointer to buffer of 60 bit words
+**                  count       number of words to transfer
 **                  writeToEcs  TRUE if this is a write to ECS, FALSE if
 **                              this is a read.
 **
-**  Returns:        TRUE if accepted, FALSE otherwise.
+**  Returns:        Number of words transferred. The transfer stops short
+**                  at the end of ECS, so fewer than count words means the
+**                  word following the last one transferred is rejected.
 **
 **------------------------------------------------------------------------*/
-bool cpuDdpTransfer(u32 ecsAddress, CpWord *data, bool writeToEcs)
+u32 cpuDdpBlockTransfer(u32 ecsAddress, CpWord *data, u32 count, bool writeToEcs)
     {
+    CpWord *ecsPtr;
+    u32 i;
+
     /*
     **  Normal (non flag-register) access must be within ECS boundaries.
     */
@@ -912,25 +1337,105 @@ bool cpuDdpTransfer(u32 ecsAddress, CpWord *data, bool writeToEcs)
         /*
         **  Abort.
         */
-        return(FALSE);
+        return(0);
+        }
+
+    if (count > extMaxMemory - ecsAddress)
+        {
+        count = extMaxMemory - ecsAddress;
         }
 
     /*
     **  Perform the transfer.
     */
+    ecsPtr = extMem + ecsAddress;
     if (writeToEcs)
         {
-        extMem[ecsAddress] = *data & Mask60;
+        for (i = 0; i < count; i++)
+            {
+            ecsPtr[i] = data[i] & Mask60;
+            }
         }
     else
         {
-        *data = extMem[ecsAddress] & Mask60;
+        for (i = 0; i < count; i++)
+            {
+            data[i] = ecsPtr[i] & Mask60;
+            }
         }
 
-    /*
-    **  Normal accept.
-    */
-    return(TRUE);
+    return(count);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hold or release the CPU threads of a multiprocessor
+**                  between their instruction batches.
+**
+**  Parameters:     Name        Description.
+**                  hold        TRUE to hold, FALSE to release
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuHold(bool hold)
+    {
+    u8 i;
+
+    for (i = 0; i < cpuCount; i++)
+        {
+        if (hold)
+            {
+            cpuLock(cpus + i);
+            }
+        else
+            {
+            cpuUnlock(cpus + i);
+            }
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take a consistent copy of the context of a CPU.
+**
+**                  The copy of a multiprocessor CPU is taken between its
+**                  instruction batches.
+**
+**  Parameters:     Name        Description.
+**                  cpuNum      CPU number
+**                  copy        receives the context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuSample(u8 cpuNum, CpuContext *copy)
+    {
+    CpuContext *cc = cpus + cpuNum;
+
+    cpuLock(cc);
+    *copy = *cc;
+    cpuUnlock(cc);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Restart the CPUs in a cloned emulator process, which
+**                  only inherits the main thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuClone(void)
+    {
+    u8 i;
+
+    if (cpuCount > 1)
+        {
+        for (i = 0; i < cpuCount; i++)
+            {
+            cpuCreateThread(cpus + i);
+            }
+        }
     }
 
 /*
@@ -951,22 +1456,155 @@ bool cpuDdpTransfer(u32 ecsAddress, CpWord *data, bool writeToEcs)
 **------------------------------------------------------------------------*/
 static void cpuOpIllegal(void)
     {
-    cpuStopped = TRUE;
-    if (cpu.regRaCm < cpuMaxMemory)
+    activeCpu->isStopped = TRUE;
+    if (activeCpu->regRaCm < cpuMaxMemory)
         {
-        cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+        cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
         }
 
-    cpu.regP = 0;
+    activeCpu->regP = 0;
 
-    if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+    if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
         {
         /*
         **  Exchange jump to MA.
         */
-        cpu.monitorMode = TRUE;
-        cpuExchangeJump(cpu.regMa);
+        cpuExchangeToMonitor();
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Execute next instruction in the CPU.
+**
+**  Parameters:     Name        Description.
+**                  mf          features of the model compiled for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+ForceInline void cpuStepModel(ModelFeatures mf)
+    {
+    if (activeCpu->isStopped)
+        {
+        /*
+        **  A CPU which had to wait for the other CPU to leave monitor mode
+        **  retries its exchange jump to MA.
+        */
+        if (activeCpu->monitorPending && cpuEnterMonitor())
+            {
+            activeCpu->monitorPending = FALSE;
+            cpuExchangeJump(activeCpu->regMa);
+            }
+
+        return;
+        }
+
+#if CcSMM_EJT
+    if (activeCpu->skipStep != 0)
+        {
+        activeCpu->skipStep -= 1;
+        return;
         }
+#endif
+
+    /*
+    **  Execute one CM word atomically.
+    */
+    do
+        {
+        /*
+        **  Decode based on type.
+        */
+        opFm = (u8)((activeCpu->opWord >> (activeCpu->opOffset -  6)) & Mask6);
+        opI  = (u8)((activeCpu->opWord >> (activeCpu->opOffset -  9)) & Mask3);
+        opJ  = (u8)((activeCpu->opWord >> (activeCpu->opOffset - 12)) & Mask3);
+        opLength = decodeCpuOpcode[opFm].length;
+        activeCpu->instructions += 1;
+
+        if (opLength == 0)
+            {
+            opLength = cpOp01Length[opI];
+            }
+
+        if (opLength == 15)
+            {
+            opK       = (u8)((activeCpu->opWord >> (activeCpu->opOffset - 15)) & Mask3);
+            opAddress = 0;
+
+            activeCpu->opOffset -= 15;
+            }
+        else
+            {
+            if (activeCpu->opOffset == 15)
+                {
+                /*
+                **  Invalid packing is handled as illegal instruction.
+                */
+                cpuOpIllegal();
+                return;
+                }
+
+            opK       = 0;
+            opAddress = (u32)((activeCpu->opWord >> (activeCpu->opOffset - 30)) & Mask18);
+
+            activeCpu->opOffset -= 30;
+            }
+
+        oldRegP = activeCpu->regP;
+
+        /*
+        **  Force B0 to 0.
+        */
+        activeCpu->regB[0] = 0;
+
+        /*
+        **  Execute instruction.
+        */
+        decodeCpuOpcode[opFm].execute();
+
+        /*
+        **  Force B0 to 0.
+        */
+        activeCpu->regB[0] = 0;
+
+#if CcDebug == 1
+        traceCpu(oldRegP, opFm, opI, opJ, opK, opAddress);
+#endif
+
+#if CcCoSim == 1
+        if (coSimJournaling && coSimOpCount < CoSimMaxOps)
+            {
+            coSimOps[coSimOpCount].p = oldRegP;
+            coSimOps[coSimOpCount].opFm = opFm;
+            coSimOps[coSimOpCount].opI = opI;
+            coSimOps[coSimOpCount].opJ = opJ;
+            coSimOps[coSimOpCount].opK = opK;
+            coSimOps[coSimOpCount].opAddress = opAddress;
+            coSimOpCount += 1;
+            }
+#endif
+
+        if (activeCpu->isStopped)
+            {
+            if (activeCpu->opOffset == 0 && !activeCpu->monitorPending)
+                {
+                activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+                }
+#if CcDebug == 1
+            traceCpuPrint("Stopped\n");
+#endif
+            return;
+            }
+
+        /*
+        **  Fetch next instruction word if necessary.
+        */
+        if (activeCpu->opOffset == 0)
+            {
+            activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+            cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
+            }
+        } while (activeCpu->opOffset != 60);
     }
 
 /*--------------------------------------------------------------------------
@@ -975,43 +1613,49 @@ static void cpuOpIllegal(void)
 **  Parameters:     Name        Description.
 **                  address     RA relative address to read.
 **                  location    Pointer to u32 which will contain absolute address.
+**                  mf          features of the model compiled for
 **
 **  Returns:        TRUE if validation failed, FALSE otherwise;
 **
 **------------------------------------------------------------------------*/
-static bool cpuCheckOpAddress(u32 address, u32 *location)
+ForceInline bool cpuCheckOpAddressModel(u32 address, u32 *location, ModelFeatures mf)
     {
+    if (address < activeCpu->fieldLength)
+        {
+        *location = activeCpu->regRaCm + address;
+        return(FALSE);
+        }
+
     /*
     **  Calculate absolute address.
     */
     *location = cpuAddRa(address);
     
-    if (address >= cpu.regFlCm || (*location >= cpuMaxMemory && (features & HasNoCmWrap) != 0))
+    if (address >= activeCpu->regFlCm || (*location >= cpuMaxMemory && ModelHas(mf, HasNoCmWrap)))
         {
         /*
         **  Exit mode is always selected for RNI or branch.
         */
-        cpuStopped = TRUE;
+        activeCpu->isStopped = TRUE;
 
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if (cpu.regRaCm < cpuMaxMemory)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if (activeCpu->regRaCm < cpuMaxMemory)
             {
             // not need for RNI or branch - how about other uses?
-            if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+            if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP) << 30);
                 }
             }
 
-        cpu.regP = 0;
+        activeCpu->regP = 0;
     
-        if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+        if (!ModelHas(mf, HasNoCejMej | IsSeries6x00) && !activeCpu->monitorMode)
             {
             /*
             **  Exchange jump to MA.
             */
-            cpu.monitorMode = TRUE;
-            cpuExchangeJump(cpu.regMa);
+            cpuExchangeToMonitor();
             }
 
         return(TRUE);
@@ -1020,7 +1664,10 @@ static bool cpuCheckOpAddress(u32 address, u32 *location)
     /*
     **  Calculate absolute address with wraparound.
     */
-    *location %= cpuMaxMemory;
+    if (*location >= cpuMaxMemory)
+        {
+        *location %= cpuMaxMemory;
+        }
     
     return(FALSE);
     }
@@ -1032,20 +1679,21 @@ static bool cpuCheckOpAddress(u32 address, u32 *location)
 **  Parameters:     Name        Description.
 **                  address     RA relative address to read.
 **                  data        Pointer to 60 bit word which gets the data.
+**                  mf          features of the model compiled for
 **
 **  Returns:        Nothing.
 **
 **------------------------------------------------------------------------*/
-static void cpuFetchOpWord(u32 address, CpWord *data)
+ForceInline void cpuFetchOpWordModel(u32 address, CpWord *data, ModelFeatures mf)
     {
     u32 location;
 
-    if (cpuCheckOpAddress(address, &location))
+    if (cpuCheckOpAddressModel(address, &location, mf))
         {
         return;
         }
 
-    if ((features & HasInstructionStack) != 0)
+    if (ModelHas(mf, HasInstructionStack))
         {
         int i;
 
@@ -1055,9 +1703,9 @@ static void cpuFetchOpWord(u32 address, CpWord *data)
         */
         for (i = 0; i < MaxIwStack; i++)
             {
-            if (cpu.iwValid[i] && cpu.iwAddress[i] == location)
+            if (activeCpu->iwValid[i] && activeCpu->iwAddress[i] == location)
                 {
-                *data = cpu.iwStack[i];
+                *data = activeCpu->iwStack[i];
                 break;
                 }
             }
@@ -1067,14 +1715,14 @@ static void cpuFetchOpWord(u32 address, CpWord *data)
             /*
             **  No hit, fetch the instruction from CM and enter it into the stack.
             */
-            cpu.iwRank = (cpu.iwRank + 1) % MaxIwStack;
-            cpu.iwAddress[cpu.iwRank] = location;
-            cpu.iwStack[cpu.iwRank] = cpMem[location] & Mask60;
-            cpu.iwValid[cpu.iwRank] = TRUE;
-            *data = cpu.iwStack[cpu.iwRank];
+            activeCpu->iwRank = activeCpu->iwRank + 1 < MaxIwStack ? activeCpu->iwRank + 1 : 0;
+            activeCpu->iwAddress[activeCpu->iwRank] = location;
+            activeCpu->iwStack[activeCpu->iwRank] = cpMem[location] & Mask60;
+            activeCpu->iwValid[activeCpu->iwRank] = TRUE;
+            *data = activeCpu->iwStack[activeCpu->iwRank];
             }
 
-        if ((features & HasIStackPrefetch) != 0 && (i == MaxIwStack || i == cpu.iwRank))
+        if (ModelHas(mf, HasIStackPrefetch) && (i == MaxIwStack || i == activeCpu->iwRank))
             {
 #if 0
             /*
@@ -1083,30 +1731,30 @@ static void cpuFetchOpWord(u32 address, CpWord *data)
             for (i = 2; i > 0; i--)
                 {
                 address += 1;
-                if (cpuCheckOpAddress(address, &location))
+                if (cpuCheckOpAddressModel(address, &location, mf))
                     {
                     return;
                     }
 
-                cpu.iwRank = (cpu.iwRank + 1) % MaxIwStack;
-                cpu.iwAddress[cpu.iwRank] = location;
-                cpu.iwStack[cpu.iwRank] = cpMem[location] & Mask60;
-                cpu.iwValid[cpu.iwRank] = TRUE;
+                activeCpu->iwRank = activeCpu->iwRank + 1 < MaxIwStack ? activeCpu->iwRank + 1 : 0;
+                activeCpu->iwAddress[activeCpu->iwRank] = location;
+                activeCpu->iwStack[activeCpu->iwRank] = cpMem[location] & Mask60;
+                activeCpu->iwValid[activeCpu->iwRank] = TRUE;
                 }
 #else
             /*
             **  Prefetch one instruction word.
             */
             address += 1;
-            if (cpuCheckOpAddress(address, &location))
+            if (cpuCheckOpAddressModel(address, &location, mf))
                 {
                 return;
                 }
 
-            cpu.iwRank = (cpu.iwRank + 1) % MaxIwStack;
-            cpu.iwAddress[cpu.iwRank] = location;
-            cpu.iwStack[cpu.iwRank] = cpMem[location] & Mask60;
-            cpu.iwValid[cpu.iwRank] = TRUE;
+            activeCpu->iwRank = activeCpu->iwRank + 1 < MaxIwStack ? activeCpu->iwRank + 1 : 0;
+            activeCpu->iwAddress[activeCpu->iwRank] = location;
+            activeCpu->iwStack[activeCpu->iwRank] = cpMem[location] & Mask60;
+            activeCpu->iwValid[activeCpu->iwRank] = TRUE;
 #endif
             }
         }
@@ -1118,11 +1766,27 @@ static void cpuFetchOpWord(u32 address, CpWord *data)
         *data = cpMem[location] & Mask60;
         }
 
-    opOffset = 60;
+    activeCpu->opOffset = 60;
 
     return;
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Read CPU instruction word outside of the model
+**                  specific code.
+**
+**  Parameters:     Name        Description.
+**                  address     RA relative address to read.
+**                  data        Pointer to 60 bit word which gets the data.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuFetchOpWord(u32 address, CpWord *data)
+    {
+    cpuFetchOpWordModel(address, data, features);
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Void the instruction stack unless branch target is
 **                  within stack (or unconditionally if address is ~0).
@@ -1145,7 +1809,7 @@ static void cpuVoidIwStack(u32 branchAddr)
 
         for (i = 0; i < MaxIwStack; i++)
             {
-            if (cpu.iwValid[i] && cpu.iwAddress[i] == location)
+            if (activeCpu->iwValid[i] && activeCpu->iwAddress[i] == location)
                 {
                 /*
                 **  Branch target is within stack - do nothing.
@@ -1160,10 +1824,10 @@ static void cpuVoidIwStack(u32 branchAddr)
     */
     for (i = 0; i < MaxIwStack; i++)
         {
-        cpu.iwValid[i] = FALSE;
+        activeCpu->iwValid[i] = FALSE;
         }
 
-    cpu.iwRank = 0;
+    activeCpu->iwRank = 0;
     }
 
 /*--------------------------------------------------------------------------
@@ -1180,28 +1844,37 @@ static bool cpuReadMem(u32 address, CpWord *data)
     {
     u32 location;
 
-    if (address >= cpu.regFlCm)
+    /*
+    **  Fast path for addresses within the job's field.
+    */
+    if (address < activeCpu->fieldLength)
+        {
+        *data = activeCpu->fieldCm[address] & Mask60;
+        return(FALSE);
+        }
+
+    if (address >= activeCpu->regFlCm)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
+        activeCpu->exitCondition |= EcAddressOutOfRange;
 
         /*
         **  Clear the data.
         */
         *data = 0;
 
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
             if ((features & IsSeries170) == 0)
                 {
@@ -1211,13 +1884,12 @@ static bool cpuReadMem(u32 address, CpWord *data)
                 *data = 0;
                 }
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return(TRUE);
@@ -1267,31 +1939,40 @@ static bool cpuWriteMem(u32 address, CpWord *data)
     {
     u32 location;
 
-    if (address >= cpu.regFlCm)
+    /*
+    **  Fast path for addresses within the job's field.
+    */
+    if (address < activeCpu->fieldLength)
+        {
+        CoSimSave(activeCpu->fieldCm + address);
+        activeCpu->fieldCm[address] = *data & Mask60;
+        return(FALSE);
+        }
+
+    if (address >= activeCpu->regFlCm)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
+        activeCpu->exitCondition |= EcAddressOutOfRange;
 
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return(TRUE);
@@ -1321,6 +2002,7 @@ static bool cpuWriteMem(u32 address, CpWord *data)
     /*
     **  Store the data.
     */
+    CoSimSave(cpMem + location);
     cpMem[location] = *data & Mask60;
 
     return(FALSE);
@@ -1346,14 +2028,14 @@ static void cpuRegASemantics(void)
         /*
         **  Read semantics.
         */
-        cpuReadMem(cpu.regA[opI], cpu.regX + opI);
+        cpuReadMem(activeCpu->regA[opI], activeCpu->regX + opI);
         }
     else
         {
         /*
         **  Write semantics.
         */
-        if ((cpu.exitMode & EmFlagStackPurge) != 0)
+        if ((activeCpu->exitMode & EmFlagStackPurge) != 0)
             {
             /*
             **  Instruction stack purge flag is set - do an
@@ -1362,7 +2044,7 @@ static void cpuRegASemantics(void)
             cpuVoidIwStack(~0);
             }
 
-        cpuWriteMem(cpu.regA[opI], cpu.regX + opI);
+        cpuWriteMem(activeCpu->regA[opI], activeCpu->regX + opI);
         }
     }
 
@@ -1378,24 +2060,59 @@ static void cpuRegASemantics(void)
 **------------------------------------------------------------------------*/
 static u32 cpuAddRa(u32 op)
     {
-    if ((features & IsSeries800) != 0)
+    u32 acc;
+
+    acc = (activeCpu->regRaCm & raMask) - (~op & raMask);
+    if ((acc & raOverflow) != 0)
+        {
+        acc -= 1;
+        }
+
+    return(acc & raMask);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set up the host view of the job's field after RA or FL
+**                  have changed.
+**
+**                  The window covers the RA relative addresses which are
+**                  below FL, lie within configured memory and which the
+**                  RA adder maps to RA plus address, so accesses within
+**                  it need neither the FL check nor relocation.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuSetField(void)
+    {
+    u32 ra = activeCpu->regRaCm;
+    u32 length = 0;
+
+    if (ra < raMask && ra < cpuMaxMemory)
         {
-        acc21 = (cpu.regRaCm & Mask21) - (~op & Mask21);
-        if ((acc21 & Overflow21) != 0)
+        length = raMask - ra;
+        if (length > cpuMaxMemory - ra)
             {
-            acc21 -= 1;
+            length = cpuMaxMemory - ra;
             }
 
-        return(acc21 & Mask21);
+        if (length > activeCpu->regFlCm)
+            {
+            length = activeCpu->regFlCm;
+            }
         }
 
-    acc18 = (cpu.regRaCm & Mask18) - (~op & Mask18);
-    if ((acc18 & Overflow18) != 0)
+#if CcCoSim == 1
+    if (coSimReference)
         {
-        acc18 -= 1;
+        length = 0;
         }
+#endif
 
-    return(acc18 & Mask18);
+    activeCpu->fieldCm = cpMem + (ra < cpuMaxMemory ? ra : 0);
+    activeCpu->fieldLength = length;
     }
 
 /*--------------------------------------------------------------------------
@@ -1478,35 +2195,34 @@ static void cpuUemWord(bool writeToUem)
     /*
     **  Calculate source or destination addresses.
     */
-    uemAddress = (u32)(cpu.regX[opK] & Mask24);
+    uemAddress = (u32)(activeCpu->regX[opK] & Mask24);
 
     /*
     **  Check for UEM range.
     */
-    if (cpu.regFlEcs <= uemAddress)
+    if (activeCpu->regFlEcs <= uemAddress)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
 
@@ -1516,7 +2232,7 @@ static void cpuUemWord(bool writeToUem)
     /*
     **  Add base address.
     */
-    uemAddress += cpu.regRaEcs;
+    uemAddress += activeCpu->regRaEcs;
 
     /*
     **  Perform the transfer.
@@ -1525,7 +2241,7 @@ static void cpuUemWord(bool writeToUem)
         {
         if (uemAddress < cpuMaxMemory && (uemAddress & (3 << 21)) == 0)
             {
-            cpMem[uemAddress++] = cpu.regX[opJ] & Mask60;
+            cpMem[uemAddress++] = activeCpu->regX[opJ] & Mask60;
             }
         }
     else
@@ -1535,11 +2251,11 @@ static void cpuUemWord(bool writeToUem)
             /*
             **  If bits 21 or 22 are non-zero, zero Xj.
             */
-            cpu.regX[opJ] = 0;
+            activeCpu->regX[opJ] = 0;
             }
         else
             {
-            cpu.regX[opJ] = cpMem[uemAddress] & Mask60;
+            activeCpu->regX[opJ] = cpMem[uemAddress] & Mask60;
             }
         }
     }
@@ -1567,35 +2283,34 @@ static void cpuEcsWord(bool writeToEcs)
         return;
         }
 
-    ecsAddress = (u32)(cpu.regX[opK] & Mask24);
+    ecsAddress = (u32)(activeCpu->regX[opK] & Mask24);
 
     /*
     **  Check for ECS range.
     */
-    if (cpu.regFlEcs <= ecsAddress)
+    if (activeCpu->regFlEcs <= ecsAddress)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
 
@@ -1605,7 +2320,7 @@ static void cpuEcsWord(bool writeToEcs)
     /*
     **  Add base address.
     */
-    ecsAddress += cpu.regRaEcs;
+    ecsAddress += activeCpu->regRaEcs;
 
     /*
     **  Perform the transfer.
@@ -1614,7 +2329,7 @@ static void cpuEcsWord(bool writeToEcs)
         {
         if (ecsAddress < extMaxMemory)
             {
-            extMem[ecsAddress++] = cpu.regX[opJ] & Mask60;
+            extMem[ecsAddress++] = activeCpu->regX[opJ] & Mask60;
             }
         }
     else
@@ -1624,11 +2339,11 @@ static void cpuEcsWord(bool writeToEcs)
             /*
             **  Zero Xj.
             */
-            cpu.regX[opJ] = 0;
+            activeCpu->regX[opJ] = 0;
             }
         else
             {
-            cpu.regX[opJ] = extMem[ecsAddress++] & Mask60;
+            activeCpu->regX[opJ] = extMem[ecsAddress++] & Mask60;
             }
         }
     }
@@ -1652,7 +2367,7 @@ static void cpuUemTransfer(bool writeToUem)
     /*
     **  Instruction must be located in the upper 30 bits.
     */
-    if (opOffset != 30)
+    if (activeCpu->opOffset != 30)
         {
         cpuOpIllegal();
         return;
@@ -1661,16 +2376,16 @@ static void cpuUemTransfer(bool writeToUem)
     /*
     **  Calculate word count, source and destination addresses.
     */
-    wordCount = cpuAdd18(cpu.regB[opJ], opAddress);
-    uemAddress = (u32)(cpu.regX[0] & Mask30);
+    wordCount = cpuAdd18(activeCpu->regB[opJ], opAddress);
+    uemAddress = (u32)(activeCpu->regX[0] & Mask30);
 
-    if ((cpu.exitMode & EmFlagEnhancedBlockCopy) != 0)
+    if ((activeCpu->exitMode & EmFlagEnhancedBlockCopy) != 0)
         {
-        cmAddress = (u32)((cpu.regX[0] >> 30) & Mask21);
+        cmAddress = (u32)((activeCpu->regX[0] >> 30) & Mask21);
         }
     else
         {
-        cmAddress = cpu.regA[0] & Mask18;
+        cmAddress = activeCpu->regA[0] & Mask18;
         }
 
     /*
@@ -1685,37 +2400,36 @@ static void cpuUemTransfer(bool writeToUem)
     **  Check for positive word count, CM and UEM range.
     */
     if (   (wordCount & Sign18) != 0
-        || cpu.regFlCm  < cmAddress  + wordCount
-        || cpu.regFlEcs < uemAddress + wordCount)
+        || activeCpu->regFlCm  < cmAddress  + wordCount
+        || activeCpu->regFlEcs < uemAddress + wordCount)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
         else
             {
-            cpu.regP = (cpu.regP + 1) & Mask18;
-            cpuFetchOpWord(cpu.regP, &opWord);
+            activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+            cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
             }
 
         return;
@@ -1725,9 +2439,12 @@ static void cpuUemTransfer(bool writeToUem)
     **  Add base addresses.
     */
     cmAddress = cpuAddRa(cmAddress);
-    cmAddress %= cpuMaxMemory;
+    if (cmAddress >= cpuMaxMemory)
+        {
+        cmAddress %= cpuMaxMemory;
+        }
 
-    uemAddress += cpu.regRaEcs;
+    uemAddress += activeCpu->regRaEcs;
 
     /*
     **  Perform the transfer.
@@ -1751,7 +2468,10 @@ static void cpuUemTransfer(bool writeToUem)
             **  Increment CM address.
             */
             cmAddress = cpuAdd24(cmAddress, 1);
-            cmAddress %= cpuMaxMemory;
+            if (cmAddress >= cpuMaxMemory)
+                {
+                cmAddress %= cpuMaxMemory;
+                }
             }
         }
     else
@@ -1781,7 +2501,10 @@ static void cpuUemTransfer(bool writeToUem)
             **  Increment CM address.
             */
             cmAddress = cpuAdd24(cmAddress, 1);
-            cmAddress %= cpuMaxMemory;
+            if (cmAddress >= cpuMaxMemory)
+                {
+                cmAddress %= cpuMaxMemory;
+                }
             }
 
         if (takeErrorExit)
@@ -1796,8 +2519,8 @@ static void cpuUemTransfer(bool writeToUem)
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -1819,7 +2542,7 @@ static void cpuEcsTransfer(bool writeToEcs)
     /*
     **  ECS must exist and instruction must be located in the upper 30 bits.
     */
-    if (extMaxMemory == 0 || opOffset != 30)
+    if (extMaxMemory == 0 || activeCpu->opOffset != 30)
         {
         cpuOpIllegal();
         return;
@@ -1828,16 +2551,16 @@ static void cpuEcsTransfer(bool writeToEcs)
     /*
     **  Calculate word count, source and destination addresses.
     */
-    wordCount = cpuAdd18(cpu.regB[opJ], opAddress);
-    ecsAddress = (u32)(cpu.regX[0] & Mask24);
+    wordCount = cpuAdd18(activeCpu->regB[opJ], opAddress);
+    ecsAddress = (u32)(activeCpu->regX[0] & Mask24);
 
-    if ((cpu.exitMode & EmFlagEnhancedBlockCopy) != 0)
+    if ((activeCpu->exitMode & EmFlagEnhancedBlockCopy) != 0)
         {
-        cmAddress = (u32)((cpu.regX[0] >> 30) & Mask24);
+        cmAddress = (u32)((activeCpu->regX[0] >> 30) & Mask24);
         }
     else
         {
-        cmAddress = cpu.regA[0] & Mask18;
+        cmAddress = activeCpu->regA[0] & Mask18;
         }
 
     /*
@@ -1849,7 +2572,7 @@ static void cpuEcsTransfer(bool writeToEcs)
     **  Note that the ECS RA is NOT added to the relative address.
     */
     if (   (ecsAddress   & ((u32)1 << 23)) != 0
-        && (cpu.regFlEcs & ((u32)1 << 23)) != 0)
+        && (activeCpu->regFlEcs & ((u32)1 << 23)) != 0)
         {
         if (!cpuEcsFlagRegister(ecsAddress))
             {
@@ -1859,8 +2582,8 @@ static void cpuEcsTransfer(bool writeToEcs)
         /*
         **  Normal exit.
         */
-        cpu.regP = (cpu.regP + 1) & Mask18;
-        cpuFetchOpWord(cpu.regP, &opWord);
+        activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+        cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
         return;
         }
 
@@ -1876,37 +2599,36 @@ static void cpuEcsTransfer(bool writeToEcs)
     **  Check for positive word count, CM and ECS range.
     */
     if (   (wordCount & Sign18) != 0
-        || cpu.regFlCm  < cmAddress  + wordCount
-        || cpu.regFlEcs < ecsAddress + wordCount)
+        || activeCpu->regFlCm  < cmAddress  + wordCount
+        || activeCpu->regFlEcs < ecsAddress + wordCount)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
         else
             {
-            cpu.regP = (cpu.regP + 1) & Mask18;
-            cpuFetchOpWord(cpu.regP, &opWord);
+            activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+            cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
             }
 
         return;
@@ -1916,9 +2638,12 @@ static void cpuEcsTransfer(bool writeToEcs)
     **  Add base addresses.
     */
     cmAddress = cpuAddRa(cmAddress);
-    cmAddress %= cpuMaxMemory;
+    if (cmAddress >= cpuMaxMemory)
+        {
+        cmAddress %= cpuMaxMemory;
+        }
 
-    ecsAddress += cpu.regRaEcs;
+    ecsAddress += activeCpu->regRaEcs;
 
     /*
     **  Perform the transfer.
@@ -1941,7 +2666,10 @@ static void cpuEcsTransfer(bool writeToEcs)
             **  Increment CM address.
             */
             cmAddress = cpuAdd24(cmAddress, 1);
-            cmAddress %= cpuMaxMemory;
+            if (cmAddress >= cpuMaxMemory)
+                {
+                cmAddress %= cpuMaxMemory;
+                }
             }
         }
     else
@@ -1967,7 +2695,10 @@ static void cpuEcsTransfer(bool writeToEcs)
             **  Increment CM address.
             */
             cmAddress = cpuAdd24(cmAddress, 1);
-            cmAddress %= cpuMaxMemory;
+            if (cmAddress >= cpuMaxMemory)
+                {
+                cmAddress %= cpuMaxMemory;
+                }
             }
 
         if (takeErrorExit)
@@ -1982,8 +2713,8 @@ static void cpuEcsTransfer(bool writeToEcs)
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -2005,30 +2736,29 @@ static bool cpuCmuGetByte(u32 address, u32 pos, u8 *byte)
     /*
     **  Validate access.
     */
-    if (address >= cpu.regFlCm || cpu.regRaCm + address >= cpuMaxMemory)
+    if (address >= activeCpu->regFlCm || activeCpu->regRaCm + address >= cpuMaxMemory)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
 
@@ -2039,7 +2769,10 @@ static bool cpuCmuGetByte(u32 address, u32 pos, u8 *byte)
     **  Calculate absolute address with wraparound.
     */
     location = cpuAddRa(address);
-    location %= cpuMaxMemory;
+    if (location >= cpuMaxMemory)
+        {
+        location %= cpuMaxMemory;
+        }
 
     /*
     **  Fetch the word.
@@ -2073,30 +2806,29 @@ static bool cpuCmuPutByte(u32 address, u32 pos, u8 byte)
     /*
     **  Validate access.
     */
-    if (address >= cpu.regFlCm || cpu.regRaCm + address >= cpuMaxMemory)
+    if (address >= activeCpu->regFlCm || activeCpu->regRaCm + address >= cpuMaxMemory)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
 
@@ -2107,7 +2839,10 @@ static bool cpuCmuPutByte(u32 address, u32 pos, u8 byte)
     **  Calculate absolute address with wraparound.
     */
     location = cpuAddRa(address);
-    location %= cpuMaxMemory;
+    if (location >= cpuMaxMemory)
+        {
+        location %= cpuMaxMemory;
+        }
 
     /*
     **  Fetch the word.
@@ -2127,6 +2862,7 @@ static bool cpuCmuPutByte(u32 address, u32 pos, u8 byte)
     /*
     **  Store the word.
     */
+    CoSimSave(cpMem + location);
     cpMem[location] = data & Mask60;
 
     return(FALSE);
@@ -2154,8 +2890,8 @@ static void cpuCmuMoveIndirect(void)
     /*
     **  Fetch the descriptor word.
     */
-    opAddress = (u32)((opWord >> 30) & Mask18);
-    opAddress = cpuAdd18(cpu.regB[opJ], opAddress);
+    opAddress = (u32)((activeCpu->opWord >> 30) & Mask18);
+    opAddress = cpuAdd18(activeCpu->regB[opJ], opAddress);
     failed = cpuReadMem(opAddress, &descWord);
     if (failed)
         {
@@ -2176,28 +2912,27 @@ static void cpuCmuMoveIndirect(void)
     */
     if (c1 > 9 || c2 > 9)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return;
@@ -2220,7 +2955,7 @@ static void cpuCmuMoveIndirect(void)
         if (   cpuCmuGetByte(k1, c1, &byte)
             || cpuCmuPutByte(k2, c2, byte))
             {
-            if (cpuStopped) //????????????????????????
+            if (activeCpu->isStopped) //????????????????????????
                 {
                 return;
                 }
@@ -2250,13 +2985,13 @@ static void cpuCmuMoveIndirect(void)
     /*
     **  Clear register X0 after the move.
     */
-    cpu.regX[0] = 0;
+    activeCpu->regX[0] = 0;
 
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -2279,39 +3014,38 @@ static void cpuCmuMoveDirect(void)
     /*
     **  Decode opcode word.
     */
-    k1 = (u32)(opWord >> 30) & Mask18;
-    k2 = (u32)(opWord >>  0) & Mask18;
-    c1 = (u32)(opWord >> 22) & Mask4;
-    c2 = (u32)(opWord >> 18) & Mask4;
-    ll = (u32)((opWord >> 26) & Mask4) | (u32)((opWord >> (48 - 4)) & (Mask3 << 4));
+    k1 = (u32)(activeCpu->opWord >> 30) & Mask18;
+    k2 = (u32)(activeCpu->opWord >>  0) & Mask18;
+    c1 = (u32)(activeCpu->opWord >> 22) & Mask4;
+    c2 = (u32)(activeCpu->opWord >> 18) & Mask4;
+    ll = (u32)((activeCpu->opWord >> 26) & Mask4) | (u32)((activeCpu->opWord >> (48 - 4)) & (Mask3 << 4));
 
     /*
     **  Check for address out of range.
     */
     if (c1 > 9 || c2 > 9)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return;
@@ -2334,7 +3068,7 @@ static void cpuCmuMoveDirect(void)
         if (   cpuCmuGetByte(k1, c1, &byte)
             || cpuCmuPutByte(k2, c2, byte))
             {
-            if (cpuStopped) //?????????????????????
+            if (activeCpu->isStopped) //?????????????????????
                 {
                 return;
                 }
@@ -2364,13 +3098,13 @@ static void cpuCmuMoveDirect(void)
     /*
     **  Clear register X0 after the move.
     */
-    cpu.regX[0] = 0;
+    activeCpu->regX[0] = 0;
 
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -2393,44 +3127,43 @@ static void cpuCmuCompareCollated(void)
     /*
     **  Decode opcode word.
     */
-    k1 = (u32)(opWord >> 30) & Mask18;
-    k2 = (u32)(opWord >>  0) & Mask18;
-    c1 = (u32)(opWord >> 22) & Mask4;
-    c2 = (u32)(opWord >> 18) & Mask4;
-    ll = (u32)((opWord >> 26) & Mask4) | (u32)((opWord >> (48 - 4)) & (Mask3 << 4));
+    k1 = (u32)(activeCpu->opWord >> 30) & Mask18;
+    k2 = (u32)(activeCpu->opWord >>  0) & Mask18;
+    c1 = (u32)(activeCpu->opWord >> 22) & Mask4;
+    c2 = (u32)(activeCpu->opWord >> 18) & Mask4;
+    ll = (u32)((activeCpu->opWord >> 26) & Mask4) | (u32)((activeCpu->opWord >> (48 - 4)) & (Mask3 << 4));
 
     /*
     **  Setup collating table.
     */
-    collTable = cpu.regA[0];
+    collTable = activeCpu->regA[0];
 
     /*
     **  Check for addresses and collTable out of range.
     */
-    if (c1 > 9 || c2 > 9 || collTable >= cpu.regFlCm || cpu.regRaCm + collTable >= cpuMaxMemory)
+    if (c1 > 9 || c2 > 9 || collTable >= activeCpu->regFlCm || activeCpu->regRaCm + collTable >= cpuMaxMemory)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return;
@@ -2453,7 +3186,7 @@ static void cpuCmuCompareCollated(void)
         if (   cpuCmuGetByte(k1, c1, &byte1)
             || cpuCmuGetByte(k2, c2, &byte2))
             {
-            if (cpuStopped) //?????????????????????
+            if (activeCpu->isStopped) //?????????????????????
                 {
                 return;
                 }
@@ -2472,7 +3205,7 @@ static void cpuCmuCompareCollated(void)
             if (   cpuCmuGetByte(collTable + ((byte1 >> 3) & Mask3), byte1 & Mask3, &byte1)
                 || cpuCmuGetByte(collTable + ((byte2 >> 3) & Mask3), byte2 & Mask3, &byte2))
                 {
-                if (cpuStopped) //??????????????????????
+                if (activeCpu->isStopped) //??????????????????????
                     {
                     return;
                     }
@@ -2518,13 +3251,13 @@ static void cpuCmuCompareCollated(void)
     /*
     **  Store result in X0.
     */
-    cpu.regX[0] = result;
+    activeCpu->regX[0] = result;
 
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -2546,39 +3279,38 @@ static void cpuCmuCompareUncollated(void)
     /*
     **  Decode opcode word.
     */
-    k1 = (u32)(opWord >> 30) & Mask18;
-    k2 = (u32)(opWord >>  0) & Mask18;
-    c1 = (u32)(opWord >> 22) & Mask4;
-    c2 = (u32)(opWord >> 18) & Mask4;
-    ll = (u32)((opWord >> 26) & Mask4) | (u32)((opWord >> (48 - 4)) & (Mask3 << 4));
+    k1 = (u32)(activeCpu->opWord >> 30) & Mask18;
+    k2 = (u32)(activeCpu->opWord >>  0) & Mask18;
+    c1 = (u32)(activeCpu->opWord >> 22) & Mask4;
+    c2 = (u32)(activeCpu->opWord >> 18) & Mask4;
+    ll = (u32)((activeCpu->opWord >> 26) & Mask4) | (u32)((activeCpu->opWord >> (48 - 4)) & (Mask3 << 4));
 
     /*
     **  Check for address out of range.
     */
     if (c1 > 9 || c2 > 9)
         {
-        cpu.exitCondition |= EcAddressOutOfRange;
-        if ((cpu.exitMode & EmAddressOutOfRange) != 0)
+        activeCpu->exitCondition |= EcAddressOutOfRange;
+        if ((activeCpu->exitMode & EmAddressOutOfRange) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
 
             return;
@@ -2601,7 +3333,7 @@ static void cpuCmuCompareUncollated(void)
         if (   cpuCmuGetByte(k1, c1, &byte1)
             || cpuCmuGetByte(k2, c2, &byte2))
             {
-            if (cpuStopped) //?????????????????
+            if (activeCpu->isStopped) //?????????????????
                 {
                 return;
                 }
@@ -2646,13 +3378,13 @@ static void cpuCmuCompareUncollated(void)
     /*
     **  Store result in X0.
     */
-    cpu.regX[0] = result;
+    activeCpu->regX[0] = result;
 
     /*
     **  Normal exit to next instruction word.
     */
-    cpu.regP = (cpu.regP + 1) & Mask18;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+    cpuFetchOpWord(activeCpu->regP, &activeCpu->opWord);
     }
 
 /*--------------------------------------------------------------------------
@@ -2671,12 +3403,12 @@ static void cpuFloatCheck(CpWord value)
 
     if (exponent == 03777 || exponent == 04000)
         {
-        cpu.exitCondition |= EcOperandOutOfRange;
+        activeCpu->exitCondition |= EcOperandOutOfRange;
         floatException = TRUE;
         }
     else if (exponent == 01777 || exponent == 06000)
         {
-        cpu.exitCondition |= EcIndefiniteOperand;
+        activeCpu->exitCondition |= EcIndefiniteOperand;
         floatException = TRUE;
         }
     }
@@ -2695,27 +3427,26 @@ static void cpuFloatExceptionHandler(void)
         {
         floatException = FALSE;
 
-        if ((cpu.exitMode & (cpu.exitCondition << 12)) != 0)
+        if ((activeCpu->exitMode & (activeCpu->exitCondition << 12)) != 0)
             {
             /*
             **  Exit mode selected.
             */
-            cpuStopped = TRUE;
+            activeCpu->isStopped = TRUE;
 
-            if (cpu.regRaCm < cpuMaxMemory)
+            if (activeCpu->regRaCm < cpuMaxMemory)
                 {
-                cpMem[cpu.regRaCm] = ((CpWord)cpu.exitCondition << 48) | ((CpWord)(cpu.regP + 1) << 30);
+                cpMem[activeCpu->regRaCm] = ((CpWord)activeCpu->exitCondition << 48) | ((CpWord)(activeCpu->regP + 1) << 30);
                 }
 
-            cpu.regP = 0;
+            activeCpu->regP = 0;
 
-            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !cpu.monitorMode)
+            if ((features & (HasNoCejMej | IsSeries6x00)) == 0 && !activeCpu->monitorMode)
                 {
                 /*
                 **  Exchange jump to MA.
                 */
-                cpu.monitorMode = TRUE;
-                cpuExchangeJump(cpu.regMa);
+                cpuExchangeToMonitor();
                 }
             }
         }
@@ -2735,9 +3466,9 @@ static void cpOp00(void)
     /*
     **  PS or Error Exit to MA.
     */
-    if ((features & (HasNoCejMej | IsSeries6x00)) != 0 || cpu.monitorMode)
+    if ((features & (HasNoCejMej | IsSeries6x00)) != 0 || activeCpu->monitorMode)
         {
-        cpuStopped = TRUE;
+        activeCpu->isStopped = TRUE;
         }
     else
         {
@@ -2745,24 +3476,34 @@ static void cpOp00(void)
         }
     }
 
-static void cpOp01(void)
+ForceInline void cpOp01Model(ModelFeatures mf)
     {
+#if CcCoSim == 1
+    /*
+    **  ECS/UEM transfers, exchange jumps and the clock are not repeatable.
+    */
+    if (opI != 0)
+        {
+        coSimUnchecked = TRUE;
+        }
+#endif
+
     switch (opI)
         {
     case 0:
         /*
         **  RJ  K
         */
-        acc60 = ((CpWord)0400 << 48) | ((CpWord)((cpu.regP + 1) & Mask18) << 30);
+        acc60 = ((CpWord)0400 << 48) | ((CpWord)((activeCpu->regP + 1) & Mask18) << 30);
         if (cpuWriteMem(opAddress, &acc60))
             {
             return;
             }
 
-        cpu.regP = opAddress;
-        opOffset = 0;
+        activeCpu->regP = opAddress;
+        activeCpu->opOffset = 0;
 
-        if ((features & HasInstructionStack) != 0)
+        if (ModelHas(mf, HasInstructionStack))
             {
             /*
             **  Void the instruction stack.
@@ -2776,7 +3517,7 @@ static void cpOp01(void)
         /*
         **  REC  Bj+K
         */
-        if ((cpu.exitMode & EmFlagUemEnable) != 0)
+        if ((activeCpu->exitMode & EmFlagUemEnable) != 0)
             {
             cpuUemTransfer(FALSE);
             }
@@ -2785,7 +3526,7 @@ static void cpOp01(void)
             cpuEcsTransfer(FALSE);
             }
 
-        if ((features & HasInstructionStack) != 0)
+        if (ModelHas(mf, HasInstructionStack))
             {
             /*
             **  Void the instruction stack.
@@ -2799,7 +3540,7 @@ static void cpOp01(void)
         /*
         **  WEC  Bj+K
         */
-        if ((cpu.exitMode & EmFlagUemEnable) != 0)
+        if ((activeCpu->exitMode & EmFlagUemEnable) != 0)
             {
             cpuUemTransfer(TRUE);
             }
@@ -2814,7 +3555,7 @@ static void cpOp01(void)
         /*
         **  XJ  K
         */
-        if ((features & HasNoCejMej) != 0 || opOffset != 30)
+        if (ModelHas(mf, HasNoCejMej) || activeCpu->opOffset != 30)
             {
             /*
             **  CEJ/MEJ must be enabled and the instruction must be in parcel 0,
@@ -2824,18 +3565,17 @@ static void cpOp01(void)
             return;
             }
 
-        cpu.regP = (cpu.regP + 1) & Mask18;
-        cpuStopped = TRUE;
+        activeCpu->regP = (activeCpu->regP + 1) & Mask18;
+        activeCpu->isStopped = TRUE;
 
-        if (cpu.monitorMode)
+        if (activeCpu->monitorMode)
             {
-            cpu.monitorMode = FALSE;
-            cpuExchangeJump(opAddress + cpu.regB[opJ]);
+            activeCpu->monitorMode = FALSE;
+            cpuExchangeJump(opAddress + activeCpu->regB[opJ]);
             }
         else
             {
-            cpu.monitorMode = TRUE;
-            cpuExchangeJump(cpu.regMa);
+            cpuExchangeToMonitor();
             }
 
         break;
@@ -2850,7 +3590,7 @@ static void cpOp01(void)
         /*
         **  RXj  Xk
         */
-        if ((cpu.exitMode & EmFlagUemEnable) != 0)
+        if ((activeCpu->exitMode & EmFlagUemEnable) != 0)
             {
             cpuUemWord(FALSE);
             }
@@ -2871,7 +3611,7 @@ static void cpOp01(void)
         /*
         **  WXj  Xk
         */
-        if ((cpu.exitMode & EmFlagUemEnable) != 0)
+        if ((activeCpu->exitMode & EmFlagUemEnable) != 0)
             {
             cpuUemWord(TRUE);
             }
@@ -2883,13 +3623,13 @@ static void cpOp01(void)
         break;
 
     case 6:
-        if ((features & HasMicrosecondClock) != 0)
+        if (ModelHas(mf, HasMicrosecondClock))
             {
             /*
             **  RC  Xj
             */
             rtcReadUsCounter();
-            cpu.regX[opJ] = rtcClock;
+            activeCpu->regX[opJ] = rtcClock;
             }
         else
             {
@@ -2907,14 +3647,19 @@ static void cpOp01(void)
         }
     }
 
-static void cpOp02(void)
+static void cpOp01(void)
+    {
+    cpOp01Model(features);
+    }
+
+ForceInline void cpOp02Model(ModelFeatures mf)
     {
     /*
     **  JP  Bi+K
     */
-    cpu.regP = cpuAdd18(cpu.regB[opI], opAddress);
+    activeCpu->regP = cpuAdd18(activeCpu->regB[opI], opAddress);
 
-    if ((features & HasInstructionStack) != 0)
+    if (ModelHas(mf, HasInstructionStack))
         {
         /*
         **  Void the instruction stack.
@@ -2922,10 +3667,15 @@ static void cpOp02(void)
         cpuVoidIwStack(~0);
         }
 
-    cpuFetchOpWord(cpu.regP, &opWord);
+    cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
     }
 
-static void cpOp03(void)
+static void cpOp02(void)
+    {
+    cpOp02Model(features);
+    }
+
+ForceInline void cpOp03Model(ModelFeatures mf)
     {
     bool jump = FALSE;
 
@@ -2935,35 +3685,35 @@ static void cpOp03(void)
         /*
         **  ZR  Xj K
         */
-        jump = cpu.regX[opJ] == 0 || cpu.regX[opJ] == NegativeZero;
+        jump = activeCpu->regX[opJ] == 0 || activeCpu->regX[opJ] == NegativeZero;
         break;
 
     case 1:
         /*
         **  NZ  Xj K
         */
-        jump = cpu.regX[opJ] != 0 && cpu.regX[opJ] != NegativeZero;
+        jump = activeCpu->regX[opJ] != 0 && activeCpu->regX[opJ] != NegativeZero;
         break;
 
     case 2:
         /*
         **  PL  Xj K
         */
-        jump = (cpu.regX[opJ] & Sign60) == 0;
+        jump = (activeCpu->regX[opJ] & Sign60) == 0;
         break;
 
     case 3:
         /*
         **  NG  Xj K
         */
-        jump = (cpu.regX[opJ] & Sign60) != 0;
+        jump = (activeCpu->regX[opJ] & Sign60) != 0;
         break;
 
     case 4:
         /*
         **  IR  Xj K
         */
-        acc60 = cpu.regX[opJ] >> 48;
+        acc60 = activeCpu->regX[opJ] >> 48;
         jump = acc60 != 03777 && acc60 != 04000;
         break;
 
@@ -2971,7 +3721,7 @@ static void cpOp03(void)
         /*
         **  OR  Xj K
         */
-        acc60 = cpu.regX[opJ] >> 48;
+        acc60 = activeCpu->regX[opJ] >> 48;
         jump = acc60 == 03777 || acc60 == 04000;
         break;
 
@@ -2979,7 +3729,7 @@ static void cpOp03(void)
         /*
         **  DF  Xj K
         */
-        acc60 = cpu.regX[opJ] >> 48;
+        acc60 = activeCpu->regX[opJ] >> 48;
         jump = acc60 != 01777 && acc60 != 06000;
         break;
 
@@ -2987,19 +3737,19 @@ static void cpOp03(void)
         /*
         **  ID  Xj K
         */
-        acc60 = cpu.regX[opJ] >> 48;
+        acc60 = activeCpu->regX[opJ] >> 48;
         jump = acc60 == 01777 || acc60 == 06000;
         break;
         }
 
     if (jump)
         {
-        if ((features & HasInstructionStack) != 0)
+        if (ModelHas(mf, HasInstructionStack))
             {
             /*
             **  Void the instruction stack.
             */
-            if ((cpu.exitMode & EmFlagStackPurge) != 0)
+            if ((activeCpu->exitMode & EmFlagStackPurge) != 0)
                 {
                 /*
                 **  Instruction stack purge flag is set - do an
@@ -3016,19 +3766,24 @@ static void cpOp03(void)
                 }
             }
 
-        cpu.regP = opAddress;
-        cpuFetchOpWord(cpu.regP, &opWord);
+        activeCpu->regP = opAddress;
+        cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
         }
     }
 
-static void cpOp04(void)
+static void cpOp03(void)
+    {
+    cpOp03Model(features);
+    }
+
+ForceInline void cpOp04Model(ModelFeatures mf)
     {
     /*
     **  EQ  Bi Bj K
     */
-    if (cpu.regB[opI] == cpu.regB[opJ])
+    if (activeCpu->regB[opI] == activeCpu->regB[opJ])
         {
-        if ((features & HasInstructionStack) != 0)
+        if (ModelHas(mf, HasInstructionStack))
             {
             /*
             **  Void the instruction stack.
@@ -3036,19 +3791,24 @@ static void cpOp04(void)
             cpuVoidIwStack(opAddress);
             }
 
-        cpu.regP = opAddress;
-        cpuFetchOpWord(cpu.regP, &opWord);
+        activeCpu->regP = opAddress;
+        cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
         }
     }
 
-static void cpOp05(void)
+static void cpOp04(void)
+    {
+    cpOp04Model(features);
+    }
+
+ForceInline void cpOp05Model(ModelFeatures mf)
     {
     /*
     **  NE  Bi Bj K
     */
-    if (cpu.regB[opI] != cpu.regB[opJ])
+    if (activeCpu->regB[opI] != activeCpu->regB[opJ])
         {
-        if ((features & HasInstructionStack) != 0)
+        if (ModelHas(mf, HasInstructionStack))
             {
             /*
             **  Void the instruction stack.
@@ -3056,17 +3816,22 @@ static void cpOp05(void)
             cpuVoidIwStack(opAddress);
             }
 
-        cpu.regP = opAddress;
-        cpuFetchOpWord(cpu.regP, &opWord);
+        activeCpu->regP = opAddress;
+        cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
         }
     }
 
-static void cpOp06(void)
+static void cpOp05(void)
+    {
+    cpOp05Model(features);
+    }
+
+ForceInline void cpOp06Model(ModelFeatures mf)
     {
     /*
     **  GE  Bi Bj K
     */
-    i32 signDiff = (cpu.regB[opI] & Sign18) - (cpu.regB[opJ] & Sign18);
+    i32 signDiff = (activeCpu->regB[opI] & Sign18) - (activeCpu->regB[opJ] & Sign18);
     if (signDiff > 0)
         {
         return;
@@ -3074,7 +3839,7 @@ static void cpOp06(void)
 
     if (signDiff == 0)
         {
-        acc18 = (cpu.regB[opI] & Mask18) - (cpu.regB[opJ] & Mask18);
+        acc18 = (activeCpu->regB[opI] & Mask18) - (activeCpu->regB[opJ] & Mask18);
         if ((acc18 & Overflow18) != 0 && (acc18 & Mask18) != 0)
             {
             acc18 -= 1;
@@ -3086,7 +3851,7 @@ static void cpOp06(void)
             }
         }
 
-    if ((features & HasInstructionStack) != 0)
+    if (ModelHas(mf, HasInstructionStack))
         {
         /*
         **  Void the instruction stack.
@@ -3094,16 +3859,21 @@ static void cpOp06(void)
         cpuVoidIwStack(opAddress);
         }
 
-    cpu.regP = opAddress;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = opAddress;
+    cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
     }
 
-static void cpOp07(void)
+static void cpOp06(void)
+    {
+    cpOp06Model(features);
+    }
+
+ForceInline void cpOp07Model(ModelFeatures mf)
     {
     /*
     **  LT  Bi Bj K
     */
-    i32 signDiff = (cpu.regB[opI] & Sign18) - (cpu.regB[opJ] & Sign18);
+    i32 signDiff = (activeCpu->regB[opI] & Sign18) - (activeCpu->regB[opJ] & Sign18);
     if (signDiff < 0)
         {
         return;
@@ -3111,7 +3881,7 @@ static void cpOp07(void)
 
     if (signDiff == 0)
         {
-        acc18 = (cpu.regB[opI] & Mask18) - (cpu.regB[opJ] & Mask18);
+        acc18 = (activeCpu->regB[opI] & Mask18) - (activeCpu->regB[opJ] & Mask18);
         if ((acc18 & Overflow18) != 0 && (acc18 & Mask18) != 0)
             {
             acc18 -= 1;
@@ -3123,7 +3893,7 @@ static void cpOp07(void)
             }
         }
 
-    if ((features & HasInstructionStack) != 0)
+    if (ModelHas(mf, HasInstructionStack))
         {
         /*
         **  Void the instruction stack.
@@ -3131,8 +3901,13 @@ static void cpOp07(void)
         cpuVoidIwStack(opAddress);
         }
 
-    cpu.regP = opAddress;
-    cpuFetchOpWord(cpu.regP, &opWord);
+    activeCpu->regP = opAddress;
+    cpuFetchOpWordModel(activeCpu->regP, &activeCpu->opWord, mf);
+    }
+
+static void cpOp07(void)
+    {
+    cpOp07Model(features);
     }
 
 static void cpOp10(void)
@@ -3140,7 +3915,7 @@ static void cpOp10(void)
     /*
     **  BXi Xj
     */
-    cpu.regX[opI] = cpu.regX[opJ] & Mask60;
+    activeCpu->regX[opI] = activeCpu->regX[opJ] & Mask60;
     }
 
 static void cpOp11(void)
@@ -3148,7 +3923,7 @@ static void cpOp11(void)
     /*
     **  BXi Xj*Xk
     */
-    cpu.regX[opI] = (cpu.regX[opJ] & cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] & activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp12(void)
@@ -3156,7 +3931,7 @@ static void cpOp12(void)
     /*
     **  BXi Xj+Xk
     */
-    cpu.regX[opI] = (cpu.regX[opJ] | cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] | activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp13(void)
@@ -3164,7 +3939,7 @@ static void cpOp13(void)
     /*
     **  BXi Xj-Xk
     */
-    cpu.regX[opI] = (cpu.regX[opJ] ^ cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] ^ activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp14(void)
@@ -3172,7 +3947,7 @@ static void cpOp14(void)
     /*
     **  BXi -Xj
     */
-    cpu.regX[opI] = ~cpu.regX[opK] & Mask60;
+    activeCpu->regX[opI] = ~activeCpu->regX[opK] & Mask60;
     }
 
 static void cpOp15(void)
@@ -3180,7 +3955,7 @@ static void cpOp15(void)
     /*
     **  BXi -Xk*Xj
     */
-    cpu.regX[opI] = (cpu.regX[opJ] & ~cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] & ~activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp16(void)
@@ -3188,7 +3963,7 @@ static void cpOp16(void)
     /*
     **  BXi -Xk+Xj
     */
-    cpu.regX[opI] = (cpu.regX[opJ] | ~cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] | ~activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp17(void)
@@ -3196,7 +3971,7 @@ static void cpOp17(void)
     /*
     **  BXi -Xk-Xj
     */
-    cpu.regX[opI] = (cpu.regX[opJ] ^ ~cpu.regX[opK]) & Mask60;
+    activeCpu->regX[opI] = (activeCpu->regX[opJ] ^ ~activeCpu->regX[opK]) & Mask60;
     }
 
 static void cpOp20(void)
@@ -3207,7 +3982,7 @@ static void cpOp20(void)
     u8 jk;
 
     jk = (u8)((opJ << 3) | opK);
-    cpu.regX[opI] = shiftLeftCircular(cpu.regX[opI] & Mask60, jk);
+    activeCpu->regX[opI] = shiftLeftCircular(activeCpu->regX[opI] & Mask60, jk);
     }
 
 static void cpOp21(void)
@@ -3218,7 +3993,7 @@ static void cpOp21(void)
     u8 jk;
 
     jk = (u8)((opJ << 3) | opK);
-    cpu.regX[opI] = shiftRightArithmetic(cpu.regX[opI] & Mask60, jk);
+    activeCpu->regX[opI] = shiftRightArithmetic(activeCpu->regX[opI] & Mask60, jk);
     }
 
 static void cpOp22(void)
@@ -3228,13 +4003,13 @@ static void cpOp22(void)
     */
     u32 count;
 
-    count = cpu.regB[opJ] & Mask18;
-    acc60 = cpu.regX[opK] & Mask60;
+    count = activeCpu->regB[opJ] & Mask18;
+    acc60 = activeCpu->regX[opK] & Mask60;
 
     if ((count & Sign18) == 0)
         {
         count &= Mask6;
-        cpu.regX[opI] = shiftLeftCircular(acc60, count);
+        activeCpu->regX[opI] = shiftLeftCircular(acc60, count);
         }
     else
         {
@@ -3242,11 +4017,11 @@ static void cpOp22(void)
         count &= Mask11;
         if ((count & ~Mask6) != 0)
             {
-            cpu.regX[opI] = 0;
+            activeCpu->regX[opI] = 0;
             }
         else
             {
-            cpu.regX[opI] = shiftRightArithmetic(acc60, count);
+            activeCpu->regX[opI] = shiftRightArithmetic(acc60, count);
             }
         }
     }
@@ -3258,26 +4033,26 @@ static void cpOp23(void)
     */
     u32 count;
 
-    count = cpu.regB[opJ] & Mask18;
-    acc60 = cpu.regX[opK] & Mask60;
+    count = activeCpu->regB[opJ] & Mask18;
+    acc60 = activeCpu->regX[opK] & Mask60;
 
     if ((count & Sign18) == 0)
         {
         count &= Mask11;
         if ((count & ~Mask6) != 0)
             {
-            cpu.regX[opI] = 0;
+            activeCpu->regX[opI] = 0;
             }
         else
             {
-            cpu.regX[opI] = shiftRightArithmetic(acc60, count);
+            activeCpu->regX[opI] = shiftRightArithmetic(acc60, count);
             }
         }
     else
         {
         count = ~count;
         count &= Mask6;
-        cpu.regX[opI] = shiftLeftCircular(acc60, count);
+        activeCpu->regX[opI] = shiftLeftCircular(acc60, count);
         }
     }
 
@@ -3286,8 +4061,8 @@ static void cpOp24(void)
     /*
     **  NXi Bj Xk
     */
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = shiftNormalize(cpu.regX[opK], &cpu.regB[opJ], FALSE);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = shiftNormalize(activeCpu->regX[opK], &activeCpu->regB[opJ], FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3296,8 +4071,8 @@ static void cpOp25(void)
     /*
     **  ZXi Bj Xk
     */
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = shiftNormalize(cpu.regX[opK], &cpu.regB[opJ], TRUE);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = shiftNormalize(activeCpu->regX[opK], &activeCpu->regB[opJ], TRUE);
     cpuFloatExceptionHandler();
     }
 
@@ -3308,11 +4083,11 @@ static void cpOp26(void)
     */
     if (opJ == 0)
         {
-        cpu.regX[opI] = shiftUnpack(cpu.regX[opK], NULL);
+        activeCpu->regX[opI] = shiftUnpack(activeCpu->regX[opK], NULL);
         }
     else
         {
-        cpu.regX[opI] = shiftUnpack(cpu.regX[opK], &cpu.regB[opJ]);
+        activeCpu->regX[opI] = shiftUnpack(activeCpu->regX[opK], &activeCpu->regB[opJ]);
         }
     }
 
@@ -3323,11 +4098,11 @@ static void cpOp27(void)
     */
     if (opJ == 0)
         {
-        cpu.regX[opI] = shiftPack(cpu.regX[opK], 0);
+        activeCpu->regX[opI] = shiftPack(activeCpu->regX[opK], 0);
         }
     else
         {
-        cpu.regX[opI] = shiftPack(cpu.regX[opK], cpu.regB[opJ]);
+        activeCpu->regX[opI] = shiftPack(activeCpu->regX[opK], activeCpu->regB[opJ]);
         }
     }
 
@@ -3336,9 +4111,9 @@ static void cpOp30(void)
     /*
     **  FXi Xj+Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], cpu.regX[opK], FALSE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], activeCpu->regX[opK], FALSE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3347,9 +4122,9 @@ static void cpOp31(void)
     /*
     **  FXi Xj-Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], (~cpu.regX[opK] & Mask60), FALSE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], (~activeCpu->regX[opK] & Mask60), FALSE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3358,9 +4133,9 @@ static void cpOp32(void)
     /*
     **  DXi Xj+Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], cpu.regX[opK], FALSE, TRUE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], activeCpu->regX[opK], FALSE, TRUE);
     cpuFloatExceptionHandler();
     }
 
@@ -3369,9 +4144,9 @@ static void cpOp33(void)
     /*
     **  DXi Xj-Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], (~cpu.regX[opK] & Mask60), FALSE, TRUE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], (~activeCpu->regX[opK] & Mask60), FALSE, TRUE);
     cpuFloatExceptionHandler();
     }
 
@@ -3380,9 +4155,9 @@ static void cpOp34(void)
     /*
     **  RXi Xj+Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], cpu.regX[opK], TRUE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], activeCpu->regX[opK], TRUE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3391,9 +4166,9 @@ static void cpOp35(void)
     /*
     **  RXi Xj-Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatAdd(cpu.regX[opJ], (~cpu.regX[opK] & Mask60), TRUE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatAdd(activeCpu->regX[opJ], (~activeCpu->regX[opK] & Mask60), TRUE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3402,13 +4177,13 @@ static void cpOp36(void)
     /*
     **  IXi Xj+Xk
     */
-    acc60 = (cpu.regX[opJ] & Mask60) - (~cpu.regX[opK] & Mask60);
+    acc60 = (activeCpu->regX[opJ] & Mask60) - (~activeCpu->regX[opK] & Mask60);
     if ((acc60 & Overflow60) != 0)
         {
         acc60 -= 1;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp37(void)
@@ -3416,13 +4191,13 @@ static void cpOp37(void)
     /*
     **  IXi Xj-Xk
     */
-    acc60 = (cpu.regX[opJ] & Mask60) - (cpu.regX[opK] & Mask60);
+    acc60 = (activeCpu->regX[opJ] & Mask60) - (activeCpu->regX[opK] & Mask60);
     if ((acc60 & Overflow60) != 0)
         {
         acc60 -= 1;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp40(void)
@@ -3430,9 +4205,9 @@ static void cpOp40(void)
     /*
     **  FXi Xj*Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatMultiply(cpu.regX[opJ], cpu.regX[opK], FALSE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatMultiply(activeCpu->regX[opJ], activeCpu->regX[opK], FALSE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3441,9 +4216,9 @@ static void cpOp41(void)
     /*
     **  RXi Xj*Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatMultiply(cpu.regX[opJ], cpu.regX[opK], TRUE, FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatMultiply(activeCpu->regX[opJ], activeCpu->regX[opK], TRUE, FALSE);
     cpuFloatExceptionHandler();
     }
 
@@ -3452,9 +4227,9 @@ static void cpOp42(void)
     /*
     **  DXi Xj*Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatMultiply(cpu.regX[opJ], cpu.regX[opK], FALSE, TRUE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatMultiply(activeCpu->regX[opJ], activeCpu->regX[opK], FALSE, TRUE);
     cpuFloatExceptionHandler();
     }
 
@@ -3466,7 +4241,7 @@ static void cpOp43(void)
     u8 jk;
 
     jk = (u8)((opJ << 3) | opK);
-    cpu.regX[opI] = shiftMask(jk);
+    activeCpu->regX[opI] = shiftMask(jk);
     }
 
 static void cpOp44(void)
@@ -3474,12 +4249,12 @@ static void cpOp44(void)
     /*
     **  FXi Xj/Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatDivide(cpu.regX[opJ], cpu.regX[opK], FALSE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatDivide(activeCpu->regX[opJ], activeCpu->regX[opK], FALSE);
     cpuFloatExceptionHandler();
 #if CcSMM_EJT
-    skipStep = 20;
+    activeCpu->skipStep = 20;
 #endif
     }
 
@@ -3488,9 +4263,9 @@ static void cpOp45(void)
     /*
     **  RXi Xj/Xk
     */
-    cpuFloatCheck(cpu.regX[opJ]);
-    cpuFloatCheck(cpu.regX[opK]);
-    cpu.regX[opI] = floatDivide(cpu.regX[opJ], cpu.regX[opK], TRUE);
+    cpuFloatCheck(activeCpu->regX[opJ]);
+    cpuFloatCheck(activeCpu->regX[opK]);
+    activeCpu->regX[opI] = floatDivide(activeCpu->regX[opJ], activeCpu->regX[opK], TRUE);
     cpuFloatExceptionHandler();
     }
 
@@ -3514,7 +4289,7 @@ static void cpOp46(void)
             return;
             }
 
-        if (opOffset != 45)
+        if (activeCpu->opOffset != 45)
             {
             if ((features & IsSeries70) == 0)
                 {
@@ -3568,14 +4343,14 @@ static void cpOp47(void)
     /*
     **  CXi Xk
     */
-    acc60 = cpu.regX[opK] & Mask60;
+    acc60 = activeCpu->regX[opK] & Mask60;
     acc60 = ((acc60 & 0xAAAAAAAAAAAAAAAA) >>  1) + (acc60 & 0x5555555555555555);
     acc60 = ((acc60 & 0xCCCCCCCCCCCCCCCC) >>  2) + (acc60 & 0x3333333333333333);
     acc60 = ((acc60 & 0xF0F0F0F0F0F0F0F0) >>  4) + (acc60 & 0x0F0F0F0F0F0F0F0F);
     acc60 = ((acc60 & 0xFF00FF00FF00FF00) >>  8) + (acc60 & 0x00FF00FF00FF00FF);
     acc60 = ((acc60 & 0xFFFF0000FFFF0000) >> 16) + (acc60 & 0x0000FFFF0000FFFF);
     acc60 = ((acc60 & 0xFFFFFFFF00000000) >> 32) + (acc60 & 0x00000000FFFFFFFF);
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp50(void)
@@ -3583,7 +4358,7 @@ static void cpOp50(void)
     /*
     **  SAi Aj+K
     */
-    cpu.regA[opI] = cpuAdd18(cpu.regA[opJ], opAddress);
+    activeCpu->regA[opI] = cpuAdd18(activeCpu->regA[opJ], opAddress);
 
     cpuRegASemantics();
     }
@@ -3593,7 +4368,7 @@ static void cpOp51(void)
     /*
     **  SAi Bj+K
     */
-    cpu.regA[opI] = cpuAdd18(cpu.regB[opJ], opAddress);
+    activeCpu->regA[opI] = cpuAdd18(activeCpu->regB[opJ], opAddress);
 
     cpuRegASemantics();
     }
@@ -3603,7 +4378,7 @@ static void cpOp52(void)
     /*
     **  SAi Xj+K
     */
-    cpu.regA[opI] = cpuAdd18((u32)cpu.regX[opJ], opAddress);
+    activeCpu->regA[opI] = cpuAdd18((u32)activeCpu->regX[opJ], opAddress);
 
     cpuRegASemantics();
     }
@@ -3613,7 +4388,7 @@ static void cpOp53(void)
     /*
     **  SAi Xj+Bk
     */
-    cpu.regA[opI] = cpuAdd18((u32)cpu.regX[opJ], cpu.regB[opK]);
+    activeCpu->regA[opI] = cpuAdd18((u32)activeCpu->regX[opJ], activeCpu->regB[opK]);
 
     cpuRegASemantics();
     }
@@ -3623,7 +4398,7 @@ static void cpOp54(void)
     /*
     **  SAi Aj+Bk
     */
-    cpu.regA[opI] = cpuAdd18(cpu.regA[opJ], cpu.regB[opK]);
+    activeCpu->regA[opI] = cpuAdd18(activeCpu->regA[opJ], activeCpu->regB[opK]);
 
     cpuRegASemantics();
     }
@@ -3633,7 +4408,7 @@ static void cpOp55(void)
     /*
     **  SAi Aj-Bk
     */
-    cpu.regA[opI] = cpuSubtract18(cpu.regA[opJ], cpu.regB[opK]);
+    activeCpu->regA[opI] = cpuSubtract18(activeCpu->regA[opJ], activeCpu->regB[opK]);
 
     cpuRegASemantics();
     }
@@ -3643,7 +4418,7 @@ static void cpOp56(void)
     /*
     **  SAi Bj+Bk
     */
-    cpu.regA[opI] = cpuAdd18(cpu.regB[opJ], cpu.regB[opK]);
+    activeCpu->regA[opI] = cpuAdd18(activeCpu->regB[opJ], activeCpu->regB[opK]);
 
     cpuRegASemantics();
     }
@@ -3653,7 +4428,7 @@ static void cpOp57(void)
     /*
     **  SAi Bj-Bk
     */
-    cpu.regA[opI] = cpuSubtract18(cpu.regB[opJ], cpu.regB[opK]);
+    activeCpu->regA[opI] = cpuSubtract18(activeCpu->regB[opJ], activeCpu->regB[opK]);
 
     cpuRegASemantics();
     }
@@ -3663,7 +4438,7 @@ static void cpOp60(void)
     /*
     **  SBi Aj+K
     */
-    cpu.regB[opI] = cpuAdd18(cpu.regA[opJ], opAddress);
+    activeCpu->regB[opI] = cpuAdd18(activeCpu->regA[opJ], opAddress);
     }
 
 static void cpOp61(void)
@@ -3671,7 +4446,7 @@ static void cpOp61(void)
     /*
     **  SBi Bj+K
     */
-    cpu.regB[opI] = cpuAdd18(cpu.regB[opJ], opAddress);
+    activeCpu->regB[opI] = cpuAdd18(activeCpu->regB[opJ], opAddress);
     }
 
 static void cpOp62(void)
@@ -3679,7 +4454,7 @@ static void cpOp62(void)
     /*
     **  SBi Xj+K
     */
-    cpu.regB[opI] = cpuAdd18((u32)cpu.regX[opJ], opAddress);
+    activeCpu->regB[opI] = cpuAdd18((u32)activeCpu->regX[opJ], opAddress);
     }
 
 static void cpOp63(void)
@@ -3687,7 +4462,7 @@ static void cpOp63(void)
     /*
     **  SBi Xj+Bk
     */
-    cpu.regB[opI] = cpuAdd18((u32)cpu.regX[opJ], cpu.regB[opK]);
+    activeCpu->regB[opI] = cpuAdd18((u32)activeCpu->regX[opJ], activeCpu->regB[opK]);
     }
 
 static void cpOp64(void)
@@ -3695,7 +4470,7 @@ static void cpOp64(void)
     /*
     **  SBi Aj+Bk
     */
-    cpu.regB[opI] = cpuAdd18(cpu.regA[opJ], cpu.regB[opK]);
+    activeCpu->regB[opI] = cpuAdd18(activeCpu->regA[opJ], activeCpu->regB[opK]);
     }
 
 static void cpOp65(void)
@@ -3703,7 +4478,7 @@ static void cpOp65(void)
     /*
     **  SBi Aj-Bk
     */
-    cpu.regB[opI] = cpuSubtract18(cpu.regA[opJ], cpu.regB[opK]);
+    activeCpu->regB[opI] = cpuSubtract18(activeCpu->regA[opJ], activeCpu->regB[opK]);
     }
 
 static void cpOp66(void)
@@ -3713,14 +4488,14 @@ static void cpOp66(void)
         /*
         **  CR Xj,Xk
         */
-        cpuReadMem((u32)(cpu.regX[opK]) & Mask21, cpu.regX + opJ);
+        cpuReadMem((u32)(activeCpu->regX[opK]) & Mask21, activeCpu->regX + opJ);
         return;
         }
 
     /*
     **  SBi Bj+Bk
     */
-    cpu.regB[opI] = cpuAdd18(cpu.regB[opJ], cpu.regB[opK]);
+    activeCpu->regB[opI] = cpuAdd18(activeCpu->regB[opJ], activeCpu->regB[opK]);
     }
 
 static void cpOp67(void)
@@ -3730,14 +4505,14 @@ static void cpOp67(void)
         /*
         **  CW Xj,Xk
         */
-        cpuWriteMem((u32)(cpu.regX[opK]) & Mask21, cpu.regX + opJ);
+        cpuWriteMem((u32)(activeCpu->regX[opK]) & Mask21, activeCpu->regX + opJ);
         return;
         }
 
     /*
     **  SBi Bj-Bk
     */
-    cpu.regB[opI] = cpuSubtract18(cpu.regB[opJ], cpu.regB[opK]);
+    activeCpu->regB[opI] = cpuSubtract18(activeCpu->regB[opJ], activeCpu->regB[opK]);
     }
 
 static void cpOp70(void)
@@ -3745,14 +4520,14 @@ static void cpOp70(void)
     /*
     **  SXi Aj+K
     */
-    acc60 = (CpWord)cpuAdd18(cpu.regA[opJ], opAddress);
+    acc60 = (CpWord)cpuAdd18(activeCpu->regA[opJ], opAddress);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp71(void)
@@ -3760,14 +4535,14 @@ static void cpOp71(void)
     /*
     **  SXi Bj+K
     */
-    acc60 = (CpWord)cpuAdd18(cpu.regB[opJ], opAddress);
+    acc60 = (CpWord)cpuAdd18(activeCpu->regB[opJ], opAddress);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp72(void)
@@ -3775,14 +4550,14 @@ static void cpOp72(void)
     /*
     **  SXi Xj+K
     */
-    acc60 = (CpWord)cpuAdd18((u32)cpu.regX[opJ], opAddress);
+    acc60 = (CpWord)cpuAdd18((u32)activeCpu->regX[opJ], opAddress);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp73(void)
@@ -3790,14 +4565,14 @@ static void cpOp73(void)
     /*
     **  SXi Xj+Bk
     */
-    acc60 = (CpWord)cpuAdd18((u32)cpu.regX[opJ], cpu.regB[opK]);
+    acc60 = (CpWord)cpuAdd18((u32)activeCpu->regX[opJ], activeCpu->regB[opK]);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp74(void)
@@ -3805,14 +4580,14 @@ static void cpOp74(void)
     /*
     **  SXi Aj+Bk
     */
-    acc60 = (CpWord)cpuAdd18(cpu.regA[opJ], cpu.regB[opK]);
+    acc60 = (CpWord)cpuAdd18(activeCpu->regA[opJ], activeCpu->regB[opK]);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp75(void)
@@ -3820,7 +4595,7 @@ static void cpOp75(void)
     /*
     **  SXi Aj-Bk
     */
-    acc60 = (CpWord)cpuSubtract18(cpu.regA[opJ], cpu.regB[opK]);
+    acc60 = (CpWord)cpuSubtract18(activeCpu->regA[opJ], activeCpu->regB[opK]);
 
 
     if ((acc60 & 0400000) != 0)
@@ -3828,7 +4603,7 @@ static void cpOp75(void)
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp76(void)
@@ -3836,14 +4611,14 @@ static void cpOp76(void)
     /*
     **  SXi Bj+Bk
     */
-    acc60 = (CpWord)cpuAdd18(cpu.regB[opJ], cpu.regB[opK]);
+    acc60 = (CpWord)cpuAdd18(activeCpu->regB[opJ], activeCpu->regB[opK]);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
     }
 
 static void cpOp77(void)
@@ -3851,14 +4626,833 @@ static void cpOp77(void)
     /*
     **  SXi Bj-Bk
     */
-    acc60 = (CpWord)cpuSubtract18(cpu.regB[opJ], cpu.regB[opK]);
+    acc60 = (CpWord)cpuSubtract18(activeCpu->regB[opJ], activeCpu->regB[opK]);
 
     if ((acc60 & 0400000) != 0)
         {
         acc60 |= SignExtend18To60;
         }
 
-    cpu.regX[opI] = acc60 & Mask60;
+    activeCpu->regX[opI] = acc60 & Mask60;
+    }
+
+/*
+**  CPU cores compiled for each model. The feature tests in the
+**  instruction loop, the instruction fetch and the opcodes 01 to 07 fold
+**  to constants.
+*/
+#define CpuModelCore(model, mf)                                             \
+    static void cpuStep##model(void)  { cpuStepModel(mf); }                 \
+    static void cpOp01##model(void)   { cpOp01Model(mf); }                  \
+    static void cpOp02##model(void)   { cpOp02Model(mf); }                  \
+    static void cpOp03##model(void)   { cpOp03Model(mf); }                  \
+    static void cpOp04##model(void)   { cpOp04Model(mf); }                  \
+    static void cpOp05##model(void)   { cpOp05Model(mf); }                  \
+    static void cpOp06##model(void)   { cpOp06Model(mf); }                  \
+    static void cpOp07##model(void)   { cpOp07Model(mf); }
+
+#define CpuCoreEntry(model)                                                 \
+    { cpuStep##model,                                                       \
+        { cpOp01##model, cpOp02##model, cpOp03##model, cpOp04##model,       \
+          cpOp05##model, cpOp06##model, cpOp07##model } }
+
+CpuModelCore(Model6400, Features6400)
+CpuModelCore(ModelCyber73, FeaturesCyber73)
+CpuModelCore(ModelCyber173, FeaturesCyber173)
+CpuModelCore(ModelCyber175, FeaturesCyber175)
+CpuModelCore(ModelCyber840A, FeaturesCyber840A)
+CpuModelCore(ModelCyber865, FeaturesCyber865)
+
+/*
+**  Indexed by ModelType.
+*/
+static CpuCore cpuCores[] =
+    {
+    CpuCoreEntry(Model6400),
+    CpuCoreEntry(ModelCyber73),
+    CpuCoreEntry(ModelCyber173),
+    CpuCoreEntry(ModelCyber175),
+    CpuCoreEntry(ModelCyber840A),
+    CpuCoreEntry(ModelCyber865),
+    };
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Select the CPU core compiled for a model.
+**
+**  Parameters:     Name        Description.
+**                  model       configured model
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuSelectCore(ModelType model)
+    {
+    int i;
+
+    cpuStepVariant = cpuCores[model].step;
+    for (i = 0; i < 7; i++)
+        {
+        decodeCpuOpcode[i + 1].execute = cpuCores[model].op0x[i];
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Put the active CPU into monitor mode if no other CPU
+**                  is in monitor mode.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if the CPU is now in monitor mode, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cpuEnterMonitor(void)
+    {
+    bool result = TRUE;
+    u8 i;
+
+    cpuLockInterlock();
+
+    for (i = 0; i < cpuCount; i++)
+        {
+        if (cpus + i != activeCpu && cpus[i].monitorMode)
+            {
+            result = FALSE;
+            break;
+            }
+        }
+
+    if (result)
+        {
+        activeCpu->monitorMode = TRUE;
+        }
+
+    cpuUnlockInterlock();
+
+    return(result);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Exchange jump the active CPU to its monitor address.
+**                  If the other CPU is in monitor mode the active CPU stops
+**                  and retries the exchange jump until it can proceed.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuExchangeToMonitor(void)
+    {
+    if (cpuEnterMonitor())
+        {
+        cpuExchangeJump(activeCpu->regMa);
+        }
+    else
+        {
+        activeCpu->isStopped = TRUE;
+        activeCpu->monitorPending = TRUE;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create the thread of a CPU.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuCreateThread(CpuContext *cc)
+    {
+#if defined(_WIN32)
+    DWORD dwThreadId; 
+    HANDLE hThread;
+
+    /*
+    **  Create CPU thread.
+    */
+    hThread = CreateThread( 
+        NULL,                                       // no security attribute 
+        0,                                          // default stack size 
+        (LPTHREAD_START_ROUTINE)cpuThread, 
+        (LPVOID)cc,                                 // thread parameter 
+        0,                                          // not suspended 
+        &dwThreadId);                               // returns thread ID 
+
+    if (hThread == NULL)
+        {
+        fprintf(stderr, "Failed to create CPU %d thread\n", cc->id);
+        exit(1);
+        }
+#else
+    int rc;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    /*
+    **  Create POSIX thread with default attributes.
+    */
+    pthread_attr_init(&attr);
+    rc = pthread_create(&thread, &attr, cpuThread, cc);
+    if (rc != 0)
+        {
+        fprintf(stderr, "Failed to create CPU %d thread\n", cc->id);
+        exit(1);
+        }
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        CPU thread of a multiprocessor.
+**
+**                  Executes batches of instructions. A batch ends early
+**                  when another thread waits for the CPU mutex, and the
+**                  thread then stands back until that thread has the
+**                  mutex, so a PP can exchange jump the CPU promptly. A
+**                  stopped CPU is polled once a millisecond.
+**
+**  Parameters:     Name        Description.
+**                  param       CPU context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static void cpuThread(void *param)
+#else
+static void *cpuThread(void *param)
+#endif
+    {
+    char name[8];
+    int i;
+
+    activeCpu = (CpuContext *)param;
+    sprintf(name, "cpu%d", activeCpu->id);
+    threadSetup(name);
+
+    for (;;)
+        {
+        cpuLock(activeCpu);
+
+        if (!emulationActive)
+            {
+            cpuUnlock(activeCpu);
+            break;
+            }
+
+        for (i = 0; i < CpuBatchSize && cpuMutex[activeCpu->id].waiters == 0; i++)
+            {
+            cpuStep();
+            }
+
+        cpuUnlock(activeCpu);
+
+        /*
+        **  Let a waiting PP or the main thread take the mutex.
+        */
+        while (cpuMutex[activeCpu->id].waiters != 0)
+            {
+        #if defined(_WIN32)
+            SwitchToThread();
+        #else
+            sched_yield();
+        #endif
+            }
+
+        if (activeCpu->isStopped)
+            {
+        #if defined(_WIN32)
+            Sleep(1);
+        #else
+            usleep(1000);
+        #endif
+            }
+        }
+
+#if !defined(_WIN32)
+    return(NULL);
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Lock a CPU against execution by its thread.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuLock(CpuContext *cc)
+    {
+    if (cpuCount > 1)
+        {
+        (void)AtomicAdd32(&cpuMutex[cc->id].waiters, 1);
+    #if defined(_WIN32)
+        EnterCriticalSection(&cpuMutex[cc->id].mutex);
+    #else
+        pthread_mutex_lock(&cpuMutex[cc->id].mutex);
+    #endif
+        (void)AtomicAdd32(&cpuMutex[cc->id].waiters, -1);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unlock a CPU.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuUnlock(CpuContext *cc)
+    {
+    if (cpuCount > 1)
+        {
+    #if defined(_WIN32)
+        LeaveCriticalSection(&cpuMutex[cc->id].mutex);
+    #else
+        pthread_mutex_unlock(&cpuMutex[cc->id].mutex);
+    #endif
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Lock the interlock shared by the CPUs.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuLockInterlock(void)
+    {
+    if (cpuCount > 1)
+        {
+    #if defined(_WIN32)
+        EnterCriticalSection(&cpuInterlockMutex);
+    #else
+        pthread_mutex_lock(&cpuInterlockMutex);
+    #endif
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unlock the interlock shared by the CPUs.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuUnlockInterlock(void)
+    {
+    if (cpuCount > 1)
+        {
+    #if defined(_WIN32)
+        LeaveCriticalSection(&cpuInterlockMutex);
+    #else
+        pthread_mutex_unlock(&cpuInterlockMutex);
+    #endif
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create or attach to the ECS shared with other emulators.
+**
+**                  The first emulator creates the segment and marks it as
+**                  initialised once it has loaded the persisted ECS. Other
+**                  emulators wait for that and check that they are
+**                  configured with the same ECS size. If the creator ended
+**                  before initialising the segment, the next emulator takes
+**                  over as creator. Emulators sharing ECS must run on the
+**                  same host, so their process IDs can be checked.
+**
+**  Parameters:     Name        Description.
+**                  size        ECS size in bytes
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuSharedEcsAttach(size_t size)
+    {
+    u32 creator;
+    int wait;
+
+    ecsSharedSize = sizeof(EcsShared) + size;
+
+#if defined(_WIN32)
+    ecsSharedPid = (u32)GetCurrentProcessId();
+    ecsMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        (DWORD)((u64)ecsSharedSize >> 32), (DWORD)ecsSharedSize, ecsSharedName);
+    if (ecsMapping == NULL)
+        {
+        fprintf(stderr, "Failed to create shared ECS %s\n", ecsSharedName);
+        exit(1);
+        }
+
+    ecsSharedCreator = GetLastError() != ERROR_ALREADY_EXISTS;
+    ecsShared = MapViewOfFile(ecsMapping, FILE_MAP_ALL_ACCESS, 0, 0, ecsSharedSize);
+    if (ecsShared == NULL)
+        {
+        fprintf(stderr, "Failed to map shared ECS %s\n", ecsSharedName);
+        exit(1);
+        }
+#else
+    struct stat st;
+    void *addr;
+    int fd;
+
+    ecsSharedPid = (u32)getpid();
+    sprintf(ecsSharedPath, "/%.70s", ecsSharedName);
+    fd = shm_open(ecsSharedPath, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        {
+        ecsSharedCreator = TRUE;
+        if (ftruncate(fd, (off_t)ecsSharedSize) != 0)
+            {
+            fprintf(stderr, "Failed to size shared ECS %s\n", ecsSharedName);
+            shm_unlink(ecsSharedPath);
+            exit(1);
+            }
+        }
+    else if (errno == EEXIST)
+        {
+        fd = shm_open(ecsSharedPath, O_RDWR, 0600);
+        }
+
+    if (fd < 0)
+        {
+        fprintf(stderr, "Failed to open shared ECS %s\n", ecsSharedName);
+        exit(1);
+        }
+
+    /*
+    **  Give the creator time to size the segment.
+    */
+    for (wait = 0; ; wait++)
+        {
+        if (fstat(fd, &st) != 0)
+            {
+            fprintf(stderr, "Failed to open shared ECS %s\n", ecsSharedName);
+            exit(1);
+            }
+
+        if (st.st_size != 0 || wait == EcsSharedWait * 10)
+            {
+            break;
+            }
+
+        usleep(100000);
+        }
+
+    /*
+    **  A segment which is still empty was left by a creator which ended
+    **  before sizing it.
+    */
+    if (st.st_size == 0 && (ftruncate(fd, (off_t)ecsSharedSize) != 0 || fstat(fd, &st) != 0))
+        {
+        fprintf(stderr, "Failed to size shared ECS %s\n", ecsSharedName);
+        exit(1);
+        }
+
+    if ((size_t)st.st_size != ecsSharedSize)
+        {
+        fprintf(stderr, "Shared ECS %s has a different size than configured\n", ecsSharedName);
+        exit(1);
+        }
+
+    addr = mmap(NULL, ecsSharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        {
+        fprintf(stderr, "Failed to map shared ECS %s\n", ecsSharedName);
+        exit(1);
+        }
+
+    ecsShared = addr;
+#endif
+
+    if (ecsSharedCreator)
+        {
+        ecsShared->creator = ecsSharedPid;
+        }
+
+    /*
+    **  Wait until the creator has initialised ECS.
+    */
+    for (wait = 0; !ecsSharedCreator && ecsShared->magic != EcsSharedMagic; wait++)
+        {
+        /*
+        **  Take over from a creator which has ended, or which never
+        **  recorded its process ID.
+        */
+        creator = ecsShared->creator;
+        if (creator != 0 ? !cpuSharedEcsAlive(creator) : wait >= EcsSharedWait * 10)
+            {
+            if (AtomicCas32(&ecsShared->creator, creator, ecsSharedPid))
+                {
+                printf("Creator of shared ECS %s ended before initialising it, taking over\n", ecsSharedName);
+                memset(ecsShared + 1, 0, size);
+                ecsShared->flagRegister = 0;
+                ecsSharedCreator = TRUE;
+                break;
+                }
+
+            wait = 0;
+            continue;
+            }
+
+        if (wait == EcsSharedWait * 10)
+            {
+            fprintf(stderr, "Shared ECS %s was not initialised by its creator (process %u)\n", ecsSharedName, creator);
+            exit(1);
+            }
+
+    #if defined(_WIN32)
+        Sleep(100);
+    #else
+        usleep(100000);
+    #endif
+        }
+
+    if (!ecsSharedCreator && (size_t)ecsShared->words * sizeof(CpWord) != size)
+        {
+        fprintf(stderr, "Shared ECS %s has a different size than configured\n", ecsSharedName);
+        exit(1);
+        }
+
+    cpuSharedEcsJoin();
+    ecsFlags = &ecsShared->flagRegister;
+    extMem = (CpWord *)(ecsShared + 1);
+
+    printf("%s shared ECS %s\n", ecsSharedCreator ? "Created" : "Attached to", ecsSharedName);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Detach from the shared ECS. The segment is removed when
+**                  the last emulator detaches. Emulators which ended
+**                  without detaching are not counted.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if this was the last emulator, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cpuSharedEcsDetach(void)
+    {
+    (void)AtomicCas32(&ecsShared->users[ecsSharedSlot], ecsSharedPid, 0);
+    if (cpuSharedEcsPrune() != 0)
+        {
+        return(FALSE);
+        }
+
+#if !defined(_WIN32)
+    shm_unlink(ecsSharedPath);
+#endif
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Record this emulator as a user of the shared ECS.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuSharedEcsJoin(void)
+    {
+    int i;
+
+    (void)cpuSharedEcsPrune();
+
+    for (i = 0; i < EcsSharedUsers; i++)
+        {
+        if (AtomicCas32(&ecsShared->users[i], 0, ecsSharedPid))
+            {
+            ecsSharedSlot = i;
+            return;
+            }
+        }
+
+    fprintf(stderr, "Too many emulators attached to shared ECS %s\n", ecsSharedName);
+    exit(1);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Remove users of the shared ECS which ended without
+**                  detaching and count the remaining ones.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Number of other emulators attached.
+**
+**------------------------------------------------------------------------*/
+static int cpuSharedEcsPrune(void)
+    {
+    int count = 0;
+    u32 pid;
+    int i;
+
+    for (i = 0; i < EcsSharedUsers; i++)
+        {
+        pid = ecsShared->users[i];
+        if (pid == 0 || pid == ecsSharedPid)
+            {
+            continue;
+            }
+
+        if (!cpuSharedEcsAlive(pid))
+            {
+            if (AtomicCas32(&ecsShared->users[i], pid, 0))
+                {
+                printf("Process %u ended without detaching from shared ECS %s\n", pid, ecsSharedName);
+                }
+
+            continue;
+            }
+
+        count += 1;
+        }
+
+    return(count);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check whether a process still exists.
+**
+**  Parameters:     Name        Description.
+**                  pid         process ID
+**
+**  Returns:        TRUE if it exists, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cpuSharedEcsAlive(u32 pid)
+    {
+#if defined(_WIN32)
+    HANDLE process;
+    bool alive;
+
+    process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (process == NULL)
+        {
+        return(GetLastError() == ERROR_ACCESS_DENIED);
+        }
+
+    alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+
+    return(alive);
+#else
+    return(kill((pid_t)pid, 0) == 0 || errno == EPERM);
+#endif
+    }
+
+#if CcCoSim == 1
+/*--------------------------------------------------------------------------
+**  Purpose:        Journal a CM word before the CPU stores into it.
+**
+**  Parameters:     Name        Description.
+**                  word        host address of the word
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuCoSimSave(CpWord *word)
+    {
+    CoSimWrite *w;
+
+    if (coSimWrites[coSimPass] == CoSimMaxWrites)
+        {
+        /*
+        **  Too many stores to undo, e.g. a long CMU move.
+        */
+        coSimUnchecked = TRUE;
+        coSimJournaling = FALSE;
+        return;
+        }
+
+    w = coSimJournal[coSimPass] + coSimWrites[coSimPass]++;
+    w->word = word;
+    w->old = *word;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare the result of the reference run with the
+**                  result of the fast run.
+**
+**  Parameters:     Name        Description.
+**                  fast        CPU context after the fast run
+**                  what        buffer for description of first difference
+**
+**  Returns:        TRUE if the results differ, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool cpuCoSimCompare(CpuContext *fast, char *what)
+    {
+    CpuContext *ref = activeCpu;
+    CoSimWrite *w;
+    int i;
+    int j;
+
+    if (coSimUnchecked)
+        {
+        /*
+        **  The reference run took a different path, e.g. an exit.
+        */
+        sprintf(what, "reference run exited or overflowed the journal");
+        return(TRUE);
+        }
+
+    for (i = 0; i < 8; i++)
+        {
+        if (ref->regX[i] != fast->regX[i])
+            {
+            sprintf(what, "X%d fast " FMT60_020o " reference " FMT60_020o, i, fast->regX[i], ref->regX[i]);
+            return(TRUE);
+            }
+
+        if (ref->regA[i] != fast->regA[i])
+            {
+            sprintf(what, "A%d fast %06o reference %06o", i, fast->regA[i], ref->regA[i]);
+            return(TRUE);
+            }
+
+        if (ref->regB[i] != fast->regB[i])
+            {
+            sprintf(what, "B%d fast %06o reference %06o", i, fast->regB[i], ref->regB[i]);
+            return(TRUE);
+            }
+        }
+
+    if (   ref->regP != fast->regP
+        || ref->opOffset != fast->opOffset
+        || ref->opWord != fast->opWord)
+        {
+        sprintf(what, "P fast %06o/%d reference %06o/%d", fast->regP, fast->opOffset, ref->regP, ref->opOffset);
+        return(TRUE);
+        }
+
+    if (ref->exitCondition != fast->exitCondition || ref->isStopped != fast->isStopped)
+        {
+        sprintf(what, "exit condition fast %02o reference %02o", fast->exitCondition, ref->exitCondition);
+        return(TRUE);
+        }
+
+    if (ref->instructions != fast->instructions)
+        {
+        sprintf(what, "instruction count fast %lu reference %lu",
+            (unsigned long)fast->instructions, (unsigned long)ref->instructions);
+        return(TRUE);
+        }
+
+    if (   ref->iwRank != fast->iwRank
+        || memcmp(ref->iwStack, fast->iwStack, sizeof(ref->iwStack)) != 0
+        || memcmp(ref->iwAddress, fast->iwAddress, sizeof(ref->iwAddress)) != 0
+        || memcmp(ref->iwValid, fast->iwValid, sizeof(ref->iwValid)) != 0)
+        {
+        sprintf(what, "instruction word stack");
+        return(TRUE);
+        }
+
+    /*
+    **  Words stored by the fast run must hold the same value now.
+    */
+    for (i = 0, w = coSimJournal[0]; i < coSimWrites[0]; i++, w++)
+        {
+        if (*w->word != w->fast)
+            {
+            sprintf(what, "CM %08o fast " FMT60_020o " reference " FMT60_020o,
+                (u32)(w->word - cpMem), w->fast, *w->word);
+            return(TRUE);
+            }
+        }
+
+    /*
+    **  Words only stored by the reference run must be unchanged.
+    */
+    for (i = 0, w = coSimJournal[1]; i < coSimWrites[1]; i++, w++)
+        {
+        for (j = 0; j < coSimWrites[0]; j++)
+            {
+            if (coSimJournal[0][j].word == w->word)
+                {
+                break;
+                }
+            }
+
+        if (j == coSimWrites[0] && *w->word != w->old)
+            {
+            sprintf(what, "CM %08o fast " FMT60_020o " reference " FMT60_020o,
+                (u32)(w->word - cpMem), w->old, *w->word);
+            return(TRUE);
+            }
+        }
+
+    return(FALSE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Report a divergence between fast and reference run in
+**                  cosim.trc, with the disassembly of the instruction word.
+**
+**  Parameters:     Name        Description.
+**                  before      CPU context before the instruction word
+**                  fast        CPU context after the fast run
+**                  what        description of first difference
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuCoSimReport(CpuContext *before, CpuContext *fast, char *what)
+    {
+    int i;
+
+    coSimDivergences += 1;
+
+    if (coSimF == NULL)
+        {
+        coSimF = fopen("cosim.trc", "wt");
+        if (coSimF == NULL)
+            {
+            fprintf(stderr, "can't open cosim.trc\n");
+            return;
+            }
+
+        printf("CPU co-simulation: %s at P=%06o after %lu instructions, see cosim.trc\n",
+            what, before->regP, (unsigned long)before->instructions);
+        }
+
+    fprintf(coSimF, "Divergence %u: %s\n", coSimDivergences, what);
+    fprintf(coSimF, "RA %08o  FL %08o  P %06o  instructions %lu\n",
+        before->regRaCm, before->regFlCm, before->regP, (unsigned long)before->instructions);
+
+    for (i = 0; i < 8; i++)
+        {
+        fprintf(coSimF, "    before A%d %06o  B%d %06o  X%d " FMT60_020o "\n",
+            i, before->regA[i], i, before->regB[i], i, before->regX[i]);
+        }
+
+    for (i = 0; i < 8; i++)
+        {
+        fprintf(coSimF, "    fast   A%d %06o  B%d %06o  X%d " FMT60_020o "\n",
+            i, fast->regA[i], i, fast->regB[i], i, fast->regX[i]);
+        }
+
+    fprintf(coSimF, "Reference:\n");
+    for (i = 0; i < coSimOpCount; i++)
+        {
+        traceCpuFile(coSimF, coSimOps[i].p, coSimOps[i].opFm, coSimOps[i].opI,
+            coSimOps[i].opJ, coSimOps[i].opK, coSimOps[i].opAddress);
+        }
+
+    fprintf(coSimF, "\n");
+    fflush(coSimF);
+    }
+#endif
+
 /*---------------------------  End Of File  ------------------------------*/
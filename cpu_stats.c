@@ -0,0 +1,635 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: cpu_stats.c
+**
+**  Description:
+**      Account executed CPU instructions and host time to the exchange
+**      package a CPU is running, which identifies the control point of
+**      the job. The table can be displayed by the operator, shown as a
+**      periodically refreshed top list or appended to a statistics file.
+**      The periodic output is driven by the main emulation loop.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxCpuStats         128
+#define TopLines            20
+#define OtherXp             0xFFFFFFFF
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if defined(_WIN32)
+#define CpuStatsLock(n)     EnterCriticalSection(&statsMutex[n].mutex)
+#define CpuStatsUnlock(n)   LeaveCriticalSection(&statsMutex[n].mutex)
+#else
+#define CpuStatsLock(n)     pthread_mutex_lock(&statsMutex[n].mutex)
+#define CpuStatsUnlock(n)   pthread_mutex_unlock(&statsMutex[n].mutex)
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct cpuStats
+    {
+    u32             xpAddress;          /* exchange package address */
+    u32             regRaCm;            /* RA at last exchange */
+    u32             regFlCm;            /* FL at last exchange */
+    u32             exchanges;          /* exchange jumps into package */
+    u64             instructions;       /* executed instructions */
+    u64             hostNs;             /* host time in nanoseconds */
+    } CpuStats;
+
+typedef struct CacheAligned cpuStatsState
+    {
+    int             count;              /* entries used in table */
+    CpuStats        *current;           /* package the CPU is in */
+    u64             lastTime;           /* host time of last exchange */
+    u64             lastInstructions;   /* instructions at last exchange */
+    } CpuStatsState;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static CpuStats *cpuStatsFind(u8 cpuNum, u32 xpAddress);
+static int cpuStatsCollect(CpuStats *table);
+static int cpuStatsMerge(CpuStats *table, int count, CpuStats *sp, u32 xpAddress);
+static void cpuStatsShowTop(void);
+static int cpuStatsCompare(const void *e1, const void *e2);
+static void cpuStatsPrint(FILE *fp, CpuStats *table, int count, int lines);
+static void cpuStatsWrite(void);
+static u64 cpuStatsGetTime(void);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+char cpuStatsFile[256];
+u16 cpuStatsInterval = 60;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**  Each CPU only updates its own table and state. The state of each CPU
+**  has a cache line of its own. The last entry of each table collects the
+**  packages which did not fit. In a multiprocessor the tables are read by
+**  the main thread while the CPU threads update them, so each table is
+**  guarded by a mutex of its own.
+*/
+static CpuStats stats[MaxCpus][MaxCpuStats + 1];
+static CpuStatsState state[MaxCpus];
+#if defined(_WIN32)
+static struct CacheAligned { CRITICAL_SECTION mutex; } statsMutex[MaxCpus];
+#else
+static struct CacheAligned { pthread_mutex_t mutex; } statsMutex[MaxCpus];
+#endif
+
+/*
+**  Snapshot of the previous top display and the times at which the next
+**  top display and statistics file snapshot are due. These are only used
+**  by the main thread.
+*/
+static CpuStats topTable[MaxCpus * (MaxCpuStats + 1)];
+static CpuStats topBase[MaxCpus * (MaxCpuStats + 1)];
+static int topBaseCount = 0;
+static u64 topBaseTime = 0;
+static u16 topInterval = 0;
+static u64 topDue = 0;
+static u64 fileDue = 0;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise the locks of the CPU tables.
+**
+**                  Called before the CPU threads are created.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsInit(void)
+    {
+    int i;
+
+    for (i = 0; i < MaxCpus; i++)
+        {
+    #if defined(_WIN32)
+        InitializeCriticalSection(&statsMutex[i].mutex);
+    #else
+        pthread_mutex_init(&statsMutex[i].mutex, NULL);
+    #endif
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Charge the instructions and host time since the previous
+**                  exchange jump of a CPU to the package it was running and
+**                  make the new package current.
+**
+**                  Called by the CPU thread after each exchange jump.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context after the exchange
+**                  xpAddress   address of the new exchange package
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsExchange(CpuContext *cc, u32 xpAddress)
+    {
+    CpuStats *sp;
+    u64 now = cpuStatsGetTime();
+
+    if (cpuCount > 1)
+        {
+        CpuStatsLock(cc->id);
+        }
+
+    sp = state[cc->id].current;
+    if (sp != NULL)
+        {
+        sp->instructions += cc->instructions - state[cc->id].lastInstructions;
+        sp->hostNs += now - state[cc->id].lastTime;
+        }
+
+    state[cc->id].lastTime = now;
+    state[cc->id].lastInstructions = cc->instructions;
+
+    sp = cpuStatsFind(cc->id, xpAddress);
+    sp->regRaCm = cc->regRaCm;
+    sp->regFlCm = cc->regFlCm;
+    sp->exchanges += 1;
+    state[cc->id].current = sp;
+
+    if (cpuCount > 1)
+        {
+        CpuStatsUnlock(cc->id);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Produce the top display and statistics file snapshot
+**                  when they are due.
+**
+**                  Called periodically by the main emulation loop, so the
+**                  output continues when a CPU is stopped or idle and does
+**                  not interleave with operator output.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsCheck(void)
+    {
+    u64 now;
+
+    if (topInterval == 0 && cpuStatsFile[0] == '\0')
+        {
+        return;
+        }
+
+    now = cpuStatsGetTime();
+
+    if (topInterval != 0 && now >= topDue)
+        {
+        topDue = now + (u64)topInterval * 1000000000;
+        cpuStatsShowTop();
+        }
+
+    if (cpuStatsFile[0] != '\0' && now >= fileDue)
+        {
+        if (fileDue != 0)
+            {
+            cpuStatsWrite();
+            }
+
+        fileDue = now + (u64)cpuStatsInterval * 1000000000;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show CPU accounting totals since deadstart on the
+**                  operator console.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsShow(void)
+    {
+    static CpuStats table[MaxCpus * (MaxCpuStats + 1)];
+    int count;
+
+    count = cpuStatsCollect(table);
+    cpuStatsPrint(stdout, table, count, count);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set the interval of the top display.
+**
+**  Parameters:     Name        Description.
+**                  interval    seconds between displays, 0 to stop
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsTop(u16 interval)
+    {
+    topInterval = interval;
+    topDue = 0;
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find or create the entry of an exchange package.
+**
+**  Parameters:     Name        Description.
+**                  cpuNum      CPU number
+**                  xpAddress   exchange package address
+**
+**  Returns:        Pointer to entry.
+**
+**------------------------------------------------------------------------*/
+static CpuStats *cpuStatsFind(u8 cpuNum, u32 xpAddress)
+    {
+    CpuStats *sp = stats[cpuNum];
+    int i;
+
+    for (i = 0; i < state[cpuNum].count; i++, sp++)
+        {
+        if (sp->xpAddress == xpAddress)
+            {
+            return(sp);
+            }
+        }
+
+    if (state[cpuNum].count == MaxCpuStats)
+        {
+        /*
+        **  Table full - account to the overflow entry.
+        */
+        return(sp);
+        }
+
+    memset(sp, 0, sizeof(CpuStats));
+    sp->xpAddress = xpAddress;
+    state[cpuNum].count += 1;
+
+    return(sp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Combine the tables of all CPUs sorted by host time.
+**
+**  Parameters:     Name        Description.
+**                  table       combined table
+**
+**  Returns:        Number of entries.
+**
+**------------------------------------------------------------------------*/
+static int cpuStatsCollect(CpuStats *table)
+    {
+    int count = 0;
+    int c;
+    int i;
+
+    for (c = 0; c < cpuCount; c++)
+        {
+        if (cpuCount > 1)
+            {
+            CpuStatsLock(c);
+            }
+
+        for (i = 0; i < state[c].count; i++)
+            {
+            count = cpuStatsMerge(table, count, stats[c] + i, stats[c][i].xpAddress);
+            }
+
+        count = cpuStatsMerge(table, count, stats[c] + MaxCpuStats, OtherXp);
+
+        if (cpuCount > 1)
+            {
+            CpuStatsUnlock(c);
+            }
+        }
+
+    qsort(table, count, sizeof(CpuStats), cpuStatsCompare);
+
+    return(count);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add an entry to the combined table.
+**
+**  Parameters:     Name        Description.
+**                  table       combined table
+**                  count       number of entries in combined table
+**                  sp          entry to add
+**                  xpAddress   exchange package address to account to
+**
+**  Returns:        New number of entries.
+**
+**------------------------------------------------------------------------*/
+static int cpuStatsMerge(CpuStats *table, int count, CpuStats *sp, u32 xpAddress)
+    {
+    CpuStats *tp;
+    int i;
+
+    if (sp->exchanges == 0)
+        {
+        return(count);
+        }
+
+    for (i = 0, tp = table; i < count; i++, tp++)
+        {
+        if (tp->xpAddress == xpAddress)
+            {
+            break;
+            }
+        }
+
+    if (i == count)
+        {
+        memset(tp, 0, sizeof(CpuStats));
+        tp->xpAddress = xpAddress;
+        count += 1;
+        }
+
+    tp->regRaCm = sp->regRaCm;
+    tp->regFlCm = sp->regFlCm;
+    tp->exchanges += sp->exchanges;
+    tp->instructions += sp->instructions;
+    tp->hostNs += sp->hostNs;
+
+    return(count);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show the busiest exchange packages since the previous
+**                  top display.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuStatsShowTop(void)
+    {
+    CpuStats *sp;
+    CpuStats *tp;
+    CpuStats base;
+    u64 now = cpuStatsGetTime();
+    int count;
+    int i;
+    int j;
+
+    count = cpuStatsCollect(topTable);
+
+    /*
+    **  Subtract the previous snapshot and remember the current one.
+    */
+    for (i = 0, tp = topTable; i < count; i++, tp++)
+        {
+        for (j = 0, sp = topBase; j < topBaseCount; j++, sp++)
+            {
+            if (sp->xpAddress == tp->xpAddress)
+                {
+                break;
+                }
+            }
+
+        if (j == topBaseCount)
+            {
+            memset(sp, 0, sizeof(CpuStats));
+            topBaseCount += 1;
+            }
+
+        base = *sp;
+        *sp = *tp;
+        tp->exchanges -= base.exchanges;
+        tp->instructions -= base.instructions;
+        tp->hostNs -= base.hostNs;
+        }
+
+    qsort(topTable, count, sizeof(CpuStats), cpuStatsCompare);
+
+    if (topBaseTime == 0)
+        {
+        printf("\nCPU top - since deadstart\n");
+        }
+    else
+        {
+        printf("\nCPU top - last %.1f seconds\n", (double)(now - topBaseTime) / 1000000000.0);
+        }
+
+    cpuStatsPrint(stdout, topTable, count, TopLines);
+    printf("\nOperator> ");
+    fflush(stdout);
+
+    topBaseTime = now;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two entries by descending host time.
+**
+**  Parameters:     Name        Description.
+**                  e1          first entry
+**                  e2          second entry
+**
+**  Returns:        Sort order.
+**
+**------------------------------------------------------------------------*/
+static int cpuStatsCompare(const void *e1, const void *e2)
+    {
+    const CpuStats *s1 = e1;
+    const CpuStats *s2 = e2;
+
+    if (s1->hostNs > s2->hostNs)
+        {
+        return(-1);
+        }
+
+    if (s1->hostNs < s2->hostNs)
+        {
+        return(1);
+        }
+
+    return(0);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print accounting table.
+**
+**  Parameters:     Name        Description.
+**                  fp          output file
+**                  table       sorted combined table
+**                  count       number of entries
+**                  lines       maximum number of entries to print
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuStatsPrint(FILE *fp, CpuStats *table, int count, int lines)
+    {
+    CpuStats *tp;
+    u64 totalNs = 0;
+    int i;
+
+    for (i = 0, tp = table; i < count; i++, tp++)
+        {
+        totalNs += tp->hostNs;
+        }
+
+    fprintf(fp, "%-8s %-8s %-8s %10s %14s %10s %8s %6s\n",
+        "XP", "RA", "FL", "Exchanges", "Instructions", "HostMs", "MIPS", "%Time");
+
+    for (i = 0, tp = table; i < count && i < lines; i++, tp++)
+        {
+        if (tp->xpAddress == OtherXp)
+            {
+            fprintf(fp, "%-26s", "other");
+            }
+        else
+            {
+            fprintf(fp, "%08o %08o %08o", tp->xpAddress, tp->regRaCm, tp->regFlCm);
+            }
+
+        fprintf(fp, " %10u %14.0f %10.0f %8.2f %6.1f\n",
+            tp->exchanges,
+            (double)tp->instructions,
+            (double)tp->hostNs / 1000000.0,
+            tp->hostNs == 0 ? 0.0 : (double)tp->instructions * 1000.0 / (double)tp->hostNs,
+            totalNs == 0 ? 0.0 : (double)tp->hostNs * 100.0 / (double)totalNs);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Append a timestamped snapshot to the statistics file.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void cpuStatsWrite(void)
+    {
+    static CpuStats table[MaxCpus * (MaxCpuStats + 1)];
+    FILE *fp;
+    time_t now;
+    char timeStamp[40];
+    int count;
+
+    fp = fopen(cpuStatsFile, "a");
+    if (fp == NULL)
+        {
+        logError(LogErrorLocation, "can't open %s", cpuStatsFile);
+        cpuStatsFile[0] = '\0';
+        return;
+        }
+
+    count = cpuStatsCollect(table);
+
+    now = time(NULL);
+    strftime(timeStamp, sizeof(timeStamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    fprintf(fp, "==== %s  cycles %u\n", timeStamp, cycles);
+    cpuStatsPrint(fp, table, count, count);
+    fprintf(fp, "\n");
+    fclose(fp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read monotonic host time.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Host time in nanoseconds.
+**
+**------------------------------------------------------------------------*/
+static u64 cpuStatsGetTime(void)
+    {
+#if defined(_WIN32)
+    static LARGE_INTEGER hz;
+    LARGE_INTEGER ctr;
+
+    if (hz.QuadPart == 0)
+        {
+        QueryPerformanceFrequency(&hz);
+        }
+
+    QueryPerformanceCounter(&ctr);
+    return((u64)((double)ctr.QuadPart * 1000000000.0 / (double)hz.QuadPart));
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((u64)ts.tv_sec * 1000000000 + (u64)ts.tv_nsec);
+#endif
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
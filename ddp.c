@@ -73,6 +73,13 @@
 #define DdpAddrReadOne           (1 << 22)
 #define DdpAddrFlagReg           (1 << 23)
 
+/*
+**  Number of ECS words staged per transfer and number of major cycles
+**  between the end of the address and the first data word of a read.
+*/
+#define DdpBufSize               64
+#define DdpAccessCycles          20
+
 /*
 **  -----------------------
 **  Private Macro Functions
@@ -91,8 +98,19 @@ typedef struct
     u32     addr;
     int     dbyte;
     int     abyte;
-    int     endaddrcycle;
+    u32     endaddrcycle;
+    bool    accessDelay;
     PpWord  stat;
+
+    /*
+    **  ECS words staged for the PP. For reads buf[bufIndex..bufCount-1]
+    **  are the words following addr, for writes buf[0..bufCount-1] are
+    **  waiting to be stored at bufAddr.
+    */
+    u32     bufAddr;
+    int     bufIndex;
+    int     bufCount;
+    CpWord  buf[DdpBufSize];
     } DdpContext;
 
 /*
@@ -104,6 +122,9 @@ static FcStatus ddpFunc(PpWord funcCode);
 static void ddpIo(void);
 static void ddpActivate(void);
 static void ddpDisconnect(void);
+static bool ddpReadWord(DdpContext *dc);
+static bool ddpWriteWord(DdpContext *dc);
+static bool ddpFlush(DdpContext *dc);
 static char *ddpFunc2String(PpWord funcCode);
 
 /*
@@ -209,6 +230,17 @@ static FcStatus ddpFunc(PpWord funcCode)
         ddpFunc2String(funcCode));
 #endif
 
+    /*
+    **  Complete any write and discard words staged by a read.
+    */
+    if (activeDevice->fcode == FcDdpWriteECS && !ddpFlush(dc))
+        {
+        dc->stat = StDdpAbort;
+        }
+
+    dc->bufIndex = 0;
+    dc->bufCount = 0;
+
     switch (funcCode)
         {
     default:
@@ -295,6 +327,7 @@ static void ddpIo(void)
                     **  Delay a bit before we set channel full.
                     */
                     dc->endaddrcycle = cycles;
+                    dc->accessDelay = TRUE;
 
                     /*
                     **  A flag register reference occurs when bit 23 is set address.
@@ -326,50 +359,66 @@ static void ddpIo(void)
 
         if (activeDevice->fcode == FcDdpReadECS)
             {
-            if (!activeChannel->full && cycles - dc->endaddrcycle > 20)
+            if (activeChannel->full)
                 {
-                if (dc->dbyte == -1)
-                    {
-                    /*
-                    **  Fetch next 60 bits from ECS.
-                    */
-                    if (cpuDdpTransfer(dc->addr, &dc->curword, FALSE))
-                        {
-                        dc->stat = StDdpAccept;
-                        }
-                    else
-                        {
-                        activeChannel->discAfterInput = TRUE;
-                        dc->stat = StDdpAbort;
-                        }
+                break;
+                }
 
-                    dc->dbyte = 0;
+            /*
+            **  The ECS access time only delays the first word, so stop
+            **  looking at the clock once it has passed.
+            */
+            if (dc->accessDelay)
+                {
+                if (cycles - dc->endaddrcycle <= DdpAccessCycles)
+                    {
+                    break;
                     }
 
+                dc->accessDelay = FALSE;
+                }
+
+            if (dc->dbyte == -1)
+                {
                 /*
-                **  Return next byte to PPU.
+                **  Fetch next 60 bits from ECS.
                 */
-                activeChannel->data = (PpWord)((dc->curword >> 48) & Mask12);
-                activeChannel->full = TRUE;
+                if (ddpReadWord(dc))
+                    {
+                    dc->stat = StDdpAccept;
+                    }
+                else
+                    {
+                    activeChannel->discAfterInput = TRUE;
+                    dc->stat = StDdpAbort;
+                    }
+
+                dc->dbyte = 0;
+                }
+
+            /*
+            **  Return next byte to PPU.
+            */
+            activeChannel->data = (PpWord)((dc->curword >> 48) & Mask12);
+            activeChannel->full = TRUE;
 
 #if DEBUG
-                fprintf(ddpLog, " %04o", activeChannel->data);
+            fprintf(ddpLog, " %04o", activeChannel->data);
 #endif
 
-                /*
-                **  Update admin stuff.
-                */
-                dc->curword <<= 12;
-                if (++dc->dbyte == 5)
+            /*
+            **  Update admin stuff.
+            */
+            dc->curword <<= 12;
+            if (++dc->dbyte == 5)
+                {
+                if (dc->addr & (DdpAddrReadOne | DdpAddrFlagReg))
                     {
-                    if (dc->addr & (DdpAddrReadOne | DdpAddrFlagReg))
-                        {
-                        activeChannel->discAfterInput = TRUE;
-                        }
-
-                    dc->dbyte = -1;
-                    dc->addr++;
+                    activeChannel->discAfterInput = TRUE;
                     }
+
+                dc->dbyte = -1;
+                dc->addr++;
                 }
             }
         else if (activeChannel->full)
@@ -388,7 +437,7 @@ static void ddpIo(void)
                 /*
                 **  Write next 60 bit to ECS.
                 */
-                if (!cpuDdpTransfer(dc->addr, &dc->curword, TRUE))
+                if (!ddpWriteWord(dc))
                     {
                     activeChannel->active = FALSE;
                     dc->stat = StDdpAbort;
@@ -447,8 +496,8 @@ static void ddpDisconnect(void)
         /*
         **  Write final 60 bit to ECS padded with zeros.
         */
-        dc->curword <<= 5 - dc->dbyte;
-        if (!cpuDdpTransfer(dc->addr, &dc->curword, TRUE))
+        dc->curword <<= 12 * (5 - dc->dbyte);
+        if (!ddpWriteWord(dc))
             {
             activeChannel->active = FALSE;
             dc->stat = StDdpAbort;
@@ -460,12 +509,111 @@ static void ddpDisconnect(void)
         dc->addr++;
         }
 
+    /*
+    **  Store the words collected by the write.
+    */
+    if (activeDevice->fcode == FcDdpWriteECS && !ddpFlush(dc))
+        {
+        activeChannel->active = FALSE;
+        dc->stat = StDdpAbort;
+        return;
+        }
+
     /*
     **  Abort pending device disconnects - the PP is doing the disconnect.
     */
     activeChannel->discAfterInput = FALSE;
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Get the next ECS word of a read into curword, fetching
+**                  the following block of ECS when the staged words are
+**                  used up.
+**
+**  Parameters:     Name        Description.
+**                  dc          DDP context
+**
+**  Returns:        TRUE if accepted, FALSE if ECS rejected the address.
+**
+**------------------------------------------------------------------------*/
+static bool ddpReadWord(DdpContext *dc)
+    {
+    if (dc->bufIndex == dc->bufCount)
+        {
+        /*
+        **  A single word read must not run ahead of its address.
+        */
+        dc->bufIndex = 0;
+        dc->bufCount = cpuDdpBlockTransfer(dc->addr, dc->buf,
+            (dc->addr & DdpAddrReadOne) != 0 ? 1 : DdpBufSize, FALSE);
+        if (dc->bufCount == 0)
+            {
+            return(FALSE);
+            }
+        }
+
+    dc->curword = dc->buf[dc->bufIndex++];
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Stage the word in curword for writing to ECS at addr,
+**                  storing the staged block when it is full.
+**
+**  Parameters:     Name        Description.
+**                  dc          DDP context
+**
+**  Returns:        TRUE if accepted, FALSE if ECS rejected the address.
+**
+**------------------------------------------------------------------------*/
+static bool ddpWriteWord(DdpContext *dc)
+    {
+    /*
+    **  Reject the word right away if it is outside ECS, after storing
+    **  the words preceding it.
+    */
+    if (dc->addr >= extMaxMemory)
+        {
+        ddpFlush(dc);
+        return(FALSE);
+        }
+
+    if (dc->bufCount == 0)
+        {
+        dc->bufAddr = dc->addr;
+        }
+
+    dc->buf[dc->bufCount++] = dc->curword;
+    if (dc->bufCount == DdpBufSize)
+        {
+        return(ddpFlush(dc));
+        }
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store the words staged by a write in ECS.
+**
+**  Parameters:     Name        Description.
+**                  dc          DDP context
+**
+**  Returns:        TRUE if accepted, FALSE if ECS rejected the address.
+**
+**------------------------------------------------------------------------*/
+static bool ddpFlush(DdpContext *dc)
+    {
+    u32 count = dc->bufCount;
+
+    dc->bufCount = 0;
+    if (count == 0)
+        {
+        return(TRUE);
+        }
+
+    return(cpuDdpBlockTransfer(dc->bufAddr, dc->buf, count, TRUE) == count);
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Convert function code to string.
 **
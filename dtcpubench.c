@@ -0,0 +1,732 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: dtcpubench.c
+**
+**  Description:
+**      CPU instruction micro-benchmark. Runs the CPU of the emulator
+**      (cpu.c, float.c and shift.c) without PPs, devices or operating
+**      system on synthetic instruction streams and reports the emulated
+**      MIPS for each class of instructions:
+**          integer     integer and boolean arithmetic, shifts
+**          float       floating point add, multiply, divide, normalise
+**          memory      loads and stores through A registers
+**          branch      conditional branches on X and B registers
+**          cmu         compare/move unit direct moves
+**          ecs         ECS block reads and writes
+**          exchange    exchange jumps between program and monitor
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define BenchMemory         01000000    // CM words
+#define BenchEcsBanks       1
+#define BenchBatch          1000        // instruction words between clock reads
+
+/*
+**  Absolute addresses of the exchange packages and the monitor program.
+*/
+#define BenchXpProgram      0100
+#define BenchXpMonitor      0200
+#define BenchMonitorCode    01000
+
+/*
+**  Field of the benchmark programs and addresses relative to it.
+*/
+#define BenchRa             010000
+#define BenchFl             0200000
+#define BenchCode           0100
+#define BenchData           010000
+#define BenchOut            020000
+#define BenchDataWords      04000
+#define BenchEcsWords       0100
+#define BenchFlEcs          01000
+
+/*
+**  Assembler flags.
+*/
+#define BenchToStart        1           // K is the start of the program
+#define BenchToNext         2           // K is the next word, which starts after this one
+#define BenchEndWord        4           // the next instruction starts a new word
+
+/*
+**  No-operation parcel used to fill words.
+*/
+#define BenchPass           046000
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#define Op15(fm, i, j, k)       { 15, 0, ((CpWord)(fm) << 9) | ((i) << 6) | ((j) << 3) | (k) }
+#define Op30(fm, i, j, K, f)    { 30, f, ((CpWord)(fm) << 24) | ((CpWord)(i) << 21) | ((CpWord)(j) << 18) | (K) }
+#define OpEnd                   { 0, 0, 0 }
+
+/*
+**  CMU direct move of ll characters from k1/c1 to k2/c2.
+*/
+#define OpMove(k1, c1, k2, c2, ll)                                                  \
+    { 60, 0, ((CpWord)046 << 54) | ((CpWord)5 << 51) | ((CpWord)((ll) >> 4) << 48)  \
+           | ((CpWord)(k1) << 30) | ((CpWord)((ll) & 017) << 26)                    \
+           | ((CpWord)(c1) << 22) | ((CpWord)(c2) << 18) | (k2) }
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct benchOp
+    {
+    u8                  length;         /* 15, 30 or 60 bits, 0 ends program */
+    u8                  flags;          /* assembler flags */
+    CpWord              value;          /* instruction */
+    } BenchOp;
+
+typedef struct benchProgram
+    {
+    char                *name;          /* instruction class */
+    BenchOp             *ops;           /* program run in the job field */
+    BenchOp             *monitor;       /* program run in monitor mode or NULL */
+    ModelFeatures       needs;          /* required model features */
+    CpWord              x[8];           /* initial X registers */
+    u32                 a[8];           /* initial A registers */
+    u32                 b[8];           /* initial B registers */
+    } BenchProgram;
+
+typedef struct benchModel
+    {
+    char                *name;
+    ModelType           type;
+    ModelFeatures       features;
+    } BenchModel;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void usage(void);
+static BenchModel *benchFindModel(char *name);
+static bool benchRun(BenchProgram *bp, u32 seconds);
+static void benchSetup(BenchProgram *bp);
+static void benchAssemble(BenchOp *op, u32 ra, u32 origin);
+static void benchPackage(u32 address, u32 p, u32 ra, u32 fl, u32 ma, BenchProgram *bp);
+static u64 getMicroseconds(void);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  Normally defined by the parts of the emulator which are not linked.
+*/
+bool emulationActive = TRUE;
+ModelFeatures features;
+ModelType modelType;
+char persistDir[256] = "";
+char ecsSharedName[64] = "";
+u32 rtcClock = 0;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static BenchOp integerOps[] =
+    {
+    Op15(036, 1, 1, 2),                             // IX1 X1+X2
+    Op15(037, 3, 3, 2),                             // IX3 X3-X2
+    Op15(011, 4, 1, 3),                             // BX4 X1*X3
+    Op15(013, 5, 4, 1),                             // BX5 X4-X1
+    Op30(072, 6, 6, 1, 0),                          // SX6 X6+1
+    Op15(020, 7, 0, 1),                             // LX7 1
+    Op15(066, 3, 3, 1),                             // SB3 B3+B1
+    Op15(036, 7, 7, 6),                             // IX7 X7+X6
+    Op15(043, 0, 0, 6),                             // MX0 6
+    Op15(011, 0, 0, 5),                             // BX0 X0*X5
+    Op15(021, 5, 0, 3),                             // AX5 3
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp floatOps[] =
+    {
+    Op15(030, 1, 2, 3),                             // FX1 X2+X3
+    Op15(040, 4, 2, 3),                             // FX4 X2*X3
+    Op15(044, 5, 2, 3),                             // FX5 X2/X3
+    Op15(032, 6, 2, 3),                             // DX6 X2+X3
+    Op15(041, 7, 2, 3),                             // RX7 X2*X3
+    Op15(024, 1, 0, 1),                             // NX1 B0,X1
+    Op15(031, 5, 5, 3),                             // FX5 X5-X3
+    Op15(026, 6, 6, 4),                             // UX6 B6,X4
+    Op15(027, 7, 6, 6),                             // PX7 B6,X6
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp memoryOps[] =
+    {
+    Op30(051, 1, 1, BenchData, 0),                  // SA1 B1+DATA
+    Op30(050, 2, 1, 1, 0),                          // SA2 A1+1
+    Op15(036, 6, 1, 2),                             // IX6 X1+X2
+    Op30(051, 6, 1, BenchOut, 0),                   // SA6 B1+OUT
+    Op15(013, 7, 1, 2),                             // BX7 X1-X2
+    Op30(050, 7, 6, 1, 0),                          // SA7 A6+1
+    Op30(061, 1, 1, 2, 0),                          // SB1 B1+2
+    Op30(007, 1, 2, 0, BenchToStart),               // LT B1,B2,START
+    Op15(066, 1, 0, 0),                             // SB1 B0
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp branchOps[] =
+    {
+    Op30(061, 1, 1, 1, 0),                          // SB1 B1+1
+    Op30(003, 1, 1, 0, BenchToNext),                // NZ X1,*+1 (taken)
+    Op30(003, 3, 1, 0, BenchToNext),                // NG X1,*+1 (not taken)
+    Op30(004, 1, 0, 0, BenchToNext),                // EQ B1,B0,*+1 (not taken)
+    Op30(006, 1, 0, 0, BenchToNext),                // GE B1,B0,*+1 (taken)
+    Op30(003, 2, 1, 0, BenchToNext),                // PL X1,*+1 (taken)
+    Op30(007, 0, 1, 0, BenchToNext),                // LT B0,B1,*+1
+    Op30(005, 1, 2, 0, BenchToStart),               // NE B1,B2,START (taken)
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp cmuOps[] =
+    {
+    OpMove(BenchData, 0, BenchOut, 3, 0120),        // DM 80 characters
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp ecsOps[] =
+    {
+    Op30(001, 2, 0, BenchEcsWords, 0),              // WEC B0+ECSWORDS
+    Op15(000, 0, 0, 0),                             // PS (error exit)
+    Op30(001, 1, 0, BenchEcsWords, 0),              // REC B0+ECSWORDS
+    Op15(000, 0, 0, 0),                             // PS (error exit)
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp exchangeOps[] =
+    {
+    Op30(001, 3, 0, 0, BenchEndWord),               // XJ
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchOp monitorOps[] =
+    {
+    Op30(001, 3, 0, BenchXpMonitor, BenchEndWord),  // XJ B0+XPMONITOR
+    Op30(002, 0, 0, 0, BenchToStart | BenchEndWord),// JP START
+    OpEnd
+    };
+
+static BenchProgram programs[] =
+    {
+        {
+        "integer", integerOps, NULL, 0,
+        { 0, 0, 3, 0, 0, 0, 0, 0 },
+        { 0 },
+        { 0, 1, 0, 0, 0, 0, 0, 0 }
+        },
+        {
+        "float", floatOps, NULL, 0,
+        { 0, 0, 017226000000000000000, 017216000000000000000, 0, 0, 0, 0 },   // X2 3.0, X3 1.5
+        { 0 },
+        { 0 }
+        },
+        {
+        "memory", memoryOps, NULL, 0,
+        { 0 },
+        { 0 },
+        { 0, 0, BenchDataWords, 0, 0, 0, 0, 0 }
+        },
+        {
+        "branch", branchOps, NULL, 0,
+        { 0, 1, 0, 0, 0, 0, 0, 0 },
+        { 0 },
+        { 0, 0, Mask18, 0, 0, 0, 0, 0 }
+        },
+        {
+        "cmu", cmuOps, NULL, HasCMU,
+        { 0 },
+        { 0 },
+        { 0 }
+        },
+        {
+        "ecs", ecsOps, NULL, 0,
+        { 0 },
+        { BenchData, 0, 0, 0, 0, 0, 0, 0 },
+        { 0 }
+        },
+        {
+        "exchange", exchangeOps, monitorOps, 0,
+        { 0 },
+        { 0 },
+        { 0 }
+        },
+    };
+
+static BenchModel models[] =
+    {
+    { "6400",       Model6400,      Features6400 },
+    { "CYBER73",    ModelCyber73,   FeaturesCyber73 },
+    { "CYBER173",   ModelCyber173,  FeaturesCyber173 },
+    { "CYBER175",   ModelCyber175,  FeaturesCyber175 },
+    { "CYBER865",   ModelCyber865,  FeaturesCyber865 },
+    };
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        CPU benchmark main program.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        argument values
+**
+**  Returns:        0 if all benchmarks ran, 1 otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+    {
+    BenchModel *model = benchFindModel("CYBER173");
+    u32 seconds = 2;
+    int failed = 0;
+    int selected = 0;
+    int i;
+    int j;
+
+    /*
+    **  Parse command line.
+    */
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+        {
+        if (argv[i][2] != '\0' || i + 1 >= argc)
+            {
+            usage();
+            }
+
+        switch (argv[i][1])
+            {
+        case 'm':
+            model = benchFindModel(argv[++i]);
+            if (model == NULL)
+                {
+                usage();
+                }
+            break;
+
+        case 't':
+            seconds = atoi(argv[++i]);
+            break;
+
+        default:
+            usage();
+            }
+        }
+
+    if (seconds < 1)
+        {
+        usage();
+        }
+
+    modelType = model->type;
+    features = model->features;
+    memHugePages = 0;
+
+    cpuInit(model->name, BenchMemory, BenchEcsBanks, ECS, 1);
+
+    printf("%-10s %10s %14s\n", "Class", "MIPS", "Instructions");
+
+    for (j = 0; j < (int)(sizeof(programs) / sizeof(programs[0])); j++)
+        {
+        if (i < argc)
+            {
+            /*
+            **  Only run the classes named on the command line.
+            */
+            for (selected = i; selected < argc; selected++)
+                {
+                if (strcmp(argv[selected], programs[j].name) == 0)
+                    {
+                    break;
+                    }
+                }
+
+            if (selected == argc)
+                {
+                continue;
+                }
+            }
+
+        if ((features & programs[j].needs) != programs[j].needs)
+            {
+            printf("%-10s %10s\n", programs[j].name, "n/a");
+            continue;
+            }
+
+        if (!benchRun(programs + j, seconds))
+            {
+            failed += 1;
+            }
+        }
+
+    cpuTerminate();
+
+    return(failed == 0 ? 0 : 1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Exchange package accounting, not needed here.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context
+**                  xpAddress   exchange package address
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsExchange(CpuContext *cc, u32 xpAddress)
+    {
+    (void)cc;
+    (void)xpAddress;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Update the microsecond clock read by RC.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void rtcReadUsCounter(void)
+    {
+    rtcClock = (u32)getMicroseconds();
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Display usage and exit.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Does not return.
+**
+**------------------------------------------------------------------------*/
+static void usage(void)
+    {
+    int i;
+
+    fprintf(stderr, "usage: dtcpubench [-m model] [-t seconds] [class ...]\n");
+    fprintf(stderr, "    -m model     6400, CYBER73, CYBER173, CYBER175 or CYBER865 (default CYBER173)\n");
+    fprintf(stderr, "    -t seconds   run time of each class (default 2)\n");
+    fprintf(stderr, "    classes:    ");
+    for (i = 0; i < (int)(sizeof(programs) / sizeof(programs[0])); i++)
+        {
+        fprintf(stderr, " %s", programs[i].name);
+        }
+
+    fprintf(stderr, "\n");
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Look up a model by name.
+**
+**  Parameters:     Name        Description.
+**                  name        model name
+**
+**  Returns:        Model, NULL if not found.
+**
+**------------------------------------------------------------------------*/
+static BenchModel *benchFindModel(char *name)
+    {
+    int i;
+
+    for (i = 0; i < (int)(sizeof(models) / sizeof(models[0])); i++)
+        {
+        if (stricmp(models[i].name, name) == 0)
+            {
+            return(models + i);
+            }
+        }
+
+    return(NULL);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run one benchmark program and report its speed.
+**
+**  Parameters:     Name        Description.
+**                  bp          benchmark program
+**                  seconds     run time
+**
+**  Returns:        TRUE if the program ran, FALSE if the CPU stopped.
+**
+**------------------------------------------------------------------------*/
+static bool benchRun(BenchProgram *bp, u32 seconds)
+    {
+    u64 startInstructions;
+    u64 instructions;
+    u64 start;
+    u64 elapsed;
+    int i;
+
+    benchSetup(bp);
+
+    startInstructions = activeCpu->instructions;
+    start = getMicroseconds();
+
+    do
+        {
+        for (i = 0; i < BenchBatch; i++)
+            {
+            cpuStep();
+            }
+
+        if (activeCpu->isStopped)
+            {
+            printf("%-10s CPU stopped at P=%06o, exit condition %02o\n",
+                bp->name, activeCpu->regP, activeCpu->exitCondition);
+            return(FALSE);
+            }
+
+        elapsed = getMicroseconds() - start;
+        } while (elapsed < (u64)seconds * 1000000);
+
+    instructions = activeCpu->instructions - startInstructions;
+    printf("%-10s %10.2f %14.0f\n", bp->name, (double)instructions / (double)elapsed, (double)instructions);
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Load a benchmark program and start the CPU on it.
+**
+**  Parameters:     Name        Description.
+**                  bp          benchmark program
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void benchSetup(BenchProgram *bp)
+    {
+    u32 i;
+
+    memset(cpMem, 0, BenchMemory * sizeof(CpWord));
+
+    for (i = 0; i < BenchDataWords + 2; i++)
+        {
+        cpMem[BenchRa + BenchData + i] = ((CpWord)i * 0123456701) & Mask60;
+        }
+
+    benchAssemble(bp->ops, BenchRa, BenchCode);
+    benchPackage(BenchXpProgram, BenchCode, BenchRa, BenchFl, BenchXpMonitor, bp);
+
+    if (bp->monitor != NULL)
+        {
+        benchAssemble(bp->monitor, 0, BenchMonitorCode);
+        benchPackage(BenchXpMonitor, BenchMonitorCode, 0, BenchMemory, BenchXpMonitor, NULL);
+        }
+
+    activeCpu->isStopped = TRUE;
+    activeCpu->monitorMode = FALSE;
+    activeCpu->exitCondition = 0;
+    cpuExchangeJump(BenchXpProgram);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack instructions into words.
+**
+**  Parameters:     Name        Description.
+**                  op          instructions, ended by a zero length
+**                  ra          reference address
+**                  origin      relative address of the first word
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void benchAssemble(BenchOp *op, u32 ra, u32 origin)
+    {
+    u32 address = origin;
+    CpWord word = 0;
+    CpWord value;
+    int offset = 60;
+
+    for (; op->length != 0; op++)
+        {
+        if (offset < op->length)
+            {
+            /*
+            **  Fill the rest of the word with passes.
+            */
+            while (offset > 0)
+                {
+                offset -= 15;
+                word |= (CpWord)BenchPass << offset;
+                }
+
+            cpMem[ra + address++] = word;
+            word = 0;
+            offset = 60;
+            }
+
+        value = op->value;
+        if ((op->flags & BenchToStart) != 0)
+            {
+            value |= origin;
+            }
+        else if ((op->flags & BenchToNext) != 0)
+            {
+            value |= address + 1;
+            }
+
+        offset -= op->length;
+        word |= value << offset;
+
+        if ((op->flags & (BenchToNext | BenchEndWord)) != 0)
+            {
+            while (offset > 0)
+                {
+                offset -= 15;
+                word |= (CpWord)BenchPass << offset;
+                }
+            }
+        }
+
+    while (offset > 0 && offset < 60)
+        {
+        offset -= 15;
+        word |= (CpWord)BenchPass << offset;
+        }
+
+    if (offset == 0)
+        {
+        cpMem[ra + address] = word;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build an exchange package.
+**
+**  Parameters:     Name        Description.
+**                  address     absolute address of package
+**                  p           program address
+**                  ra          reference address
+**                  fl          field length
+**                  ma          monitor address
+**                  bp          benchmark program with initial registers
+**                              or NULL
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void benchPackage(u32 address, u32 p, u32 ra, u32 fl, u32 ma, BenchProgram *bp)
+    {
+    static BenchProgram empty;
+    CpWord *mem = cpMem + address;
+    int i;
+
+    if (bp == NULL)
+        {
+        bp = &empty;
+        }
+
+    mem[0] = ((CpWord)p << 36) | ((CpWord)bp->a[0] << 18);
+    mem[1] = ((CpWord)ra << 36) | ((CpWord)bp->a[1] << 18) | bp->b[1];
+    mem[2] = ((CpWord)fl << 36) | ((CpWord)bp->a[2] << 18) | bp->b[2];
+    mem[3] = ((CpWord)bp->a[3] << 18) | bp->b[3];
+    mem[4] = ((CpWord)bp->a[4] << 18) | bp->b[4];
+    mem[5] = ((CpWord)BenchFlEcs << 36) | ((CpWord)bp->a[5] << 18) | bp->b[5];
+    mem[6] = ((CpWord)ma << 36) | ((CpWord)bp->a[6] << 18) | bp->b[6];
+    mem[7] = ((CpWord)bp->a[7] << 18) | bp->b[7];
+
+    for (i = 0; i < 8; i++)
+        {
+        mem[010 + i] = bp->x[i] & Mask60;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read wall clock time.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Time in microseconds.
+**
+**------------------------------------------------------------------------*/
+static u64 getMicroseconds(void)
+    {
+#if defined(_WIN32)
+    LARGE_INTEGER count;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return((u64)(count.QuadPart / (frequency.QuadPart / 1000000)));
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return((u64)tv.tv_sec * 1000000 + tv.tv_usec);
+#endif
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
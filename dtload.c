@@ -0,0 +1,1138 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: dtload.c
+**
+**  Description:
+**      Terminal load generator and latency benchmark for the NPU and
+**      6676 multiplexer terminal ports of the emulator. Opens a number
+**      of Telnet sessions over loopback, runs a login and command script
+**      in each and reports percentiles of echo latency, response time
+**      and output throughput.
+**
+**      Script file syntax, one command per line:
+**          expect <text>   wait until <text> has been received
+**          send <text>     send <text> followed by carriage return
+**          echo <text>     type <text> one character at a time, timing
+**                          the echo of each, then send carriage return
+**          sleep <ms>      pause for <ms> milliseconds
+**          loop            start of the part repeated until the run ends
+**      Lines starting with ';' and empty lines are ignored. In <text>,
+**      "%d" is replaced by the session number and "%%" by "%"; any other
+**      character is sent as it is.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#if defined(_WIN32)
+#include <windows.h>
+#include <winsock.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxSessions     1000
+#define MaxScript       200
+#define MaxLine         256
+#define RecvBufSize     8192
+#define DefaultTimeout  30000               // ms to wait for expected text
+#define PollMs          5
+
+/*
+**  Telnet protocol.
+*/
+#define TelnetIac       255
+#define TelnetDont      254
+#define TelnetDo        253
+#define TelnetWont      252
+#define TelnetWill      251
+#define TelnetSb        250
+#define TelnetSe        240
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef enum
+    {
+    CmdExpect,
+    CmdSend,
+    CmdEcho,
+    CmdSleep,
+    CmdLoop,
+    } CmdType;
+
+typedef struct scriptCmd
+    {
+    CmdType             type;
+    char                *text;
+    long                ms;
+    } ScriptCmd;
+
+typedef enum
+    {
+    TnData,
+    TnIac,
+    TnOption,
+    TnSub,
+    TnSubIac,
+    } TelnetState;
+
+typedef struct session
+    {
+    int                 fd;
+    int                 number;
+    int                 pc;                 // current script command
+    bool                done;
+    bool                failed;
+    char                text[MaxLine];      // current command text after substitution
+    int                 textLen;
+    TelnetState         tnState;
+    u8                  tnCommand;
+
+    /*
+    **  Received data not yet consumed by an expect or echo.
+    */
+    char                rxBuf[RecvBufSize];
+    int                 rxLen;
+
+    /*
+    **  Timing of the current command.
+    */
+    u64                 cmdStart;           // start of current command
+    u64                 deadline;           // timeout or end of sleep
+    u64                 sendTime;           // last send, 0 if no response pending
+    u64                 firstByte;          // first byte received after send
+    u32                 rxBytes;            // bytes received since send
+    int                 echoPos;            // next character to type
+    bool                echoPending;        // waiting for echo of typed character
+    } Session;
+
+typedef struct samples
+    {
+    u32                 *value;
+    int                 count;
+    int                 size;
+    } Samples;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void usage(void);
+static void loadScript(char *fileName);
+static bool sessionOpen(Session *sp);
+static void sessionClose(Session *sp);
+static void sessionStart(Session *sp);
+static void sessionExpand(Session *sp, char *text);
+static void sessionStep(Session *sp, u64 now);
+static void sessionReceive(Session *sp, u64 now);
+static void sessionSend(Session *sp, char *data, int len);
+static void sessionFail(Session *sp, char *reason);
+static void sessionConsume(Session *sp, int len);
+static void sampleAdd(Samples *sp, u32 value);
+static void sampleReport(char *title, char *unit, Samples *sp);
+static int sampleCompare(const void *a, const void *b);
+static u64 getMicroseconds(void);
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static ScriptCmd script[MaxScript];
+static int scriptLen = 0;
+static int loopStart = -1;
+
+static char *hostAddr = "127.0.0.1";
+static int tcpPort = 6610;
+static int numSessions = 1;
+static long durationMs = 60000;
+static long rampMs = 100;
+static long timeoutMs = DefaultTimeout;
+
+static Session *sessions;
+static u64 runStart;
+static u64 runEnd;
+static u64 totalBytes = 0;
+
+static Samples echoLatency;
+static Samples responseTime;
+static Samples firstByteTime;
+static Samples throughput;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Load generator main program.
+**
+**  Parameters:     Name        Description.
+**                  argc        Argument count.
+**                  argv        Array of argument strings.
+**
+**  Returns:        Zero if all sessions completed, 1 otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+    {
+    char *scriptFile = NULL;
+    fd_set readFds;
+    struct timeval timeout;
+    Session *sp;
+    int started = 0;
+    int active;
+    int failed = 0;
+    int maxFd;
+    int i;
+    u64 now;
+    double seconds;
+#if defined(_WIN32)
+    WSADATA wsaData;
+
+    if (WSAStartup(MAKEWORD(1, 1), &wsaData) != 0)
+        {
+        fprintf(stderr, "Error in WSAStartup\n");
+        exit(1);
+        }
+#endif
+
+    /*
+    **  Parse command line.
+    */
+    for (i = 1; i < argc; i++)
+        {
+        if (argv[i][0] != '-' || argv[i][2] != '\0' || i + 1 >= argc)
+            {
+            usage();
+            }
+
+        switch (argv[i][1])
+            {
+        case 'h':
+            hostAddr = argv[++i];
+            break;
+
+        case 'p':
+            tcpPort = atoi(argv[++i]);
+            break;
+
+        case 'n':
+            numSessions = atoi(argv[++i]);
+            break;
+
+        case 's':
+            scriptFile = argv[++i];
+            break;
+
+        case 'd':
+            durationMs = atol(argv[++i]) * 1000;
+            break;
+
+        case 'r':
+            rampMs = atol(argv[++i]);
+            break;
+
+        case 't':
+            timeoutMs = atol(argv[++i]) * 1000;
+            break;
+
+        default:
+            usage();
+            }
+        }
+
+    if (scriptFile == NULL || numSessions < 1 || numSessions > MaxSessions || tcpPort < 1 || tcpPort > 65535)
+        {
+        usage();
+        }
+
+    loadScript(scriptFile);
+
+    sessions = calloc(numSessions, sizeof(Session));
+    if (sessions == NULL)
+        {
+        fprintf(stderr, "Failed to allocate sessions\n");
+        exit(1);
+        }
+
+    for (i = 0; i < numSessions; i++)
+        {
+        sessions[i].fd = -1;
+        sessions[i].number = i + 1;
+        }
+
+    printf("Running %d session(s) against %s:%d for %ld seconds\n", numSessions, hostAddr, tcpPort, durationMs / 1000);
+
+    runStart = getMicroseconds();
+    runEnd = runStart + (u64)durationMs * 1000;
+
+    /*
+    **  Run until all sessions have finished their script.
+    */
+    for (;;)
+        {
+        now = getMicroseconds();
+
+        /*
+        **  Start sessions spread over the ramp interval.
+        */
+        while (started < numSessions && now >= runStart + (u64)started * rampMs * 1000)
+            {
+            sp = sessions + started++;
+            if (sessionOpen(sp))
+                {
+                sessionStart(sp);
+                }
+            }
+
+        /*
+        **  Advance every session as far as it goes without waiting.
+        */
+        active = 0;
+        maxFd = -1;
+        FD_ZERO(&readFds);
+        for (i = 0, sp = sessions; i < started; i++, sp++)
+            {
+            if (sp->done)
+                {
+                continue;
+                }
+
+            sessionStep(sp, now);
+            if (sp->done)
+                {
+                continue;
+                }
+
+            active += 1;
+            FD_SET(sp->fd, &readFds);
+            if (maxFd < sp->fd)
+                {
+                maxFd = sp->fd;
+                }
+            }
+
+        if (active == 0 && started == numSessions)
+            {
+            break;
+            }
+
+        timeout.tv_sec = 0;
+        timeout.tv_usec = PollMs * 1000;
+        if (maxFd < 0)
+            {
+        #if defined(_WIN32)
+            Sleep(PollMs);
+        #else
+            usleep(PollMs * 1000);
+        #endif
+            continue;
+            }
+
+        if (select(maxFd + 1, &readFds, NULL, NULL, &timeout) <= 0)
+            {
+            continue;
+            }
+
+        now = getMicroseconds();
+        for (i = 0, sp = sessions; i < started; i++, sp++)
+            {
+            if (!sp->done && FD_ISSET(sp->fd, &readFds))
+                {
+                sessionReceive(sp, now);
+                }
+            }
+        }
+
+    /*
+    **  Report results.
+    */
+    seconds = (double)(getMicroseconds() - runStart) / 1000000.0;
+    for (i = 0; i < numSessions; i++)
+        {
+        if (sessions[i].failed)
+            {
+            failed += 1;
+            }
+        }
+
+    printf("\nSessions: %d completed, %d failed\n", numSessions - failed, failed);
+    printf("Received %llu bytes in %.1f seconds (%.0f bytes/s)\n\n",
+        (unsigned long long)totalBytes, seconds, seconds > 0 ? (double)totalBytes / seconds : 0.0);
+    printf("%-28s %7s %9s %9s %9s %9s %9s\n", "", "count", "min", "50%", "90%", "99%", "max");
+    sampleReport("Echo latency", "us", &echoLatency);
+    sampleReport("First byte after send", "us", &firstByteTime);
+    sampleReport("Response time", "us", &responseTime);
+    sampleReport("Output throughput", "B/s", &throughput);
+
+    return(failed == 0 ? 0 : 1);
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print usage and exit.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void usage(void)
+    {
+    fprintf(stderr, "usage: dtload -s script [-h host] [-p port] [-n sessions] [-d seconds] [-r rampms] [-t timeout]\n");
+    fprintf(stderr, "    -s script    login and command script\n");
+    fprintf(stderr, "    -h host      emulator address (default 127.0.0.1)\n");
+    fprintf(stderr, "    -p port      NPU or mux6676 Telnet port (default 6610)\n");
+    fprintf(stderr, "    -n sessions  number of concurrent sessions, 1 - %d (default 1)\n", MaxSessions);
+    fprintf(stderr, "    -d seconds   time to repeat the looped part of the script (default 60)\n");
+    fprintf(stderr, "    -r rampms    delay between session starts in ms (default 100)\n");
+    fprintf(stderr, "    -t timeout   seconds to wait for expected text (default %d)\n", DefaultTimeout / 1000);
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and parse script file.
+**
+**  Parameters:     Name        Description.
+**                  fileName    script file name
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void loadScript(char *fileName)
+    {
+    FILE *fp;
+    char line[MaxLine];
+    char *cp;
+    char *arg;
+    int lineNo = 0;
+    ScriptCmd *cmd;
+
+    fp = fopen(fileName, "r");
+    if (fp == NULL)
+        {
+        fprintf(stderr, "Can't open script %s\n", fileName);
+        exit(1);
+        }
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+        {
+        lineNo += 1;
+
+        /*
+        **  Strip line terminator.
+        */
+        cp = line + strlen(line);
+        while (cp > line && (cp[-1] == '\n' || cp[-1] == '\r'))
+            {
+            *--cp = '\0';
+            }
+
+        if (line[0] == '\0' || line[0] == ';')
+            {
+            continue;
+            }
+
+        if (scriptLen >= MaxScript)
+            {
+            fprintf(stderr, "Script %s has more than %d commands\n", fileName, MaxScript);
+            exit(1);
+            }
+
+        /*
+        **  Split keyword and argument.
+        */
+        arg = strchr(line, ' ');
+        if (arg != NULL)
+            {
+            *arg++ = '\0';
+            }
+        else
+            {
+            arg = "";
+            }
+
+        cmd = script + scriptLen;
+        cmd->text = strdup(arg);
+
+        if (strcmp(line, "expect") == 0)
+            {
+            cmd->type = CmdExpect;
+            }
+        else if (strcmp(line, "send") == 0)
+            {
+            cmd->type = CmdSend;
+            }
+        else if (strcmp(line, "echo") == 0)
+            {
+            cmd->type = CmdEcho;
+            }
+        else if (strcmp(line, "sleep") == 0)
+            {
+            cmd->type = CmdSleep;
+            cmd->ms = atol(arg);
+            }
+        else if (strcmp(line, "loop") == 0)
+            {
+            cmd->type = CmdLoop;
+            loopStart = scriptLen + 1;
+            }
+        else
+            {
+            fprintf(stderr, "Script %s line %d: unknown command '%s'\n", fileName, lineNo, line);
+            exit(1);
+            }
+
+        if (cmd->type == CmdExpect && arg[0] == '\0')
+            {
+            fprintf(stderr, "Script %s line %d: expect needs text\n", fileName, lineNo);
+            exit(1);
+            }
+
+        scriptLen += 1;
+        }
+
+    fclose(fp);
+
+    if (scriptLen == 0)
+        {
+        fprintf(stderr, "Script %s is empty\n", fileName);
+        exit(1);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Connect a session to the emulator.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**
+**  Returns:        TRUE if connected, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool sessionOpen(Session *sp)
+    {
+    struct sockaddr_in server;
+    int optEnable = 1;
+#if defined(_WIN32)
+    u_long blockEnable = 1;
+#endif
+
+    sp->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sp->fd < 0)
+        {
+        sessionFail(sp, "can't create socket");
+        return(FALSE);
+        }
+
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = inet_addr(hostAddr);
+    server.sin_port = htons(tcpPort);
+
+    if (connect(sp->fd, (struct sockaddr *)&server, sizeof(server)) < 0)
+        {
+        sessionFail(sp, "can't connect");
+        return(FALSE);
+        }
+
+    /*
+    **  Typed characters must go out at once, like from a real terminal.
+    */
+    setsockopt(sp->fd, IPPROTO_TCP, TCP_NODELAY, (char *)&optEnable, sizeof(optEnable));
+
+#if defined(_WIN32)
+    ioctlsocket(sp->fd, FIONBIO, &blockEnable);
+#else
+    fcntl(sp->fd, F_SETFL, O_NONBLOCK);
+#endif
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close a session's connection.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionClose(Session *sp)
+    {
+    if (sp->fd >= 0)
+        {
+    #if defined(_WIN32)
+        closesocket(sp->fd);
+    #else
+        close(sp->fd);
+    #endif
+        sp->fd = -1;
+        }
+
+    sp->done = TRUE;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Start the current script command of a session.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionStart(Session *sp)
+    {
+    ScriptCmd *cmd;
+    u64 now = getMicroseconds();
+
+    /*
+    **  At the end of the script go round the loop until the run is over.
+    */
+    if (sp->pc >= scriptLen)
+        {
+        if (loopStart < 0 || loopStart >= scriptLen || now >= runEnd)
+            {
+            sessionClose(sp);
+            return;
+            }
+
+        sp->pc = loopStart;
+        }
+
+    cmd = script + sp->pc;
+    sessionExpand(sp, cmd->text);
+
+    sp->cmdStart = now;
+    sp->echoPos = 0;
+    sp->echoPending = FALSE;
+
+    switch (cmd->type)
+        {
+    case CmdExpect:
+        sp->deadline = now + (u64)timeoutMs * 1000;
+        break;
+
+    case CmdSleep:
+        sp->deadline = now + (u64)cmd->ms * 1000;
+        break;
+
+    default:
+        sp->deadline = 0;
+        break;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Substitute the session number into the text of a
+**                  script command. The script text is never used as a
+**                  format string.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  text        script command text
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionExpand(Session *sp, char *text)
+    {
+    char number[12];
+    int len = 0;
+    int n;
+
+    while (*text != '\0' && len < (int)sizeof(sp->text) - 1)
+        {
+        if (text[0] == '%' && text[1] == 'd')
+            {
+            n = sprintf(number, "%d", sp->number);
+            if (len + n >= (int)sizeof(sp->text))
+                {
+                break;
+                }
+
+            memcpy(sp->text + len, number, n);
+            len += n;
+            text += 2;
+            continue;
+            }
+
+        if (text[0] == '%' && text[1] == '%')
+            {
+            text += 1;
+            }
+
+        sp->text[len++] = *text++;
+        }
+
+    sp->text[len] = '\0';
+    sp->textLen = len;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Advance a session through its script as far as
+**                  possible without waiting.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  now         current time in microseconds
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionStep(Session *sp, u64 now)
+    {
+    ScriptCmd *cmd;
+    char *match;
+
+    while (!sp->done)
+        {
+        cmd = script + sp->pc;
+
+        switch (cmd->type)
+            {
+        case CmdExpect:
+            sp->rxBuf[sp->rxLen] = '\0';
+            match = strstr(sp->rxBuf, sp->text);
+            if (match == NULL)
+                {
+                if (now >= sp->deadline)
+                    {
+                    sessionFail(sp, "timeout waiting for expected text");
+                    }
+
+                return;
+                }
+
+            /*
+            **  Completes the response to the last send.
+            */
+            if (sp->sendTime != 0)
+                {
+                sampleAdd(&responseTime, (u32)(now - sp->sendTime));
+                if (now > sp->sendTime && sp->rxBytes > 0)
+                    {
+                    sampleAdd(&throughput, (u32)((u64)sp->rxBytes * 1000000 / (now - sp->sendTime)));
+                    }
+
+                sp->sendTime = 0;
+                }
+
+            sessionConsume(sp, (match - sp->rxBuf) + sp->textLen);
+            break;
+
+        case CmdSend:
+            sessionSend(sp, sp->text, sp->textLen);
+            sessionSend(sp, "\r", 1);
+            sp->sendTime = now;
+            sp->firstByte = 0;
+            sp->rxBytes = 0;
+            break;
+
+        case CmdEcho:
+            if (sp->echoPending)
+                {
+                /*
+                **  Wait for the echo of the character typed last.
+                */
+                sp->rxBuf[sp->rxLen] = '\0';
+                match = strchr(sp->rxBuf, sp->text[sp->echoPos - 1]);
+                if (match == NULL)
+                    {
+                    if (now >= sp->cmdStart + (u64)timeoutMs * 1000)
+                        {
+                        sessionFail(sp, "timeout waiting for echo");
+                        }
+
+                    return;
+                    }
+
+                sampleAdd(&echoLatency, (u32)(now - sp->sendTime));
+                sessionConsume(sp, (match - sp->rxBuf) + 1);
+                sp->echoPending = FALSE;
+                }
+
+            if (sp->echoPos < sp->textLen)
+                {
+                sessionSend(sp, sp->text + sp->echoPos, 1);
+                sp->echoPos += 1;
+                sp->echoPending = TRUE;
+                sp->sendTime = now;
+                sp->cmdStart = now;
+                return;
+                }
+
+            /*
+            **  Line typed - enter it and time the response.
+            */
+            sessionSend(sp, "\r", 1);
+            sp->sendTime = now;
+            sp->firstByte = 0;
+            sp->rxBytes = 0;
+            break;
+
+        case CmdSleep:
+            if (now < sp->deadline)
+                {
+                return;
+                }
+
+            break;
+
+        case CmdLoop:
+            break;
+            }
+
+        if (sp->done)
+            {
+            return;
+            }
+
+        sp->pc += 1;
+        sessionStart(sp);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Receive data for a session and strip Telnet commands,
+**                  refusing all options.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  now         current time in microseconds
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionReceive(Session *sp, u64 now)
+    {
+    u8 data[RecvBufSize];
+    u8 reply[3];
+    u8 ch;
+    int len;
+    int i;
+
+    len = recv(sp->fd, data, sizeof(data), 0);
+    if (len <= 0)
+        {
+        sessionFail(sp, "connection closed");
+        return;
+        }
+
+    totalBytes += len;
+    if (sp->sendTime != 0)
+        {
+        if (sp->firstByte == 0)
+            {
+            sp->firstByte = now;
+            sampleAdd(&firstByteTime, (u32)(now - sp->sendTime));
+            }
+
+        sp->rxBytes += len;
+        }
+
+    for (i = 0; i < len; i++)
+        {
+        ch = data[i];
+
+        switch (sp->tnState)
+            {
+        case TnData:
+            if (ch == TelnetIac)
+                {
+                sp->tnState = TnIac;
+                }
+            else if (ch != 0)
+                {
+                /*
+                **  Keep the most recent data if nothing consumes it.
+                */
+                if (sp->rxLen >= RecvBufSize - 1)
+                    {
+                    sessionConsume(sp, RecvBufSize / 2);
+                    }
+
+                sp->rxBuf[sp->rxLen++] = ch;
+                }
+
+            break;
+
+        case TnIac:
+            switch (ch)
+                {
+            case TelnetDo:
+            case TelnetDont:
+            case TelnetWill:
+            case TelnetWont:
+                sp->tnCommand = ch;
+                sp->tnState = TnOption;
+                break;
+
+            case TelnetSb:
+                sp->tnState = TnSub;
+                break;
+
+            default:
+                sp->tnState = TnData;
+                break;
+                }
+
+            break;
+
+        case TnOption:
+            if (sp->tnCommand == TelnetDo || sp->tnCommand == TelnetWill)
+                {
+                reply[0] = TelnetIac;
+                reply[1] = sp->tnCommand == TelnetDo ? TelnetWont : TelnetDont;
+                reply[2] = ch;
+                sessionSend(sp, (char *)reply, 3);
+                }
+
+            sp->tnState = TnData;
+            break;
+
+        case TnSub:
+            if (ch == TelnetIac)
+                {
+                sp->tnState = TnSubIac;
+                }
+
+            break;
+
+        case TnSubIac:
+            sp->tnState = ch == TelnetSe ? TnData : TnSub;
+            break;
+            }
+        }
+
+    sessionStep(sp, now);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send data on a session.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  data        data address
+**                  len         data length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionSend(Session *sp, char *data, int len)
+    {
+    int result;
+
+    while (len > 0 && !sp->done)
+        {
+        result = send(sp->fd, data, len, 0);
+        if (result <= 0)
+            {
+        #if !defined(_WIN32)
+            if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                usleep(1000);
+                continue;
+                }
+        #endif
+            sessionFail(sp, "send failed");
+            return;
+            }
+
+        data += result;
+        len -= result;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Abort a session.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  reason      reason for the failure
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionFail(Session *sp, char *reason)
+    {
+    fprintf(stderr, "Session %d: %s at script command %d\n", sp->number, reason, sp->pc + 1);
+    sp->failed = TRUE;
+    sessionClose(sp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Discard data from the start of the receive buffer.
+**
+**  Parameters:     Name        Description.
+**                  sp          session
+**                  len         number of bytes to discard
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sessionConsume(Session *sp, int len)
+    {
+    if (len > sp->rxLen)
+        {
+        len = sp->rxLen;
+        }
+
+    memmove(sp->rxBuf, sp->rxBuf + len, sp->rxLen - len);
+    sp->rxLen -= len;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Record a measurement.
+**
+**  Parameters:     Name        Description.
+**                  sp          sample set
+**                  value       measured value
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sampleAdd(Samples *sp, u32 value)
+    {
+    if (sp->count == sp->size)
+        {
+        sp->size = sp->size == 0 ? 1024 : sp->size * 2;
+        sp->value = realloc(sp->value, sp->size * sizeof(u32));
+        if (sp->value == NULL)
+            {
+            fprintf(stderr, "Failed to allocate samples\n");
+            exit(1);
+            }
+        }
+
+    sp->value[sp->count++] = value;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print percentiles of a set of measurements.
+**
+**  Parameters:     Name        Description.
+**                  title       measurement name
+**                  unit        unit of the values
+**                  sp          sample set
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void sampleReport(char *title, char *unit, Samples *sp)
+    {
+    char label[40];
+    int n = sp->count;
+
+    sprintf(label, "%s (%s)", title, unit);
+    if (n == 0)
+        {
+        printf("%-28s %7d\n", label, 0);
+        return;
+        }
+
+    qsort(sp->value, n, sizeof(u32), sampleCompare);
+    printf("%-28s %7d %9u %9u %9u %9u %9u\n", label, n,
+        sp->value[0], sp->value[n * 50 / 100], sp->value[n * 90 / 100],
+        sp->value[n * 99 / 100], sp->value[n - 1]);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two measurements for qsort.
+**
+**  Parameters:     Name        Description.
+**                  a           first value
+**                  b           second value
+**
+**  Returns:        <0, 0 or >0.
+**
+**------------------------------------------------------------------------*/
+static int sampleCompare(const void *a, const void *b)
+    {
+    u32 x = *(const u32 *)a;
+    u32 y = *(const u32 *)b;
+
+    return(x < y ? -1 : x > y ? 1 : 0);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read wall clock time.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Time in microseconds.
+**
+**------------------------------------------------------------------------*/
+static u64 getMicroseconds(void)
+    {
+#if defined(_WIN32)
+    return((u64)GetTickCount() * 1000);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return((u64)tv.tv_sec * 1000000 + tv.tv_usec);
+#endif
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
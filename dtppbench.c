@@ -0,0 +1,713 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: dtppbench.c
+**
+**  Description:
+**      PP and channel micro-benchmark. Runs the PPs and channels of the
+**      emulator (pp.c and channel.c) without operating system or real
+**      devices. Each PP runs a canned program against a loopback device
+**      on a channel of its own, or against the interlock register, and
+**      the PP instructions per second and channel words per second are
+**      reported for each class of programs:
+**          direct      direct cell arithmetic, no I/O
+**          block       OAM/IAM block transfers through the loopback
+**          flag        OAN with tight empty/active channel flag loops
+**          cm          CRM/CWM central memory block transfers
+**          interlock   test & set / test & clear of the interlock register
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define BenchMemory         0200000     // CM words
+#define BenchChannels       020
+#define BenchMaxPps         012         // loopback channels 0 - 11
+#define BenchBatch          1000        // major cycles between clock reads
+#define BenchIlrBits        64
+
+/*
+**  PP program layout.
+*/
+#define BenchOrigin         0100
+#define BenchCounter        040         // loop counter of the cm class
+#define BenchCount          041         // CRM/CWM word count
+#define BenchCmWords        0100
+
+/*
+**  Program word to which the unit of the PP (its channel or interlock
+**  bit) is added when the program is loaded.
+*/
+#define BenchUnit           0100000
+
+/*
+**  End of a PP program.
+*/
+#define BenchEnd            0177777
+
+/*
+**  Loopback device function codes and buffer.
+*/
+#define LoopbackWrite       1
+#define LoopbackRead        2
+#define LoopbackSize        010000
+#define LoopbackMask        (LoopbackSize - 1)
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct benchProgram
+    {
+    char                *name;          /* program class */
+    PpWord              *code;          /* program loaded at BenchOrigin, ended by BenchEnd */
+    bool                interlock;      /* unit is an interlock bit, not a channel */
+    bool                cm;             /* words are counted from CM loops */
+    } BenchProgram;
+
+typedef struct loopback
+    {
+    PpWord              buffer[LoopbackSize];
+    u32                 in;             /* words written by the PP */
+    u32                 out;            /* words read by the PP */
+    } Loopback;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void usage(void);
+static void benchRun(BenchProgram *bp, u32 seconds);
+static void benchSetup(BenchProgram *bp);
+static u64 benchWords(BenchProgram *bp);
+static FcStatus loopFunc(PpWord funcCode);
+static void loopIo(void);
+static void loopActivate(void);
+static void loopDisconnect(void);
+static u64 getMicroseconds(void);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  Normally defined by the parts of the emulator which are not linked.
+*/
+bool emulationActive = TRUE;
+ModelFeatures features = FeaturesCyber73;
+ModelType modelType = ModelCyber73;
+char persistDir[256] = "";
+char ecsSharedName[64] = "";
+u32 rtcClock = 0;
+u32 traceSequenceNo = 0;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static PpWord directCode[] =
+    {
+    03040,                                  // LDD 40
+    01601,                                  // ADN 1
+    03440,                                  // STD 40
+    01003,                                  // SHN 3
+    03141,                                  // ADD 41
+    01277,                                  // LPN 77
+    03441,                                  // STD 41
+    00100, BenchOrigin,                     // LJM ORIGIN
+    BenchEnd
+    };
+
+static PpWord blockCode[] =
+    {
+    07700 + BenchUnit, LoopbackWrite,       // FNC WRITE,CH
+    07400 + BenchUnit,                      // ACN CH
+    02000, 01000,                           // LDC 1000
+    07300 + BenchUnit, 01000,               // OAM 1000,CH
+    07500 + BenchUnit,                      // DCN CH
+    07700 + BenchUnit, LoopbackRead,        // FNC READ,CH
+    07400 + BenchUnit,                      // ACN CH
+    02000, 01000,                           // LDC 1000
+    07100 + BenchUnit, 02000,               // IAM 2000,CH
+    07500 + BenchUnit,                      // DCN CH
+    00100, BenchOrigin,                     // LJM ORIGIN
+    BenchEnd
+    };
+
+static PpWord flagCode[] =
+    {
+    07700 + BenchUnit, LoopbackWrite,       // FNC WRITE,CH
+    07400 + BenchUnit,                      // ACN CH
+    01401,                                  // LOOP   LDN 1
+    07200 + BenchUnit,                      //        OAN CH
+    06700 + BenchUnit, BenchOrigin + 011,   // WAIT   EJM EMPTY,CH
+    00100, BenchOrigin + 5,                 //        LJM WAIT
+    06500 + BenchUnit, BenchOrigin,         // EMPTY  IJM ORIGIN,CH
+    06400 + BenchUnit, BenchOrigin + 3,     //        AJM LOOP,CH
+    00100, BenchOrigin,                     //        LJM ORIGIN
+    BenchEnd
+    };
+
+static PpWord cmCode[] =
+    {
+    02001, 00000,                           // LDC 10000
+    06100 + BenchCount, 01000,              // CRM 1000,COUNT
+    02001, 00000,                           // LDC 10000
+    06300 + BenchCount, 01000,              // CWM 1000,COUNT
+    03600 + BenchCounter,                   // AOD COUNTER
+    00100, BenchOrigin,                     // LJM ORIGIN
+    BenchEnd
+    };
+
+static PpWord interlockCode[] =
+    {
+    02000, 05000 + BenchUnit,               // LDC 5000+BIT (test & set)
+    07200 + ChInterlock,                    // OAN 15
+    07000 + ChInterlock,                    // IAN 15
+    02000, 03000 + BenchUnit,               // LDC 3000+BIT (test & clear)
+    07200 + ChInterlock,                    // OAN 15
+    07000 + ChInterlock,                    // IAN 15
+    00100, BenchOrigin,                     // LJM ORIGIN
+    BenchEnd
+    };
+
+static BenchProgram programs[] =
+    {
+    { "direct",     directCode,     FALSE,  FALSE },
+    { "block",      blockCode,      FALSE,  FALSE },
+    { "flag",       flagCode,       FALSE,  FALSE },
+    { "cm",         cmCode,         FALSE,  TRUE  },
+    { "interlock",  interlockCode,  TRUE,   FALSE },
+    };
+
+static u32 cmLoops[BenchMaxPps];
+static PpWord cmCounter[BenchMaxPps];
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        PP benchmark main program.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        argument values
+**
+**  Returns:        0.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+    {
+    DevSlot *dp;
+    u32 seconds = 2;
+    int pps = BenchMaxPps;
+    int selected = 0;
+    int i;
+    int j;
+
+    /*
+    **  Parse command line.
+    */
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+        {
+        if (argv[i][2] != '\0')
+            {
+            usage();
+            }
+
+        switch (argv[i][1])
+            {
+        case 'b':
+            ppBlockTransfer = TRUE;
+            continue;
+
+        case 'p':
+            if (i + 1 >= argc)
+                {
+                usage();
+                }
+
+            pps = atoi(argv[++i]);
+            break;
+
+        case 't':
+            if (i + 1 >= argc)
+                {
+                usage();
+                }
+
+            seconds = atoi(argv[++i]);
+            break;
+
+        default:
+            usage();
+            }
+        }
+
+    if (seconds < 1 || pps < 1 || pps > BenchMaxPps)
+        {
+        usage();
+        }
+
+    memHugePages = 0;
+
+    /*
+    **  A CYBER 73 with an interlock register and one loopback device
+    **  per PP.
+    */
+    cpuInit("CYBER73", BenchMemory, 0, ECS, 1);
+    ppInit((u8)pps);
+    channelInit(BenchChannels);
+    ilrInit(BenchIlrBits);
+
+    for (j = 0; j < pps; j++)
+        {
+        dp = channelAttach((u8)j, 0, DtNone);
+        dp->activate = loopActivate;
+        dp->disconnect = loopDisconnect;
+        dp->func = loopFunc;
+        dp->io = loopIo;
+        dp->context[0] = calloc(1, sizeof(Loopback));
+        if (dp->context[0] == NULL)
+            {
+            fprintf(stderr, "Failed to allocate loopback context\n");
+            exit(1);
+            }
+        }
+
+    printf("%-10s %4s %10s %14s %14s\n", "Class", "PPs", "PP MIPS", "Words/s", "Words/s/unit");
+
+    for (j = 0; j < (int)(sizeof(programs) / sizeof(programs[0])); j++)
+        {
+        if (i < argc)
+            {
+            /*
+            **  Only run the classes named on the command line.
+            */
+            for (selected = i; selected < argc; selected++)
+                {
+                if (strcmp(argv[selected], programs[j].name) == 0)
+                    {
+                    break;
+                    }
+                }
+
+            if (selected == argc)
+                {
+                continue;
+                }
+            }
+
+        benchRun(programs + j, seconds);
+        }
+
+    return(0);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        PP statistics, not needed here.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void ppStatsSample(void)
+    {
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Exchange package accounting, not needed here.
+**
+**  Parameters:     Name        Description.
+**                  cc          CPU context
+**                  xpAddress   exchange package address
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void cpuStatsExchange(CpuContext *cc, u32 xpAddress)
+    {
+    (void)cc;
+    (void)xpAddress;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Update the microsecond clock.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void rtcReadUsCounter(void)
+    {
+    rtcClock = (u32)getMicroseconds();
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Device termination, no such devices are attached.
+**
+**  Parameters:     Name        Description.
+**                  dp          device descriptor
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void dcc6681Terminate(DevSlot *dp)
+    {
+    (void)dp;
+    }
+
+void mt669Terminate(DevSlot *dp)
+    {
+    (void)dp;
+    }
+
+void mt679Terminate(DevSlot *dp)
+    {
+    (void)dp;
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Display usage and exit.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Does not return.
+**
+**------------------------------------------------------------------------*/
+static void usage(void)
+    {
+    int i;
+
+    fprintf(stderr, "usage: dtppbench [-b] [-p pps] [-t seconds] [class ...]\n");
+    fprintf(stderr, "    -b           enable PP block transfers\n");
+    fprintf(stderr, "    -p pps       number of PPs, 1 to %d (default %d)\n", BenchMaxPps, BenchMaxPps);
+    fprintf(stderr, "    -t seconds   run time of each class (default 2)\n");
+    fprintf(stderr, "    classes:    ");
+    for (i = 0; i < (int)(sizeof(programs) / sizeof(programs[0])); i++)
+        {
+        fprintf(stderr, " %s", programs[i].name);
+        }
+
+    fprintf(stderr, "\n");
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run one benchmark program on all PPs and report its
+**                  speed.
+**
+**                  Words are channel words for the I/O classes and CM
+**                  words for the cm class. The interlock class shares
+**                  one channel, so its unit is the register rather than
+**                  a channel.
+**
+**  Parameters:     Name        Description.
+**                  bp          benchmark program
+**                  seconds     run time
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void benchRun(BenchProgram *bp, u32 seconds)
+    {
+    u32 startInstructions;
+    u64 instructions;
+    u64 words;
+    u64 start;
+    u64 elapsed;
+    double seconds1;
+    int i;
+
+    benchSetup(bp);
+
+    startInstructions = traceSequenceNo;
+    instructions = 0;
+    start = getMicroseconds();
+
+    do
+        {
+        for (i = 0; i < BenchBatch; i++)
+            {
+            ppStep();
+            channelStep();
+            }
+
+        /*
+        **  Accumulate before the 32 bit sequence number wraps.
+        */
+        instructions += (u32)(traceSequenceNo - startInstructions);
+        startInstructions = traceSequenceNo;
+        benchWords(bp);
+
+        elapsed = getMicroseconds() - start;
+        } while (elapsed < (u64)seconds * 1000000);
+
+    words = benchWords(bp);
+    seconds1 = (double)elapsed / 1000000.0;
+
+    printf("%-10s %4d %10.2f %14.0f %14.0f\n", bp->name, ppuCount,
+        (double)instructions / (double)elapsed,
+        (double)words / seconds1,
+        (double)words / seconds1 / (bp->interlock ? 1 : ppuCount));
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Reset PPs and channels and load a benchmark program
+**                  into every PP.
+**
+**  Parameters:     Name        Description.
+**                  bp          benchmark program
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void benchSetup(BenchProgram *bp)
+    {
+    ChSlot *cp;
+    PpSlot *pp;
+    PpWord *code;
+    PpWord address;
+    u8 i;
+
+    for (i = 0; i < BenchChannels; i++)
+        {
+        cp = channel + i;
+        if (cp->hardwired)
+            {
+            cp->full = FALSE;
+            cp->inputPending = FALSE;
+            continue;
+            }
+
+        cp->active = FALSE;
+        cp->full = FALSE;
+        cp->discAfterInput = FALSE;
+        cp->delayStatus = 0;
+        cp->delayDisconnect = 0;
+        cp->ioDevice = NULL;
+        }
+
+    for (i = 0; i < ppuCount; i++)
+        {
+        pp = ppu + i;
+        memset(pp, 0, sizeof(PpSlot));
+        pp->id = i;
+        pp->regP = BenchOrigin;
+        pp->mem[BenchCount] = BenchCmWords;
+
+        for (code = bp->code, address = BenchOrigin; *code != BenchEnd; code++, address++)
+            {
+            pp->mem[address] = *code & Mask12;
+            if ((*code & BenchUnit) != 0)
+                {
+                pp->mem[address] += i;
+                }
+            }
+
+        cmLoops[i] = 0;
+        cmCounter[i] = 0;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count the words transferred so far by all PPs.
+**
+**                  The 12 bit loop counters of the cm class are sampled
+**                  every batch, well before they can wrap.
+**
+**  Parameters:     Name        Description.
+**                  bp          benchmark program
+**
+**  Returns:        Words transferred.
+**
+**------------------------------------------------------------------------*/
+static u64 benchWords(BenchProgram *bp)
+    {
+    u64 words = 0;
+    PpWord counter;
+    u8 i;
+
+    for (i = 0; i < ppuCount; i++)
+        {
+        if (bp->cm)
+            {
+            counter = ppu[i].mem[BenchCounter];
+            cmLoops[i] += (counter - cmCounter[i]) & Mask12;
+            cmCounter[i] = counter;
+            words += (u64)cmLoops[i] * 2 * BenchCmWords;
+            }
+        else
+            {
+            words += ppu[i].ioWords;
+            }
+        }
+
+    return(words);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Execute function code on the loopback device.
+**
+**  Parameters:     Name        Description.
+**                  funcCode    function code
+**
+**  Returns:        FcStatus
+**
+**------------------------------------------------------------------------*/
+static FcStatus loopFunc(PpWord funcCode)
+    {
+    if (funcCode != LoopbackWrite && funcCode != LoopbackRead)
+        {
+        return(FcDeclined);
+        }
+
+    activeDevice->fcode = funcCode;
+    return(FcAccepted);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform I/O on the loopback device. Words written are
+**                  buffered and returned by a later read; a read of an
+**                  empty buffer returns zero so a PP never hangs.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void loopIo(void)
+    {
+    Loopback *lp = (Loopback *)activeDevice->context[0];
+
+    if (activeDevice->fcode == LoopbackWrite)
+        {
+        if (activeChannel->full)
+            {
+            if (lp->in - lp->out == LoopbackSize)
+                {
+                lp->out += 1;
+                }
+
+            lp->buffer[lp->in++ & LoopbackMask] = activeChannel->data;
+            activeChannel->full = FALSE;
+            }
+        }
+    else if (!activeChannel->full)
+        {
+        activeChannel->data = lp->in != lp->out ? lp->buffer[lp->out++ & LoopbackMask] : 0;
+        activeChannel->full = TRUE;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Handle channel activation.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void loopActivate(void)
+    {
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Handle disconnecting of channel.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void loopDisconnect(void)
+    {
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read wall clock time.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Time in microseconds.
+**
+**------------------------------------------------------------------------*/
+static u64 getMicroseconds(void)
+    {
+#if defined(_WIN32)
+    LARGE_INTEGER count;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return((u64)(count.QuadPart / (frequency.QuadPart / 1000000)));
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return((u64)tv.tv_sec * 1000000 + tv.tv_usec);
+#endif
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -176,65 +176,79 @@ void dumpCpu(void)
     bool duplicateLine;
     u8 ch;
     u8 i;
+    u8 n;
     u8 shiftCount;
+    CpuContext *cc;
 
-    fprintf(cpuF, "P       %06o  ", cpu.regP);
-    fprintf(cpuF, "A%d %06o  ", 0, cpu.regA[0]);
-    fprintf(cpuF, "B%d %06o", 0, cpu.regB[0]);
-    fprintf(cpuF, "\n");
+    /*
+    **  Dump the registers of each CPU.
+    */
+    for (n = 0; n < cpuCount; n++)
+        {
+        cc = cpus + n;
+        if (cpuCount > 1)
+            {
+            fprintf(cpuF, "CPU %d\n", n);
+            }
+
+        fprintf(cpuF, "P       %06o  ", cc->regP);
+        fprintf(cpuF, "A%d %06o  ", 0, cc->regA[0]);
+        fprintf(cpuF, "B%d %06o", 0, cc->regB[0]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "RA      %06o  ", cpu.regRaCm);
-    fprintf(cpuF, "A%d %06o  ", 1, cpu.regA[1]);
-    fprintf(cpuF, "B%d %06o", 1, cpu.regB[1]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "RA      %06o  ", cc->regRaCm);
+        fprintf(cpuF, "A%d %06o  ", 1, cc->regA[1]);
+        fprintf(cpuF, "B%d %06o", 1, cc->regB[1]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "FL      %06o  ", cpu.regFlCm);
-    fprintf(cpuF, "A%d %06o  ", 2, cpu.regA[2]);
-    fprintf(cpuF, "B%d %06o", 2, cpu.regB[2]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "FL      %06o  ", cc->regFlCm);
+        fprintf(cpuF, "A%d %06o  ", 2, cc->regA[2]);
+        fprintf(cpuF, "B%d %06o", 2, cc->regB[2]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "RAE   %08o  ", cpu.regRaEcs);
-    fprintf(cpuF, "A%d %06o  ", 3, cpu.regA[3]);
-    fprintf(cpuF, "B%d %06o", 3, cpu.regB[3]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "RAE   %08o  ", cc->regRaEcs);
+        fprintf(cpuF, "A%d %06o  ", 3, cc->regA[3]);
+        fprintf(cpuF, "B%d %06o", 3, cc->regB[3]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "FLE   %08o  ", cpu.regFlEcs);
-    fprintf(cpuF, "A%d %06o  ", 4, cpu.regA[4]);
-    fprintf(cpuF, "B%d %06o", 4, cpu.regB[4]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "FLE   %08o  ", cc->regFlEcs);
+        fprintf(cpuF, "A%d %06o  ", 4, cc->regA[4]);
+        fprintf(cpuF, "B%d %06o", 4, cc->regB[4]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "EM/FL %08o  ", cpu.exitMode);
-    fprintf(cpuF, "A%d %06o  ", 5, cpu.regA[5]);
-    fprintf(cpuF, "B%d %06o", 5, cpu.regB[5]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "EM/FL %08o  ", cc->exitMode);
+        fprintf(cpuF, "A%d %06o  ", 5, cc->regA[5]);
+        fprintf(cpuF, "B%d %06o", 5, cc->regB[5]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "MA      %06o  ", cpu.regMa);
-    fprintf(cpuF, "A%d %06o  ", 6, cpu.regA[6]);
-    fprintf(cpuF, "B%d %06o", 6, cpu.regB[6]);
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "MA      %06o  ", cc->regMa);
+        fprintf(cpuF, "A%d %06o  ", 6, cc->regA[6]);
+        fprintf(cpuF, "B%d %06o", 6, cc->regB[6]);
+        fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "ECOND       %02o  ", cpu.exitCondition);
-    fprintf(cpuF, "A%d %06o  ", 7, cpu.regA[7]);
-    fprintf(cpuF, "B%d %06o  ", 7, cpu.regB[7]);
-    fprintf(cpuF, "\n");
-    fprintf(cpuF, "STOP         %d  ", cpuStopped ? 1 : 0);
-    fprintf(cpuF, "\n");
-    fprintf(cpuF, "\n");
-
-    for (i = 0; i < 8; i++)
-        {
-        fprintf(cpuF, "X%d ", i);
-        data = cpu.regX[i];
-        fprintf(cpuF, "%04o %04o %04o %04o %04o   ",
-            (PpWord)((data >> 48) & Mask12),
-            (PpWord)((data >> 36) & Mask12),
-            (PpWord)((data >> 24) & Mask12),
-            (PpWord)((data >> 12) & Mask12),
-            (PpWord)((data      ) & Mask12));
+        fprintf(cpuF, "ECOND       %02o  ", cc->exitCondition);
+        fprintf(cpuF, "A%d %06o  ", 7, cc->regA[7]);
+        fprintf(cpuF, "B%d %06o  ", 7, cc->regB[7]);
         fprintf(cpuF, "\n");
-        }
+        fprintf(cpuF, "STOP         %d  ", cc->isStopped ? 1 : 0);
+        fprintf(cpuF, "\n");
+        fprintf(cpuF, "\n");
+
+        for (i = 0; i < 8; i++)
+            {
+            fprintf(cpuF, "X%d ", i);
+            data = cc->regX[i];
+            fprintf(cpuF, "%04o %04o %04o %04o %04o   ",
+                (PpWord)((data >> 48) & Mask12),
+                (PpWord)((data >> 36) & Mask12),
+                (PpWord)((data >> 24) & Mask12),
+                (PpWord)((data >> 12) & Mask12),
+                (PpWord)((data      ) & Mask12));
+            fprintf(cpuF, "\n");
+            }
 
-    fprintf(cpuF, "\n");
+        fprintf(cpuF, "\n");
+        }
 
     lastData = ~cpMem[0];
     duplicateLine = FALSE;
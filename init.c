@@ -68,6 +68,7 @@ static void initCyber(char *config);
 static void initNpuConnections(void);
 static void initEquipment(void);
 static void initDeadstart(void);
+static void initThreads(char *config);
 static bool initOpenSection(char *name);
 static char *initGetNextLine(void);
 static bool initGetOctal(char *entry, int defValue, long *value);
@@ -85,6 +86,7 @@ extern u8 deadstartCount;
 ModelFeatures features;
 ModelType modelType;
 char persistDir[256];
+char ecsSharedName[64];
 char printDir[256];		//drs
 char printApp[256];		//drs
 long autoRemovePaper;	//drs
@@ -101,6 +103,7 @@ static char *startupFile = "cyber.ini";
 static char deadstart[80];
 static char equipment[80];
 static char npuConnections[80];
+static char threads[80];
 static long chCount;
 static union
     {
@@ -108,19 +111,6 @@ static union
     u8 bytes[4];
     } endianCheck;
 
-static ModelFeatures features6400 = (IsSeries6x00);
-static ModelFeatures featuresCyber73 = (IsSeries70 | HasInterlockReg | HasCMU);
-static ModelFeatures featuresCyber173 =
-    (IsSeries170 | HasStatusAndControlReg | HasCMU);
-static ModelFeatures featuresCyber175 =
-    (IsSeries170 | HasStatusAndControlReg | HasInstructionStack | HasIStackPrefetch | Has175Float);
-static ModelFeatures featuresCyber840A =
-    (  IsSeries800 | HasNoCmWrap | HasFullRTC | HasTwoPortMux | HasMaintenanceChannel | HasCMU | HasChannelFlag
-     | HasErrorFlag | HasRelocationRegLong | HasMicrosecondClock | HasInstructionStack | HasIStackPrefetch);
-static ModelFeatures featuresCyber865 =
-    (  IsSeries800 | HasNoCmWrap | HasFullRTC | HasTwoPortMux | HasStatusAndControlReg
-     | HasRelocationRegShort | HasMicrosecondClock | HasInstructionStack | HasIStackPrefetch | Has175Float);
-
 /*
 **--------------------------------------------------------------------------
 **
@@ -166,6 +156,9 @@ void initStartup(char *config)
     printf("%s\n\n", DtCyberLicense);
     printf("Starting initialisation\n");
 
+    initThreads(config);
+    threadSetup("main");
+
     initCyber(config);
     initDeadstart();
     initNpuConnections();
@@ -221,12 +214,19 @@ static void initCyber(char *config)
     long memory;
     long ecsBanks;
     long esmBanks;
+    long cpus;
     long enableCejMej;
     long clockIncrement;
     long pps;
     long mask;
+    long address;
+    long blockTransfer;
+    long virtualTime;
+    long hugePages;
+    long numaNode;
     long port;
     long conns;
+    long interval;
     long setMHz;
 
 	autoRemovePaper = 0;
@@ -269,32 +269,32 @@ static void initCyber(char *config)
     if (stricmp(model, "6400") == 0)
         {
         modelType = Model6400;
-        features = features6400;
+        features = Features6400;
         }
     else if (stricmp(model, "CYBER73") == 0)
         {
         modelType = ModelCyber73;
-        features = featuresCyber73;
+        features = FeaturesCyber73;
         }
     else if (stricmp(model, "CYBER173") == 0)
         {
         modelType = ModelCyber173;
-        features = featuresCyber173;
+        features = FeaturesCyber173;
         }
     else if (stricmp(model, "CYBER175") == 0)
         {
         modelType = ModelCyber175;
-        features = featuresCyber175;
+        features = FeaturesCyber175;
         }
     else if (stricmp(model, "CYBER840A") == 0)
         {
         modelType = ModelCyber840A;
-        features = featuresCyber840A;
+        features = FeaturesCyber840A;
         }
     else if (stricmp(model, "CYBER865") == 0)
         {
         modelType = ModelCyber865;
-        features = featuresCyber865;
+        features = FeaturesCyber865;
         }
     else
         {
@@ -433,9 +433,54 @@ static void initCyber(char *config)
     initGetString("autodateyear", "21", autoYearString, 9);
  
     /*
-    **  Initialise CPU.
+    **  Determine number of CPUs and initialise CPU.
     */
-    cpuInit(model, memory, ecsBanks + esmBanks, ecsBanks != 0 ? ECS : ESM);
+    (void)initGetInteger("cpus", 1, &cpus);
+    if (cpus < 1 || cpus > MaxCpus)
+        {
+        fprintf(stderr, "Entry 'cpus' invalid in section [%s] in %s - correct values are 1 to %d\n", config, startupFile, MaxCpus);
+        exit(1);
+        }
+
+    /*
+    **  Get optional name of the ECS shared with other emulators.
+    */
+    initGetString("ecsShared", "", ecsSharedName, sizeof(ecsSharedName));
+    if (strchr(ecsSharedName, '/') != NULL || strchr(ecsSharedName, '\\') != NULL)
+        {
+        fprintf(stderr, "Entry 'ecsShared' invalid in section [%s] in %s - name must not contain slashes\n", config, startupFile);
+        exit(1);
+        }
+
+    if (*ecsSharedName != '\0' && ecsBanks + esmBanks == 0)
+        {
+        fprintf(stderr, "Entry 'ecsShared' in section [%s] in %s requires 'ecsbanks' or 'esmbanks'\n", config, startupFile);
+        exit(1);
+        }
+
+    /*
+    **  Get optional page size and NUMA node of CM, ECS and PP memory.
+    */
+    (void)initGetInteger("hugePages", 1, &hugePages);
+    if (hugePages < 0 || hugePages > 2)
+        {
+        fprintf(stderr, "Entry 'hugePages' invalid in section [%s] in %s - correct values are 0, 1 or 2\n", config, startupFile);
+        exit(1);
+        }
+
+    memHugePages = (u8)hugePages;
+
+    (void)initGetInteger("numaNode", -1, &numaNode);
+    if (numaNode < -1 || numaNode > 63)
+        {
+        fprintf(stderr, "Entry 'numaNode' invalid in section [%s] in %s - correct values are -1 to 63\n", config, startupFile);
+        exit(1);
+        }
+
+    memNumaNode = (int)numaNode;
+
+    cpuStatsInit();
+    cpuInit(model, memory, ecsBanks + esmBanks, ecsBanks != 0 ? ECS : ESM, (u8)cpus);
 
     /*
     **  Determine number of PPs and initialise PP subsystem.
@@ -449,6 +494,18 @@ static void initCyber(char *config)
 
     ppInit((u8)pps);
 
+    /*
+    **  Optionally let CRM and CWM transfer their whole block at once.
+    */
+    (void)initGetInteger("ppBlockTransfer", 0, &blockTransfer);
+    if (blockTransfer != 0 && blockTransfer != 1)
+        {
+        fprintf(stderr, "Entry 'ppBlockTransfer' invalid in section [cyber] in %s - correct values are 0 or 1\n", startupFile);
+        exit(1);
+        }
+
+    ppBlockTransfer = blockTransfer != 0;
+
     /*
     **  Calculate number of channels and initialise channel subsystem.
     */
@@ -484,6 +541,33 @@ static void initCyber(char *config)
 
     rtcInit((u8)clockIncrement, setMHz);
 
+    /*
+    **  Optionally advance the clock while the system is idle.
+    */
+    (void)initGetInteger("virtualTime", 0, &virtualTime);
+    if (virtualTime != 0 && virtualTime != 1)
+        {
+        fprintf(stderr, "Entry 'virtualTime' invalid in section [cyber] in %s - correct values are 0 or 1\n", startupFile);
+        exit(1);
+        }
+
+    rtcVirtualTime = virtualTime != 0;
+
+#if CcCoSim == 1
+    /*
+    **  Verify every n-th CPU instruction word against the reference
+    **  implementation, 0 disables.
+    */
+    (void)initGetInteger("coSimInterval", 1, &interval);
+    if (interval < 0)
+        {
+        fprintf(stderr, "Entry 'coSimInterval' invalid in section [cyber] in %s - correct values are 0 or greater\n", startupFile);
+        exit(1);
+        }
+
+    cpuCoSimInterval = (u32)interval;
+#endif
+
     /*
     **  Initialise optional Interlock Register on channel 15.
     */
@@ -545,6 +629,60 @@ static void initCyber(char *config)
     */
     initGetInteger("telnetconns", 4, &conns);
     mux6676TelnetConns = (u16)conns;
+
+    /*
+    **  Get optional NPU statistics file and the interval in seconds at which
+    **  a snapshot is appended to it.
+    */
+    initGetString("npuStatsFile", "", npuStatsFile, sizeof(npuStatsFile));
+    initGetInteger("npuStatsInterval", 60, &interval);
+    if (interval < 1 || interval > 0xFFFF)
+        {
+        fprintf(stderr, "Entry 'npuStatsInterval' invalid in section [cyber] in %s\n", startupFile);
+        exit(1);
+        }
+
+    npuStatsInterval = (u16)interval;
+
+    /*
+    **  Get optional CPU accounting file and the interval in seconds at
+    **  which a snapshot is appended to it.
+    */
+    initGetString("cpuStatsFile", "", cpuStatsFile, sizeof(cpuStatsFile));
+    initGetInteger("cpuStatsInterval", 60, &interval);
+    if (interval < 1 || interval > 0xFFFF)
+        {
+        fprintf(stderr, "Entry 'cpuStatsInterval' invalid in section [cyber] in %s\n", startupFile);
+        exit(1);
+        }
+
+    cpuStatsInterval = (u16)interval;
+
+    /*
+    **  Get optional address of the PP communication area which the PP
+    **  profiler reads the program names from.
+    */
+    (void)initGetOctal("ppCommArea", 050, &address);
+    if (address < 0 || address > Mask21)
+        {
+        fprintf(stderr, "Entry 'ppCommArea' invalid in section [cyber] in %s\n", startupFile);
+        exit(1);
+        }
+
+    ppStatsCommArea = (u32)address;
+
+    /*
+    **  Get optional offset by which the TCP ports of each clone of the
+    **  running system are moved.
+    */
+    initGetInteger("clonePortOffset", 100, &interval);
+    if (interval < 1 || interval > 0x7FFF)
+        {
+        fprintf(stderr, "Entry 'clonePortOffset' invalid in section [cyber] in %s\n", startupFile);
+        exit(1);
+        }
+
+    clonePortOffset = (u16)interval;
     }
 
 /*--------------------------------------------------------------------------
@@ -561,7 +699,9 @@ static void initNpuConnections(void)
     char *token;
     int tcpPort;
     int numConns;
+    int maxConns;
     u8 connType;
+    int outputRate;
     int lineNo;
     int rc;
 
@@ -570,7 +710,7 @@ static void initNpuConnections(void)
         /*
         **  Default is the classic port 6610, 10 connections and raw TCP connection.
         */
-        npuNetRegister(6610, 10, ConnTypeRaw);
+        npuNetRegister(6610, 10, 10, ConnTypeRaw, 0);
         return;
         }
 
@@ -620,18 +760,18 @@ static void initNpuConnections(void)
             }
 
         numConns = strtol(token, NULL, 10);
-        if (numConns < 0 || numConns > 100)
+        if (numConns < 0 || numConns > MaxTcbs)
             {
             fprintf(stderr, "Section [%s], relative line %d, out of range number of connections %s in %s\n",
                 npuConnections, lineNo, token == NULL ? "NULL" : token, startupFile);
-            fprintf(stderr, "Connection count must be between 0 and 100\n");
+            fprintf(stderr, "Connection count must be between 0 and %d\n", MaxTcbs);
             exit(1);
             }
 
         /*
         **  Parse NPU connection type.
         */
-        token = strtok(NULL, " ");
+        token = strtok(NULL, ", ");
         if (token == NULL)
             {
             fprintf(stderr, "Section [%s], relative line %d, invalid NPU connection type %s in %s\n",
@@ -639,30 +779,62 @@ static void initNpuConnections(void)
             exit(1);
             }
 
-        if (strcmp(token, "raw") == 0)
+        rc = npuNetFindConnType(token);
+        if (rc < 0)
             {
-            connType = ConnTypeRaw;
-            }
-        else if (strcmp(token, "pterm") == 0)
-            {
-            connType = ConnTypePterm;
+            fprintf(stderr, "Section [%s], relative line %d, unknown NPU connection type %s in %s\n",
+                npuConnections, lineNo, token == NULL ? "NULL" : token, startupFile);
+            fprintf(stderr, "NPU connection types must be one of:");
+            for (rc = 0; rc < npuConnDescCount; rc++)
+                {
+                fprintf(stderr, " '%s'", npuConnDesc[rc].name);
+                }
+
+            fprintf(stderr, "\n");
+            exit(1);
             }
-        else if (strcmp(token, "rs232") == 0)
+
+        connType = (u8)rc;
+
+        /*
+        **  Parse optional output rate in characters per second.
+        */
+        outputRate = 0;
+        token = strtok(NULL, ", ");
+        if (token != NULL)
             {
-            connType = ConnTypeRs232;
+            if (!isdigit(token[0]))
+                {
+                fprintf(stderr, "Section [%s], relative line %d, invalid output rate %s in %s\n",
+                    npuConnections, lineNo, token, startupFile);
+                exit(1);
+                }
+
+            outputRate = strtol(token, NULL, 10);
             }
-        else
+
+        /*
+        **  Parse optional number of connections this port may grow to
+        **  while the system is running.
+        */
+        maxConns = numConns;
+        token = strtok(NULL, ", ");
+        if (token != NULL)
             {
-            fprintf(stderr, "Section [%s], relative line %d, unknown NPU connection type %s in %s\n",
-                npuConnections, lineNo, token == NULL ? "NULL" : token, startupFile);
-            fprintf(stderr, "NPU connection types must be 'raw' or 'pterm' or 'rs232'\n");
-            exit(1);
+            maxConns = strtol(token, NULL, 10);
+            if (!isdigit(token[0]) || maxConns < numConns || maxConns > MaxTcbs)
+                {
+                fprintf(stderr, "Section [%s], relative line %d, invalid maximum number of connections %s in %s\n",
+                    npuConnections, lineNo, token, startupFile);
+                fprintf(stderr, "Maximum must be between the connection count and %d\n", MaxTcbs);
+                exit(1);
+                }
             }
 
         /*
         **  Setup NPU connection type.
         */
-        rc = npuNetRegister(tcpPort, numConns, connType);
+        rc = npuNetRegister(tcpPort, numConns, maxConns, connType, outputRate);
         switch (rc)
             {
         case NpuNetRegOk:
@@ -681,6 +853,122 @@ static void initNpuConnections(void)
         }
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and process thread definitions.
+**
+**                  Done before anything else so that the threads created
+**                  during initialisation find their settings.
+**
+**  Parameters:     Name        Description.
+**                  config      name of the section to run
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void initThreads(char *config)
+    {
+    char *line;
+    char *name;
+    char *cores;
+    char *policy;
+    char *token;
+    int level;
+    int lineNo;
+    int rc;
+
+    if (!initOpenSection(config))
+        {
+        fprintf(stderr, "Required section [%s] not found in %s\n", config, startupFile);
+        exit(1);
+        }
+
+    /*
+    **  Get optional thread definition section name.
+    */
+    initGetString("threads", "", threads, sizeof(threads));
+    if (strlen(threads) == 0)
+        {
+        return;
+        }
+
+    if (!initOpenSection(threads))
+        {
+        fprintf(stderr, "Required section [%s] not found in %s\n", threads, startupFile);
+        exit(1);
+        }
+
+    /*
+    **  Process all thread entries.
+    */
+    lineNo = -1;
+    while  ((line = initGetNextLine()) != NULL)
+        {
+        lineNo += 1;
+
+        /*
+        **  Parse thread name, cores, policy and nice level or priority.
+        */
+        name = strtok(line, ", ");
+        cores = strtok(NULL, ", ");
+        if (name == NULL || cores == NULL)
+            {
+            fprintf(stderr, "Section [%s], relative line %d, thread name and cores expected in %s\n",
+                threads, lineNo, startupFile);
+            exit(1);
+            }
+
+        policy = strtok(NULL, ", ");
+        token = strtok(NULL, ", ");
+        level = 0;
+        if (token != NULL)
+            {
+            if (!isdigit(token[0]) && token[0] != '-')
+                {
+                fprintf(stderr, "Section [%s], relative line %d, invalid level %s in %s\n",
+                    threads, lineNo, token, startupFile);
+                exit(1);
+                }
+
+            level = strtol(token, NULL, 10);
+            }
+
+        rc = threadRegister(name, cores, policy, level);
+        switch (rc)
+            {
+        case ThreadRegOk:
+            break;
+
+        case ThreadRegOvfl:
+            fprintf(stderr, "Section [%s], relative line %d, too many threads or name %s too long in %s\n",
+                threads, lineNo, name, startupFile);
+            exit(1);
+
+        case ThreadRegDupl:
+            fprintf(stderr, "Section [%s], relative line %d, duplicate thread %s in %s\n",
+                threads, lineNo, name, startupFile);
+            exit(1);
+
+        case ThreadRegCores:
+            fprintf(stderr, "Section [%s], relative line %d, invalid cores %s in %s\n",
+                threads, lineNo, cores, startupFile);
+            fprintf(stderr, "Cores are given as e.g. 2, 0-3, 1+5-7 or * for any\n");
+            exit(1);
+
+        case ThreadRegPolicy:
+            fprintf(stderr, "Section [%s], relative line %d, invalid policy %s in %s\n",
+                threads, lineNo, policy, startupFile);
+            fprintf(stderr, "Policies are default, other, batch, idle, fifo and rr\n");
+            exit(1);
+
+        case ThreadRegLevel:
+            fprintf(stderr, "Section [%s], relative line %d, out of range level %d in %s\n",
+                threads, lineNo, level, startupFile);
+            fprintf(stderr, "Nice levels must be between -20 and 19, fifo and rr priorities between 1 and 99\n");
+            exit(1);
+            }
+        }
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Read and process equipment definitions.
 **
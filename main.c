@@ -46,6 +46,7 @@
 **  Private Constants
 **  -----------------
 */
+#define StatsCheckMask      0xFFFF      /* major cycles between CPU statistics checks */
 
 /*
 **  -----------------------
@@ -192,14 +193,43 @@ int main(int argc, char **argv)
         */
         ppStep();
 
-        cpuStep();
-        cpuStep();
-        cpuStep();
-        cpuStep();
+        /*
+        **  In a multiprocessor the CPUs run in their own threads.
+        */
+        if (cpuCount == 1)
+            {
+#if CcCoSim == 1
+            cpuCoSimStep();
+            cpuCoSimStep();
+            cpuCoSimStep();
+            cpuCoSimStep();
+#else
+            cpuStep();
+            cpuStep();
+            cpuStep();
+            cpuStep();
+#endif
+            }
 
         channelStep();
         rtcTick();
 
+        /*
+        **  Periodic CPU accounting output.
+        */
+        if ((cycles & StatsCheckMask) == 0)
+            {
+            cpuStatsCheck();
+            }
+
+        /*
+        **  Skip idle time when running in virtual time.
+        */
+        if (rtcVirtualTime)
+            {
+            rtcVirtualStep();
+            }
+
 #if CcCycleTime
         cycleTime = rtcStopTimer();
 #endif
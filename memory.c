@@ -0,0 +1,363 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: memory.c
+**
+**  Description:
+**      Allocate the large emulated memories (CM, ECS/ESM and PP memory).
+**      Where the host supports it the memory is backed by huge pages to
+**      reduce TLB misses on random access, and placed on a chosen NUMA
+**      node. Also allocate control blocks aligned to host cache lines.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MemHugePageSize     (2 * 1024 * 1024)
+
+#if defined(__linux__)
+#define MemPolicyPreferred  1       /* MPOL_PREFERRED */
+#define MemPolicyFNode      1       /* MPOL_F_NODE */
+#define MemPolicyFAddr      2       /* MPOL_F_ADDR */
+#define MemMaxNodes         64
+#define MemMaskBits         (sizeof(unsigned long) * 8)
+#endif
+
+#if !defined(_WIN32) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS       MAP_ANON
+#endif
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static size_t memRoundSize(size_t size);
+#if defined(__linux__)
+static char *memBindNode(void *addr, size_t size);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+u8 memHugePages = 1;
+int memNumaNode = -1;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate zeroed memory for an emulated memory.
+**
+**                  memHugePages selects the page size: 0 uses normal pages,
+**                  1 asks for transparent huge pages and 2 uses reserved
+**                  huge pages, falling back to 1 if none are available.
+**                  If memNumaNode is not negative the memory is placed on
+**                  that node, otherwise on the node the threads section
+**                  places the emulation threads on.
+**
+**  Parameters:     Name        Description.
+**                  size        size in bytes
+**                  name        memory name for the startup report
+**
+**  Returns:        Pointer to memory, NULL if it can't be allocated.
+**
+**------------------------------------------------------------------------*/
+void *memAlloc(size_t size, char *name)
+    {
+    char *pages = "normal pages";
+    char *node = "";
+    void *addr;
+
+    size = memRoundSize(size);
+
+#if defined(_WIN32)
+    addr = NULL;
+    if (memHugePages == 2 && GetLargePageMinimum() != 0)
+        {
+        addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        pages = "large pages";
+        }
+
+    if (addr == NULL)
+        {
+        addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        pages = "normal pages";
+        }
+
+    if (addr == NULL)
+        {
+        return(NULL);
+        }
+#else
+    addr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if (memHugePages == 2)
+        {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        pages = "reserved huge pages";
+        }
+#endif
+
+    if (addr == MAP_FAILED)
+        {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED)
+            {
+            return(NULL);
+            }
+
+        pages = "normal pages";
+#if defined(MADV_HUGEPAGE)
+        /*
+        **  The kernel only decides on huge pages as the memory is
+        **  touched, so all that can be reported is the request.
+        */
+        if (memHugePages != 0 && madvise(addr, size, MADV_HUGEPAGE) == 0)
+            {
+            pages = "normal pages, transparent huge pages requested";
+            }
+#endif
+        }
+
+#if defined(__linux__)
+    node = memBindNode(addr, size);
+#endif
+#endif
+
+    printf("%s: %lu KB of %s%s\n", name, (unsigned long)(size / 1024), pages, node);
+
+    return(addr);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release memory obtained from memAlloc.
+**
+**  Parameters:     Name        Description.
+**                  addr        memory address
+**                  size        size in bytes as passed to memAlloc
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memFree(void *addr, size_t size)
+    {
+    if (addr == NULL)
+        {
+        return;
+        }
+
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munmap(addr, memRoundSize(size));
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate zeroed control blocks starting on a cache
+**                  line, so blocks owned by different threads never share
+**                  a line.
+**
+**  Parameters:     Name        Description.
+**                  size        size in bytes
+**
+**  Returns:        Pointer to memory, NULL if it can't be allocated.
+**
+**------------------------------------------------------------------------*/
+void *memAllocAligned(size_t size)
+    {
+    void *addr;
+
+#if defined(_WIN32)
+    addr = _aligned_malloc(size, CacheLineSize);
+#else
+    if (posix_memalign(&addr, CacheLineSize, size) != 0)
+        {
+        addr = NULL;
+        }
+#endif
+
+    if (addr != NULL)
+        {
+        memset(addr, 0, size);
+        }
+
+    return(addr);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release memory obtained from memAllocAligned.
+**
+**  Parameters:     Name        Description.
+**                  addr        memory address
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void memFreeAligned(void *addr)
+    {
+#if defined(_WIN32)
+    _aligned_free(addr);
+#else
+    free(addr);
+#endif
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Round an allocation up to whole huge pages, which is
+**                  required for reserved huge pages and lets the last
+**                  part of a memory use a huge page as well.
+**
+**  Parameters:     Name        Description.
+**                  size        size in bytes
+**
+**  Returns:        Rounded size.
+**
+**------------------------------------------------------------------------*/
+static size_t memRoundSize(size_t size)
+    {
+    if (memHugePages == 0)
+        {
+        return(size);
+        }
+
+    return((size + MemHugePageSize - 1) & ~(size_t)(MemHugePageSize - 1));
+    }
+
+#if defined(__linux__)
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Place memory on the configured NUMA node, or the node
+**                  of the emulation threads if none is configured, and
+**                  report the node the first page ended up on.
+**
+**                  The system calls are used directly so no NUMA library
+**                  is needed.
+**
+**  Parameters:     Name        Description.
+**                  addr        memory address
+**                  size        size in bytes
+**
+**  Returns:        Text for the startup report.
+**
+**------------------------------------------------------------------------*/
+static char *memBindNode(void *addr, size_t size)
+    {
+    static char text[40];
+    unsigned long mask[MemMaxNodes / MemMaskBits];
+    int node;
+
+    *text = '\0';
+
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+    node = memNumaNode >= 0 ? memNumaNode : threadNumaNode();
+    if (node >= 0 && node < MemMaxNodes)
+        {
+        /*
+        **  The node mask is an array of longs, which are 32 bits on
+        **  32 bit hosts.
+        */
+        memset(mask, 0, sizeof(mask));
+        mask[node / MemMaskBits] = 1UL << (node % MemMaskBits);
+        if (syscall(SYS_mbind, addr, size, MemPolicyPreferred, mask, MemMaxNodes + 1, 0) != 0)
+            {
+            fprintf(stderr, "Failed to place memory on NUMA node %d\n", node);
+            }
+        }
+
+    /*
+    **  Touch the first word so it has a node.
+    */
+    *(volatile char *)addr = 0;
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr, MemPolicyFNode | MemPolicyFAddr) == 0)
+        {
+        sprintf(text, " on NUMA node %d", node);
+        }
+#else
+    (void)addr;
+    (void)size;
+    (void)mask;
+    (void)node;
+#endif
+
+    return(text);
+    }
+
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -113,6 +113,7 @@ u16 mux6676TelnetConns;
 **  Private Variables
 **  -----------------
 */
+static DevSlot *muxDevice = NULL;
 
 /*
 **--------------------------------------------------------------------------
@@ -181,6 +182,7 @@ void mux6676Init(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
     /*
     **  Create the thread which will deal with TCP connections.
     */
+    muxDevice = dp;
     mux6676CreateThread(dp);
 
     /*
@@ -189,6 +191,25 @@ void mux6676Init(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
     printf("MUX6676 initialised on channel %o equipment %o\n", channelNo, eqNo);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Restart the TCP thread in a cloned emulator process on
+**                  a different port.
+**
+**  Parameters:     Name        Description.
+**                  portOffset  offset added to the Telnet port
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void mux6676Clone(u16 portOffset)
+    {
+    if (muxDevice != NULL)
+        {
+        mux6676TelnetPort += portOffset;
+        mux6676CreateThread(muxDevice);
+        }
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Execute function code on 6676 mux.
 **
@@ -444,6 +465,8 @@ static void *mux6676Thread(void *param)
     socklen_t fromLen;
 #endif
 
+    threadSetup("mux6676");
+
     /*
     **  Create TCP socket and bind to specified port.
     */
@@ -185,7 +185,9 @@
 #define ConnTypeRaw     0
 #define ConnTypePterm   1
 #define ConnTypeRs232   2
-#define MaxConnTypes    3
+#define ConnTypeBinary  3
+#define ConnTypeHasp    4
+#define MaxConnTypes    5
 
 /*
 **  npuNetRegister() return codes
@@ -198,6 +200,13 @@
 **  Miscellaneous constants.
 */
 #define MaxBuffer       2048
+#define MaxIvtData      100     // upline block unit; blocking factor is a multiple of this
+#define MaxUplineRing   16384   // per-connection receive ring size, must be power of two
+#define MaxHaspDevices  8       // device TCBs reserved per HASP workstation
+#define MaxOutputRing   32768   // initial per-connection send ring size, must be power of two
+#define MaxAckMarks     256     // block acknowledgements pending per connection, more than any DBL
+#define MaxTcbs         255     // CN is one byte and CN 0 is used by the service channel
+#define NoConnReg       0xFF    // connection registration of device TCBs
 
 /*
 **  Character definitions.
@@ -228,6 +237,19 @@
 **  -------------------
 */
 
+/*
+**  Order ring data against the ring indices shared between the network
+**  thread and the emulation thread. The producer issues it between
+**  writing the data and advancing its index, the consumer between
+**  reading the other thread's index and accessing the data.
+*/
+#if defined(_WIN32)
+#include <intrin.h>
+#define NpuRingBarrier()    _ReadWriteBarrier()     // x86 and x64 keep loads and stores in order
+#else
+#define NpuRingBarrier()    __sync_synchronize()
+#endif
+
 /*
 **  --------------------
 **  NPU Type Definitions
@@ -333,6 +355,21 @@ typedef enum
     } TermConnState;
 
 
+/*
+**  Traffic counters kept per connection and per connection type.
+*/
+typedef struct npuStats
+    {
+    u32                 blocksUp;         // upline data blocks sent to host
+    u32                 bytesUp;          // upline data bytes sent to host
+    u32                 blocksDown;       // downline data blocks received from host
+    u32                 bytesDown;        // downline data bytes received from host
+    u32                 outputMax;        // high water mark of unsent network output
+    u32                 ackCount;         // downline blocks acknowledged
+    u64                 ackCycles;        // sum of block to acknowledge latency in cycles
+    u32                 ackMaxCycles;     // worst block to acknowledge latency in cycles
+    } NpuStats;
+
 /*
 **  Terminal control block.
 */
@@ -348,6 +385,21 @@ typedef struct tcb
     bool                breakPending;
     int                 connFd;
     u8                  connType;
+    u8                  connReg;                // registered port of a network TCB, NoConnReg for devices
+
+    /*
+    **  Links of the active list and of the free list of the registered
+    **  port. Both are changed only with the network lock held.
+    */
+    struct tcb          *activeNext;
+    struct tcb          *activePrev;
+    struct tcb          *freeNext;
+
+    /*
+    **  Events staged by the network thread.
+    */
+    volatile bool       netConnect;
+    volatile bool       netEof;
 
     /*
     **  Configuration.
@@ -369,8 +421,9 @@ typedef struct tcb
     */
     u8                  uplineBsn;
 
-    u8                  inputData[100];
-    int                 inputCount;
+    u8                  inputRing[MaxUplineRing];
+    volatile u32        inputIn;
+    volatile u32        inputOut;
 
     u8                  inBuf[MaxBuffer];
     u8                  *inBufPtr;
@@ -380,15 +433,81 @@ typedef struct tcb
     u32                 xStartCycle;
 
     /*
-    **  Output state.
+    **  Output state. Network output is formatted into the send ring and
+    **  each downline block is acknowledged once the socket has taken all
+    **  data up to its mark. Holding the acknowledgments throttles the
+    **  host to its downline window, so the ring grows to whatever that
+    **  window formats into rather than dropping output. The output queue
+    **  holds downline blocks of HASP devices until they are formatted.
+    **  The output scheduler releases ring data up to outputLimit and the
+    **  network thread hands it to the socket, advancing outputOut.
     */
     NpuQueue            outputQ;
+    u8                  *outputRing;            // allocated on first output
+    u32                 outputSize;             // ring size, a power of two
+    volatile u32        outputIn;
+    volatile u32        outputLimit;
+    volatile u32        outputOut;
+    u32                 ackPos[MaxAckMarks];
+    u8                  ackBsn[MaxAckMarks];
+    u8                  ackIn;
+    u8                  ackOut;
+
+    /*
+    **  Output scheduling. Connections share the output budget of each poll
+    **  by deficit round robin and, if a rate is configured, are shaped by
+    **  a token bucket holding one downline window (DBL * DBSize).
+    */
+    volatile bool       outputBlocked;          // socket send buffer is full
+    u32                 outputRate;             // bytes per second, 0 if unlimited
+    u32                 outputTime;             // rtcClock at last bucket refill
+    u64                 outputCredit;           // bucket fill in millionths of a byte
+    int                 outputDeficit;          // round robin credit in bytes
     bool                xoff;
     bool                dbcNoEchoplex;
     bool                dbcNoCursorPos;
     bool                lastOpWasInput;
+
+    /*
+    **  Multi-device lines (HASP). The line TCB owns the network connection
+    **  and a block of device TCBs, each of which has its own host connection.
+    */
+    struct tcb          *lineTcb;               // device: owning line, NULL otherwise
+    struct tcb          *deviceTcbs;            // line: first of its device TCBs
+    u8                  haspStream;             // device: stream number
+    u8                  haspRxState;            // line: receive framing state
+    u8                  haspRxBcb;              // line: next expected block sequence count
+    u8                  haspTxBcb;              // line: next block sequence count to send
+    u8                  haspGrants;             // line: reader streams awaiting permission
+    u8                  haspNextDevice;         // line: round robin position for output
+    bool                haspSuspended;          // line: workstation has suspended output
+
+    /*
+    **  Statistics. The cycle count at which each downline block arrived
+    **  is indexed by its BSN.
+    */
+    NpuStats            stats;
+    u32                 downCycle[BlkMaskBSN + 1];
     } Tcb;
 
+/*
+**  Connection type descriptor. The npuConnDesc[] table is indexed by
+**  the ConnTypeXxx values; adding a connection type means adding an
+**  entry there together with its handlers.
+*/
+typedef struct npuConnDesc
+    {
+    char                *name;                              // name used in cyber.ini
+    bool                notify;                             // send status messages to the user
+    u8                  tipType;                            // TIP type in configuration request
+    u8                  deviceTcbs;                         // device TCBs reserved per connection
+    void                (*netSend)(Tcb *tp, u8 *data, int len);
+    void                (*processUpline)(Tcb *tp);
+    void                (*processDownline)(u8 cn, NpuBuffer *bp, bool last);
+    int                 (*uplineBlockSize)(Tcb *tp);
+    void                (*processOutput)(Tcb *tp);          // network output drained, may be NULL
+    } NpuConnDesc;
+
 /*
 **  -----------------------
 **  NPU Function Prototypes
@@ -422,6 +541,7 @@ void npuBipAbortDownlineReceived(void);
 void npuBipRequestUplineTransfer(NpuBuffer *bp);
 void npuBipRequestUplineCanned(u8 *msg, int msgSize);
 void npuBipNotifyUplineSent(void);
+int npuBipBufMinCount(void);
 
 /*
 **  npu_svm.c
@@ -448,33 +568,72 @@ void npuTipInputReset(Tcb *tp);
 void npuTipSendUserBreak(Tcb *tp, u8 bt);
 void npuTipDiscardOutputQ(Tcb *tp);
 void npuTipNotifySent(Tcb *tp, u8 blockSeqNo);
+Tcb *npuTipNewTcbs(int count);
 
 /*
 **  npu_net.c
 */
-int npuNetRegister(int tcpPort, int numConns, int connType);
+int npuNetRegister(int tcpPort, int numConns, int maxConns, int connType, int outputRate);
 void npuNetInit(bool startup);
 void npuNetReset(void);
 void npuNetConnected(Tcb *tp);
 void npuNetDisconnected(Tcb *tp);
 void npuNetSend(Tcb *tp, u8 *data, int len);
 void npuNetQueueAck(Tcb *tp, u8 blockSeqNo);
+void npuNetStartOutput(Tcb *tp);
+void npuNetDiscardOutput(Tcb *tp);
 void npuNetCheckStatus(void);
+int npuNetFindConnType(char *name);
+void npuNetLock(void);
+void npuNetUnlock(void);
 
 /*
 **  npu_async.c
 */
 void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last);
 void npuAsyncProcessUplineData(Tcb *tp);
+int npuAsyncUplineBlockSize(Tcb *tp);
 void npuAsyncFlushUplineTransparent(Tcb *tp);
 
+/*
+**  npu_binary.c
+*/
+void npuBinaryProcessDownlineData(u8 cn, NpuBuffer *bp, bool last);
+void npuBinaryProcessUplineData(Tcb *tp);
+int npuBinaryUplineBlockSize(Tcb *tp);
+
+/*
+**  npu_hasp.c
+*/
+void npuHaspProcessDownlineData(u8 cn, NpuBuffer *bp, bool last);
+void npuHaspProcessUplineData(Tcb *tp);
+int npuHaspUplineBlockSize(Tcb *tp);
+void npuHaspProcessOutput(Tcb *tp);
+Tcb *npuHaspAllocDevice(Tcb *tp, u8 stream);
+void npuHaspDiscRequestLine(Tcb *tp);
+
+/*
+**  npu_stats.c
+*/
+void npuStatsConnect(Tcb *tp);
+void npuStatsUpline(Tcb *tp, int len);
+void npuStatsDownline(Tcb *tp, int len, u8 blockSeqNo);
+void npuStatsAck(Tcb *tp, u8 blockSeqNo);
+void npuStatsOutput(Tcb *tp);
+void npuStatsRegulation(u8 regLevel);
+void npuStatsWrite(void);
+
 /*
 **  --------------------
 **  Global NPU variables
 **  --------------------
 */
-extern Tcb *npuTcbs;
-extern int npuTcbCount;
+extern Tcb *npuTcbTable[];
+extern volatile int npuTcbCount;
+extern volatile bool npuNetReady;
+extern volatile bool npuStatsDue;
+extern NpuConnDesc npuConnDesc[];
+extern u8 npuConnDescCount;
 
 #endif /* NPU_H */
 /*---------------------------  End Of File  ------------------------------*/
@@ -43,7 +43,7 @@
 **  Private Constants
 **  -----------------
 */
-#define MaxIvtData          100
+#define MaxEchoBuffer       (3 * MaxBuffer)
 
 /*
 **  -----------------------
@@ -64,10 +64,10 @@
 */
 static void npuAsyncDoFeBefore(u8 fe);
 static void npuAsyncDoFeAfter(u8 fe);
-static void npuAsyncProcessUplineTransparent(Tcb *tp);
-static void npuAsyncProcessUplineAscii(Tcb *tp);
-static void npuAsyncProcessUplineSpecial(Tcb *tp);
-static void npuAsyncProcessUplineNormal(Tcb *tp);
+static int npuAsyncProcessUplineTransparent(Tcb *tp, u8 *dp, int len);
+static int npuAsyncProcessUplineAscii(Tcb *tp, u8 *dp, int len);
+static int npuAsyncProcessUplineSpecial(Tcb *tp, u8 *dp, int len);
+static int npuAsyncProcessUplineNormal(Tcb *tp, u8 *dp, int len);
 
 /*
 **  ----------------
@@ -94,7 +94,7 @@ static u8 netBEL[] = {ChrBEL};
 static u8 netLF[] = {ChrLF};
 static u8 netCR[] = {ChrCR};
 static u8 netCRLF[] = {ChrCR, ChrLF};
-static u8 echoBuffer[1000];
+static u8 echoBuffer[MaxEchoBuffer];
 static u8 *echoPtr;
 static int echoLen;
 
@@ -135,7 +135,7 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last)
         return;
         }
 
-    npuTp = npuTcbs + cn - 1;
+    npuTp = npuTcbTable[cn];
 
     /*
     **  Extract Data Block Clarifier settings.
@@ -224,6 +224,11 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last)
 /*--------------------------------------------------------------------------
 **  Purpose:        Process upline data from terminal.
 **
+**                  Data is taken from the connection's receive ring. At
+**                  most one upline block worth of data is processed per
+**                  call so that a connection doing bulk input can't starve
+**                  the others.
+**
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
 **
@@ -232,36 +237,119 @@ void npuAsyncProcessDownlineData(u8 cn, NpuBuffer *bp, bool last)
 **------------------------------------------------------------------------*/
 void npuAsyncProcessUplineData(Tcb *tp)
     {
-    echoPtr = echoBuffer;
+    int budget;
+    int len;
+    int contiguous;
+    u32 in;
+    u8 *dp;
 
-    if (tp->params.fvXInput)
-        {
-        npuAsyncProcessUplineTransparent(tp);
-        }
-    else if (tp->params.fvFullASCII)
+    budget = npuAsyncUplineBlockSize(tp);
+
+    while (budget > 0 && (in = tp->inputIn) != tp->inputOut)
         {
-        npuAsyncProcessUplineAscii(tp);
+        NpuRingBarrier();
+
+        /*
+        **  Determine the contiguous chunk of the ring to process.
+        */
+        dp = tp->inputRing + (tp->inputOut & (MaxUplineRing - 1));
+        len = in - tp->inputOut;
+        contiguous = MaxUplineRing - (tp->inputOut & (MaxUplineRing - 1));
+        if (len > contiguous)
+            {
+            len = contiguous;
+            }
+
+        if (len > budget)
+            {
+            len = budget;
+            }
+
+        /*
+        **  Each character may be echoed, plus the cursor positioning
+        **  after an EOL, so the chunk must fit the echo buffer.
+        */
+        if (len > MaxEchoBuffer - 2)
+            {
+            len = MaxEchoBuffer - 2;
+            }
+
+        echoPtr = echoBuffer;
+
+        if (tp->params.fvXInput)
+            {
+            len = npuAsyncProcessUplineTransparent(tp, dp, len);
+            }
+        else if (tp->params.fvFullASCII)
+            {
+            len = npuAsyncProcessUplineAscii(tp, dp, len);
+            }
+        else if (tp->params.fvSpecialEdit)
+            {
+            len = npuAsyncProcessUplineSpecial(tp, dp, len);
+            }
+        else
+            {
+            len = npuAsyncProcessUplineNormal(tp, dp, len);
+            }
+
+        NpuRingBarrier();
+        tp->inputOut += len;
+        budget -= len;
+
+        /*
+        **  Optionally echo characters.
+        */
+        if (!tp->dbcNoEchoplex)
+            {
+            echoLen = echoPtr - echoBuffer;
+            if (echoLen)
+                {
+                npuNetSend(tp, echoBuffer, echoLen);
+                }
+            }
         }
-    else if (tp->params.fvSpecialEdit)
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the size of a full upline block for the
+**                  current input mode of a terminal.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Upline block size in bytes.
+**
+**------------------------------------------------------------------------*/
+int npuAsyncUplineBlockSize(Tcb *tp)
+    {
+    int size;
+
+    if (tp->params.fvXInput)
         {
-        npuAsyncProcessUplineSpecial(tp);
+        size = tp->params.fvXCnt;
+        if (size <= 0 || size > MaxBuffer - BlkOffDbc - 2)
+            {
+            size = MaxBuffer - BlkOffDbc - 2;
+            }
         }
     else
         {
-        npuAsyncProcessUplineNormal(tp);
-        }
-
-    /*
-    **  Optionally echo characters.
-    */
-    if (!tp->dbcNoEchoplex)
-        {
-        echoLen = echoPtr - echoBuffer;
-        if (echoLen)
+        /*
+        **  A block never holds more than the input buffer.
+        */
+        size = tp->params.fvBlockFactor * MaxIvtData;
+        if (size <= 0)
             {
-            npuNetSend(tp, echoBuffer, echoLen);
+            size = MaxIvtData;
+            }
+        else if (size > MaxBuffer - BlkOffDbc - 2)
+            {
+            size = MaxBuffer - BlkOffDbc - 2;
             }
         }
+
+    return(size);
     }
 
 /*--------------------------------------------------------------------------
@@ -424,30 +512,30 @@ static void npuAsyncDoFeAfter(u8 fe)
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
+**                  dp          pointer to received data
+**                  len         number of bytes received
 **
-**  Returns:        Nothing.
+**  Returns:        Number of bytes consumed.
 **
 **------------------------------------------------------------------------*/
-static void npuAsyncProcessUplineTransparent(Tcb *tp)
+static int npuAsyncProcessUplineTransparent(Tcb *tp, u8 *dp, int len)
     {
-    u8 *dp;
-    int len;
+    int count = len;
     u8 ch;
 
-    dp = tp->inputData;
-    len = tp->inputCount;
-
     /*
     **  Cancel transparent input forwarding timeout.
     */
     tp->xInputTimerRunning = FALSE;
 
     /*
-    **  Process transparent input.
+    **  Process transparent input. Stop when transparent mode terminates,
+    **  the rest of the data is then processed in the new input mode.
     */
-    while (len--)
+    while (len > 0 && tp->params.fvXInput)
         {
         ch = *dp++;
+        len -= 1;
 
         if (tp->params.fvEchoplex)
             {
@@ -510,6 +598,8 @@ static void npuAsyncProcessUplineTransparent(Tcb *tp)
         tp->xStartCycle = cycles;
         tp->xInputTimerRunning = TRUE;
         }
+
+    return(count - len);
     }
 
 /*--------------------------------------------------------------------------
@@ -517,19 +607,17 @@ static void npuAsyncProcessUplineTransparent(Tcb *tp)
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
+**                  dp          pointer to received data
+**                  len         number of bytes received
 **
-**  Returns:        Nothing.
+**  Returns:        Number of bytes consumed.
 **
 **------------------------------------------------------------------------*/
-static void npuAsyncProcessUplineAscii(Tcb *tp)
+static int npuAsyncProcessUplineAscii(Tcb *tp, u8 *dp, int len)
     {
-    u8 *dp;
-    int len;
+    int count = len;
     u8 ch;
 
-    dp = tp->inputData;
-    len = tp->inputCount;
-
     /*
     **  Process normalised input.
     */
@@ -663,6 +751,8 @@ static void npuAsyncProcessUplineAscii(Tcb *tp)
             npuTipInputReset(tp);
             }
         }
+
+    return(count);
     }
 
 /*--------------------------------------------------------------------------
@@ -670,21 +760,19 @@ static void npuAsyncProcessUplineAscii(Tcb *tp)
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
+**                  dp          pointer to received data
+**                  len         number of bytes received
 **
-**  Returns:        Nothing.
+**  Returns:        Number of bytes consumed.
 **
 **------------------------------------------------------------------------*/
-static void npuAsyncProcessUplineSpecial(Tcb *tp)
+static int npuAsyncProcessUplineSpecial(Tcb *tp, u8 *dp, int len)
     {
-    u8 *dp;
-    int len;
+    int count = len;
     u8 ch;
     int i;
     int cnt;
 
-    dp = tp->inputData;
-    len = tp->inputCount;
-
     /*
     **  Process normalised input.
     */
@@ -888,6 +976,8 @@ static void npuAsyncProcessUplineSpecial(Tcb *tp)
             npuTipInputReset(tp);
             }
         }
+
+    return(count);
     }
 
 /*--------------------------------------------------------------------------
@@ -895,21 +985,19 @@ static void npuAsyncProcessUplineSpecial(Tcb *tp)
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
+**                  dp          pointer to received data
+**                  len         number of bytes received
 **
-**  Returns:        Nothing.
+**  Returns:        Number of bytes consumed.
 **
 **------------------------------------------------------------------------*/
-static void npuAsyncProcessUplineNormal(Tcb *tp)
+static int npuAsyncProcessUplineNormal(Tcb *tp, u8 *dp, int len)
     {
-    u8 *dp;
-    int len;
+    int count = len;
     u8 ch;
     int i;
     int cnt;
 
-    dp = tp->inputData;
-    len = tp->inputCount;
-
     /*
     **  Process normalised input.
     */
@@ -1125,6 +1213,8 @@ static void npuAsyncProcessUplineNormal(Tcb *tp)
             npuTipInputReset(tp);
             }
         }
+
+    return(count);
     }
 
 /*---------------------------  End Of File  ------------------------------*/
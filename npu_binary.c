@@ -0,0 +1,245 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter, Paul Koning
+**
+**  Name: npu_binary.c
+**
+**  Description:
+**      Perform emulation of a block-mode binary connection in an NPU
+**      consisting of a CDC 2550 HCP running CCP. Data is passed in both
+**      directions as 8-bit transparent blocks without any editing, format
+**      effector processing or echo.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+#include "npu.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  Number of buffers kept in reserve for supervisory and ASYNC traffic.
+**  Binary input stays in the receive ring while the pool is this low.
+*/
+#define MinFreeBuffers      10
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process downline data from host.
+**
+**                  The data following the DBC is sent to the network
+**                  unchanged.
+**
+**  Parameters:     Name        Description.
+**                  cn          connection number
+**                  bp          buffer with downline data message.
+**                  last        last buffer.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuBinaryProcessDownlineData(u8 cn, NpuBuffer *bp, bool last)
+    {
+    Tcb *tp;
+    int len = bp->numBytes - BlkOffData - 1;
+
+    (void)last;
+
+    /*
+    **  Locate TCB dealing with this connection.
+    */
+    if (cn == 0 || cn > npuTcbCount)
+        {
+        npuLogMessage("Binary: unexpected CN %d - message ignored", cn);
+        return;
+        }
+
+    tp = npuTcbTable[cn];
+
+    if (len > 0)
+        {
+        npuNetSend(tp, bp->data + BlkOffData + 1, len);
+        }
+
+    npuNetQueueAck(tp, (u8)(bp->data[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN)));
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process upline data from the network.
+**
+**                  One block is built directly in an NPU buffer from the
+**                  connection's receive ring per call. The block is sent
+**                  as BLK if more data is already waiting, otherwise as
+**                  MSG.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuBinaryProcessUplineData(Tcb *tp)
+    {
+    NpuBuffer *bp;
+    u8 *mp;
+    u8 bt;
+    int len;
+    int avail;
+    int contiguous;
+    u32 out;
+
+    avail = tp->inputIn - tp->inputOut;
+    if (avail == 0)
+        {
+        return;
+        }
+
+    NpuRingBarrier();
+
+    /*
+    **  Leave the data in the ring until buffers become available again.
+    */
+    if (npuBipBufCount() < MinFreeBuffers)
+        {
+        return;
+        }
+
+    bp = npuBipBufGet();
+    if (bp == NULL)
+        {
+        return;
+        }
+
+    len = npuBinaryUplineBlockSize(tp);
+    if (len > avail)
+        {
+        len = avail;
+        }
+
+    bt = len < avail ? BtHTBLK : BtHTMSG;
+
+    /*
+    **  Build upline data header.
+    */
+    mp = bp->data;
+    *mp++ = AddrHost;           // DN
+    *mp++ = AddrNpu;            // SN
+    *mp++ = tp->portNumber;     // CN
+    *mp++ = bt | (tp->uplineBsn << BlkShiftBSN);
+    *mp++ = DbcTransparent;
+
+    /*
+    **  Copy data out of the ring, which may take two pieces if it wraps.
+    */
+    out = tp->inputOut & (MaxUplineRing - 1);
+    contiguous = MaxUplineRing - out;
+    if (contiguous > len)
+        {
+        contiguous = len;
+        }
+
+    memcpy(mp, tp->inputRing + out, contiguous);
+    memcpy(mp + contiguous, tp->inputRing, len - contiguous);
+
+    bp->numBytes = BlkOffData + 1 + len;
+    NpuRingBarrier();
+    tp->inputOut += len;
+
+    npuBipRequestUplineTransfer(bp);
+
+    /*
+    **  Advance the BSN for the next block.
+    */
+    npuTipInputReset(tp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the size of a full upline block.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Upline block size in bytes.
+**
+**------------------------------------------------------------------------*/
+int npuBinaryUplineBlockSize(Tcb *tp)
+    {
+    (void)tp;
+
+    return(MaxBuffer - BlkOffData - 1);
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*---------------------------  End Of File  ------------------------------*/
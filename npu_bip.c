@@ -76,6 +76,7 @@
 */
 static NpuBuffer *bufPool = NULL;
 static int bufCount = 0;
+static int bufMinCount = 0;
 
 static NpuBuffer *bipUplineBuffer = NULL;
 static NpuQueue *bipUplineQueue;
@@ -116,6 +117,7 @@ void npuBipInit(void)
     **  Allocate data buffer pool.
     */
     bufCount = NumBuffs;
+    bufMinCount = NumBuffs;
     bufPool = calloc(NumBuffs, sizeof(NpuBuffer));
     if (bufPool == NULL)
         {
@@ -194,6 +196,19 @@ int npuBipBufCount(void)
     return (bufCount);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Return lowest free buffer count seen since startup.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Buffer count low water mark.
+**
+**------------------------------------------------------------------------*/
+int npuBipBufMinCount(void)
+    {
+    return (bufMinCount);
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Allocate NPU buffer from pool.
 **
@@ -218,6 +233,10 @@ NpuBuffer *npuBipBufGet(void)
         */
         bufPool = bp->next;
         bufCount -= 1;
+        if (bufCount < bufMinCount)
+            {
+            bufMinCount = bufCount;
+            }
 
         /*
         **  Initialise buffer.
@@ -513,6 +532,17 @@ void npuBipAbortDownlineReceived(void)
 **------------------------------------------------------------------------*/
 void npuBipRequestUplineTransfer(NpuBuffer *bp)
     {
+    u8 cn = bp->data[BlkOffCN];
+    u8 bt = bp->data[BlkOffBTBSN] & BlkMaskBT;
+
+    /*
+    **  Account for data blocks of terminal connections.
+    */
+    if (cn != 0 && cn <= npuTcbCount && (bt == BtHTBLK || bt == BtHTMSG))
+        {
+        npuStatsUpline(npuTcbTable[cn], bp->numBytes - BlkOffData - 1);
+        }
+
     if (bipUplineBuffer != NULL)
         {
         /*
@@ -0,0 +1,1109 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter, Paul Koning
+**
+**  Name: npu_hasp.c
+**
+**  Description:
+**      Perform emulation of the HASP TIP in an NPU consisting of a CDC 2550
+**      HCP running CCP. A HASP multileaving workstation connects over TCP.
+**      The line TCB owns the network connection and the devices configured
+**      on the line (console, card readers, printers and punches) are each
+**      connected to the host on their own device TCB.
+**
+**      Blocks are exchanged in BSC transparent framing without CRC, i.e.
+**      DLE STX <BCB> <FCS> <FCS> <records> <RCB=0> DLE ETB, with DLE
+**      doubled inside the block. Each record is RCB, SRCB and SCB
+**      compressed EBCDIC data terminated by SCB 0. As TCP is reliable and
+**      full duplex there is no line turnaround: blocks are sent in both
+**      directions as soon as they are ready and a received block is
+**      answered with DLE ACK0 only if there is no data to send.
+**
+**      Card decks are sent upline as records terminated by US in BLK
+**      blocks; the empty record which ends a deck is sent as MSG. Print,
+**      punch and console output is taken from the downline blocks line by
+**      line and interleaved across all active streams in each HASP block.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+#include "npu.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  BSC control characters (EBCDIC).
+*/
+#define BscSOH          0x01
+#define BscSTX          0x02
+#define BscETX          0x03
+#define BscDLE          0x10
+#define BscETB          0x26
+#define BscENQ          0x2D
+#define BscSYN          0x32
+#define BscEOT          0x37
+#define BscACK0         0x70
+
+/*
+**  Record control bytes. Function records carry the stream number in
+**  bits 4-6 and the function type in bits 0-3.
+*/
+#define RcbEnd          0x00    // end of block
+#define RcbPermRequest  0x90    // request to initiate a function
+#define RcbPermGrant    0xA0    // permission to initiate a function granted
+#define RcbControl      0xE0    // general control record
+#define RcbSignon       0xF0    // signon record
+
+#define RcbConsoleIn    0x01    // operator console input
+#define RcbConsoleOut   0x02    // operator console output
+#define RcbReader       0x03    // card reader
+#define RcbPrinter      0x04    // printer
+#define RcbPunch        0x05    // card punch
+
+/*
+**  Sub-record control bytes. For printers the SRCB gives the carriage
+**  control to perform before printing the record.
+*/
+#define SrcbNormal      0x80
+#define SrcbSpace       0x80    // space 0 to 3 lines
+#define SrcbSkip        0x90    // skip to channel
+#define SrcbSignon      0xC1
+
+/*
+**  String control bytes.
+*/
+#define ScbEnd          0x00    // end of record
+#define ScbBlanks       0x80    // n blanks
+#define ScbDup          0xA0    // n copies of the following character
+#define ScbLiteral      0xC0    // n characters follow
+#define ScbMaxDup       0x1F
+#define ScbMaxLiteral   0x3F
+
+/*
+**  Function control sequence.
+*/
+#define FcsSuspend      0x40    // workstation has suspended all output
+#define Fcs1Ready       0x8F
+#define Fcs2Ready       0xCF
+
+/*
+**  Receive framing states.
+*/
+#define RxIdle          0
+#define RxIdleDle       1
+#define RxBlock         2
+#define RxBlockDle      3
+
+/*
+**  Miscellaneous constants.
+*/
+#define HaspBlockSize   400     // maximum data in a block sent to the workstation
+#define HaspMaxRecord   255     // maximum record length
+#define HaspSignonLen   80      // signon card is sent uncompressed
+#define EbcdicBlank     0x40
+
+/*
+**  Number of buffers kept in reserve for supervisory and ASYNC traffic.
+**  Input stays in the receive ring while the pool is this low.
+*/
+#define MinFreeBuffers  10
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#define RcbMake(stream, type)   (0x80 | (((stream) & 7) << 4) | (type))
+#define RcbStream(rcb)          (((rcb) >> 4) & 7)
+#define RcbType(rcb)            ((rcb) & 0x0F)
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static int npuHaspSendBlocks(Tcb *tp);
+static u8 *npuHaspBuildRecords(Tcb *tp, u8 *mp, u8 *limit);
+static int npuHaspNextRecord(Tcb *dp, u8 *rec, int *nextOffset);
+static void npuHaspProcessBlock(Tcb *tp, u8 *blk, int len);
+static void npuHaspUplineConsole(Tcb *dp, u8 *text, int len);
+static void npuHaspUplineCard(Tcb *dp, u8 *text, int len);
+static Tcb *npuHaspFindDevice(Tcb *tp, u8 deviceType, u8 stream);
+static u8 npuHaspPrintControl(u8 fe);
+static u8 *npuHaspCompress(u8 *dp, u8 *text, int len);
+static u8 *npuHaspExpand(u8 *sp, u8 *end, u8 *text, int *textLen);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static u8 ackMsg[] = { BscDLE, BscACK0 };
+
+static u8 payload[HaspBlockSize + 8];
+static u8 frame[2 * sizeof(payload) + 8];
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process downline data from host.
+**
+**                  The block is kept on the device's output queue until
+**                  all its lines have been put into HASP blocks.
+**
+**  Parameters:     Name        Description.
+**                  cn          connection number
+**                  bp          buffer with downline data message.
+**                  last        last buffer.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuHaspProcessDownlineData(u8 cn, NpuBuffer *bp, bool last)
+    {
+    Tcb *dp;
+    NpuBuffer *qp;
+    u8 blockSeqNo = (u8)(bp->data[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN));
+
+    (void)last;
+
+    /*
+    **  Locate TCB dealing with this connection.
+    */
+    if (cn == 0 || cn > npuTcbCount)
+        {
+        npuLogMessage("HASP: unexpected CN %d - message ignored", cn);
+        return;
+        }
+
+    dp = npuTcbTable[cn];
+    if (dp->lineTcb == NULL)
+        {
+        npuLogMessage("HASP: CN %d is not a HASP device - message ignored", cn);
+        return;
+        }
+
+    qp = npuBipBufGet();
+    if (qp == NULL)
+        {
+        npuTipNotifySent(dp, blockSeqNo);
+        return;
+        }
+
+    memcpy(qp->data, bp->data, bp->numBytes);
+    qp->numBytes = bp->numBytes;
+    qp->offset = BlkOffDbc + 1;
+    qp->blockSeqNo = blockSeqNo;
+    npuBipQueueAppend(qp, &dp->outputQ);
+
+    npuHaspProcessOutput(dp->lineTcb);
+    npuNetStartOutput(dp->lineTcb);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process upline data from workstation.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuHaspProcessUplineData(Tcb *tp)
+    {
+    u8 ch;
+
+    while (tp->inputIn != tp->inputOut)
+        {
+        /*
+        **  Leave further blocks in the ring while buffers are short.
+        */
+        if (tp->haspRxState == RxIdle && npuBipBufCount() < MinFreeBuffers)
+            {
+            return;
+            }
+
+        NpuRingBarrier();
+        ch = tp->inputRing[tp->inputOut & (MaxUplineRing - 1)];
+        NpuRingBarrier();
+        tp->inputOut += 1;
+
+        switch (tp->haspRxState)
+            {
+        case RxIdle:
+            if (ch == BscDLE)
+                {
+                tp->haspRxState = RxIdleDle;
+                }
+            else if (ch == BscENQ)
+                {
+                /*
+                **  Line bid - we are always ready.
+                */
+                npuNetSend(tp, ackMsg, sizeof(ackMsg));
+                }
+            else if (ch == BscEOT)
+                {
+                npuLogMessage("HASP: EOT received on port %d", tp->portNumber);
+                }
+
+            break;
+
+        case RxIdleDle:
+            if (ch == BscSTX)
+                {
+                tp->inBufPtr = tp->inBuf;
+                tp->haspRxState = RxBlock;
+                }
+            else
+                {
+                /*
+                **  DLE ACK0 and anything else outside a block is ignored.
+                */
+                tp->haspRxState = RxIdle;
+                }
+
+            break;
+
+        case RxBlock:
+            if (ch == BscDLE)
+                {
+                tp->haspRxState = RxBlockDle;
+                break;
+                }
+
+            if (tp->inBufPtr >= tp->inBuf + MaxBuffer)
+                {
+                npuLogMessage("HASP: block too long on port %d - discarded", tp->portNumber);
+                tp->haspRxState = RxIdle;
+                break;
+                }
+
+            *tp->inBufPtr++ = ch;
+            break;
+
+        case RxBlockDle:
+            if (ch == BscDLE)
+                {
+                if (tp->inBufPtr < tp->inBuf + MaxBuffer)
+                    {
+                    *tp->inBufPtr++ = ch;
+                    }
+
+                tp->haspRxState = RxBlock;
+                }
+            else if (ch == BscETB || ch == BscETX)
+                {
+                tp->haspRxState = RxIdle;
+                npuHaspProcessBlock(tp, tp->inBuf, tp->inBufPtr - tp->inBuf);
+                }
+            else if (ch == BscSYN)
+                {
+                /*
+                **  Transparent idle fill.
+                */
+                tp->haspRxState = RxBlock;
+                }
+            else
+                {
+                npuLogMessage("HASP: framing error 0x%02X on port %d - block discarded", ch, tp->portNumber);
+                tp->haspRxState = RxIdle;
+                }
+
+            break;
+            }
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the size of a full upline block.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Upline block size in bytes.
+**
+**------------------------------------------------------------------------*/
+int npuHaspUplineBlockSize(Tcb *tp)
+    {
+    (void)tp;
+
+    return(MaxBuffer);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send pending output of a HASP line once the network
+**                  has taken everything previously queued.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuHaspProcessOutput(Tcb *tp)
+    {
+    npuHaspSendBlocks(tp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate a device TCB on a HASP line.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**                  stream      device stream number
+**
+**  Returns:        Device TCB pointer or NULL if none is free.
+**
+**------------------------------------------------------------------------*/
+Tcb *npuHaspAllocDevice(Tcb *tp, u8 stream)
+    {
+    Tcb *dp = tp->deviceTcbs;
+    int i;
+
+    if (dp == NULL)
+        {
+        return(NULL);
+        }
+
+    for (i = 0; i < MaxHaspDevices; i++, dp++)
+        {
+        if (dp->state == StTermIdle)
+            {
+            dp->lineTcb = tp;
+            dp->connType = tp->connType;
+            dp->tipType = TtHASP;
+            dp->haspStream = stream == 0 ? 1 : stream & 7;
+            dp->xoff = FALSE;
+            npuTipInputReset(dp);
+            npuStatsConnect(dp);
+            return(dp);
+            }
+        }
+
+    return(NULL);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Disconnect all devices of a HASP line after the
+**                  workstation has dropped the network connection.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuHaspDiscRequestLine(Tcb *tp)
+    {
+    Tcb *dp = tp->deviceTcbs;
+    int i;
+
+    if (dp != NULL)
+        {
+        for (i = 0; i < MaxHaspDevices; i++, dp++)
+            {
+            if (dp->lineTcb == tp && dp->state != StTermIdle)
+                {
+                npuSvmDiscRequestTerminal(dp);
+                }
+            }
+        }
+
+    tp->haspRxState = RxIdle;
+    tp->haspGrants = 0;
+    tp->haspSuspended = FALSE;
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build and send HASP blocks while the network keeps up.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**
+**  Returns:        Number of blocks sent.
+**
+**------------------------------------------------------------------------*/
+static int npuHaspSendBlocks(Tcb *tp)
+    {
+    u8 *mp;
+    u8 *fp;
+    u8 *sp;
+    u8 stream;
+    int blocks = 0;
+
+    if (tp->state != StTermHostConnected)
+        {
+        return(0);
+        }
+
+    while (tp->outputIn == tp->outputOut)
+        {
+        mp = payload + 3;
+
+        /*
+        **  Grant outstanding permission requests.
+        */
+        for (stream = 1; stream <= 7; stream++)
+            {
+            if ((tp->haspGrants & (1 << stream)) != 0)
+                {
+                *mp++ = RcbPermGrant;
+                *mp++ = RcbMake(stream, RcbReader);
+                *mp++ = ScbEnd;
+                }
+            }
+
+        tp->haspGrants = 0;
+
+        if (!tp->haspSuspended)
+            {
+            mp = npuHaspBuildRecords(tp, mp, payload + HaspBlockSize - 1);
+            }
+
+        if (mp == payload + 3)
+            {
+            break;
+            }
+
+        *mp++ = RcbEnd;
+        payload[0] = 0x80 | tp->haspTxBcb;
+        payload[1] = Fcs1Ready;
+        payload[2] = Fcs2Ready;
+        tp->haspTxBcb = (tp->haspTxBcb + 1) & 0x0F;
+
+        /*
+        **  Frame the block, doubling any DLE in the data.
+        */
+        fp = frame;
+        *fp++ = BscSYN;
+        *fp++ = BscSYN;
+        *fp++ = BscDLE;
+        *fp++ = BscSTX;
+        for (sp = payload; sp < mp; sp++)
+            {
+            if (*sp == BscDLE)
+                {
+                *fp++ = BscDLE;
+                }
+
+            *fp++ = *sp;
+            }
+
+        *fp++ = BscDLE;
+        *fp++ = BscETB;
+
+        npuNetSend(tp, frame, fp - frame);
+        blocks += 1;
+        }
+
+    return(blocks);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Fill a HASP block with records from the devices of a
+**                  line, taking one record from each device in turn.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**                  mp          where to store the records
+**                  limit       end of space for records
+**
+**  Returns:        Pointer past the last record stored.
+**
+**------------------------------------------------------------------------*/
+static u8 *npuHaspBuildRecords(Tcb *tp, u8 *mp, u8 *limit)
+    {
+    static u8 rec[HaspMaxRecord + HaspMaxRecord / ScbMaxLiteral + 8];
+    NpuBuffer *bp;
+    Tcb *dp;
+    int count;
+    int len;
+    int nextOffset;
+    bool added;
+
+    do
+        {
+        added = FALSE;
+        for (count = 0; count < MaxHaspDevices; count++)
+            {
+            dp = tp->deviceTcbs + tp->haspNextDevice;
+            tp->haspNextDevice = (tp->haspNextDevice + 1) % MaxHaspDevices;
+
+            if (dp->lineTcb != tp || dp->state != StTermHostConnected)
+                {
+                continue;
+                }
+
+            len = npuHaspNextRecord(dp, rec, &nextOffset);
+            if (len == 0)
+                {
+                continue;
+                }
+
+            if (len > limit - mp)
+                {
+                /*
+                **  Block is full - retry this device first next time.
+                */
+                tp->haspNextDevice = dp - tp->deviceTcbs;
+                return(mp);
+                }
+
+            memcpy(mp, rec, len);
+            mp += len;
+            added = TRUE;
+
+            /*
+            **  Acknowledge the downline block once all of it has been taken.
+            */
+            bp = dp->outputQ.first;
+            bp->offset = nextOffset;
+            if (bp->offset >= bp->numBytes)
+                {
+                bp = npuBipQueueExtract(&dp->outputQ);
+                npuStatsAck(dp, bp->blockSeqNo);
+                npuTipNotifySent(dp, bp->blockSeqNo);
+                npuBipBufRelease(bp);
+                }
+            }
+        } while (added);
+
+    return(mp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Encode the next output line of a device as a HASP
+**                  record without consuming it.
+**
+**  Parameters:     Name        Description.
+**                  dp          device TCB pointer
+**                  rec         where to store the record
+**                  nextOffset  returns buffer offset following the line
+**
+**  Returns:        Record length or 0 if there is nothing to send.
+**
+**------------------------------------------------------------------------*/
+static int npuHaspNextRecord(Tcb *dp, u8 *rec, int *nextOffset)
+    {
+    NpuBuffer *bp;
+    u8 *data;
+    u8 *rp;
+    u8 *ptrUS;
+    u8 fe = ' ';
+    int pos;
+    int len;
+
+    /*
+    **  Skip over (and acknowledge) empty blocks.
+    */
+    while ((bp = dp->outputQ.first) != NULL && bp->offset >= bp->numBytes)
+        {
+        bp = npuBipQueueExtract(&dp->outputQ);
+        npuTipNotifySent(dp, bp->blockSeqNo);
+        npuBipBufRelease(bp);
+        }
+
+    if (bp == NULL)
+        {
+        return(0);
+        }
+
+    data = bp->data;
+    pos = bp->offset;
+    if ((data[BlkOffDbc] & DbcNoFe) == 0)
+        {
+        fe = data[pos++];
+        }
+
+    /*
+    **  The line ends at the US byte or the end of the block.
+    */
+    len = bp->numBytes - pos;
+    ptrUS = len > 0 ? memchr(data + pos, ChrUS, len) : NULL;
+    if (ptrUS != NULL)
+        {
+        len = ptrUS - (data + pos);
+        *nextOffset = pos + len + 1;
+        }
+    else
+        {
+        *nextOffset = bp->numBytes;
+        }
+
+    if (len > HaspMaxRecord)
+        {
+        len = HaspMaxRecord;
+        }
+
+    rp = rec;
+    switch (dp->deviceType)
+        {
+    case DtLP:
+        *rp++ = RcbMake(dp->haspStream, RcbPrinter);
+        *rp++ = npuHaspPrintControl(fe);
+        break;
+
+    case DtCP:
+        *rp++ = RcbMake(dp->haspStream, RcbPunch);
+        *rp++ = SrcbNormal;
+        break;
+
+    default:
+        *rp++ = RcbMake(1, RcbConsoleOut);
+        *rp++ = SrcbNormal;
+        break;
+        }
+
+    rp = npuHaspCompress(rp, data + pos, len);
+
+    return(rp - rec);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Process a block received from the workstation.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**                  blk         block data following DLE STX
+**                  len         block length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuHaspProcessBlock(Tcb *tp, u8 *blk, int len)
+    {
+    static u8 text[HaspMaxRecord];
+    u8 *sp = blk + 3;
+    u8 *end = blk + len;
+    u8 rcb;
+    u8 srcb;
+    int textLen;
+    Tcb *dp;
+
+    if (len < 3)
+        {
+        npuLogMessage("HASP: short block on port %d", tp->portNumber);
+        return;
+        }
+
+    /*
+    **  Check block sequence and note whether output may continue.
+    */
+    if ((blk[0] & 0x0F) != tp->haspRxBcb)
+        {
+        npuLogMessage("HASP: BCB sequence error on port %d, expected %d, received %d",
+            tp->portNumber, tp->haspRxBcb, blk[0] & 0x0F);
+        }
+
+    tp->haspRxBcb = (blk[0] + 1) & 0x0F;
+    tp->haspSuspended = (blk[1] & FcsSuspend) != 0;
+
+    while (sp < end)
+        {
+        rcb = *sp++;
+        if (rcb == RcbEnd || sp >= end)
+            {
+            break;
+            }
+
+        srcb = *sp++;
+
+        switch (rcb)
+            {
+        case RcbPermRequest:
+            /*
+            **  Permission to start a card deck is granted if the reader
+            **  is connected to the host.
+            */
+            if (   RcbType(srcb) == RcbReader
+                && npuHaspFindDevice(tp, DtCR, RcbStream(srcb)) != NULL)
+                {
+                tp->haspGrants |= 1 << RcbStream(srcb);
+                }
+
+            if (sp < end && *sp == ScbEnd)
+                {
+                sp += 1;
+                }
+
+            continue;
+
+        case RcbPermGrant:
+        case RcbControl:
+            if (sp < end && *sp == ScbEnd)
+                {
+                sp += 1;
+                }
+
+            continue;
+
+        case RcbSignon:
+            if (srcb == SrcbSignon)
+                {
+                npuLogMessage("HASP: signon on port %d", tp->portNumber);
+                sp += HaspSignonLen;
+                }
+
+            continue;
+            }
+
+        sp = npuHaspExpand(sp, end, text, &textLen);
+        if (sp == NULL)
+            {
+            npuLogMessage("HASP: bad record 0x%02X on port %d - rest of block discarded", rcb, tp->portNumber);
+            break;
+            }
+
+        switch (RcbType(rcb))
+            {
+        case RcbConsoleIn:
+            dp = npuHaspFindDevice(tp, DtCONSOLE, 0);
+            if (dp != NULL)
+                {
+                npuHaspUplineConsole(dp, text, textLen);
+                }
+
+            break;
+
+        case RcbReader:
+            dp = npuHaspFindDevice(tp, DtCR, RcbStream(rcb));
+            if (dp != NULL)
+                {
+                npuHaspUplineCard(dp, text, textLen);
+                }
+            else
+                {
+                npuLogMessage("HASP: no reader for stream %d on port %d", RcbStream(rcb), tp->portNumber);
+                }
+
+            break;
+
+        default:
+            npuLogMessage("HASP: unexpected RCB 0x%02X on port %d", rcb, tp->portNumber);
+            break;
+            }
+        }
+
+    /*
+    **  Respond with data if there is any, otherwise acknowledge.
+    */
+    if (npuHaspSendBlocks(tp) == 0)
+        {
+        npuNetSend(tp, ackMsg, sizeof(ackMsg));
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send an operator console line to the host.
+**
+**  Parameters:     Name        Description.
+**                  dp          console device TCB pointer
+**                  text        ASCII text
+**                  len         text length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuHaspUplineConsole(Tcb *dp, u8 *text, int len)
+    {
+    memcpy(dp->inBufStart, text, len);
+    dp->inBufPtr = dp->inBufStart + len;
+    npuBipRequestUplineCanned(dp->inBuf, dp->inBufPtr - dp->inBuf);
+    npuTipInputReset(dp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a card to the reader's upline block. An empty
+**                  record ends the deck.
+**
+**  Parameters:     Name        Description.
+**                  dp          reader device TCB pointer
+**                  text        ASCII card image
+**                  len         card length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuHaspUplineCard(Tcb *dp, u8 *text, int len)
+    {
+    if (len == 0)
+        {
+        /*
+        **  End of deck - send the rest as MSG.
+        */
+        npuBipRequestUplineCanned(dp->inBuf, dp->inBufPtr - dp->inBuf);
+        npuTipInputReset(dp);
+        return;
+        }
+
+    if (dp->inBufPtr + len + 1 > dp->inBuf + MaxBuffer)
+        {
+        /*
+        **  Block is full - send it as BLK.
+        */
+        dp->inBuf[BlkOffBTBSN] = BtHTBLK | (dp->uplineBsn << BlkShiftBSN);
+        npuBipRequestUplineCanned(dp->inBuf, dp->inBufPtr - dp->inBuf);
+        npuTipInputReset(dp);
+        }
+
+    memcpy(dp->inBufPtr, text, len);
+    dp->inBufPtr += len;
+    *dp->inBufPtr++ = ChrUS;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find a connected device on a HASP line.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**                  deviceType  device type
+**                  stream      stream number, 0 for any
+**
+**  Returns:        Device TCB pointer or NULL if not found.
+**
+**------------------------------------------------------------------------*/
+static Tcb *npuHaspFindDevice(Tcb *tp, u8 deviceType, u8 stream)
+    {
+    Tcb *dp = tp->deviceTcbs;
+    int i;
+
+    for (i = 0; i < MaxHaspDevices; i++, dp++)
+        {
+        if (   dp->lineTcb == tp
+            && dp->state == StTermHostConnected
+            && dp->deviceType == deviceType
+            && (stream == 0 || dp->haspStream == stream))
+            {
+            return(dp);
+            }
+        }
+
+    return(NULL);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Translate a format effector into printer SRCB.
+**
+**  Parameters:     Name        Description.
+**                  fe          format effector
+**
+**  Returns:        SRCB.
+**
+**------------------------------------------------------------------------*/
+static u8 npuHaspPrintControl(u8 fe)
+    {
+    switch (fe)
+        {
+    case '+':
+        return(SrcbSpace | 0);
+
+    case '0':
+        return(SrcbSpace | 2);
+
+    case '-':
+        return(SrcbSpace | 3);
+
+    case '1':
+        return(SrcbSkip | 1);
+
+    default:
+        return(SrcbSpace | 1);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert ASCII text to SCB compressed EBCDIC.
+**
+**  Parameters:     Name        Description.
+**                  dp          where to store the compressed record
+**                  text        ASCII text
+**                  len         text length
+**
+**  Returns:        Pointer past the terminating SCB.
+**
+**------------------------------------------------------------------------*/
+static u8 *npuHaspCompress(u8 *dp, u8 *text, int len)
+    {
+    u8 *lit = NULL;
+    u8 ch;
+    int run;
+
+    while (len > 0)
+        {
+        ch = asciiToEbcdic[*text & 0x7F];
+        for (run = 1; run < len && run < ScbMaxDup; run++)
+            {
+            if (asciiToEbcdic[text[run] & 0x7F] != ch)
+                {
+                break;
+                }
+            }
+
+        if (run >= 3 || (run == 2 && ch == EbcdicBlank))
+            {
+            lit = NULL;
+            if (ch == EbcdicBlank)
+                {
+                *dp++ = ScbBlanks | run;
+                }
+            else
+                {
+                *dp++ = ScbDup | run;
+                *dp++ = ch;
+                }
+            }
+        else
+            {
+            run = 1;
+            if (lit == NULL || (*lit & ScbMaxLiteral) == ScbMaxLiteral)
+                {
+                lit = dp++;
+                *lit = ScbLiteral;
+                }
+
+            *lit += 1;
+            *dp++ = ch;
+            }
+
+        text += run;
+        len -= run;
+        }
+
+    *dp++ = ScbEnd;
+
+    return(dp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Expand an SCB compressed EBCDIC record into ASCII.
+**
+**  Parameters:     Name        Description.
+**                  sp          compressed record
+**                  end         end of block
+**                  text        where to store the ASCII text
+**                  textLen     returns text length
+**
+**  Returns:        Pointer past the terminating SCB or NULL if the record
+**                  is malformed.
+**
+**------------------------------------------------------------------------*/
+static u8 *npuHaspExpand(u8 *sp, u8 *end, u8 *text, int *textLen)
+    {
+    int n = 0;
+    int count;
+    u8 scb;
+    u8 ch;
+
+    while (sp < end)
+        {
+        scb = *sp++;
+        if (scb == ScbEnd)
+            {
+            *textLen = n;
+            return(sp);
+            }
+
+        if ((scb & ScbLiteral) == ScbLiteral)
+            {
+            count = scb & ScbMaxLiteral;
+            if (sp + count > end)
+                {
+                return(NULL);
+                }
+
+            while (count-- > 0)
+                {
+                ch = ebcdicToAscii[*sp++];
+                if (n < HaspMaxRecord)
+                    {
+                    text[n++] = ch;
+                    }
+                }
+            }
+        else if ((scb & ScbBlanks) == ScbBlanks)
+            {
+            count = scb & ScbMaxDup;
+            ch = ' ';
+            if ((scb & ScbDup) == ScbDup)
+                {
+                if (sp >= end)
+                    {
+                    return(NULL);
+                    }
+
+                ch = ebcdicToAscii[*sp++];
+                }
+
+            while (count-- > 0 && n < HaspMaxRecord)
+                {
+                text[n++] = ch;
+                }
+            }
+        else
+            {
+            /*
+            **  Abort or unknown SCB.
+            */
+            return(NULL);
+            }
+        }
+
+    return(NULL);
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -431,9 +431,12 @@ static FcStatus npuHipFunc(PpWord funcCode)
 
         case StHipIdle:
             /*
-            **  Poll network status.
+            **  Process network events if the network thread has staged any.
             */
-            npuNetCheckStatus();
+            if (npuNetReady)
+                {
+                npuNetCheckStatus();
+                }
 
             /*
             **  If no upline data pending.
@@ -32,6 +32,8 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "const.h"
 #include "types.h"
 #include "proto.h"
@@ -46,6 +48,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <signal.h>
@@ -57,6 +60,22 @@
 **  -----------------
 */
 #define Ms200       200000
+#define NetPollMs   10
+
+/*
+**  Output scheduling: bytes sent to all connections per poll and round
+**  robin quantum of connections without a configured downline block size.
+*/
+#define OutputBudget    16384
+#define OutputQuantum   1024
+
+/*
+**  Connections which are closed by the network thread once their final
+**  message has been sent, and the time rejected connections are kept
+**  open so that the user gets to read why.
+*/
+#define MaxDeferredClose    32
+#define RejectDelay         2
 
 /*
 **  -----------------------
@@ -76,11 +95,24 @@
 typedef struct npuConnType
     {
     u16                 tcpPort;
-    int                 numConns;
+    int                 numConns;           // TCBs allocated so far
+    int                 maxConns;           // TCBs which may be allocated on demand
     u8                  connType;
-    Tcb                 *startTcb;
+    u32                 outputRate;
+    Tcb                 *freeTcbs;
     } NpuConnType;
 
+/*
+**  Connection waiting to be closed by the network thread.
+*/
+typedef struct npuNetClose
+    {
+    int                 fd;
+    char                *msg;               // message still to be sent or NULL
+    int                 len;
+    time_t              due;                // time at which to close
+    } NpuNetClose;
+
 /*
 **  ---------------------------
 **  Private Function Prototypes
@@ -93,8 +125,25 @@ static void npuNetThread(void *param);
 static void *npuNetThread(void *param);
 #endif
 static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct);
+static void npuNetSendTelnet(Tcb *tp, u8 *data, int len);
+static void npuNetSendRaw(Tcb *tp, u8 *data, int len);
 static void npuNetQueueOutput(Tcb *tp, u8 *data, int len);
-static void npuNetTryOutput(Tcb *tp);
+static bool npuNetGrowOutput(Tcb *tp, int len);
+static int npuNetTryOutput(Tcb *tp);
+static bool npuNetScheduleOutput(void);
+static int npuNetServeOutput(Tcb *tp, int budget);
+static int npuNetOutputQuantum(Tcb *tp);
+static int npuNetOutputTokens(Tcb *tp);
+static void npuNetAckSent(Tcb *tp);
+static int npuNetInputLimit(Tcb *tp);
+static bool npuNetReceive(Tcb *tp);
+static void npuNetCloseConnection(Tcb *tp);
+static void npuNetAbortConnection(Tcb *tp, char *msg, int len);
+static void npuNetDeferClose(int fd, char *msg, int len, int delay);
+static void npuNetServeClose(void);
+static Tcb *npuNetNewTcb(NpuConnType *ct);
+static void npuNetReleaseTcb(Tcb *tp);
+static void npuNetRotateActive(void);
 
 /*
 **  ----------------
@@ -102,6 +151,36 @@ static void npuNetTryOutput(Tcb *tp);
 **  ----------------
 */
 u16 npuNetTcpConns = 0;
+volatile bool npuNetReady = FALSE;
+
+/*
+**  Connection types, indexed by ConnTypeXxx.
+*/
+NpuConnDesc npuConnDesc[] =
+    {
+        {
+        "raw",      TRUE,   TtASYNC,    0,
+        npuNetSendRaw,      npuAsyncProcessUplineData,  npuAsyncProcessDownlineData,  npuAsyncUplineBlockSize,  NULL
+        },
+        {
+        "pterm",    TRUE,   TtASYNC,    0,
+        npuNetSendTelnet,   npuAsyncProcessUplineData,  npuAsyncProcessDownlineData,  npuAsyncUplineBlockSize,  NULL
+        },
+        {
+        "rs232",    TRUE,   TtASYNC,    0,
+        npuNetSendRaw,      npuAsyncProcessUplineData,  npuAsyncProcessDownlineData,  npuAsyncUplineBlockSize,  NULL
+        },
+        {
+        "binary",   FALSE,  TtASYNC,    0,
+        npuNetSendRaw,      npuBinaryProcessUplineData, npuBinaryProcessDownlineData, npuBinaryUplineBlockSize, NULL
+        },
+        {
+        "hasp",     FALSE,  TtHASP,     MaxHaspDevices,
+        npuNetSendRaw,      npuHaspProcessUplineData,   npuHaspProcessDownlineData,   npuHaspUplineBlockSize,   npuHaspProcessOutput
+        },
+    };
+
+u8 npuConnDescCount = sizeof(npuConnDesc) / sizeof(npuConnDesc[0]);
 
 /*
 **  -----------------
@@ -119,7 +198,33 @@ static char noPortsAvailMsg[] = "\r\nNo free ports available - please try again
 static NpuConnType connTypes[MaxConnTypes];
 static int numConnTypes = 0;
 
-static int pollIndex = 0;
+/*
+**  Set while output is being released, so that TIPs supplying more
+**  output from within the scheduler don't start it again.
+*/
+static bool outputActive = FALSE;
+
+/*
+**  Network TCBs in use. The network thread links new connections at the
+**  tail and the emulation thread unlinks them once they are idle again,
+**  both with the network lock held. Only the emulation thread unlinks,
+**  so it may walk the list without the lock.
+*/
+static Tcb * volatile activeHead = NULL;
+static Tcb *activeTail = NULL;
+
+/*
+**  Connections to be closed by the network thread, with the network
+**  lock held.
+*/
+static NpuNetClose closeList[MaxDeferredClose];
+static int closeCount = 0;
+
+#if defined(_WIN32)
+static CRITICAL_SECTION npuNetMutex;
+#else
+static pthread_mutex_t npuNetMutex;
+#endif
 
 /*
 **--------------------------------------------------------------------------
@@ -135,14 +240,16 @@ static int pollIndex = 0;
 **  Parameters:     Name        Description.
 **                  tcpPort     TCP port number
 **                  numConns    Number of connections on this TCP port
-**                  connType    Connection type (raw/pterm/rs232)
+**                  maxConns    Number of connections it may grow to
+**                  connType    Connection type (index into npuConnDesc[])
+**                  outputRate  Output rate in bytes per second, 0 if unlimited
 **
 **  Returns:        NpuNetRegOk: successfully registered
 **                  NpuNetRegOvfl: too many connection types
 **                  NpuNetRegDupl: duplicate TCP port specified
 **
 **------------------------------------------------------------------------*/
-int npuNetRegister(int tcpPort, int numConns, int connType)
+int npuNetRegister(int tcpPort, int numConns, int maxConns, int connType, int outputRate)
     {
     int i;
 
@@ -170,13 +277,39 @@ int npuNetRegister(int tcpPort, int numConns, int connType)
     */
     connTypes[numConnTypes].tcpPort = tcpPort;
     connTypes[numConnTypes].numConns = numConns;
+    connTypes[numConnTypes].maxConns = maxConns > numConns ? maxConns : numConns;
     connTypes[numConnTypes].connType = connType;
+    connTypes[numConnTypes].outputRate = outputRate;
     numConnTypes += 1;
     npuNetTcpConns += numConns;
 
     return(NpuNetRegOk);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Look up connection type by name.
+**
+**  Parameters:     Name        Description.
+**                  name        connection type name as used in cyber.ini
+**
+**  Returns:        Connection type or -1 if name is unknown.
+**
+**------------------------------------------------------------------------*/
+int npuNetFindConnType(char *name)
+    {
+    int i;
+
+    for (i = 0; i < npuConnDescCount; i++)
+        {
+        if (strcmp(name, npuConnDesc[i].name) == 0)
+            {
+            return(i);
+            }
+        }
+
+    return(-1);
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Initialise network connection handler.
 **
@@ -191,60 +324,153 @@ void npuNetInit(bool startup)
     {
     int i;
     int j;
-    int numConns;
-    u8 connType;
+    int cn;
+    u8 devices;
+    NpuConnType *ct;
     Tcb *tp;
 
     /*
-    **  Initialise network part of TCBs.
+    **  Only do the following when the emulator starts up.
     */
-    tp = npuTcbs;
-    for (i = 0; i < npuNetTcpConns; i++, tp++)
+    if (startup)
         {
-        tp->state = StTermIdle;
-        tp->connFd = 0;
+        /*
+        **  Disable SIGPIPE which some non-Win32 platform generate on disconnect.
+        */
+        #ifndef WIN32
+        signal(SIGPIPE, SIG_IGN);
+        #endif
+
+        /*
+        **  Create the mutex which serialises changes to the connection lists
+        **  and closing of connections against the network thread.
+        */
+    #if defined(_WIN32)
+        InitializeCriticalSection(&npuNetMutex);
+    #else
+        pthread_mutex_init(&npuNetMutex, NULL);
+    #endif
+
+        /*
+        **  Allocate the configured network TCBs in order of their TCP ports,
+        **  followed by the device TCBs of multi-device lines.
+        */
+        for (i = 0; i < numConnTypes; i++)
+            {
+            if (connTypes[i].numConns == 0)
+                {
+                continue;
+                }
+
+            tp = npuTipNewTcbs(connTypes[i].numConns);
+            if (tp == NULL)
+                {
+                fprintf(stderr, "npuNet: Too many NPU connections (max of %d)\n", MaxTcbs);
+                exit(1);
+                }
+
+            for (j = 0; j < connTypes[i].numConns; j++)
+                {
+                tp[j].connReg = i;
+                }
+            }
+
+        for (cn = 1; cn <= npuNetTcpConns; cn++)
+            {
+            tp = npuTcbTable[cn];
+            devices = npuConnDesc[connTypes[tp->connReg].connType].deviceTcbs;
+            if (devices > 0)
+                {
+                tp->deviceTcbs = npuTipNewTcbs(devices);
+                if (tp->deviceTcbs == NULL)
+                    {
+                    fprintf(stderr, "npuNet: Too many NPU connections (max of %d)\n", MaxTcbs);
+                    exit(1);
+                    }
+                }
+            }
         }
 
     /*
-    ** Initialise connection type specific TCB values.
+    **  Initialise network part of TCBs and put the network TCBs on the
+    **  free list of their TCP port, lowest connection number first.
     */
-    tp = npuTcbs;
+    npuNetLock();
+
+    activeHead = NULL;
+    activeTail = NULL;
     for (i = 0; i < numConnTypes; i++)
         {
-        connTypes[i].startTcb = tp;
-        numConns = connTypes[i].numConns;
-        connType = connTypes[i].connType;
+        connTypes[i].freeTcbs = NULL;
+        }
+
+    for (cn = npuTcbCount; cn > 0; cn--)
+        {
+        tp = npuTcbTable[cn];
+        tp->state = StTermIdle;
+        tp->connFd = -1;
+        tp->activeNext = NULL;
+        tp->activePrev = NULL;
 
-        for (j = 0; j < numConns; j++, tp++)
+        if (tp->connReg != NoConnReg)
             {
-            tp->connType = connType;
+            ct = connTypes + tp->connReg;
+            tp->connType = ct->connType;
+            tp->tipType = npuConnDesc[ct->connType].tipType;
+            tp->outputRate = ct->outputRate;
+            tp->freeNext = ct->freeTcbs;
+            ct->freeTcbs = tp;
             }
         }
 
-    /*
-    **  Setup for input data processing.
-    */
-    pollIndex = npuNetTcpConns;
+    npuNetUnlock();
 
     /*
-    **  Only do the following when the emulator starts up.
+    **  Create the thread which will deal with TCP connections.
     */
     if (startup)
         {
-        /*
-        **  Disable SIGPIPE which some non-Win32 platform generate on disconnect.
-        */
-        #ifndef WIN32
-        signal(SIGPIPE, SIG_IGN);
-        #endif
-                
-        /*
-        **  Create the thread which will deal with TCP connections.
-        */
         npuNetCreateThread();
         }
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Restart the network thread in a cloned emulator process
+**                  on different TCP ports.
+**
+**                  The clone only inherits the main thread, so the mutex
+**                  may have been held by the network thread of the parent
+**                  and is initialised again.
+**
+**  Parameters:     Name        Description.
+**                  portOffset  offset added to all TCP ports
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetClone(u16 portOffset)
+    {
+    int i;
+
+    if (npuTcbCount == 0)
+        {
+        return;
+        }
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&npuNetMutex);
+#else
+    pthread_mutex_init(&npuNetMutex, NULL);
+#endif
+
+    for (i = 0; i < numConnTypes; i++)
+        {
+        connTypes[i].tcpPort += portOffset;
+        }
+
+    npuNetCreateThread();
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Reset network connection handler when network is going
 **                  down.
@@ -256,31 +482,34 @@ void npuNetInit(bool startup)
 **------------------------------------------------------------------------*/
 void npuNetReset(void)
     {
-    int i;
-    Tcb *tp = npuTcbs;
+    int cn;
+    Tcb *tp;
 
     /*
     **  Iterate through all TCBs.
     */
-    for (i = 0; i < npuNetTcpConns; i++, tp++)
+    for (cn = 1; cn <= npuTcbCount; cn++)
         {
+        tp = npuTcbTable[cn];
         if (tp->state != StTermIdle)
             {
             /*
             **  Notify user that network is going down and then disconnect.
             */
-            send(tp->connFd, networkDownMsg, sizeof(networkDownMsg) - 1, 0);
-
-            #if defined(_WIN32)
-                closesocket(tp->connFd);
-            #else
-                close(tp->connFd);
-            #endif
+            if (npuConnDesc[tp->connType].notify)
+                {
+                npuNetAbortConnection(tp, networkDownMsg, sizeof(networkDownMsg) - 1);
+                }
+            else
+                {
+                npuNetCloseConnection(tp);
+                }
 
             tp->state = StTermIdle;
-            tp->connFd = 0;
             }
         }
+
+    npuNetReady = FALSE;
     }
 
 
@@ -296,7 +525,11 @@ void npuNetReset(void)
 void npuNetConnected(Tcb *tp)
     {
     tp->state = StTermHostConnected;
-    send(tp->connFd, connectedMsg, sizeof(connectedMsg) - 1, 0);
+    if (npuConnDesc[tp->connType].notify)
+        {
+        npuNetQueueOutput(tp, (u8 *)connectedMsg, sizeof(connectedMsg) - 1);
+        npuNetStartOutput(tp);
+        }
     }
 
 /*--------------------------------------------------------------------------
@@ -313,11 +546,7 @@ void npuNetDisconnected(Tcb *tp)
     /*
     **  Received disconnect - close socket.
     */
-#if defined(_WIN32)
-    closesocket(tp->connFd);
-#else
-    close(tp->connFd);
-#endif
+    npuNetCloseConnection(tp);
 
     /*
     **  Cleanup connection.
@@ -339,55 +568,7 @@ void npuNetDisconnected(Tcb *tp)
 **------------------------------------------------------------------------*/
 void npuNetSend(Tcb *tp, u8 *data, int len)
     {
-    u8 *p;
-    int count;
-
-    switch (tp->connType)
-        {
-    case ConnTypePterm:
-        /*
-        **  Telnet escape processing as required by Pterm.
-        */
-        for (p = data; len > 0; len -= 1)
-            {
-            switch (*p++)
-                {
-            case 0xFF:
-                /*
-                **  Double FF to escape the Telnet IAC code making it a real FF.
-                */
-                count = p - data;
-                npuNetQueueOutput(tp, data, count);
-                npuNetQueueOutput(tp, (u8 *)"\xFF", 1);
-                data = p;
-                break;
-                
-            case 0x0D:
-                /*
-                **  Append zero to CR otherwise real zeroes will be stripped by Telnet.
-                */
-                count = p - data;
-                npuNetQueueOutput(tp, data, count);
-                npuNetQueueOutput(tp, (u8 *)"\x00", 1);
-                data = p;
-                break;
-                }
-            }
-                
-        if ((count = p - data) > 0)
-            {
-            npuNetQueueOutput(tp, data, count);
-            }
-        break;
-
-    case ConnTypeRaw:    
-    case ConnTypeRs232:    
-        /*
-        **  Standard (non-Telnet) TCP connection.
-        */
-        npuNetQueueOutput(tp, data, len);
-        break;
-        }
+    npuConnDesc[tp->connType].netSend(tp, data, len);
     }
 
 /*--------------------------------------------------------------------------
@@ -403,32 +584,99 @@ void npuNetSend(Tcb *tp, u8 *data, int len)
 **------------------------------------------------------------------------*/
 void npuNetQueueAck(Tcb *tp, u8 blockSeqNo)
     {
-    NpuBuffer *bp;
-
     /*
-    **  Try to use the last pending buffer unless it carries a sequence number
-    **  which must be acknowledged. If there is none, get a new one and queue it.
+    **  Acknowledge straight away if everything has already been sent.
     */
-    bp = npuBipQueueGetLast(&tp->outputQ);
-    if (bp == NULL || bp->blockSeqNo != 0)
+    if (tp->outputIn == tp->outputOut)
+        {
+        npuStatsAck(tp, blockSeqNo);
+        npuTipNotifySent(tp, blockSeqNo);
+        return;
+        }
+
+    if ((u8)(tp->ackIn - tp->ackOut) >= MaxAckMarks - 1)
+        {
+        /*
+        **  The marks cover any DBL the host can configure, so this is a
+        **  host which ignores its downline window - don't hold it up.
+        */
+        npuLogMessage("npuNet: host exceeded downline window on port %d", tp->portNumber);
+        npuTipNotifySent(tp, blockSeqNo);
+        }
+    else
         {
-        bp = npuBipBufGet();
-        npuBipQueueAppend(bp, &tp->outputQ);
+        tp->ackPos[tp->ackIn % MaxAckMarks] = tp->outputIn;
+        tp->ackBsn[tp->ackIn % MaxAckMarks] = blockSeqNo;
+        tp->ackIn += 1;
         }
 
-    if (bp != NULL)
+    npuNetStartOutput(tp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release the output of a connection to the network
+**                  thread straight away instead of waiting for the next
+**                  coupler status poll of the host.
+**
+**                  The round robin deficit and the token bucket of the
+**                  connection still decide how much may be released now;
+**                  the rest is left to the output scheduler.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetStartOutput(Tcb *tp)
+    {
+    if (outputActive)
         {
-        bp->blockSeqNo = blockSeqNo;
+        return;
         }
 
+    outputActive = TRUE;
+    npuNetServeOutput(tp, OutputBudget);
+    outputActive = FALSE;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Discard pending network output and acknowledge the
+**                  blocks it belonged to.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetDiscardOutput(Tcb *tp)
+    {
     /*
-    **  Try to output the data on the network connection.
+    **  The network thread sends with the lock held.
     */
-    npuNetTryOutput(tp);
+    npuNetLock();
+    tp->outputLimit = tp->outputIn;
+    tp->outputOut = tp->outputIn;
+    npuNetUnlock();
+
+    npuNetAckSent(tp);
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Check for network status.
+**  Purpose:        Process network events staged by the network thread.
+**
+**                  The network thread receives input into the connection
+**                  receive rings and raises npuNetReady when there is work
+**                  for the emulation thread. Callers test that flag before
+**                  calling here, so idle polls don't cost any system calls.
+**                  Every active connection is visited once per call and
+**                  the ASYNC TIP consumes at most one upline block from
+**                  each ring, so bulk input can't starve other connections.
+**                  Output queued by the TIPs is released to the network
+**                  thread by the output scheduler at the end of the call
+**                  and blocks are acknowledged once the network thread
+**                  has sent them, so this path makes no system calls.
 **
 **  Parameters:     Name        Description.
 **
@@ -437,95 +685,179 @@ void npuNetQueueAck(Tcb *tp, u8 blockSeqNo)
 **------------------------------------------------------------------------*/
 void npuNetCheckStatus(void)
     {
-    static fd_set readFds;
-    static fd_set writeFds;
-    struct timeval timeout;
-    int readySockets = 0;
+    bool pending = FALSE;
     Tcb *tp;
+    Tcb *next;
+
+    /*
+    **  Clear the ready flag before scanning so that events staged during
+    **  the scan raise it again.
+    */
+    npuNetReady = FALSE;
+
+    if (npuStatsDue)
+        {
+        npuStatsDue = FALSE;
+        npuStatsWrite();
+        }
 
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
+    /*
+    **  Start with a different connection on each call so that early
+    **  connections don't get preferential treatment.
+    */
+    npuNetRotateActive();
 
-    while (pollIndex < npuNetTcpConns)
+    for (tp = activeHead; tp != NULL; tp = next)
         {
-        tp = npuTcbs + pollIndex++;
+        next = tp->activeNext;
 
         if (tp->state == StTermIdle)
             {
+            /*
+            **  Connection has been cleaned up - make the TCB available again.
+            */
+            npuNetReleaseTcb(tp);
             continue;
             }
 
         /*
-        **  Handle transparent input timeout.
+        **  Handle new connection accepted by the network thread.
         */
-        if (tp->xInputTimerRunning && (cycles - tp->xStartCycle) >= Ms200)
+        if (tp->netConnect)
             {
-            npuAsyncFlushUplineTransparent(tp);
+            tp->netConnect = FALSE;
+            if (!npuSvmConnectTerminal(tp))
+                {
+                /*
+                **  No buffers, notify user and disconnect.
+                */
+                if (npuConnDesc[tp->connType].notify)
+                    {
+                    npuNetAbortConnection(tp, abortMsg, sizeof(abortMsg) - 1);
+                    }
+                else
+                    {
+                    npuNetCloseConnection(tp);
+                    }
+
+                tp->state = StTermIdle;
+                continue;
+                }
             }
 
         /*
-        **  Handle network traffic.
+        **  Handle disconnect detected by the network thread.
         */
-        FD_ZERO(&readFds);
-        FD_ZERO(&writeFds);
-        FD_SET(tp->connFd, &readFds);
-        FD_SET(tp->connFd, &writeFds);
-        readySockets = select(tp->connFd + 1, &readFds, &writeFds, NULL, &timeout);
-        if (readySockets <= 0)
+        if (tp->netEof)
             {
-            continue;
-            }
+            tp->netEof = FALSE;
+            npuNetCloseConnection(tp);
+            npuLogMessage("npuNet: Connection dropped on port %d\n", tp->portNumber);
 
-        if (npuBipQueueNotEmpty(&tp->outputQ) && FD_ISSET(tp->connFd, &writeFds))
-            {
             /*
-            **  Send data if any is pending.
+            **  Notify SVM.
             */
-            npuNetTryOutput(tp);
+            npuSvmDiscRequestTerminal(tp);
+            continue;
             }
 
-        if (FD_ISSET(tp->connFd, &readFds))
+        /*
+        **  Handle transparent input timeout.
+        */
+        if (tp->xInputTimerRunning)
             {
-            /*
-            **  Receive a block of data.
-            */
-            tp->inputCount = recv(tp->connFd, tp->inputData, sizeof(tp->inputData), 0);
-            if (tp->inputCount <= 0)
+            if ((cycles - tp->xStartCycle) >= Ms200)
                 {
-                /*
-                **  Received disconnect - close socket.
-                */
-            #if defined(_WIN32)
-                closesocket(tp->connFd);
-            #else
-                close(tp->connFd);
-            #endif
+                npuAsyncFlushUplineTransparent(tp);
+                }
+            else
+                {
+                pending = TRUE;
+                }
+            }
 
-                npuLogMessage("npuNet: Connection dropped on port %d\n", tp->portNumber);
+        /*
+        **  Acknowledge blocks which the network thread has sent.
+        */
+        if (tp->ackIn != tp->ackOut)
+            {
+            npuNetAckSent(tp);
+            }
 
+        if (tp->inputIn != tp->inputOut)
+            {
+            if (tp->state == StTermHostConnected)
+                {
                 /*
-                **  Notify SVM.
+                **  Hand up to the TIP serving this connection type.
                 */
-                npuSvmDiscRequestTerminal(tp);
+                npuConnDesc[tp->connType].processUpline(tp);
+                if (tp->inputIn != tp->inputOut)
+                    {
+                    pending = TRUE;
+                    }
                 }
-            else if (tp->state == StTermHostConnected)
+            else
                 {
                 /*
-                **  Hand up to the ASYNC TIP.
+                **  Discard input while not connected to the host.
                 */
-                npuAsyncProcessUplineData(tp);
+                tp->inputOut = tp->inputIn;
                 }
-
-            /*
-            **  The following return ensures that we resume with polling the next
-            **  connection in sequence otherwise low-numbered connections would get
-            **  preferential treatment.
-            */
-            return;
             }
         }
 
-    pollIndex = 0;
+    /*
+    **  Release pending output to the network thread.
+    */
+    if (npuNetScheduleOutput())
+        {
+        pending = TRUE;
+        }
+
+    /*
+    **  Come back on the next poll if work is left over.
+    */
+    if (pending)
+        {
+        npuNetReady = TRUE;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Lock the connection table against the network thread.
+**
+**                  Also taken while the TCB table grows or is reset.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetLock(void)
+    {
+#if defined(_WIN32)
+    EnterCriticalSection(&npuNetMutex);
+#else
+    pthread_mutex_lock(&npuNetMutex);
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unlock the connection table.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuNetUnlock(void)
+    {
+#if defined(_WIN32)
+    LeaveCriticalSection(&npuNetMutex);
+#else
+    pthread_mutex_unlock(&npuNetMutex);
+#endif
     }
 
 /*
@@ -603,9 +935,16 @@ static void *npuNetThread(void *param)
     int rc;
     static fd_set selectFds;
     static fd_set acceptFds;
+    static fd_set writeFds;
     int listenFd[MaxConnTypes];
     int acceptFd;
     int maxFd = 0;
+    int maxConnFd;
+    struct timeval timeout;
+    Tcb *tp;
+    bool ready;
+    time_t statsTime;
+    time_t now;
     struct sockaddr_in server;
     struct sockaddr_in from;
     int i;
@@ -617,6 +956,8 @@ static void *npuNetThread(void *param)
     socklen_t fromLen;
 #endif
 
+    threadSetup("npu");
+
     FD_ZERO(&selectFds);
     /*
     **  Create a listening socket for every configured connection type.
@@ -693,22 +1034,121 @@ static void *npuNetThread(void *param)
         FD_SET(listenFd[i], &selectFds);
         }
 
+    statsTime = time(NULL);
+
     for (;;)
         {
         /*
-        **  Wait for a connection on all sockets for the configured connection types.
+        **  Ask the emulation thread for a statistics snapshot when one is due.
+        */
+        now = time(NULL);
+        if (npuStatsFile[0] != '\0' && now - statsTime >= npuStatsInterval)
+            {
+            statsTime = now;
+            npuStatsDue = TRUE;
+            npuNetReady = TRUE;
+            }
+
+        /*
+        **  Send final messages and close connections which are due.
+        */
+        if (closeCount > 0)
+            {
+            npuNetServeClose();
+            }
+
+        /*
+        **  Wait for a connection on all sockets for the configured connection types,
+        **  for input on all connections with room in their receive ring and for
+        **  connections with blocked output to become writable.
         */
         memcpy(&acceptFds, &selectFds, sizeof(selectFds));
-        rc = select(maxFd + 1, &acceptFds, NULL, NULL, NULL);
+        FD_ZERO(&writeFds);
+        maxConnFd = maxFd;
+
+        npuNetLock();
+        for (tp = activeHead; tp != NULL; tp = tp->activeNext)
+            {
+            if (tp->state == StTermIdle || tp->connFd < 0 || tp->netEof)
+                {
+                continue;
+                }
+
+            if ((int)(tp->inputIn - tp->inputOut) < npuNetInputLimit(tp))
+                {
+                FD_SET(tp->connFd, &acceptFds);
+                }
+
+            if (tp->outputBlocked && !tp->xoff)
+                {
+                FD_SET(tp->connFd, &writeFds);
+                }
+
+            if (maxConnFd < tp->connFd)
+                {
+                maxConnFd = tp->connFd;
+                }
+            }
+        npuNetUnlock();
+
+        /*
+        **  Use a short timeout so that changes to the set of connections,
+        **  draining of full receive rings and output released by the emulation
+        **  thread are picked up promptly.
+        */
+        timeout.tv_sec = 0;
+        timeout.tv_usec = NetPollMs * 1000;
+        rc = select(maxConnFd + 1, &acceptFds, &writeFds, NULL, &timeout);
         if (rc <= 0)
             {
-            fprintf(stderr, "npuNetThread: select returned unexpected %d\n", rc);
-        #if defined(_WIN32)
-            Sleep(1000);
-        #else
-            sleep(1);
-        #endif
-            continue;
+            /*
+            **  Timeout, or a connection was closed while we were waiting. There
+            **  may still be output to send.
+            */
+            FD_ZERO(&acceptFds);
+            FD_ZERO(&writeFds);
+            }
+
+        /*
+        **  Stage input for the emulation thread and send the output it has
+        **  released. Connections closed since the select are skipped because
+        **  their FD is gone.
+        */
+        ready = FALSE;
+        npuNetLock();
+        for (tp = activeHead; tp != NULL; tp = tp->activeNext)
+            {
+            if (tp->state == StTermIdle || tp->connFd < 0 || tp->netEof)
+                {
+                continue;
+                }
+
+            if (FD_ISSET(tp->connFd, &acceptFds))
+                {
+                if (!npuNetReceive(tp))
+                    {
+                    tp->netEof = TRUE;
+                    }
+
+                ready = TRUE;
+                }
+
+            if (FD_ISSET(tp->connFd, &writeFds))
+                {
+                tp->outputBlocked = FALSE;
+                ready = TRUE;
+                }
+
+            if (tp->outputLimit != tp->outputOut && npuNetTryOutput(tp) > 0)
+                {
+                ready = TRUE;
+                }
+            }
+        npuNetUnlock();
+
+        if (ready)
+            {
+            npuNetReady = TRUE;
             }
 
         /*
@@ -747,7 +1187,6 @@ static void *npuNetThread(void *param)
 **------------------------------------------------------------------------*/
 static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct)
     {
-    u8 i;
     Tcb *tp;
     int optEnable = 1;
 #if defined(_WIN32)
@@ -775,58 +1214,53 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct)
     if (!npuSvmIsReady())
         {
         /*
-        **  Tell the user.
+        **  Tell the user and disconnect a bit later, without holding up
+        **  the other connections meanwhile.
         */
-        send(acceptFd, notReadyMsg, sizeof(notReadyMsg) - 1, 0);
-                                
-        /*
-        **  Wait a bit and then disconnect.
-        */
-    #if defined(_WIN32)
-        Sleep(2000);
-        closesocket(acceptFd);
-    #else
-        sleep(2);
-        close(acceptFd);
-    #endif
-                                
+        if (npuConnDesc[ct->connType].notify)
+            {
+            npuNetDeferClose(acceptFd, notReadyMsg, sizeof(notReadyMsg) - 1, RejectDelay);
+            }
+        else
+            {
+            npuNetDeferClose(acceptFd, NULL, 0, RejectDelay);
+            }
+
         return;
         }
 
     /*
-    **  Find a free TCB in the set of ports associated with this connection type.
+    **  Take a free TCB of this TCP port, or add one if the port may grow.
     */
-    tp = ct->startTcb;
-    for (i = 0; i < ct->numConns; i++)
+    npuNetLock();
+    tp = ct->freeTcbs;
+    if (tp != NULL)
         {
-        if (tp->state == StTermIdle)
-            {
-            break;
-            }
+        ct->freeTcbs = tp->freeNext;
+        }
+    npuNetUnlock();
 
-        tp += 1;
+    if (tp == NULL)
+        {
+        tp = npuNetNewTcb(ct);
         }
 
     /*
     **  Did we find a free TCB?
     */
-    if (i == ct->numConns)
+    if (tp == NULL)
         {
         /*
-        **  No free port found - tell the user.
-        */
-        send(acceptFd, noPortsAvailMsg, sizeof(noPortsAvailMsg) - 1, 0);
-
-        /*
-        **  Wait a bit and then disconnect.
+        **  No free port found - tell the user and disconnect a bit later.
         */
-    #if defined(_WIN32)
-        Sleep(2000);
-        closesocket(acceptFd);
-    #else
-        sleep(2);
-        close(acceptFd);
-    #endif
+        if (npuConnDesc[ct->connType].notify)
+            {
+            npuNetDeferClose(acceptFd, noPortsAvailMsg, sizeof(noPortsAvailMsg) - 1, RejectDelay);
+            }
+        else
+            {
+            npuNetDeferClose(acceptFd, NULL, 0, RejectDelay);
+            }
 
         return;
         }
@@ -834,42 +1268,124 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct)
     /*
     **  Mark connection as active.
     */
+    tp->inputIn = 0;
+    tp->inputOut = 0;
+    tp->outputIn = 0;
+    tp->outputLimit = 0;
+    tp->outputOut = 0;
+    tp->ackIn = 0;
+    tp->ackOut = 0;
+    tp->outputBlocked = FALSE;
+    tp->outputTime = rtcClock;
+    tp->outputCredit = 0;
+    tp->outputDeficit = 0;
+    tp->netEof = FALSE;
     tp->connFd = acceptFd;
     tp->state = StTermNetConnected;
     npuLogMessage("npuNet: Received connection on port %u\n", tp->portNumber);
 
     /*
-    **  Notify user of connect attempt.
+    **  Append to the active list.
     */
-    send(tp->connFd, connectingMsg, sizeof(connectingMsg) - 1, 0);
+    npuNetLock();
+    tp->activeNext = NULL;
+    tp->activePrev = activeTail;
+    if (activeTail != NULL)
+        {
+        activeTail->activeNext = tp;
+        }
+    else
+        {
+        activeHead = tp;
+        }
+
+    activeTail = tp;
+    npuNetUnlock();
 
     /*
-    **  Attempt connection to host.
+    **  Notify user of connect attempt.
     */
-    if (!npuSvmConnectTerminal(tp))
+    if (npuConnDesc[tp->connType].notify)
         {
-        /*
-        **  No buffers, notify user.
-        */
-        send(tp->connFd, abortMsg, sizeof(abortMsg) - 1, 0);
+        send(tp->connFd, connectingMsg, sizeof(connectingMsg) - 1, 0);
+        }
 
-        /*
-        **  Wait a bit and then disconnect.
-        */
-    #if defined(_WIN32)
-        Sleep(1000);
-        closesocket(tp->connFd);
-    #else
-        sleep(1);
-        close(tp->connFd);
-    #endif
+    /*
+    **  Let the emulation thread attempt the connection to the host once
+    **  the TCB set up above is visible to it.
+    */
+    NpuRingBarrier();
+    tp->netConnect = TRUE;
+    npuNetReady = TRUE;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send data to a Telnet connection with the escape
+**                  processing required by Pterm.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  data        data address
+**                  len         data length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetSendTelnet(Tcb *tp, u8 *data, int len)
+    {
+    u8 *p;
+    int count;
+
+    for (p = data; len > 0; len -= 1)
+        {
+        switch (*p++)
+            {
+        case 0xFF:
+            /*
+            **  Double FF to escape the Telnet IAC code making it a real FF.
+            */
+            count = p - data;
+            npuNetQueueOutput(tp, data, count);
+            npuNetQueueOutput(tp, (u8 *)"\xFF", 1);
+            data = p;
+            break;
             
-        tp->state = StTermIdle;
+        case 0x0D:
+            /*
+            **  Append zero to CR otherwise real zeroes will be stripped by Telnet.
+            */
+            count = p - data;
+            npuNetQueueOutput(tp, data, count);
+            npuNetQueueOutput(tp, (u8 *)"\x00", 1);
+            data = p;
+            break;
+            }
+        }
+            
+    if ((count = p - data) > 0)
+        {
+        npuNetQueueOutput(tp, data, count);
         }
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Queue output to terminal and do basic Telnet formatting.
+**  Purpose:        Send data to a standard (non-Telnet) TCP connection.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  data        data address
+**                  len         data length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetSendRaw(Tcb *tp, u8 *data, int len)
+    {
+    npuNetQueueOutput(tp, data, len);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Append output for terminal to the send ring.
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
@@ -881,134 +1397,810 @@ static void npuNetProcessNewConnection(int acceptFd, NpuConnType *ct)
 **------------------------------------------------------------------------*/
 static void npuNetQueueOutput(Tcb *tp, u8 *data, int len)
     {
-    NpuBuffer *bp;
-    u8 *startAddress;
-    int byteCount;
+    u32 pos;
+    int room;
+    int count;
 
-    /*
-    **  Try to use the last pending buffer unless it carries a sequence number
-    **  which must be acknowledged. If there is none, get a new one and queue it.
-    */
-    bp = npuBipQueueGetLast(&tp->outputQ);
-    if (bp == NULL || bp->blockSeqNo != 0)
+    if (len <= 0)
         {
-        bp = npuBipBufGet();
-        npuBipQueueAppend(bp, &tp->outputQ);
+        return;
         }
 
-    while (bp != NULL && len > 0)
+    room = tp->outputSize - (tp->outputIn - tp->outputOut);
+    if (len > room && !npuNetGrowOutput(tp, len))
         {
-        /*
-        **  Append data to the buffer.
-        */
-        startAddress = bp->data + bp->offset + bp->numBytes;
-        byteCount = MaxBuffer - bp->offset - bp->numBytes;
-        if (byteCount >= len)
+        npuLogMessage("npuNet: no memory for send ring on port %d - %d bytes dropped", tp->portNumber, len - room);
+        len = room;
+        if (len == 0)
             {
-            byteCount = len;
+            return;
             }
+        }
+
+    /*
+    **  Copy data into the ring, which may take two pieces if it wraps.
+    */
+    pos = tp->outputIn & (tp->outputSize - 1);
+    count = tp->outputSize - pos;
+    if (count > len)
+        {
+        count = len;
+        }
 
-        memcpy(startAddress, data, byteCount);
-        bp->numBytes += byteCount;
+    memcpy(tp->outputRing + pos, data, count);
+    memcpy(tp->outputRing, data + count, len - count);
+    tp->outputIn += len;
 
-        /*
-        **  If there is still data left get a new buffer, queue it and
-        **  copy what is left.
-        */
-        len -= byteCount;
-        if (len > 0)
+    npuStatsOutput(tp);
+
+    /*
+    **  Output which is not started straight away is sent by the output
+    **  scheduler on the next poll.
+    */
+    npuNetReady = TRUE;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Make room in the send ring by allocating a larger one.
+**
+**                  The ring only holds output of downline blocks which
+**                  have not been acknowledged, so its size is bounded by
+**                  the host's downline window (DBL blocks of DBSize
+**                  characters after formatting).
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  len         number of bytes to be queued
+**
+**  Returns:        TRUE if there is room, FALSE if out of memory.
+**
+**------------------------------------------------------------------------*/
+static bool npuNetGrowOutput(Tcb *tp, int len)
+    {
+    u32 used;
+    u32 size = tp->outputSize != 0 ? tp->outputSize : MaxOutputRing;
+    u8 *ring;
+    u8 *old;
+    u32 i;
+
+    /*
+    **  The network thread sends from the ring with the lock held, so
+    **  the pending output can't change while it is moved.
+    */
+    npuNetLock();
+    used = tp->outputIn - tp->outputOut;
+
+    while (size - used < (u32)len)
+        {
+        if (size >= 0x40000000)
             {
-            bp = npuBipBufGet();
-            npuBipQueueAppend(bp, &tp->outputQ);
+            npuNetUnlock();
+            return(FALSE);
             }
+
+        size *= 2;
+        }
+
+    ring = malloc(size);
+    if (ring == NULL)
+        {
+        npuNetUnlock();
+        return(FALSE);
+        }
+
+    /*
+    **  Move pending output, keeping its position so that the
+    **  acknowledgment marks remain valid.
+    */
+    for (i = tp->outputOut; i != tp->outputIn; i++)
+        {
+        ring[i & (size - 1)] = tp->outputRing[i & (tp->outputSize - 1)];
         }
+
+    old = tp->outputRing;
+    tp->outputRing = ring;
+    tp->outputSize = size;
+
+    npuNetUnlock();
+
+    if (old != NULL)
+        {
+        npuLogMessage("npuNet: send ring on port %d grown to %u bytes", tp->portNumber, size);
+        free(old);
+        }
+
+    return(TRUE);
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Try to send any queued data.
+**  Purpose:        Send the output released by the output scheduler.
+**
+**                  Called by the network thread with the lock held. The
+**                  emulation thread acknowledges the blocks whose data
+**                  has been sent on its next poll.
 **
 **  Parameters:     Name        Description.
 **                  tp          TCB pointer
 **
-**  Returns:        Nothing.
+**  Returns:        Number of bytes sent.
 **
 **------------------------------------------------------------------------*/
-static void npuNetTryOutput(Tcb *tp)
+static int npuNetTryOutput(Tcb *tp)
     {
-    NpuBuffer *bp;
-    u8 *data;
+    u32 pos;
+    int len;
+    int count;
     int result;
+    int sent = 0;
+#if !defined(_WIN32)
+    struct iovec iov[2];
+#endif
 
     /*
-    **  Return if we are flow controlled.
+    **  Return if we are flow controlled or the socket can't take more.
     */
-    if (tp->xoff)
+    if (tp->xoff || tp->outputBlocked)
         {
-        return;
+        return(0);
         }
 
     /*
-    **  Process all queued output buffers.
+    **  Don't read the ring before the data released up to the limit.
     */
-    while ((bp = npuBipQueueExtract(&tp->outputQ)) != NULL)
+    NpuRingBarrier();
+
+    while ((len = tp->outputLimit - tp->outputOut) > 0)
         {
-        data = bp->data + bp->offset;
+        pos = tp->outputOut & (tp->outputSize - 1);
+        count = tp->outputSize - pos;
+        if (count > len)
+            {
+            count = len;
+            }
 
         /*
-        **  Don't call into TCP if there is no data to send.
+        **  Hand the ring to the socket in one call, in two pieces if
+        **  the data wraps.
         */
-        if (bp->numBytes > 0)
-            {
-            result = send(tp->connFd, data, bp->numBytes, 0);
-            }
-        else
-            {
-            result = 0;
-            }
+    #if defined(_WIN32)
+        len = count;
+        result = send(tp->connFd, tp->outputRing + pos, count, 0);
+    #else
+        iov[0].iov_base = tp->outputRing + pos;
+        iov[0].iov_len = count;
+        iov[1].iov_base = tp->outputRing;
+        iov[1].iov_len = len - count;
+        result = writev(tp->connFd, iov, len > count ? 2 : 1);
+    #endif
 
-        if (result >= bp->numBytes)
+        if (result <= 0)
             {
             /*
-            **  The socket took all our data - let TIP know what block sequence 
-            **  number we processed, free the buffer and then continue.
+            **  Likely this is a "would block" type of error. Wait until the
+            **  socket is writable again. Any disconnects or other errors will
+            **  be handled by the receive handler.
             */
-            if (bp->blockSeqNo != 0)
-                {
-                npuTipNotifySent(tp, bp->blockSeqNo);
-                }
-
-            npuBipBufRelease(bp);
-            continue;
+            tp->outputBlocked = TRUE;
+            break;
             }
 
-        /*
-        **  Not all has been sent. Put the buffer back into the queue.
-        */
-        npuBipQueuePrepend(bp, &tp->outputQ);
+        tp->outputOut += result;
+        sent += result;
 
-        /*
-        **  Was there an error?
-        */
-        if (result < 0)
+        if (result < len)
             {
             /*
-            **  Likely this is a "would block" type of error - no need to do
-            **  anything here. The select() call will later tell us when we
-            **  can send again. Any disconnects or other errors will be handled
-            **  by the receive handler.
+            **  The socket did not take all data - wait until it can. The
+            **  acknowledgments of the remaining blocks are held back until
+            **  then, which stops the host from sending more.
             */
-            return;
+            tp->outputBlocked = TRUE;
+            break;
+            }
+        }
+
+    return(sent);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send pending output of all connections.
+**
+**                  Connections are served by deficit round robin: each
+**                  round a connection earns its quantum and may release
+**                  that much to the network thread, so a bulk listing
+**                  can't hog the output budget of a poll while other
+**                  users wait. Connections with a configured rate are
+**                  further limited by their token bucket. When all of a
+**                  connection's ring has been released its TIP may supply
+**                  more output.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if output is left which can be released on a
+**                  later poll, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool npuNetScheduleOutput(void)
+    {
+    int budget = OutputBudget;
+    bool progress;
+    int sent;
+    Tcb *tp;
+
+    outputActive = TRUE;
+
+    do
+        {
+        progress = FALSE;
+
+        for (tp = activeHead; tp != NULL && budget > 0; tp = tp->activeNext)
+            {
+            sent = npuNetServeOutput(tp, budget);
+            if (sent > 0)
+                {
+                progress = TRUE;
+                budget -= sent;
+                }
+            }
+        } while (progress && budget > 0);
+
+    outputActive = FALSE;
+
+    /*
+    **  Check for output which is neither blocked by the socket nor by
+    **  flow control and so can be sent on the next poll.
+    */
+    for (tp = activeHead; tp != NULL; tp = tp->activeNext)
+        {
+        if (   tp->state != StTermIdle && tp->connFd >= 0 && !tp->xoff && !tp->outputBlocked
+            && tp->outputIn != tp->outputLimit)
+            {
+            return(TRUE);
+            }
+        }
+
+    return(FALSE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Give a connection one round of the output scheduler.
+**
+**                  The connection earns its quantum and may release that
+**                  much to the network thread, limited by its token
+**                  bucket if it has a rate. When all of its ring has been
+**                  released its TIP may supply more output.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  budget      maximum number of bytes to release
+**
+**  Returns:        Number of bytes released.
+**
+**------------------------------------------------------------------------*/
+static int npuNetServeOutput(Tcb *tp, int budget)
+    {
+    int limit;
+    int tokens;
+    int released;
+
+    if (tp->state == StTermIdle || tp->connFd < 0 || tp->xoff || tp->outputBlocked)
+        {
+        return(0);
+        }
+
+    if (tp->outputIn == tp->outputLimit)
+        {
+        tp->outputDeficit = 0;
+        if (npuConnDesc[tp->connType].processOutput != NULL)
+            {
+            npuConnDesc[tp->connType].processOutput(tp);
+            }
+
+        if (tp->outputIn == tp->outputLimit)
+            {
+            return(0);
+            }
+        }
+
+    /*
+    **  Earn this round's quantum, but don't let an idle or shaped
+    **  connection save up more than one downline window.
+    */
+    tp->outputDeficit += npuNetOutputQuantum(tp);
+    limit = npuNetOutputQuantum(tp) * (tp->params.fvDBL > 0 ? tp->params.fvDBL : 1);
+    if (tp->outputDeficit > limit)
+        {
+        tp->outputDeficit = limit;
+        }
+
+    limit = tp->outputDeficit;
+    if (limit > budget)
+        {
+        limit = budget;
+        }
+
+    if (tp->outputRate != 0)
+        {
+        tokens = npuNetOutputTokens(tp);
+        if (limit > tokens)
+            {
+            limit = tokens;
+            }
+        }
+
+    released = tp->outputIn - tp->outputLimit;
+    if (released > limit)
+        {
+        released = limit;
+        }
+
+    if (released <= 0)
+        {
+        return(0);
+        }
+
+    /*
+    **  Publish the ring data before the new limit.
+    */
+    NpuRingBarrier();
+    tp->outputLimit += released;
+
+    tp->outputDeficit -= released;
+    if (tp->outputRate != 0)
+        {
+        tp->outputCredit -= (u64)released * 1000000;
+        }
+
+    return(released);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the round robin quantum of a connection.
+**
+**                  This is the downline block size the TIP negotiated
+**                  with the host, so each round a connection can send
+**                  one downline block.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Quantum in bytes.
+**
+**------------------------------------------------------------------------*/
+static int npuNetOutputQuantum(Tcb *tp)
+    {
+    return(tp->params.fvDBSize > 0 ? tp->params.fvDBSize : OutputQuantum);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Refill the token bucket of a shaped connection.
+**
+**                  The bucket fills at the configured rate in emulated
+**                  time and holds at most one downline window, so the
+**                  host can always have a full window in flight.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Number of bytes which may be sent now.
+**
+**------------------------------------------------------------------------*/
+static int npuNetOutputTokens(Tcb *tp)
+    {
+    u64 depth;
+    u32 now = rtcClock;
+
+    depth = (u64)npuNetOutputQuantum(tp) * (tp->params.fvDBL > 0 ? tp->params.fvDBL : 1) * 1000000;
+
+    tp->outputCredit += (u64)(now - tp->outputTime) * tp->outputRate;
+    tp->outputTime = now;
+    if (tp->outputCredit > depth)
+        {
+        tp->outputCredit = depth;
+        }
+
+    return((int)(tp->outputCredit / 1000000));
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Acknowledge downline blocks whose data has been sent.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetAckSent(Tcb *tp)
+    {
+    int i;
+
+    while (tp->ackIn != tp->ackOut)
+        {
+        i = tp->ackOut % MaxAckMarks;
+        if ((i32)(tp->outputOut - tp->ackPos[i]) < 0)
+            {
+            break;
+            }
+
+        tp->ackOut += 1;
+        npuStatsAck(tp, tp->ackBsn[i]);
+        npuTipNotifySent(tp, tp->ackBsn[i]);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine how much input may be staged in the receive
+**                  ring of a connection.
+**
+**                  The ring is filled up to the number of upline blocks
+**                  the TIP may have outstanding (UBL) times the upline
+**                  block size. When it is full, no more data is read and
+**                  TCP flow control throttles the sender.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Ring limit in bytes.
+**
+**------------------------------------------------------------------------*/
+static int npuNetInputLimit(Tcb *tp)
+    {
+    int limit;
+
+    limit = npuConnDesc[tp->connType].uplineBlockSize(tp) * (tp->params.fvUBL > 0 ? tp->params.fvUBL : 1);
+    if (limit < MaxBuffer)
+        {
+        limit = MaxBuffer;
+        }
+
+    if (limit > MaxUplineRing)
+        {
+        limit = MaxUplineRing;
+        }
+
+    return(limit);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Receive pending input into the connection's receive
+**                  ring.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        FALSE if the connection was dropped, TRUE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool npuNetReceive(Tcb *tp)
+    {
+    int space;
+    int contiguous;
+    int offset;
+    int result;
+    bool first = TRUE;
+
+    space = npuNetInputLimit(tp) - (int)(tp->inputIn - tp->inputOut);
+    if (space <= 0)
+        {
+        /*
+        **  Ring is full - leave the data in the socket for now.
+        */
+        return(TRUE);
+        }
+
+    NpuRingBarrier();
+
+    /*
+    **  Receive into the contiguous free part of the ring. If that part ends
+    **  at the end of the ring, a second receive fills the wrapped part.
+    */
+    do
+        {
+        offset = tp->inputIn & (MaxUplineRing - 1);
+        contiguous = MaxUplineRing - offset;
+        if (contiguous > space)
+            {
+            contiguous = space;
             }
 
+        result = recv(tp->connFd, tp->inputRing + offset, contiguous, 0);
+        if (result <= 0)
+            {
+            /*
+            **  Nothing on the first receive after select() reported the
+            **  socket readable means the connection was dropped. On later
+            **  receives the socket has merely run dry.
+            */
+            return(!first);
+            }
+
+        first = FALSE;
+        NpuRingBarrier();
+        tp->inputIn += result;
+        space -= result;
+        } while (space > 0 && result == contiguous);
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close the network connection of a terminal.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetCloseConnection(Tcb *tp)
+    {
+    /*
+    **  Serialise against the network thread which may otherwise still
+    **  receive from the FD after it has been closed and possibly reused.
+    */
+    npuNetLock();
+
+    if (tp->connFd >= 0)
+        {
+    #if defined(_WIN32)
+        closesocket(tp->connFd);
+    #else
+        close(tp->connFd);
+    #endif
+        }
+
+    tp->connFd = -1;
+    tp->netConnect = FALSE;
+    tp->netEof = FALSE;
+
+    npuNetUnlock();
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close the network connection of a terminal after a
+**                  final message.
+**
+**                  The connection is handed to the network thread which
+**                  sends the message and closes it, so the emulation
+**                  thread makes no system calls.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  msg         final message
+**                  len         message length
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetAbortConnection(Tcb *tp, char *msg, int len)
+    {
+    int fd;
+
+    npuNetLock();
+
+    fd = tp->connFd;
+    tp->connFd = -1;
+    tp->netConnect = FALSE;
+    tp->netEof = FALSE;
+
+    npuNetUnlock();
+
+    if (fd >= 0)
+        {
+        npuNetDeferClose(fd, msg, len, 0);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Have the network thread send a final message to a
+**                  connection and close it a while later.
+**
+**  Parameters:     Name        Description.
+**                  fd          connection's FD
+**                  msg         final message or NULL
+**                  len         message length
+**                  delay       seconds to keep the connection open
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetDeferClose(int fd, char *msg, int len, int delay)
+    {
+    NpuNetClose *cp;
+
+    npuNetLock();
+
+    if (closeCount >= MaxDeferredClose)
+        {
         /*
-        **  The socket did not take all data - update offset and count.
+        **  Too many at once - close straight away.
         */
-        if (result > 0)
+        npuNetUnlock();
+    #if defined(_WIN32)
+        closesocket(fd);
+    #else
+        close(fd);
+    #endif
+        return;
+        }
+
+    cp = closeList + closeCount++;
+    cp->fd = fd;
+    cp->msg = msg;
+    cp->len = len;
+    cp->due = time(NULL) + delay;
+
+    npuNetUnlock();
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Send pending final messages and close the connections
+**                  which are due.
+**
+**                  Called by the network thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetServeClose(void)
+    {
+    NpuNetClose *cp;
+    time_t now = time(NULL);
+    int i;
+
+    npuNetLock();
+
+    for (i = 0; i < closeCount; )
+        {
+        cp = closeList + i;
+        if (cp->msg != NULL)
             {
-            bp->offset   += result;
-            bp->numBytes -= result;
+            send(cp->fd, cp->msg, cp->len, 0);
+            cp->msg = NULL;
             }
+
+        if (now < cp->due)
+            {
+            i += 1;
+            continue;
+            }
+
+    #if defined(_WIN32)
+        closesocket(cp->fd);
+    #else
+        close(cp->fd);
+    #endif
+
+        *cp = closeList[--closeCount];
         }
+
+    npuNetUnlock();
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a TCB to a TCP port which has run out of free ones.
+**
+**                  Called by the network thread. The TCB gets the next free
+**                  connection number, so the host's configuration must
+**                  define that port for the connection to succeed. The
+**                  lock keeps the TCB table from being reset meanwhile.
+**
+**  Parameters:     Name        Description.
+**                  ct          registered TCP port
+**
+**  Returns:        Pointer to new TCB or NULL if the port may not grow.
+**
+**------------------------------------------------------------------------*/
+static Tcb *npuNetNewTcb(NpuConnType *ct)
+    {
+    u8 devices = npuConnDesc[ct->connType].deviceTcbs;
+    Tcb *tp;
+
+    npuNetLock();
+
+    if (ct->numConns >= ct->maxConns || npuTcbCount + 1 + devices > MaxTcbs)
+        {
+        npuNetUnlock();
+        return(NULL);
+        }
+
+    tp = npuTipNewTcbs(1);
+    if (tp == NULL)
+        {
+        npuNetUnlock();
+        return(NULL);
+        }
+
+    tp->connReg = ct - connTypes;
+    tp->connType = ct->connType;
+    tp->tipType = npuConnDesc[ct->connType].tipType;
+    tp->outputRate = ct->outputRate;
+    if (devices > 0)
+        {
+        tp->deviceTcbs = npuTipNewTcbs(devices);
+        }
+
+    ct->numConns += 1;
+    npuNetTcpConns += 1;
+
+    npuNetUnlock();
+
+    npuLogMessage("npuNet: Added port %u for TCP port %u\n", tp->portNumber, ct->tcpPort);
+
+    return(tp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move an idle TCB from the active list to the free list
+**                  of its TCP port.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetReleaseTcb(Tcb *tp)
+    {
+    NpuConnType *ct = connTypes + tp->connReg;
+
+    npuNetLock();
+
+    if (tp->activePrev != NULL)
+        {
+        tp->activePrev->activeNext = tp->activeNext;
+        }
+    else
+        {
+        activeHead = tp->activeNext;
+        }
+
+    if (tp->activeNext != NULL)
+        {
+        tp->activeNext->activePrev = tp->activePrev;
+        }
+    else
+        {
+        activeTail = tp->activePrev;
+        }
+
+    tp->activeNext = NULL;
+    tp->activePrev = NULL;
+    tp->freeNext = ct->freeTcbs;
+    ct->freeTcbs = tp;
+
+    npuNetUnlock();
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move the first active TCB to the end of the list.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuNetRotateActive(void)
+    {
+    Tcb *tp;
+
+    npuNetLock();
+
+    tp = activeHead;
+    if (tp != NULL && tp->activeNext != NULL)
+        {
+        activeHead = tp->activeNext;
+        activeHead->activePrev = NULL;
+        tp->activeNext = NULL;
+        tp->activePrev = activeTail;
+        activeTail->activeNext = tp;
+        activeTail = tp;
+        }
+
+    npuNetUnlock();
     }
 
 /*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,400 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter, Paul Koning
+**
+**  Name: npu_stats.c
+**
+**  Description:
+**      Collect traffic statistics of the NPU connections. Counters are kept
+**      per connection and per connection type and can be displayed by the
+**      operator or appended periodically to a statistics file.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+#include "npu.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void npuStatsPrint(FILE *fp);
+static void npuStatsPrintHeader(FILE *fp);
+static void npuStatsPrintLine(FILE *fp, NpuStats *sp, u32 pending);
+static void npuStatsMax(u32 *max, u32 value);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+char npuStatsFile[256];
+u16 npuStatsInterval = 60;
+volatile bool npuStatsDue = FALSE;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static NpuStats connTypeStats[MaxConnTypes];
+static u8 regLevel = 0;
+static u32 regChanges = 0;
+
+static char *stateName[] =
+    {
+    "idle",
+    "netcon",
+    "config",
+    "connect",
+    "host",
+    "npudisc",
+    "hostdisc",
+    };
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Reset connection statistics for a new connection.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsConnect(Tcb *tp)
+    {
+    memset(&tp->stats, 0, sizeof(tp->stats));
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count an upline data block.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  len         number of data bytes following the DBC
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsUpline(Tcb *tp, int len)
+    {
+    NpuStats *cp = connTypeStats + tp->connType;
+
+    if (len < 0)
+        {
+        len = 0;
+        }
+
+    tp->stats.blocksUp += 1;
+    tp->stats.bytesUp += len;
+    cp->blocksUp += 1;
+    cp->bytesUp += len;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count a downline data block and remember when it
+**                  arrived so the acknowledgment latency can be measured.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  len         number of data bytes following the DBC
+**                  blockSeqNo  block sequence number (in BT/BSN position)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsDownline(Tcb *tp, int len, u8 blockSeqNo)
+    {
+    NpuStats *cp = connTypeStats + tp->connType;
+
+    if (len < 0)
+        {
+        len = 0;
+        }
+
+    tp->stats.blocksDown += 1;
+    tp->stats.bytesDown += len;
+    cp->blocksDown += 1;
+    cp->bytesDown += len;
+
+    tp->downCycle[(blockSeqNo >> BlkShiftBSN) & BlkMaskBSN] = cycles;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Record the latency of a downline block acknowledgment.
+**                  Only called for blocks whose data has been sent, so
+**                  blocks which are discarded do not count.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**                  blockSeqNo  block sequence number (in BT/BSN position)
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsAck(Tcb *tp, u8 blockSeqNo)
+    {
+    NpuStats *cp = connTypeStats + tp->connType;
+    u32 latency;
+
+    latency = cycles - tp->downCycle[(blockSeqNo >> BlkShiftBSN) & BlkMaskBSN];
+
+    tp->stats.ackCount += 1;
+    tp->stats.ackCycles += latency;
+    npuStatsMax(&tp->stats.ackMaxCycles, latency);
+    cp->ackCount += 1;
+    cp->ackCycles += latency;
+    npuStatsMax(&cp->ackMaxCycles, latency);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Track the high water mark of unsent network output.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsOutput(Tcb *tp)
+    {
+    u32 pending = tp->outputIn - tp->outputOut;
+
+    npuStatsMax(&tp->stats.outputMax, pending);
+    npuStatsMax(&connTypeStats[tp->connType].outputMax, pending);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count a change of the regulation level reported to
+**                  the host.
+**
+**  Parameters:     Name        Description.
+**                  level       new regulation level
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsRegulation(u8 level)
+    {
+    regLevel = level;
+    regChanges += 1;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show NPU statistics on the operator console.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsShow(void)
+    {
+    if (npuTcbCount == 0)
+        {
+        printf("NPU not configured\n");
+        return;
+        }
+
+    npuStatsPrint(stdout);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Append a timestamped snapshot to the statistics file.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void npuStatsWrite(void)
+    {
+    FILE *fp;
+    time_t now;
+    char timeStamp[40];
+
+    if (npuTcbCount == 0 || npuStatsFile[0] == '\0')
+        {
+        return;
+        }
+
+    fp = fopen(npuStatsFile, "a");
+    if (fp == NULL)
+        {
+        npuLogMessage("Stats: can't open %s", npuStatsFile);
+        return;
+        }
+
+    now = time(NULL);
+    strftime(timeStamp, sizeof(timeStamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    fprintf(fp, "==== %s  cycles %u\n", timeStamp, cycles);
+    npuStatsPrint(fp);
+    fprintf(fp, "\n");
+    fclose(fp);
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print statistics of all active connections followed by
+**                  the totals per connection type.
+**
+**  Parameters:     Name        Description.
+**                  fp          output file
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuStatsPrint(FILE *fp)
+    {
+    Tcb *tp;
+    u32 pending[MaxConnTypes];
+    int active[MaxConnTypes];
+    int i;
+
+    fprintf(fp, "Buffers free %d (low %d), regulation level %d (%u changes)\n\n",
+        npuBipBufCount(), npuBipBufMinCount(), regLevel, regChanges);
+
+    fprintf(fp, "%-28s", "CN  Type    Term    State");
+    npuStatsPrintHeader(fp);
+
+    memset(pending, 0, sizeof(pending));
+    memset(active, 0, sizeof(active));
+
+    for (i = 1; i <= npuTcbCount; i++)
+        {
+        tp = npuTcbTable[i];
+        if (tp->state == StTermIdle)
+            {
+            continue;
+            }
+
+        pending[tp->connType] += tp->outputIn - tp->outputOut;
+        active[tp->connType] += 1;
+
+        fprintf(fp, "%-3d %-7s %-7.7s %-8s",
+            tp->portNumber, npuConnDesc[tp->connType].name, tp->termName, stateName[tp->state]);
+        npuStatsPrintLine(fp, &tp->stats, tp->outputIn - tp->outputOut);
+        }
+
+    fprintf(fp, "\n%-28s", "Type    Active");
+    npuStatsPrintHeader(fp);
+
+    for (i = 0; i < npuConnDescCount; i++)
+        {
+        fprintf(fp, "%-7s %-20d", npuConnDesc[i].name, active[i]);
+        npuStatsPrintLine(fp, connTypeStats + i, pending[i]);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print the column headings of the counters.
+**
+**  Parameters:     Name        Description.
+**                  fp          output file
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuStatsPrintHeader(FILE *fp)
+    {
+    fprintf(fp, " %8s %10s %8s %10s %5s %8s %5s %8s %8s\n",
+        "BlksUp", "BytesUp", "BlksDn", "BytesDn", "OutQ", "OutMax", "Acks", "AvgAck", "MaxAck");
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print one line of counters.
+**
+**  Parameters:     Name        Description.
+**                  fp          output file
+**                  sp          counters
+**                  pending     currently unsent network output
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuStatsPrintLine(FILE *fp, NpuStats *sp, u32 pending)
+    {
+    fprintf(fp, " %8u %10u %8u %10u %5u %8u %5u %8u %8u\n",
+        sp->blocksUp, sp->bytesUp, sp->blocksDown, sp->bytesDown,
+        pending, sp->outputMax, sp->ackCount,
+        sp->ackCount == 0 ? 0 : (u32)(sp->ackCycles / sp->ackCount), sp->ackMaxCycles);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Update a high water mark.
+**
+**  Parameters:     Name        Description.
+**                  max         pointer to high water mark
+**                  value       new value
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuStatsMax(u32 *max, u32 value)
+    {
+    if (*max < value)
+        {
+        *max = value;
+        }
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -126,6 +126,7 @@
 static bool npuSvmRequestTerminalConfig(Tcb *tp);
 static bool npuSvmProcessTerminalConfig(Tcb *tp, NpuBuffer *bp);
 static bool npuSvmRequestTerminalConnection(Tcb *tp);
+static void npuSvmProcessHaspConfig(Tcb *tp, NpuBuffer *bp);
 
 /*
 **  ----------------
@@ -268,6 +269,11 @@ void npuSvmNotifyHostRegulation(u8 regLevel)
     {
     if (svmState == StIdle || regLevel != oldRegLevel)
         {
+        if (regLevel != oldRegLevel)
+            {
+            npuStatsRegulation(regLevel);
+            }
+
         oldRegLevel = regLevel;
         linkRegulation[BlkOffP3] = regLevel;
         npuBipRequestUplineCanned(linkRegulation, sizeof(linkRegulation));
@@ -293,6 +299,7 @@ bool npuSvmConnectTerminal(Tcb *tp)
     {
     if (npuSvmRequestTerminalConfig(tp))
         {
+        npuStatsConnect(tp);
         tp->state = StTermRequestConfig;
         return(TRUE);
         }
@@ -391,7 +398,7 @@ void npuSvmProcessBuffer(NpuBuffer *bp)
             return;
             }
 
-        tp = npuTcbs + cn - 1;
+        tp = npuTcbTable[cn];
         break;
         }
 
@@ -435,6 +442,15 @@ void npuSvmProcessBuffer(NpuBuffer *bp)
         break;
 
     case PfcCNF:
+        if (tp->tipType == TtHASP && block[BlkOffSfc] == (SfcTE | SfcResp))
+            {
+            /*
+            **  HASP lines get one reply per configured device.
+            */
+            npuSvmProcessHaspConfig(tp, bp);
+            break;
+            }
+
         if (tp->state != StTermRequestConfig)
             {
             npuLogMessage("Unexpected Terminal Configuration Reply in state %d", tp->state);
@@ -540,6 +556,17 @@ void npuSvmProcessBuffer(NpuBuffer *bp)
 **------------------------------------------------------------------------*/
 void npuSvmDiscRequestTerminal(Tcb *tp)
     {
+    if (tp->tipType == TtHASP && tp->lineTcb == NULL)
+        {
+        /*
+        **  A HASP line has no host connection of its own, disconnect
+        **  its devices instead.
+        */
+        npuHaspDiscRequestLine(tp);
+        tp->state = StTermIdle;
+        return;
+        }
+
     if (tp->state == StTermHostConnected)
         {
         /*
@@ -803,5 +830,59 @@ static bool npuSvmRequestTerminalConnection(Tcb *tp)
     return(TRUE);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Process a terminal configuration reply for a device
+**                  on a HASP line and connect the device to the host.
+**
+**                  The host sends one reply per device configured on the
+**                  line. Address 2 carries the device stream number.
+**
+**  Parameters:     Name        Description.
+**                  tp          TCB pointer of line
+**                  bp          buffer with service message.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void npuSvmProcessHaspConfig(Tcb *tp, NpuBuffer *bp)
+    {
+    u8 *mp = bp->data + BlkOffP3;
+    Tcb *dp;
+
+    if (tp->state != StTermRequestConfig && tp->state != StTermHostConnected)
+        {
+        npuLogMessage("Unexpected HASP Terminal Configuration Reply in state %d", tp->state);
+        return;
+        }
+
+    if (bp->numBytes < BlkOffP3 + 4)
+        {
+        npuLogMessage("Short HASP Terminal Configuration response with length %d", bp->numBytes);
+        return;
+        }
+
+    /*
+    **  The line itself is now ready to carry data for its devices.
+    */
+    tp->state = StTermHostConnected;
+
+    dp = npuHaspAllocDevice(tp, mp[3]);
+    if (dp == NULL)
+        {
+        npuLogMessage("No free device on HASP line %d", tp->portNumber);
+        return;
+        }
+
+    if (   npuSvmProcessTerminalConfig(dp, bp)
+        && npuSvmRequestTerminalConnection(dp))
+        {
+        dp->state = StTermRequestConnection;
+        }
+    else
+        {
+        dp->state = StTermIdle;
+        }
+    }
+
 /*---------------------------  End Of File  ------------------------------*/
 
@@ -190,8 +190,8 @@ static void npuTipSetupDefaultTc7(void);
 **  Public Variables
 **  ----------------
 */
-Tcb *npuTcbs;
-int npuTcbCount;
+Tcb *npuTcbTable[MaxTcbs + 1];       // indexed by CN
+volatile int npuTcbCount = 0;
 
 /*
 **  -----------------
@@ -269,20 +269,6 @@ TipParams defaultTc7;
 **------------------------------------------------------------------------*/
 void npuTipInit(void)
     {
-    int i;
-    Tcb *tp;
-
-    /*
-    **  Allocate TCBs.
-    */
-    npuTcbCount = npuNetTcpConns;
-    npuTcbs = calloc(npuTcbCount, sizeof(Tcb));
-    if (npuTcbs == NULL)
-        {
-        fprintf(stderr, "Failed to allocate NPU TCBs\n");
-        exit(1);
-        }
-
     /*
     **  Initialize default terminal class parameters.
     */
@@ -291,19 +277,7 @@ void npuTipInit(void)
     npuTipSetupDefaultTc7();
 
     /*
-    **  Initialise TCBs.
-    */
-    tp = npuTcbs;
-    for (i = 0; i < npuNetTcpConns; i++, tp++)
-        {
-        tp->portNumber = i + 1;
-        tp->params = defaultTc3;
-        tp->tipType = TtASYNC;
-        npuTipInputReset(tp);
-        }
-
-    /*
-    **  Initialise network.
+    **  Initialise network, which allocates the TCBs.
     */
     npuNetInit(TRUE);
     }
@@ -318,21 +292,40 @@ void npuTipInit(void)
 **------------------------------------------------------------------------*/
 void npuTipReset(void)
     {
-    int i;
-    Tcb *tp = npuTcbs;
+    int cn;
+    u8 connReg;
+    Tcb *deviceTcbs;
+    u8 *outputRing;
+    u32 outputSize;
+    Tcb *tp;
 
     /*
-    **  Iterate through all TCBs.
+    **  Iterate through all TCBs, keeping their place in the TCB table.
+    **  The network thread must not walk its lists or add TCBs meanwhile.
     */
-    for (i = 0; i < npuNetTcpConns; i++, tp++)
+    npuNetLock();
+
+    for (cn = 1; cn <= npuTcbCount; cn++)
         {
+        tp = npuTcbTable[cn];
+        connReg = tp->connReg;
+        deviceTcbs = tp->deviceTcbs;
+        outputRing = tp->outputRing;
+        outputSize = tp->outputSize;
         memset(tp, 0, sizeof(Tcb));
-        tp->portNumber = i + 1;
+        tp->portNumber = cn;
+        tp->connFd = -1;
+        tp->connReg = connReg;
+        tp->deviceTcbs = deviceTcbs;
+        tp->outputRing = outputRing;
+        tp->outputSize = outputSize;
         tp->params = defaultTc3;
         tp->tipType = TtASYNC;
         npuTipInputReset(tp);
         }
 
+    npuNetUnlock();
+
     /*
     **  Re-initialise network.
     */
@@ -368,7 +361,7 @@ void npuTipProcessBuffer(NpuBuffer *bp, int priority)
         }
     else
         {
-        tp = npuTcbs + cn - 1;
+        tp = npuTcbTable[cn];
         }
 
     switch (block[BlkOffBTBSN] & BlkMaskBT)
@@ -415,7 +408,8 @@ void npuTipProcessBuffer(NpuBuffer *bp, int priority)
         if (tp->state == StTermHostConnected)
             {
             last = (block[BlkOffBTBSN] & BlkMaskBT) == BtHTMSG;
-            npuAsyncProcessDownlineData(block[BlkOffCN], bp, last);
+            npuStatsDownline(tp, bp->numBytes - BlkOffData - 1, (u8)(block[BlkOffBTBSN] & (BlkMaskBSN << BlkShiftBSN)));
+            npuConnDesc[tp->connType].processDownline(block[BlkOffCN], bp, last);
             }
         else
             {
@@ -973,6 +967,8 @@ void npuTipDiscardOutputQ(Tcb *tp)
     {
     NpuBuffer *bp;
 
+    npuNetDiscardOutput(tp);
+
     while ((bp = npuBipQueueExtract(&tp->outputQ)) != NULL)
         {
         if (bp->blockSeqNo != 0)
@@ -1005,6 +1001,57 @@ void npuTipNotifySent(Tcb *tp, u8 blockSeqNo)
     npuBipRequestUplineCanned(blockAck, sizeof(blockAck));
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Allocate a block of consecutive TCBs and assign them
+**                  the next free connection numbers.
+**
+**                  TCBs are never freed again, so pointers to them stay
+**                  valid. The table entries are filled in and a barrier
+**                  is issued before the count is raised, so other threads
+**                  never see an empty entry below npuTcbCount. After
+**                  startup only the network thread grows the table, with
+**                  the connection table locked.
+**
+**  Parameters:     Name        Description.
+**                  count       number of TCBs
+**
+**  Returns:        Pointer to first TCB or NULL if the connection numbers
+**                  are exhausted or memory is short.
+**
+**------------------------------------------------------------------------*/
+Tcb *npuTipNewTcbs(int count)
+    {
+    Tcb *tp;
+    int i;
+
+    if (count <= 0 || npuTcbCount + count > MaxTcbs)
+        {
+        return(NULL);
+        }
+
+    tp = calloc(count, sizeof(Tcb));
+    if (tp == NULL)
+        {
+        return(NULL);
+        }
+
+    for (i = 0; i < count; i++)
+        {
+        tp[i].portNumber = npuTcbCount + i + 1;
+        tp[i].connFd = -1;
+        tp[i].connReg = NoConnReg;
+        tp[i].params = defaultTc3;
+        tp[i].tipType = TtASYNC;
+        npuTipInputReset(tp + i);
+        npuTcbTable[npuTcbCount + i + 1] = tp + i;
+        }
+
+    NpuRingBarrier();
+    npuTcbCount += count;
+
+    return(tp);
+    }
+
 /*
 **--------------------------------------------------------------------------
 **
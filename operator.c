@@ -96,6 +96,21 @@ static void opHelpLoadTape(void);
 static void opCmdShowTape(bool help, char *cmdParams);
 static void opHelpShowTape(void);
 
+static void opCmdShowNpu(bool help, char *cmdParams);
+static void opHelpShowNpu(void);
+
+static void opCmdShowCpu(bool help, char *cmdParams);
+static void opHelpShowCpu(void);
+
+static void opCmdShowPp(bool help, char *cmdParams);
+static void opHelpShowPp(void);
+
+static void opCmdClone(bool help, char *cmdParams);
+static void opHelpClone(void);
+
+static void opCmdShowPerf(bool help, char *cmdParams);
+static void opHelpShowPerf(void);
+
 static void opCmdUnloadTape(bool help, char *cmdParams);
 static void opHelpUnloadTape(void);
 
@@ -133,12 +148,20 @@ static OpCmd decode[] =
     "rc",                       opCmdRemoveCards,
     "rp",                       opCmdRemovePaper,
     "p",                        opCmdPause,
+    "sc",                       opCmdShowCpu,
+    "sn",                       opCmdShowNpu,
+    "sp",                       opCmdShowPp,
     "st",                       opCmdShowTape,
     "ut",                       opCmdUnloadTape,
+    "clone",                    opCmdClone,
     "load_cards",               opCmdLoadCards,
     "load_tape",                opCmdLoadTape,
     "remove_cards",             opCmdRemoveCards,
     "remove_paper",             opCmdRemovePaper,
+    "show_cpu",                 opCmdShowCpu,
+    "show_npu",                 opCmdShowNpu,
+    "show_perf",                opCmdShowPerf,
+    "show_pp",                  opCmdShowPp,
     "show_tape",                opCmdShowTape,
     "unload_tape",              opCmdUnloadTape,
     "?",                        opCmdHelp,
@@ -179,6 +202,149 @@ void opInit(void)
     opCreateThread();
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Clone the running system
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdClone(bool help, char *cmdParams)
+    {
+    /*
+    **  Process help request.
+    */
+    if (help)
+        {
+        opHelpClone();
+        return;
+        }
+
+    /*
+    **  Check parameters and process command.
+    */
+    if (strlen(cmdParams) == 0)
+        {
+        printf("parameters expected\n");
+        opHelpClone();
+        return;
+        }
+
+    cloneSystem(cmdParams);
+    }
+
+static void opHelpClone(void)
+    {
+    printf("'clone <directory>' start a copy of the running system which keeps its files in <directory>.\n");
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show host performance counters
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowPerf(bool help, char *cmdParams)
+    {
+    /*
+    **  Process help request.
+    */
+    if (help)
+        {
+        opHelpShowPerf();
+        return;
+        }
+
+    /*
+    **  Check parameters and process command.
+    */
+    if (strlen(cmdParams) == 0)
+        {
+        perfStatsShow();
+        return;
+        }
+
+    if (strcmp(cmdParams, "start") == 0)
+        {
+        perfStatsStart();
+        return;
+        }
+
+    if (strcmp(cmdParams, "stop") == 0)
+        {
+        perfStatsStop();
+        return;
+        }
+
+    printf("invalid parameters\n");
+    opHelpShowPerf();
+    }
+
+static void opHelpShowPerf(void)
+    {
+    printf("'show_perf [start|stop]' show host instructions and cache misses per emulated instruction since start.\n");
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show PP program profile
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowPp(bool help, char *cmdParams)
+    {
+    int lines;
+
+    /*
+    **  Process help request.
+    */
+    if (help)
+        {
+        opHelpShowPp();
+        return;
+        }
+
+    /*
+    **  Check parameters and process command.
+    */
+    if (strlen(cmdParams) == 0)
+        {
+        ppStatsShow(0);
+        return;
+        }
+
+    if (strcmp(cmdParams, "reset") == 0)
+        {
+        ppStatsReset();
+        return;
+        }
+
+    if (sscanf(cmdParams, "%d", &lines) == 1 && lines > 0)
+        {
+        ppStatsShow(lines);
+        return;
+        }
+
+    printf("invalid parameters\n");
+    opHelpShowPp();
+    }
+
+static void opHelpShowPp(void)
+    {
+    printf("'show_pp [<count>|reset]' show PP programs ranked by PP cycles, or clear the profile.\n");
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Operator request handler called from the main emulation
 **                  thread to avoid race conditions.
@@ -282,6 +448,8 @@ static void *opThread(void *param)
     char *params;
     char *pos;
 
+    threadSetup("operator");
+
     printf("\n%s.", DtCyberVersion " - " DtCyberCopyright);
     printf("\n%s.", DtCyberLicense);
     printf("\n%s.", DtCyberLicenseDetails);
@@ -772,6 +940,99 @@ static void opHelpShowTape(void)
     printf("'show_tape' show status of all tape units.\n");
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Show NPU traffic statistics
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowNpu(bool help, char *cmdParams)
+    {
+    /*
+    **  Process help request.
+    */
+    if (help)
+        {
+        opHelpShowNpu();
+        return;
+        }
+
+    /*
+    **  Check parameters and process command.
+    */
+    if (strlen(cmdParams) != 0)
+        {
+        printf("no parameters expected\n");
+        opHelpShowNpu();
+        return;
+        }
+
+    npuStatsShow();
+    }
+
+static void opHelpShowNpu(void)
+    {
+    printf("'show_npu' show NPU traffic statistics per connection and connection type.\n");
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show CPU accounting per exchange package
+**
+**  Parameters:     Name        Description.
+**                  help        Request only help on this command.
+**                  cmdParams   Command parameters
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void opCmdShowCpu(bool help, char *cmdParams)
+    {
+    int interval;
+
+    /*
+    **  Process help request.
+    */
+    if (help)
+        {
+        opHelpShowCpu();
+        return;
+        }
+
+    /*
+    **  Check parameters and process command.
+    */
+    if (strlen(cmdParams) == 0)
+        {
+        cpuStatsShow();
+        return;
+        }
+
+    if (sscanf(cmdParams, "top %d", &interval) == 1 && interval >= 0 && interval <= 0xFFFF)
+        {
+        cpuStatsTop((u16)interval);
+        return;
+        }
+
+    if (strcmp(cmdParams, "top") == 0)
+        {
+        cpuStatsTop(5);
+        return;
+        }
+
+    printf("invalid parameters\n");
+    opHelpShowCpu();
+    }
+
+static void opHelpShowCpu(void)
+    {
+    printf("'show_cpu [top [<seconds>]]' show CPU instructions and host time per exchange package.\n");
+    printf("    'top' shows the busiest packages every <seconds> (default 5), 'top 0' stops.\n");
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Remove paper from printer.
 **
@@ -0,0 +1,271 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: perf_stats.c
+**
+**  Description:
+**      Measure the host cost of emulation with the hardware performance
+**      counters of the main emulation thread: host instructions, cycles
+**      and data cache misses per emulated PP and CPU instruction.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define PerfEvents          4
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if defined(__linux__)
+#define CacheEvent(cache)   ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct perfEvent
+    {
+    char            *name;              /* name in report */
+    u32             type;               /* perf event type */
+    u64             config;             /* perf event selection */
+    } PerfEvent;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static u64 perfStatsEmulated(void);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+#if defined(__linux__)
+static PerfEvent events[PerfEvents] =
+    {
+    { "host instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "host cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "L1 data misses",     PERF_TYPE_HW_CACHE, CacheEvent(PERF_COUNT_HW_CACHE_L1D) },
+    { "last level misses",  PERF_TYPE_HW_CACHE, CacheEvent(PERF_COUNT_HW_CACHE_LL) },
+    };
+
+static int eventFd[PerfEvents] = { -1, -1, -1, -1 };
+#endif
+
+static bool running = FALSE;
+static u64 startEmulated;
+static u32 startCycles;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Start counting for the calling thread.
+**
+**                  Called from the main emulation thread, which runs the
+**                  PPs, the channels and a single CPU.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void perfStatsStart(void)
+    {
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    int i;
+
+    perfStatsStop();
+
+    for (i = 0; i < PerfEvents; i++)
+        {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        eventFd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (eventFd[i] < 0)
+            {
+            printf("Counter for %s not available\n", events[i].name);
+            continue;
+            }
+
+        ioctl(eventFd[i], PERF_EVENT_IOC_RESET, 0);
+        }
+
+    startEmulated = perfStatsEmulated();
+    startCycles = cycles;
+    running = TRUE;
+
+    for (i = 0; i < PerfEvents; i++)
+        {
+        if (eventFd[i] >= 0)
+            {
+            ioctl(eventFd[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+    printf("Counting started\n");
+#else
+    printf("Performance counters are not supported on this host\n");
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show the counts since counting was started.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void perfStatsShow(void)
+    {
+#if defined(__linux__)
+    u64 emulated;
+    u64 count;
+    int i;
+
+    if (!running)
+        {
+        printf("Counting not started\n");
+        return;
+        }
+
+    emulated = (u64)(cycles - startCycles) * ppuCount + perfStatsEmulated() - startEmulated;
+    printf("Major cycles %u, emulated instructions %.0f\n", cycles - startCycles, (double)emulated);
+    printf("%-20s %16s %12s\n", "Event", "Count", "Per instr");
+
+    for (i = 0; i < PerfEvents; i++)
+        {
+        if (eventFd[i] < 0 || read(eventFd[i], &count, sizeof(count)) != sizeof(count))
+            {
+            printf("%-20s %16s %12s\n", events[i].name, "n/a", "n/a");
+            continue;
+            }
+
+        printf("%-20s %16.0f %12.4f\n", events[i].name, (double)count,
+            emulated == 0 ? 0.0 : (double)count / (double)emulated);
+        }
+#else
+    printf("Performance counters are not supported on this host\n");
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Stop counting.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void perfStatsStop(void)
+    {
+#if defined(__linux__)
+    int i;
+
+    for (i = 0; i < PerfEvents; i++)
+        {
+        if (eventFd[i] >= 0)
+            {
+            close(eventFd[i]);
+            eventFd[i] = -1;
+            }
+        }
+#endif
+
+    running = FALSE;
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Count CPU instructions executed by the main emulation
+**                  thread.
+**
+**                  The PP instructions are counted as one step per PP and
+**                  major cycle. The CPUs of a multiprocessor run in their
+**                  own threads, which are not measured.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        CPU instructions.
+**
+**------------------------------------------------------------------------*/
+static u64 perfStatsEmulated(void)
+    {
+    if (cpuCount > 1)
+        {
+        return(0);
+        }
+
+    return(cpus[0].instructions);
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -65,19 +65,19 @@
     }
 
 #define IndexLocation                                                       \
-    if (opD != 0)                                                           \
+    if (ppActive.opD != 0)                                                  \
         {                                                                   \
-        location = activePpu->mem[opD] + activePpu->mem[activePpu->regP];   \
+        ppActive.location = activePpu->mem[ppActive.opD] + activePpu->mem[activePpu->regP]; \
         }                                                                   \
     else                                                                    \
         {                                                                   \
-        location = activePpu->mem[activePpu->regP];                         \
+        ppActive.location = activePpu->mem[activePpu->regP];                \
         }                                                                   \
-    if ((location & Overflow12) != 0 || (location & Mask12) == 07777)       \
+    if ((ppActive.location & Overflow12) != 0 || (ppActive.location & Mask12) == 07777) \
         {                                                                   \
-        location += 1;                                                      \
+        ppActive.location += 1;                                             \
         }                                                                   \
-    location &= Mask12;                                                     \
+    ppActive.location &= Mask12;                                            \
     PpIncrement(activePpu->regP);
 
 
@@ -87,6 +87,32 @@
 **  -----------------------------------------
 */
 
+/*
+**  Record of a PP in the PPM backing file. This is the layout of the
+**  original PP control block, so the file stays readable by all versions
+**  whatever the layout of PpSlot.
+*/
+typedef struct ppStore
+    {
+    u32             regA;               /* register A (18 bit) */
+    u32             regR;               /* register R (28 bit) */
+    PpWord          regP;               /* program counter (12 bit) */
+    PpWord          regQ;               /* register Q (12 bit) */
+    PpWord          mem[PpMemSize];     /* PP memory */
+    bool            busy;               /* instruction execution state */
+    u8              id;                 /* PP number */
+    PpByte          opF;                /* current opcode */
+    PpByte          opD;                /* current opcode */
+    } PpStore;
+
+/*
+**  CM access opcodes compiled for one model.
+*/
+typedef struct ppCore
+    {
+    void (*cmOps[4])(void);             /* opcodes 60 to 63 */
+    } PpCore;
+
 /*
 **  ---------------------------
 **  Private Function Prototypes
@@ -160,6 +186,19 @@ static void ppOpFNC(void);    // 77
 static u32 ppAdd18(u32 op1, u32 op2);
 static u32 ppSubtract18(u32 op1, u32 op2);
 static void ppInterlock(PpWord func);
+ForceInline bool ppCmBlockAddressModel(u32 *address, ModelFeatures mf);
+ForceInline void ppCmReadWordModel(ModelFeatures mf);
+ForceInline void ppCmWriteWordModel(ModelFeatures mf);
+ForceInline void ppCmReadBlockModel(ModelFeatures mf);
+ForceInline void ppCmWriteBlockModel(ModelFeatures mf);
+static bool ppCmBlockDelay(void);
+ForceInline void ppOpCRDModel(ModelFeatures mf);
+ForceInline void ppOpCRMModel(ModelFeatures mf);
+ForceInline void ppOpCWDModel(ModelFeatures mf);
+ForceInline void ppOpCWMModel(ModelFeatures mf);
+static void ppSelectCore(ModelType model);
+static bool ppReadStore(void);
+static bool ppWriteStore(void);
 
 /*
 **  ----------------
@@ -167,9 +206,10 @@ static void ppInterlock(PpWord func);
 **  ----------------
 */
 PpSlot *ppu;
-PpSlot *activePpu;
+PpDecode ppActive;
 u8 ppuCount;
 FILE *devF;
+bool ppBlockTransfer = FALSE;
 
 /*
 **  -----------------
@@ -177,13 +217,14 @@ FILE *devF;
 **  -----------------
 */
 static FILE *ppHandle;
+
 static u8 pp = 0;
-static PpByte opF;
-static PpByte opD;
-static PpWord location;
-static u32 acc18;
 static bool noHang;
 
+/*
+**  Opcode dispatch table. The CM access opcodes are replaced by those of
+**  the configured model.
+*/
 static void (*decodePpuOpcode[])(void) = 
     {
     ppOpPSN,    // 00
@@ -270,11 +311,16 @@ static void (*decodePpuOpcode[])(void) =
 **------------------------------------------------------------------------*/
 void ppInit(u8 count)
     {
+    /*
+    **  Use the CM access opcodes compiled for the model.
+    */
+    ppSelectCore(modelType);
+
     /*
     **  Allocate ppu structures.
     */
     ppuCount = count;
-    ppu = calloc(count, sizeof(PpSlot));
+    ppu = memAlloc(count * sizeof(PpSlot), "PP memory");
     if (ppu == NULL)
         {
         fprintf(stderr, "Failed to allocate ppu control blocks\n");
@@ -299,7 +345,7 @@ void ppInit(u8 count)
             /*
             **  Read PPM contents.
             */
-            if (fread(ppu, sizeof(PpSlot), count, ppHandle) != count)
+            if (!ppReadStore())
                 {
                 printf("Unexpected length of PPM backing file, clearing PPM\n");
                 memset(ppu, 0, count * sizeof(PpSlot));
@@ -351,7 +397,7 @@ void ppTerminate(void)
     if (ppHandle != NULL)
         {
         fseek(ppHandle, 0, SEEK_SET);
-        if (fwrite(ppu, sizeof(PpSlot), ppuCount, ppHandle) != ppuCount)
+        if (!ppWriteStore())
             {
             fprintf(stderr, "Error writing PPM backing file\n");
             }
@@ -362,7 +408,7 @@ void ppTerminate(void)
     /*
     **  Free allocated memory.
     */
-    free(ppu);
+    memFree(ppu, ppuCount * sizeof(PpSlot));
     }
 
 /*--------------------------------------------------------------------------
@@ -394,15 +440,15 @@ void ppStep(void)
             **  Extract next PPU instruction.
             */
             opCode = activePpu->mem[activePpu->regP];
-            opF = (opCode >> 6) & 077;
-            opD = opCode & 077;
+            ppActive.opF = (opCode >> 6) & 077;
+            ppActive.opD = opCode & 077;
 
 #if CcDebug == 1
             /*
             **  Save opF and opD for post-instruction trace.
             */
-            activePpu->opF = opF;
-            activePpu->opD = opD;
+            activePpu->opF = ppActive.opF;
+            activePpu->opD = ppActive.opD;
 
             /*
             **  Trace instructions.
@@ -422,7 +468,7 @@ traceSequenceNo += 1;
             /*
             **  Execute PPU instruction.
             */
-            decodePpuOpcode[opF]();
+            decodePpuOpcode[ppActive.opF]();
             }
         else
             {
@@ -452,6 +498,11 @@ traceSequenceNo += 1;
             }
 #endif
         }
+
+    /*
+    **  Sample the running PP programs for the profiler.
+    */
+    ppStatsSample();
     }
 
 /*
@@ -462,6 +513,266 @@ traceSequenceNo += 1;
 **--------------------------------------------------------------------------
 */
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the absolute CM address of a CRM/CWM block
+**                  transfer if the block is contiguous in CM and in PP
+**                  memory.
+**
+**                  The block is contiguous if A does not overflow into or
+**                  out of relocation, CM does not wrap and PP memory does
+**                  not wrap.
+**
+**  Parameters:     Name        Description.
+**                  address     Pointer to u32 which will contain the
+**                              absolute CM address of the first word.
+**                  mf          features of the model compiled for
+**
+**  Returns:        TRUE if the block is contiguous, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+ForceInline bool ppCmBlockAddressModel(u32 *address, ModelFeatures mf)
+    {
+    u32 count = activePpu->regQ;
+    u32 end = (activePpu->regA & Mask18) + count;
+
+    if ((u32)activePpu->regP + count * 5 > PpMemSize)
+        {
+        return(FALSE);
+        }
+
+    if (!ModelHas(mf, HasRelocationReg))
+        {
+        if (end > Mask18 + 1)
+            {
+            return(FALSE);
+            }
+
+        *address = activePpu->regA & Mask18;
+        }
+    else if ((activePpu->regA & Sign18) != 0)
+        {
+        if (end > Mask18 + 1)
+            {
+            return(FALSE);
+            }
+
+        *address = activePpu->regR + (activePpu->regA & Mask17);
+        }
+    else
+        {
+        if (end > Sign18)
+            {
+            return(FALSE);
+            }
+
+        *address = activePpu->regA & Mask18;
+        }
+
+    return(*address + count <= cpuMaxMemory);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read one CM word into five PP words for CRM.
+**
+**  Parameters:     Name        Description.
+**                  mf          features of the model compiled for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+ForceInline void ppCmReadWordModel(ModelFeatures mf)
+    {
+    CpWord data;
+
+    if ((activePpu->regA & Sign18) != 0 && ModelHas(mf, HasRelocationReg))
+        {
+        cpuPpReadMem(activePpu->regR + (activePpu->regA & Mask17), &data);
+        }
+    else
+        {
+        cpuPpReadMem(activePpu->regA & Mask18, &data);
+        }
+
+    activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 48) & Mask12);
+    activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 36) & Mask12);
+    activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 24) & Mask12);
+    activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 12) & Mask12);
+    activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data      ) & Mask12);
+
+    activePpu->regA += 1;
+    activePpu->regA &= Mask18;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write five PP words into one CM word for CWM.
+**
+**  Parameters:     Name        Description.
+**                  mf          features of the model compiled for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+ForceInline void ppCmWriteWordModel(ModelFeatures mf)
+    {
+    CpWord data;
+
+    data  = activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
+    data <<= 12;
+
+    data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
+    data <<= 12;
+
+    data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
+    data <<= 12;
+
+    data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
+    data <<= 12;
+
+    data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
+
+    if ((activePpu->regA & Sign18) != 0 && ModelHas(mf, HasRelocationReg))
+        {
+        cpuPpWriteMem(activePpu->regR + (activePpu->regA & Mask17), data);
+        }
+    else
+        {
+        cpuPpWriteMem(activePpu->regA & Mask18, data);
+        }
+
+    activePpu->regA += 1;
+    activePpu->regA &= Mask18;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Transfer the whole CRM block at the start of the
+**                  instruction.
+**
+**  Parameters:     Name        Description.
+**                  mf          features of the model compiled for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+ForceInline void ppCmReadBlockModel(ModelFeatures mf)
+    {
+    PpWord count = activePpu->regQ;
+    PpWord *pp;
+    CpWord *cm;
+    CpWord data;
+    u32 address;
+    PpWord i;
+
+    if (ppCmBlockAddressModel(&address, mf))
+        {
+        /*
+        **  Unpack straight from CM into PP memory.
+        */
+        cm = cpMem + address;
+        pp = activePpu->mem + activePpu->regP;
+        for (i = count; i > 0; i--)
+            {
+            data = *cm++;
+            pp[0] = (PpWord)((data >> 48) & Mask12);
+            pp[1] = (PpWord)((data >> 36) & Mask12);
+            pp[2] = (PpWord)((data >> 24) & Mask12);
+            pp[3] = (PpWord)((data >> 12) & Mask12);
+            pp[4] = (PpWord)((data      ) & Mask12);
+            pp += 5;
+            }
+
+        activePpu->regP = (activePpu->regP + count * 5) & Mask12;
+        activePpu->regA = (activePpu->regA + count) & Mask18;
+        }
+    else
+        {
+        for (i = count; i > 0; i--)
+            {
+            ppCmReadWordModel(mf);
+            }
+        }
+
+    activePpu->regQ = 0;
+    activePpu->blockDelay = count;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Transfer the whole CWM block at the start of the
+**                  instruction.
+**
+**  Parameters:     Name        Description.
+**                  mf          features of the model compiled for
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+ForceInline void ppCmWriteBlockModel(ModelFeatures mf)
+    {
+    PpWord count = activePpu->regQ;
+    PpWord *pp;
+    CpWord *cm;
+    u32 address;
+    PpWord i;
+
+    if (ppCmBlockAddressModel(&address, mf))
+        {
+        /*
+        **  Pack straight from PP memory into CM.
+        */
+        cm = cpMem + address;
+        pp = activePpu->mem + activePpu->regP;
+        for (i = count; i > 0; i--)
+            {
+            *cm++ =   ((CpWord)(pp[0] & Mask12) << 48)
+                    | ((CpWord)(pp[1] & Mask12) << 36)
+                    | ((CpWord)(pp[2] & Mask12) << 24)
+                    | ((CpWord)(pp[3] & Mask12) << 12)
+                    | ((CpWord)(pp[4] & Mask12));
+            pp += 5;
+            }
+
+        activePpu->regP = (activePpu->regP + count * 5) & Mask12;
+        activePpu->regA = (activePpu->regA + count) & Mask18;
+        }
+    else
+        {
+        for (i = count; i > 0; i--)
+            {
+            ppCmWriteWordModel(mf);
+            }
+        }
+
+    activePpu->regQ = 0;
+    activePpu->blockDelay = count;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Keep a PP busy after a block transfer for the barrel
+**                  visits the word by word transfer would have taken, and
+**                  complete the instruction at the end.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if a block transfer is in progress, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool ppCmBlockDelay(void)
+    {
+    if (activePpu->blockDelay == 0)
+        {
+        return(FALSE);
+        }
+
+    activePpu->blockDelay -= 1;
+    if (activePpu->blockDelay == 0)
+        {
+        activePpu->regP = activePpu->mem[0];
+        PpIncrement(activePpu->regP);
+        activePpu->busy = FALSE;
+        }
+
+    return(TRUE);
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        18 bit ones-complement addition with subtractive adder
 **
@@ -474,13 +785,13 @@ traceSequenceNo += 1;
 **------------------------------------------------------------------------*/
 static u32 ppAdd18(u32 op1, u32 op2)
     {
-    acc18 = (op1 & Mask18) - (~op2 & Mask18);
-    if ((acc18 & Overflow18) != 0)
+    ppActive.acc18 = (op1 & Mask18) - (~op2 & Mask18);
+    if ((ppActive.acc18 & Overflow18) != 0)
         {
-        acc18 -= 1;
+        ppActive.acc18 -= 1;
         }
 
-    return(acc18 & Mask18);
+    return(ppActive.acc18 & Mask18);
     }
 
 /*--------------------------------------------------------------------------
@@ -495,13 +806,13 @@ static u32 ppAdd18(u32 op1, u32 op2)
 **------------------------------------------------------------------------*/
 static u32 ppSubtract18(u32 op1, u32 op2)
     {
-    acc18 = (op1 & Mask18) - (op2 & Mask18);
-    if ((acc18 & Overflow18) != 0)
+    ppActive.acc18 = (op1 & Mask18) - (op2 & Mask18);
+    if ((ppActive.acc18 & Overflow18) != 0)
         {
-        acc18 -= 1;
+        ppActive.acc18 -= 1;
         }
 
-    return(acc18 & Mask18);
+    return(ppActive.acc18 & Mask18);
     }
 
 /*--------------------------------------------------------------------------
@@ -522,27 +833,27 @@ static void ppOpPSN(void)     // 00
 static void ppOpLJM(void)     // 01
     {
     IndexLocation;
-    activePpu->regP = location;
+    activePpu->regP = ppActive.location;
     }
 
 static void ppOpRJM(void)     // 02
     {
     IndexLocation;
-    activePpu->mem[location] = activePpu->regP;
-    PpIncrement(location);
-    activePpu->regP = location;
+    activePpu->mem[ppActive.location] = activePpu->regP;
+    PpIncrement(ppActive.location);
+    activePpu->regP = ppActive.location;
     }
 
 static void ppOpUJN(void)     // 03
     {
-    PpAddOffset(activePpu->regP, opD);
+    PpAddOffset(activePpu->regP, ppActive.opD);
     }
 
 static void ppOpZJN(void)     // 04
     {
     if (activePpu->regA == 0)
         {
-        PpAddOffset(activePpu->regP, opD);
+        PpAddOffset(activePpu->regP, ppActive.opD);
         }
     }
 
@@ -550,7 +861,7 @@ static void ppOpNJN(void)     // 05
     {
     if (activePpu->regA != 0)
         {
-        PpAddOffset(activePpu->regP, opD);
+        PpAddOffset(activePpu->regP, ppActive.opD);
         }
     }
 
@@ -558,7 +869,7 @@ static void ppOpPJN(void)     // 06
     {
     if (activePpu->regA < 0400000)
         {
-        PpAddOffset(activePpu->regP, opD);
+        PpAddOffset(activePpu->regP, ppActive.opD);
         }
     }
 
@@ -566,7 +877,7 @@ static void ppOpMJN(void)     // 07
     {
     if (activePpu->regA > 0377777)
         {
-        PpAddOffset(activePpu->regP, opD);
+        PpAddOffset(activePpu->regP, ppActive.opD);
         }
     }
 
@@ -574,99 +885,99 @@ static void ppOpSHN(void)     // 10
     {
     u64 acc;
 
-    if (opD < 040)
+    if (ppActive.opD < 040)
         {
-        opD = opD % 18;
+        ppActive.opD = ppActive.opD % 18;
         acc = activePpu->regA & Mask18;
-        acc <<= opD;
+        acc <<= ppActive.opD;
         activePpu->regA = (u32)((acc & Mask18) | (acc >> 18));
         }
-    else if (opD > 037)
+    else if (ppActive.opD > 037)
         {
-        opD = 077 - opD;
-        activePpu->regA >>= opD;
+        ppActive.opD = 077 - ppActive.opD;
+        activePpu->regA >>= ppActive.opD;
         }
     }
 
 static void ppOpLMN(void)     // 11
     {
-    activePpu->regA ^= opD;
+    activePpu->regA ^= ppActive.opD;
     }
 
 static void ppOpLPN(void)     // 12
     {
-    activePpu->regA &= opD;
+    activePpu->regA &= ppActive.opD;
     }
 
 static void ppOpSCN(void)     // 13
     {
-    activePpu->regA &= ~(opD & 077);
+    activePpu->regA &= ~(ppActive.opD & 077);
     }
 
 static void ppOpLDN(void)     // 14
     {
-    activePpu->regA = opD;
+    activePpu->regA = ppActive.opD;
     }
 
 static void ppOpLCN(void)     // 15
     {
-    activePpu->regA = ~opD & Mask18;
+    activePpu->regA = ~ppActive.opD & Mask18;
     }
 
 static void ppOpADN(void)     // 16
     {
-    activePpu->regA = ppAdd18(activePpu->regA, opD);
+    activePpu->regA = ppAdd18(activePpu->regA, ppActive.opD);
     }
 
 static void ppOpSBN(void)     // 17
     {
-    activePpu->regA = ppSubtract18(activePpu->regA, opD);
+    activePpu->regA = ppSubtract18(activePpu->regA, ppActive.opD);
     }
 
 static void ppOpLDC(void)     // 20
     {
-    activePpu->regA = (opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
+    activePpu->regA = (ppActive.opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
     PpIncrement(activePpu->regP);
     }
 
 static void ppOpADC(void)     // 21
     {
-    activePpu->regA = ppAdd18(activePpu->regA, (opD << 12) | (activePpu->mem[activePpu->regP] & Mask12));
+    activePpu->regA = ppAdd18(activePpu->regA, (ppActive.opD << 12) | (activePpu->mem[activePpu->regP] & Mask12));
     PpIncrement(activePpu->regP);
     }
 
 static void ppOpLPC(void)     // 22
     {
-    activePpu->regA &= (opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
+    activePpu->regA &= (ppActive.opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
     PpIncrement(activePpu->regP);
     }
 
 static void ppOpLMC(void)     // 23
     {
-    activePpu->regA ^= (opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
+    activePpu->regA ^= (ppActive.opD << 12) | (activePpu->mem[activePpu->regP] & Mask12);
     PpIncrement(activePpu->regP);
     }
 
 static void ppOpPSN24(void)     // 24
     {
-    if (opD != 0)
+    if (ppActive.opD != 0)
         {
         if ((features & HasRelocationRegShort) != 0)
             {
             /*
             **  LRD.
             */
-//            activePpu->regR  = (u32)(activePpu->mem[opD    ] & Mask4 ) << 18; // 875
-            activePpu->regR  = (u32)(activePpu->mem[opD    ] & Mask3 ) << 18; // 865
-            activePpu->regR |= (u32)(activePpu->mem[opD + 1] & Mask12) << 6;
+//            activePpu->regR  = (u32)(activePpu->mem[ppActive.opD    ] & Mask4 ) << 18; // 875
+            activePpu->regR  = (u32)(activePpu->mem[ppActive.opD    ] & Mask3 ) << 18; // 865
+            activePpu->regR |= (u32)(activePpu->mem[ppActive.opD + 1] & Mask12) << 6;
             }
         else if ((features & HasRelocationRegLong) != 0)
             {
             /*
             **  LRD.
             */
-            activePpu->regR  = (u32)(activePpu->mem[opD    ] & Mask10) << 18;
-            activePpu->regR |= (u32)(activePpu->mem[opD + 1] & Mask12) << 6;
+            activePpu->regR  = (u32)(activePpu->mem[ppActive.opD    ] & Mask10) << 18;
+            activePpu->regR |= (u32)(activePpu->mem[ppActive.opD + 1] & Mask12) << 6;
             }
         }
 
@@ -677,24 +988,24 @@ static void ppOpPSN24(void)     // 24
 
 static void ppOpPSN25(void)     // 25
     {
-    if (opD != 0)
+    if (ppActive.opD != 0)
         {
         if ((features & HasRelocationRegShort) != 0)
             {
             /*
             **  SRD.
             */
-//            activePpu->mem[opD    ] = (PpWord)(activePpu->regR >> 18) & Mask4; // 875
-            activePpu->mem[opD    ] = (PpWord)(activePpu->regR >> 18) & Mask3; // 865
-            activePpu->mem[opD + 1] = (PpWord)(activePpu->regR >>  6) & Mask12;
+//            activePpu->mem[ppActive.opD    ] = (PpWord)(activePpu->regR >> 18) & Mask4; // 875
+            activePpu->mem[ppActive.opD    ] = (PpWord)(activePpu->regR >> 18) & Mask3; // 865
+            activePpu->mem[ppActive.opD + 1] = (PpWord)(activePpu->regR >>  6) & Mask12;
             }
         else if ((features & HasRelocationRegLong) != 0)
             {
             /*
             **  SRD.
             */
-            activePpu->mem[opD    ] = (PpWord)(activePpu->regR >> 18) & Mask10;
-            activePpu->mem[opD + 1] = (PpWord)(activePpu->regR >>  6) & Mask12;
+            activePpu->mem[ppActive.opD    ] = (PpWord)(activePpu->regR >> 18) & Mask10;
+            activePpu->mem[ppActive.opD + 1] = (PpWord)(activePpu->regR >>  6) & Mask12;
             }
         }
 
@@ -707,80 +1018,45 @@ static void ppOpEXN(void)     // 26
     {
     u32 exchangeAddress;
 
-    if ((opD & 070) == 0 || (features & HasNoCejMej) != 0)
+    if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
         {
-        /*
-        **  EXN or MXN/MAN with CEJ/MEJ disabled.
-        */
-        if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
-            {
-            exchangeAddress = activePpu->regR + (activePpu->regA & Mask17);
-            if ((features & HasRelocationRegShort) != 0)
-                {
-                exchangeAddress &= Mask18;
-                }
-            }
-        else
+        exchangeAddress = activePpu->regR + (activePpu->regA & Mask17);
+        if ((features & HasRelocationRegShort) != 0)
             {
-            exchangeAddress = activePpu->regA & Mask18;
+            exchangeAddress &= Mask18;
             }
         }
     else
         {
-        if (cpu.monitorMode)
-            {
-            /*
-            **  Pass.
-            */
-            return;
-            }
-
-        if ((opD & 070) == 010)
-            {
-            /*
-            **  MXN.
-            */
-            cpu.monitorMode = TRUE;
-
-            if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
-                {
-                exchangeAddress = activePpu->regR + (activePpu->regA & Mask17);
-                if ((features & HasRelocationRegShort) != 0)
-                    {
-                    exchangeAddress &= Mask18;
-                    }
-                }
-            else
-                {
-                exchangeAddress = activePpu->regA & Mask18;
-                }
-            }
-        else if ((opD & 070) == 020)
-            {
-            /*
-            **  MAN.
-            */
-            cpu.monitorMode = TRUE;
+        exchangeAddress = activePpu->regA & Mask18;
+        }
 
-            exchangeAddress = cpu.regMa & Mask18;
-            }
-        else
-            {
-            /*
-            **  Pass.
-            */
-            return;
-            }
+    if ((ppActive.opD & 070) == 0 || (features & HasNoCejMej) != 0)
+        {
+        /*
+        **  EXN or MXN/MAN with CEJ/MEJ disabled. In a multiprocessor the
+        **  low bit of d selects the CPU.
+        */
+        cpuPpExchangeJump(cpuCount > 1 ? ppActive.opD & 1 : 0, exchangeAddress);
+        }
+    else if ((ppActive.opD & 070) == 010)
+        {
+        /*
+        **  MXN, which like EXN selects the CPU by the low bit of d.
+        */
+        cpuPpMonitorExchangeJump(cpuCount > 1 ? ppActive.opD & 1 : 0, exchangeAddress, FALSE);
+        }
+    else if ((ppActive.opD & 070) == 020)
+        {
+        /*
+        **  MAN.
+        */
+        cpuPpMonitorExchangeJump(cpuCount > 1 ? ppActive.opD & 1 : 0, 0, TRUE);
         }
 
     /*
-    **  Perform the exchange, but wait until the last parcel of the
-    **  current instruction word has been executed.
+    **  Anything else is a pass.
     */
-    while (!cpuExchangeJump(exchangeAddress))
-        {
-        cpuStep();
-        }
     }
 
 static void ppOpRPN(void)     // 27
@@ -796,157 +1072,157 @@ static void ppOpRPN(void)     // 27
 
 static void ppOpLDD(void)     // 30
     {
-    activePpu->regA = activePpu->mem[opD] & Mask12;
+    activePpu->regA = activePpu->mem[ppActive.opD] & Mask12;
     activePpu->regA &= Mask18;
     }
 
 static void ppOpADD(void)     // 31
     {
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[opD] & Mask12);
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.opD] & Mask12);
     }
 
 static void ppOpSBD(void)     // 32
     {
-    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[opD] & Mask12);
+    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[ppActive.opD] & Mask12);
     }
 
 static void ppOpLMD(void)     // 33
     {
-    activePpu->regA ^= activePpu->mem[opD] & Mask12;
+    activePpu->regA ^= activePpu->mem[ppActive.opD] & Mask12;
     activePpu->regA &= Mask18;
     }
 
 static void ppOpSTD(void)     // 34
     {
-    activePpu->mem[opD] = (PpWord)activePpu->regA & Mask12;
+    activePpu->mem[ppActive.opD] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpRAD(void)     // 35
     {
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[opD] & Mask12);
-    activePpu->mem[opD] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.opD] & Mask12);
+    activePpu->mem[ppActive.opD] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpAOD(void)     // 36
     {
-    activePpu->regA = ppAdd18(activePpu->mem[opD] & Mask12, 1);
-    activePpu->mem[opD] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppAdd18(activePpu->mem[ppActive.opD] & Mask12, 1);
+    activePpu->mem[ppActive.opD] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpSOD(void)     // 37
     {
-    activePpu->regA = ppSubtract18(activePpu->mem[opD] & Mask12, 1);
-    activePpu->mem[opD] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppSubtract18(activePpu->mem[ppActive.opD] & Mask12, 1);
+    activePpu->mem[ppActive.opD] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpLDI(void)     // 40
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = activePpu->mem[location] & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = activePpu->mem[ppActive.location] & Mask12;
     }
 
 static void ppOpADI(void)     // 41
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[location] & Mask12);
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
     }
 
 static void ppOpSBI(void)     // 42
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[location] & Mask12);
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
     }
 
 static void ppOpLMI(void)     // 43
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA ^= activePpu->mem[location] & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA ^= activePpu->mem[ppActive.location] & Mask12;
     activePpu->regA &= Mask18;
     }
 
 static void ppOpSTI(void)     // 44
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpRAI(void)     // 45
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[location] & Mask12);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpAOI(void)     // 46
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = ppAdd18(activePpu->mem[location] & Mask12, 1);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = ppAdd18(activePpu->mem[ppActive.location] & Mask12, 1);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpSOI(void)     // 47
     {
-    location = activePpu->mem[opD] & Mask12;
-    activePpu->regA = ppSubtract18(activePpu->mem[location] & Mask12, 1);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    ppActive.location = activePpu->mem[ppActive.opD] & Mask12;
+    activePpu->regA = ppSubtract18(activePpu->mem[ppActive.location] & Mask12, 1);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpLDM(void)     // 50
     {
     IndexLocation;
-    activePpu->regA = activePpu->mem[location] & Mask12;
+    activePpu->regA = activePpu->mem[ppActive.location] & Mask12;
     }
 
 static void ppOpADM(void)     // 51
     {
     IndexLocation;
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[location] & Mask12);
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
     }
 
 static void ppOpSBM(void)     // 52
     {
     IndexLocation;
-    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[location] & Mask12);
+    activePpu->regA = ppSubtract18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
     }
 
 static void ppOpLMM(void)     // 53
     {
     IndexLocation;
-    activePpu->regA ^= activePpu->mem[location] & Mask12;
+    activePpu->regA ^= activePpu->mem[ppActive.location] & Mask12;
     }
 
 static void ppOpSTM(void)     // 54
     {
     IndexLocation;
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpRAM(void)     // 55
     {
     IndexLocation;
-    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[location] & Mask12);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppAdd18(activePpu->regA, activePpu->mem[ppActive.location] & Mask12);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpAOM(void)     // 56
     {
     IndexLocation;
-    activePpu->regA = ppAdd18(activePpu->mem[location] & Mask12, 1);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppAdd18(activePpu->mem[ppActive.location] & Mask12, 1);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
 static void ppOpSOM(void)     // 57
     {
     IndexLocation;
-    activePpu->regA = ppSubtract18(activePpu->mem[location] & Mask12, 1);
-    activePpu->mem[location] = (PpWord)activePpu->regA & Mask12;
+    activePpu->regA = ppSubtract18(activePpu->mem[ppActive.location] & Mask12, 1);
+    activePpu->mem[ppActive.location] = (PpWord)activePpu->regA & Mask12;
     }
 
-static void ppOpCRD(void)     // 60
+ForceInline void ppOpCRDModel(ModelFeatures mf)     // 60
     {
     CpWord data;
 
-    if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
+    if ((activePpu->regA & Sign18) != 0 && ModelHas(mf, HasRelocationReg))
         {
         cpuPpReadMem(activePpu->regR + (activePpu->regA & Mask17), &data);
         }
@@ -955,47 +1231,44 @@ static void ppOpCRD(void)     // 60
         cpuPpReadMem(activePpu->regA & Mask18, &data);
         }
 
-    activePpu->mem[opD++ & Mask12] = (PpWord)((data >> 48) & Mask12);
-    activePpu->mem[opD++ & Mask12] = (PpWord)((data >> 36) & Mask12);
-    activePpu->mem[opD++ & Mask12] = (PpWord)((data >> 24) & Mask12);
-    activePpu->mem[opD++ & Mask12] = (PpWord)((data >> 12) & Mask12);
-    activePpu->mem[opD   & Mask12] = (PpWord)((data      ) & Mask12);
+    activePpu->mem[ppActive.opD++ & Mask12] = (PpWord)((data >> 48) & Mask12);
+    activePpu->mem[ppActive.opD++ & Mask12] = (PpWord)((data >> 36) & Mask12);
+    activePpu->mem[ppActive.opD++ & Mask12] = (PpWord)((data >> 24) & Mask12);
+    activePpu->mem[ppActive.opD++ & Mask12] = (PpWord)((data >> 12) & Mask12);
+    activePpu->mem[ppActive.opD   & Mask12] = (PpWord)((data      ) & Mask12);
     }
 
-static void ppOpCRM(void)     // 61
+static void ppOpCRD(void)     // 60
     {
-    CpWord data;
+    ppOpCRDModel(features);
+    }
 
+ForceInline void ppOpCRMModel(ModelFeatures mf)     // 61
+    {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->regQ = activePpu->mem[opD] & Mask12;
+        activePpu->opF = ppActive.opF;
+        activePpu->regQ = activePpu->mem[ppActive.opD] & Mask12;
 
         activePpu->busy = TRUE;
 
         activePpu->mem[0] = activePpu->regP;
         activePpu->regP = activePpu->mem[activePpu->regP] & Mask12;
-        }
 
-    if (activePpu->regQ--)
-        {
-        if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
-            {
-            cpuPpReadMem(activePpu->regR + (activePpu->regA & Mask17), &data);
-            }
-        else
+        if (ppBlockTransfer && activePpu->regQ != 0)
             {
-            cpuPpReadMem(activePpu->regA & Mask18, &data);
+            ppCmReadBlockModel(mf);
             }
+        }
 
-        activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 48) & Mask12);
-        activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 36) & Mask12);
-        activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 24) & Mask12);
-        activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data >> 12) & Mask12);
-        activePpu->mem[activePpu->regP++ & Mask12] = (PpWord)((data      ) & Mask12);
+    if (ppCmBlockDelay())
+        {
+        return;
+        }
 
-        activePpu->regA += 1;
-        activePpu->regA &= Mask18;
+    if (activePpu->regQ--)
+        {
+        ppCmReadWordModel(mf);
         }
 
     if (activePpu->regQ == 0)
@@ -1006,25 +1279,30 @@ static void ppOpCRM(void)     // 61
         }
     }
 
-static void ppOpCWD(void)     // 62
+static void ppOpCRM(void)     // 61
+    {
+    ppOpCRMModel(features);
+    }
+
+ForceInline void ppOpCWDModel(ModelFeatures mf)     // 62
     {
     CpWord data;
 
-    data  = activePpu->mem[opD++ & Mask12] & Mask12;
+    data  = activePpu->mem[ppActive.opD++ & Mask12] & Mask12;
     data <<= 12;
 
-    data |= activePpu->mem[opD++ & Mask12] & Mask12;
+    data |= activePpu->mem[ppActive.opD++ & Mask12] & Mask12;
     data <<= 12;
 
-    data |= activePpu->mem[opD++ & Mask12] & Mask12;
+    data |= activePpu->mem[ppActive.opD++ & Mask12] & Mask12;
     data <<= 12;
 
-    data |= activePpu->mem[opD++ & Mask12] & Mask12;
+    data |= activePpu->mem[ppActive.opD++ & Mask12] & Mask12;
     data <<= 12;
 
-    data |= activePpu->mem[opD   & Mask12] & Mask12;
+    data |= activePpu->mem[ppActive.opD   & Mask12] & Mask12;
 
-    if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
+    if ((activePpu->regA & Sign18) != 0 && ModelHas(mf, HasRelocationReg))
         {
         cpuPpWriteMem(activePpu->regR + (activePpu->regA & Mask17), data);
         }
@@ -1034,48 +1312,37 @@ static void ppOpCWD(void)     // 62
         }
     }
 
-static void ppOpCWM(void)     // 63
+static void ppOpCWD(void)     // 62
     {
-    CpWord data;
+    ppOpCWDModel(features);
+    }
 
+ForceInline void ppOpCWMModel(ModelFeatures mf)     // 63
+    {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->regQ = activePpu->mem[opD] & Mask12;
+        activePpu->opF = ppActive.opF;
+        activePpu->regQ = activePpu->mem[ppActive.opD] & Mask12;
 
         activePpu->busy = TRUE;
 
         activePpu->mem[0] = activePpu->regP;
         activePpu->regP = activePpu->mem[activePpu->regP] & Mask12;
-        }
-
-    if (activePpu->regQ--)
-        {
-        data  = activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
-        data <<= 12;
-
-        data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
-        data <<= 12;
-
-        data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
-        data <<= 12;
-
-        data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
-        data <<= 12;
 
-        data |= activePpu->mem[activePpu->regP++ & Mask12] & Mask12;
-
-        if ((activePpu->regA & Sign18) != 0 && (features & HasRelocationReg) != 0)
+        if (ppBlockTransfer && activePpu->regQ != 0)
             {
-            cpuPpWriteMem(activePpu->regR + (activePpu->regA & Mask17), data);
-            }
-        else
-            {
-            cpuPpWriteMem(activePpu->regA & Mask18, data);
+            ppCmWriteBlockModel(mf);
             }
+        }
 
-        activePpu->regA += 1;
-        activePpu->regA &= Mask18;
+    if (ppCmBlockDelay())
+        {
+        return;
+        }
+
+    if (activePpu->regQ--)
+        {
+        ppCmWriteWordModel(mf);
         }
 
     if (activePpu->regQ == 0)
@@ -1086,42 +1353,47 @@ static void ppOpCWM(void)     // 63
         }
     }
 
+static void ppOpCWM(void)     // 63
+    {
+    ppOpCWMModel(features);
+    }
+
 static void ppOpAJM(void)     // 64
     {
-    location = activePpu->mem[activePpu->regP];
-    location &= Mask12;
+    ppActive.location = activePpu->mem[activePpu->regP];
+    ppActive.location &= Mask12;
     PpIncrement(activePpu->regP);
 
-    if (   (opD & 040) != 0
+    if (   (ppActive.opD & 040) != 0
         && (features & HasChannelFlag) != 0)
         {
         /*
         **  SCF.
         */
-        opD &= 037;
-        if (opD < channelCount)
+        ppActive.opD &= 037;
+        if (ppActive.opD < channelCount)
             {
-            if (channel[opD].flag)
+            if (channel[ppActive.opD].flag)
                 {
-                activePpu->regP = location;
+                activePpu->regP = ppActive.location;
                 }
             else
                 {
-                channel[opD].flag = TRUE;
+                channel[ppActive.opD].flag = TRUE;
                 }
             }
 
         return;
         }
 
-    opD &= 037;
-    if (opD < channelCount)
+    ppActive.opD &= 037;
+    if (ppActive.opD < channelCount)
         {
-        activeChannel = channel + opD;
+        activeChannel = channel + ppActive.opD;
         channelCheckIfActive();
         if (activeChannel->active)
             {
-            activePpu->regP = location;
+            activePpu->regP = ppActive.location;
             }
         }
 
@@ -1129,48 +1401,48 @@ static void ppOpAJM(void)     // 64
 
 static void ppOpIJM(void)     // 65
     {
-    location = activePpu->mem[activePpu->regP];
-    location &= Mask12;
+    ppActive.location = activePpu->mem[activePpu->regP];
+    ppActive.location &= Mask12;
     PpIncrement(activePpu->regP);
 
-    if (   (opD & 040) != 0
+    if (   (ppActive.opD & 040) != 0
         && (features & HasChannelFlag) != 0)
         {
         /*
         **  CCF.
         */
-        opD &= 037;
-        if (opD < channelCount)
+        ppActive.opD &= 037;
+        if (ppActive.opD < channelCount)
             {
-            channel[opD].flag = FALSE;
+            channel[ppActive.opD].flag = FALSE;
             }
 
         return;
         }
 
-    opD &= 037;
-    if (opD >= channelCount)
+    ppActive.opD &= 037;
+    if (ppActive.opD >= channelCount)
         {
-        activePpu->regP = location;
+        activePpu->regP = ppActive.location;
         }
     else
         {
-        activeChannel = channel + opD;
+        activeChannel = channel + ppActive.opD;
         channelCheckIfActive();
         if (!activeChannel->active)
             {
-            activePpu->regP = location;
+            activePpu->regP = ppActive.location;
             }
         }
     }
 
 static void ppOpFJM(void)     // 66
     {
-    location = activePpu->mem[activePpu->regP];
-    location &= Mask12;
+    ppActive.location = activePpu->mem[activePpu->regP];
+    ppActive.location &= Mask12;
     PpIncrement(activePpu->regP);
 
-    if (   (opD & 040) != 0
+    if (   (ppActive.opD & 040) != 0
         && (features & HasErrorFlag) != 0)
         {
         /*
@@ -1179,53 +1451,53 @@ static void ppOpFJM(void)     // 66
         return;
         }
 
-    opD &= 037;
-    if (opD < channelCount)
+    ppActive.opD &= 037;
+    if (ppActive.opD < channelCount)
         {
-        activeChannel = channel + opD;
+        activeChannel = channel + ppActive.opD;
         channelIo();
         channelCheckIfFull();
         if (activeChannel->full)
             {
-            activePpu->regP = location;
+            activePpu->regP = ppActive.location;
             }
         }
     }
 
 static void ppOpEJM(void)     // 67
     {
-    location = activePpu->mem[activePpu->regP];
-    location &= Mask12;
+    ppActive.location = activePpu->mem[activePpu->regP];
+    ppActive.location &= Mask12;
     PpIncrement(activePpu->regP);
 
-    if (   (opD & 040) != 0
+    if (   (ppActive.opD & 040) != 0
         && (features & HasErrorFlag) != 0)
         {
         /*
         **  CFM - we never have errors, so we always jump.
         */
-        opD &= 037;
-        if (opD < channelCount)
+        ppActive.opD &= 037;
+        if (ppActive.opD < channelCount)
             {
-            activePpu->regP = location;
+            activePpu->regP = ppActive.location;
             }
 
         return;
         }
 
-    opD &= 037;
-    if (opD >= channelCount)
+    ppActive.opD &= 037;
+    if (ppActive.opD >= channelCount)
         {
-        activePpu->regP = location;
+        activePpu->regP = ppActive.location;
         }
     else
         {
-        activeChannel = channel + opD;
+        activeChannel = channel + ppActive.opD;
         channelIo();
         channelCheckIfFull();
         if (!activeChannel->full)
             {
-            activePpu->regP = location;
+            activePpu->regP = ppActive.location;
             }
         }
     }
@@ -1234,8 +1506,8 @@ static void ppOpIAN(void)     // 70
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         activeChannel->delayStatus = 0;
         }
 
@@ -1273,6 +1545,7 @@ static void ppOpIAN(void)     // 70
         channelIn();
         channelSetEmpty();
         activePpu->regA = activeChannel->data & Mask12;
+        activePpu->ioWords += 1;
         activeChannel->inputPending = FALSE;
         if (activeChannel->discAfterInput)
             {
@@ -1290,8 +1563,8 @@ static void ppOpIAM(void)     // 71
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
 
         activeChannel = channel + (activePpu->opD & 037);
         activePpu->busy = TRUE;
@@ -1352,6 +1625,7 @@ static void ppOpIAM(void)     // 71
         activePpu->mem[activePpu->regP] = activeChannel->data & Mask12;
         activePpu->regP = (activePpu->regP + 1) & Mask12;
         activePpu->regA = (activePpu->regA - 1) & Mask18;
+        activePpu->ioWords += 1;
         activeChannel->inputPending = FALSE;
 
         if (activeChannel->discAfterInput)
@@ -1381,8 +1655,8 @@ static void ppOpOAN(void)     // 72
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         activeChannel->delayStatus = 0;
         }
 
@@ -1406,6 +1680,7 @@ static void ppOpOAN(void)     // 72
         activeChannel->data = (PpWord)activePpu->regA & Mask12;
         channelOut();
         channelSetFull();
+        activePpu->ioWords += 1;
         activePpu->busy = FALSE;
         }
 
@@ -1419,8 +1694,8 @@ static void ppOpOAM(void)     // 73
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
 
         activeChannel = channel + (activePpu->opD & 037);
         activePpu->busy = TRUE;
@@ -1466,6 +1741,7 @@ static void ppOpOAM(void)     // 73
         activeChannel->data = activePpu->mem[activePpu->regP] & Mask12;
         activePpu->regP = (activePpu->regP + 1) & Mask12;
         activePpu->regA = (activePpu->regA - 1) & Mask18;
+        activePpu->ioWords += 1;
         channelOut();
         channelSetFull();
 
@@ -1487,8 +1763,8 @@ static void ppOpACN(void)     // 74
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         }
 
     noHang = (activePpu->opD & 040) != 0;
@@ -1512,8 +1788,8 @@ static void ppOpDCN(void)     // 75
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         }
 
     noHang = (activePpu->opD & 040) != 0;
@@ -1555,8 +1831,8 @@ static void ppOpFAN(void)     // 76
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         }
 
     noHang = (activePpu->opD & 040) != 0;
@@ -1588,8 +1864,8 @@ static void ppOpFNC(void)     // 77
     {
     if (!activePpu->busy)
         {
-        activePpu->opF = opF;
-        activePpu->opD = opD;
+        activePpu->opF = ppActive.opF;
+        activePpu->opD = ppActive.opD;
         }
 
     noHang = (activePpu->opD & 040) != 0;
@@ -1618,4 +1894,129 @@ static void ppOpFNC(void)     // 77
     activePpu->busy = FALSE;
     }
 
+/*
+**  CM access opcodes compiled for each model. The relocation register
+**  tests fold to constants.
+*/
+#define PpModelCore(model, mf)                                              \
+    static void ppOpCRD##model(void)  { ppOpCRDModel(mf); }                 \
+    static void ppOpCRM##model(void)  { ppOpCRMModel(mf); }                 \
+    static void ppOpCWD##model(void)  { ppOpCWDModel(mf); }                 \
+    static void ppOpCWM##model(void)  { ppOpCWMModel(mf); }
+
+#define PpCoreEntry(model)                                                  \
+    { { ppOpCRD##model, ppOpCRM##model, ppOpCWD##model, ppOpCWM##model } }
+
+PpModelCore(Model6400, Features6400)
+PpModelCore(ModelCyber73, FeaturesCyber73)
+PpModelCore(ModelCyber173, FeaturesCyber173)
+PpModelCore(ModelCyber175, FeaturesCyber175)
+PpModelCore(ModelCyber840A, FeaturesCyber840A)
+PpModelCore(ModelCyber865, FeaturesCyber865)
+
+/*
+**  Indexed by ModelType.
+*/
+static PpCore ppCores[] =
+    {
+    PpCoreEntry(Model6400),
+    PpCoreEntry(ModelCyber73),
+    PpCoreEntry(ModelCyber173),
+    PpCoreEntry(ModelCyber175),
+    PpCoreEntry(ModelCyber840A),
+    PpCoreEntry(ModelCyber865),
+    };
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read the PP registers and memory from the PPM backing
+**                  file.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if all PPs were read, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool ppReadStore(void)
+    {
+    PpStore store;
+    PpSlot *slot;
+    u8 i;
+
+    for (i = 0, slot = ppu; i < ppuCount; i++, slot++)
+        {
+        if (fread(&store, sizeof(store), 1, ppHandle) != 1)
+            {
+            return(FALSE);
+            }
+
+        slot->regA = store.regA;
+        slot->regR = store.regR;
+        slot->regP = store.regP;
+        slot->regQ = store.regQ;
+        slot->busy = store.busy;
+        slot->opF = store.opF;
+        slot->opD = store.opD;
+        memcpy(slot->mem, store.mem, sizeof(slot->mem));
+        }
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the PP registers and memory to the PPM backing
+**                  file.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if all PPs were written, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool ppWriteStore(void)
+    {
+    PpStore store;
+    PpSlot *slot;
+    u8 i;
+
+    memset(&store, 0, sizeof(store));
+
+    for (i = 0, slot = ppu; i < ppuCount; i++, slot++)
+        {
+        store.regA = slot->regA;
+        store.regR = slot->regR;
+        store.regP = slot->regP;
+        store.regQ = slot->regQ;
+        store.busy = slot->busy;
+        store.id = slot->id;
+        store.opF = slot->opF;
+        store.opD = slot->opD;
+        memcpy(store.mem, slot->mem, sizeof(store.mem));
+
+        if (fwrite(&store, sizeof(store), 1, ppHandle) != 1)
+            {
+            return(FALSE);
+            }
+        }
+
+    return(TRUE);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Select the CM access opcodes compiled for a model.
+**
+**  Parameters:     Name        Description.
+**                  model       configured model
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void ppSelectCore(ModelType model)
+    {
+    int i;
+
+    for (i = 0; i < 4; i++)
+        {
+        decodePpuOpcode[060 + i] = ppCores[model].cmOps[i];
+        }
+    }
+
 /*---------------------------  End Of File  ------------------------------*/
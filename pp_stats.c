@@ -0,0 +1,313 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: pp_stats.c
+**
+**  Description:
+**      Profile the PP programs which run in the PPs. The program name is
+**      taken from the input register of each PP in the PP communication
+**      area in central memory. PP cycles, channel words and calls are
+**      accumulated per program name and can be displayed by the operator.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxPpStats          256
+#define PpStatsPeriod       16      /* major cycles between samples (power of 2) */
+#define PpCommAreaSize      010     /* words per PP in communication area */
+#define OtherName           0xFFFFFFFF
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct ppStats
+    {
+    u32             name;               /* program name in display code, 0 if idle */
+    u32             calls;              /* times the program was started */
+    u64             cycles;             /* PP cycles spent in program */
+    u64             ioWords;            /* channel words transferred */
+    } PpStats;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static PpStats *ppStatsFind(u32 name);
+static int ppStatsCompare(const void *e1, const void *e2);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+u32 ppStatsCommArea = 050;
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**  The last entry collects the programs which did not fit.
+*/
+static PpStats stats[MaxPpStats + 1];
+static int statsCount = 0;
+static u32 ppName[MaxPpus];
+static PpStats *current[MaxPpus];
+static u32 lastIoWords[MaxPpus];
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Sample the program running in each PP.
+**
+**                  Called every major cycle, but only looks at the input
+**                  registers every PpStatsPeriod cycles. A program which
+**                  starts and ends between two samples is not seen.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void ppStatsSample(void)
+    {
+    PpStats *sp;
+    u32 address;
+    u32 name;
+    u8 i;
+
+    if ((cycles & (PpStatsPeriod - 1)) != 0)
+        {
+        return;
+        }
+
+    for (i = 0, address = ppStatsCommArea; i < ppuCount; i++, address += PpCommAreaSize)
+        {
+        if (address >= cpuMaxMemory)
+            {
+            break;
+            }
+
+        name = (u32)((cpMem[address] >> 42) & Mask18);
+        sp = current[i];
+        if (sp == NULL || name != ppName[i])
+            {
+            sp = ppStatsFind(name);
+            if (name != 0)
+                {
+                sp->calls += 1;
+                }
+
+            ppName[i] = name;
+            current[i] = sp;
+            }
+
+        sp->cycles += PpStatsPeriod;
+        sp->ioWords += ppu[i].ioWords - lastIoWords[i];
+        lastIoWords[i] = ppu[i].ioWords;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Show PP programs ranked by PP cycles on the operator
+**                  console.
+**
+**  Parameters:     Name        Description.
+**                  lines       maximum number of programs to show, 0 for all
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void ppStatsShow(int lines)
+    {
+    static PpStats table[MaxPpStats + 1];
+    PpStats *sp;
+    u64 totalCycles = 0;
+    int count;
+    int i;
+
+    count = statsCount;
+    memcpy(table, stats, count * sizeof(PpStats));
+    if (stats[MaxPpStats].cycles != 0)
+        {
+        table[count] = stats[MaxPpStats];
+        table[count++].name = OtherName;
+        }
+
+    for (i = 0, sp = table; i < count; i++, sp++)
+        {
+        totalCycles += sp->cycles;
+        }
+
+    qsort(table, count, sizeof(PpStats), ppStatsCompare);
+
+    if (lines <= 0 || lines > count)
+        {
+        lines = count;
+        }
+
+    printf("%-6s %10s %14s %6s %12s %10s\n", "Name", "Calls", "Cycles", "%PP", "IoWords", "Cyc/Call");
+    for (i = 0, sp = table; i < lines; i++, sp++)
+        {
+        if (sp->name == OtherName)
+            {
+            printf("%-6s", "other");
+            }
+        else if (sp->name == 0)
+            {
+            printf("%-6s", "idle");
+            }
+        else
+            {
+            printf("%c%c%c   ",
+                cdcToAscii[(sp->name >> 12) & Mask6],
+                cdcToAscii[(sp->name >>  6) & Mask6],
+                cdcToAscii[(sp->name >>  0) & Mask6]);
+            }
+
+        printf(" %10u %14.0f %6.1f %12.0f %10.0f\n",
+            sp->calls,
+            (double)sp->cycles,
+            totalCycles == 0 ? 0.0 : (double)sp->cycles * 100.0 / (double)totalCycles,
+            (double)sp->ioWords,
+            sp->calls == 0 ? 0.0 : (double)sp->cycles / (double)sp->calls);
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Clear the profile.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void ppStatsReset(void)
+    {
+    memset(stats, 0, sizeof(stats));
+    memset(current, 0, sizeof(current));
+    statsCount = 0;
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find or create the entry of a PP program.
+**
+**  Parameters:     Name        Description.
+**                  name        program name in display code
+**
+**  Returns:        Pointer to entry.
+**
+**------------------------------------------------------------------------*/
+static PpStats *ppStatsFind(u32 name)
+    {
+    PpStats *sp = stats;
+    int i;
+
+    for (i = 0; i < statsCount; i++, sp++)
+        {
+        if (sp->name == name)
+            {
+            return(sp);
+            }
+        }
+
+    if (statsCount == MaxPpStats)
+        {
+        /*
+        **  Table full - account to the overflow entry.
+        */
+        return(sp);
+        }
+
+    memset(sp, 0, sizeof(PpStats));
+    sp->name = name;
+    statsCount += 1;
+
+    return(sp);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two entries by descending PP cycles.
+**
+**  Parameters:     Name        Description.
+**                  e1          first entry
+**                  e2          second entry
+**
+**  Returns:        Sort order.
+**
+**------------------------------------------------------------------------*/
+static int ppStatsCompare(const void *e1, const void *e2)
+    {
+    const PpStats *s1 = e1;
+    const PpStats *s2 = e2;
+
+    if (s1->cycles > s2->cycles)
+        {
+        return(-1);
+        }
+
+    if (s1->cycles < s2->cycles)
+        {
+        return(1);
+        }
+
+    return(0);
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
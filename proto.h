@@ -50,6 +50,7 @@ void rtcTick(void);
 void rtcStartTimer(void);
 double rtcStopTimer(void);
 void rtcReadUsCounter(void);
+void rtcVirtualStep(void);
 
 /*
 **  channel.c
@@ -80,15 +81,66 @@ void ppStep(void);
 /*
 **  cpu.c
 */
-void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType);
+void cpuInit(char *model, u32 memory, u32 emBanks, ExtMemory emType, u8 numCpus);
 void cpuTerminate(void);
 u32 cpuGetP(void);
 bool cpuExchangeJump(u32 addr);
 void cpuStep(void);
 bool cpuEcsFlagRegister(u32 ecsAddress);
-bool cpuDdpTransfer(u32 ecsAddress, CpWord *data, bool writeToEcs);
+void cpuPpExchangeJump(u8 cpuNum, u32 addr);
+void cpuPpMonitorExchangeJump(u8 cpuNum, u32 addr, bool useMa);
+u32 cpuDdpBlockTransfer(u32 ecsAddress, CpWord *data, u32 count, bool writeToEcs);
+void cpuHold(bool hold);
+void cpuSample(u8 cpuNum, CpuContext *copy);
+void cpuClone(void);
 void cpuPpReadMem(u32 address, CpWord *data);
 void cpuPpWriteMem(u32 address, CpWord data);
+#if CcCoSim == 1
+void cpuCoSimStep(void);
+#endif
+
+/*
+**  cpu_stats.c
+*/
+void cpuStatsInit(void);
+void cpuStatsExchange(CpuContext *cc, u32 xpAddress);
+void cpuStatsCheck(void);
+void cpuStatsShow(void);
+void cpuStatsTop(u16 interval);
+
+/*
+**  pp_stats.c
+*/
+void ppStatsSample(void);
+void ppStatsShow(int lines);
+void ppStatsReset(void);
+
+/*
+**  perf_stats.c
+*/
+void perfStatsStart(void);
+void perfStatsShow(void);
+void perfStatsStop(void);
+
+/*
+**  memory.c
+*/
+void *memAlloc(size_t size, char *name);
+void memFree(void *addr, size_t size);
+void *memAllocAligned(size_t size);
+void memFreeAligned(void *addr);
+
+/*
+**  thread.c
+*/
+int threadRegister(char *name, char *cores, char *policy, int level);
+void threadSetup(char *name);
+int threadNumaNode(void);
+
+/*
+**  clone.c
+*/
+void cloneSystem(char *dir);
 
 /*
 **  mt362x.c
@@ -189,12 +241,15 @@ void ddpInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 **  mux6676.c
 */
 void mux6676Init(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
+void mux6676Clone(u16 portOffset);
 
 /*
 **  npu.c
 */
 void npuInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 int npuBipBufCount(void);
+void npuStatsShow(void);
+void npuNetClone(u16 portOffset);
 
 /*
 **  pci_channel_{win32,linux}.c
@@ -210,6 +265,7 @@ void pciConsoleInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
 **  tpmux.c
 */
 void tpMuxInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName);
+void tpMuxClone(u16 portOffset);
 
 /*
 **  maintenance_channel.c
@@ -241,6 +297,7 @@ void traceCpuPrint(char *str);
 void traceChannel(u8 ch);
 void traceEnd(void);
 void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress);
+void traceCpuFile(FILE *f, u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress);
 void traceExchange(CpuContext *cc, u32 addr, char *title);
 
 /*
@@ -283,6 +340,7 @@ void windowQueue(u8 ch);
 void windowUpdate(void);
 void windowGetChar(void);
 void windowTerminate(void);
+void windowClone(void);
 
 /*
 **  operator.c
@@ -306,16 +364,23 @@ extern bool emulationActive;
 extern PpSlot *ppu;
 extern ChSlot *channel;
 extern u8 ppuCount;
+extern bool ppBlockTransfer;
 extern u8 channelCount;
-extern PpSlot *activePpu;
+extern u32 channelFunctions;
+extern PpDecode ppActive;
+#define activePpu (ppActive.ppu)
 extern ChSlot *activeChannel;
 extern DevSlot *activeDevice;
 extern DevSlot *active3000Device;
-extern CpuContext cpu;
-extern bool cpuStopped;
+extern CpuContext *cpus;
+extern u8 cpuCount;
+extern ThreadLocal CpuContext *activeCpu;
 extern CpWord *cpMem;
 extern u32 cpuMaxMemory;
 extern u32 extMaxMemory;
+#if CcCoSim == 1
+extern u32 cpuCoSimInterval;
+#endif
 extern char ppKeyIn;
 extern const u8 asciiToCdc[256];
 extern const char cdcToAscii[64];
@@ -328,6 +393,8 @@ extern const char bcdToAscii[64];
 extern const char extBcdToAscii[64];
 extern const i8 asciiToPlato[128];
 extern const i8 altKeyToPlato[128];
+extern const u8 asciiToEbcdic[128];
+extern const u8 ebcdicToAscii[256];
 extern u32 traceMask;
 extern u32 traceSequenceNo;
 extern DevDesc deviceDesc[];
@@ -338,9 +405,11 @@ extern u16 mux6676TelnetPort;
 extern u16 mux6676TelnetConns;
 extern u32 cycles;
 extern u32 rtcClock;
+extern bool rtcVirtualTime;
 extern ModelFeatures features;
 extern ModelType modelType;
 extern char persistDir[];
+extern char ecsSharedName[];
 extern char printDir[];			//drs
 extern char printApp[];			//drs
 extern long autoRemovePaper;	//drs
@@ -349,6 +418,14 @@ extern char autoYearString[10];
 extern bool autoDate;			//drs
 extern u16 npuNetTelnetPort;
 extern u16 npuNetTcpConns;
+extern char npuStatsFile[256];
+extern u16 npuStatsInterval;
+extern char cpuStatsFile[256];
+extern u16 cpuStatsInterval;
+extern u32 ppStatsCommArea;
+extern u16 clonePortOffset;
+extern u8 memHugePages;
+extern int memNumaNode;
 
 #endif /* PROTO_H */
 /*---------------------------  End Of File  ------------------------------*/
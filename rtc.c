@@ -48,6 +48,14 @@
 **  Private Constants
 **  -----------------
 */
+#define RtcSampleCycles     0200    /* major cycles per idle sample period */
+#define RtcCpuSampleCycles  010     /* major cycles between CPU samples */
+#define RtcIdlePeriods      8       /* quiet sample periods before time is advanced */
+#define RtcIdleLoop         8       /* maximum words in a CPU idle loop */
+#define RtcPpIdleLoop       0200    /* maximum words in a PP wait loop */
+#define RtcMaxWarp          01777   /* clock advance between two clock reads of a PP */
+#define RtcReadRecent       010000  /* major cycles a PP counts as reading the clock */
+#define RtcUsPerCycle       10      /* microseconds per major cycle of skipped time */
 
 /*
 **  -----------------------
@@ -70,6 +78,8 @@ static FcStatus rtcFunc(PpWord funcCode);
 static void rtcIo(void);
 static void rtcActivate(void);
 static void rtcDisconnect(void);
+static void rtcVirtualRead(void);
+static bool rtcVirtualSample(void);
 static bool rtcInitTick (void);
 static u64 rtcGetTick(void);
 
@@ -79,6 +89,7 @@ static u64 rtcGetTick(void);
 **  ----------------
 */
 u32 rtcClock = 0;
+bool rtcVirtualTime = FALSE;
 
 
 /*
@@ -94,6 +105,26 @@ static double MHz;
 static u64 startTime;
 #endif
 
+/*
+**  Virtual time state. The idle windows are reset every sample period,
+**  the clock read intervals are kept for the current and the previous
+**  period.
+*/
+static u32 virtualSteps = 0;
+static u32 quietPeriods = 0;
+static bool periodQuiet = TRUE;
+static bool systemIdle = FALSE;
+static u32 lastFunctions = 0;
+static u32 loopRa[MaxCpus];
+static u32 loopP[MaxCpus];
+static u32 loopLow[MaxCpus];
+static u32 loopHigh[MaxCpus];
+static PpWord ppLow[MaxPpus];
+static PpWord ppHigh[MaxPpus];
+static u32 ppReadStep[MaxPpus];
+static u32 ppReadGap[MaxPpus];
+static u32 ppLastGap[MaxPpus];
+
 
 /*
 **--------------------------------------------------------------------------
@@ -267,6 +298,77 @@ void rtcReadUsCounter(void)
     rtcClock += (u32)result;
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Advance time while the system is idle.
+**
+**                  The system is idle when, for RtcIdlePeriods sample
+**                  periods, no PP has issued a function to a device other
+**                  than the console, every PP has stayed in a wait loop
+**                  and every CPU has been stopped or looping within a few
+**                  words of the system idle package. That package runs
+**                  in monitor mode or with RA 0; a job never does, so a
+**                  compute bound job in a tight loop does not count as
+**                  idle.
+**
+**                  The pending timers of an idle system are the deadlines
+**                  of the PP wait loops, held in PP memory and checked
+**                  against the 12-bit clock channel, so their expiry
+**                  can't be computed here. Instead the clock is moved on
+**                  as far as every PP reading it can still tell elapsed
+**                  time: by RtcMaxWarp over the longest interval between
+**                  two reads of any such PP, so each wait loop sees time
+**                  jump by up to RtcMaxWarp per read and no read sees the
+**                  channel wrap. The major cycle count follows the clock.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rtcVirtualStep(void)
+    {
+    u32 gap = 1;
+    u32 step;
+    u8 i;
+
+    virtualSteps += 1;
+
+    if (!rtcVirtualSample())
+        {
+        return;
+        }
+
+    /*
+    **  Find the PP reading the clock least often.
+    */
+    for (i = 0; i < ppuCount; i++)
+        {
+        if (virtualSteps - ppReadStep[i] >= RtcReadRecent)
+            {
+            continue;
+            }
+
+        if (gap < ppReadGap[i])
+            {
+            gap = ppReadGap[i];
+            }
+
+        if (gap < ppLastGap[i])
+            {
+            gap = ppLastGap[i];
+            }
+
+        if (gap < virtualSteps - ppReadStep[i])
+            {
+            gap = virtualSteps - ppReadStep[i];
+            }
+        }
+
+    step = RtcMaxWarp / gap;
+    rtcClock += step;
+    cycles += step / RtcUsPerCycle;
+    }
+
 /*
 **--------------------------------------------------------------------------
 **
@@ -302,6 +404,11 @@ static FcStatus rtcFunc(PpWord funcCode)
 static void rtcIo(void)
     {
     rtcReadUsCounter();
+    if (rtcVirtualTime)
+        {
+        rtcVirtualRead();
+        }
+
     activeChannel->full = rtcFull;
     activeChannel->data = (PpWord)rtcClock & Mask12;
     }
@@ -408,4 +515,174 @@ static bool rtcInitTick(void)
 
 #endif
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Record a clock read of the active PP for virtual time.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void rtcVirtualRead(void)
+    {
+    u8 i = (u8)(activePpu - ppu);
+    u32 gap;
+
+    gap = virtualSteps - ppReadStep[i];
+    if (gap > RtcReadRecent)
+        {
+        gap = RtcReadRecent;
+        }
+
+    if (ppReadGap[i] < gap)
+        {
+        ppReadGap[i] = gap;
+        }
+
+    ppReadStep[i] = virtualSteps;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Sample the PPs and CPUs to find out whether the system
+**                  is idle.
+**
+**                  The PP program counters are sampled every major cycle.
+**                  The CPUs run in their own threads in a multiprocessor,
+**                  so they are sampled under their mutex every
+**                  RtcCpuSampleCycles. At the end of each sample period
+**                  the loop windows start afresh, so a PP or CPU which
+**                  wanders through a wide range of addresses slowly is
+**                  not taken for waiting.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        TRUE if the system is idle, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool rtcVirtualSample(void)
+    {
+    CpuContext cc;
+    PpWord pp;
+    u8 i;
+
+    if (channelFunctions != lastFunctions)
+        {
+        lastFunctions = channelFunctions;
+        periodQuiet = FALSE;
+        systemIdle = FALSE;
+        }
+
+    for (i = 0; i < ppuCount; i++)
+        {
+        pp = ppu[i].regP;
+        if (pp < ppLow[i])
+            {
+            ppLow[i] = pp;
+            }
+
+        if (pp > ppHigh[i])
+            {
+            ppHigh[i] = pp;
+            }
+
+        if (ppHigh[i] - ppLow[i] >= RtcPpIdleLoop)
+            {
+            /*
+            **  PP is running a program rather than waiting.
+            */
+            periodQuiet = FALSE;
+            systemIdle = FALSE;
+            }
+        }
+
+    if ((virtualSteps % RtcCpuSampleCycles) == 0)
+        {
+        for (i = 0; i < cpuCount; i++)
+            {
+            cpuSample(i, &cc);
+            if (cc.isStopped)
+                {
+                continue;
+                }
+
+            loopP[i] = cc.regP;
+            if (cc.regRaCm != 0 && !cc.monitorMode)
+                {
+                /*
+                **  A job is running.
+                */
+                loopRa[i] = cc.regRaCm;
+                periodQuiet = FALSE;
+                systemIdle = FALSE;
+                continue;
+                }
+
+            if (cc.regRaCm != loopRa[i])
+                {
+                loopRa[i] = cc.regRaCm;
+                loopLow[i] = cc.regP;
+                loopHigh[i] = cc.regP;
+                periodQuiet = FALSE;
+                systemIdle = FALSE;
+                continue;
+                }
+
+            if (cc.regP < loopLow[i])
+                {
+                loopLow[i] = cc.regP;
+                }
+
+            if (cc.regP > loopHigh[i])
+                {
+                loopHigh[i] = cc.regP;
+                }
+
+            if (loopHigh[i] - loopLow[i] >= RtcIdleLoop)
+                {
+                periodQuiet = FALSE;
+                systemIdle = FALSE;
+                }
+            }
+        }
+
+    if ((virtualSteps % RtcSampleCycles) != 0)
+        {
+        return(systemIdle);
+        }
+
+    /*
+    **  End of a sample period - reset the windows and clock read intervals.
+    */
+    for (i = 0; i < ppuCount; i++)
+        {
+        ppLow[i] = ppu[i].regP;
+        ppHigh[i] = ppu[i].regP;
+        ppLastGap[i] = ppReadGap[i];
+        ppReadGap[i] = 0;
+        }
+
+    for (i = 0; i < cpuCount; i++)
+        {
+        loopLow[i] = loopP[i];
+        loopHigh[i] = loopP[i];
+        }
+
+    if (periodQuiet)
+        {
+        if (quietPeriods < RtcIdlePeriods)
+            {
+            quietPeriods += 1;
+            }
+        }
+    else
+        {
+        quietPeriods = 0;
+        }
+
+    systemIdle = quietPeriods >= RtcIdlePeriods;
+    periodQuiet = TRUE;
+
+    return(systemIdle);
+    }
+
 /*---------------------------  End Of File  ------------------------------*/
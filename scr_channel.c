@@ -365,7 +365,7 @@ static void scrExecute(PpWord func)
         break;
 
     case 020:
-        if (cpuStopped)
+        if (cpus[0].isStopped)
             {
             scrSetBit(scrRegister, 0300);
             }
@@ -376,7 +376,7 @@ static void scrExecute(PpWord func)
 
         scrClrBit(scrRegister, 0301);
 
-        if (cpu.monitorMode)
+        if (cpus[0].monitorMode)
             {
             scrSetBit(scrRegister, 0303);
             }
@@ -389,7 +389,7 @@ static void scrExecute(PpWord func)
 
         if (modelType == ModelCyber865)
             {
-            if ((cpu.exitMode & EmFlagExpandedAddress) != 0)
+            if ((cpus[0].exitMode & EmFlagExpandedAddress) != 0)
                 {
                 scrSetBit(scrRegister, 0312);
                 }
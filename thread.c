@@ -0,0 +1,746 @@
+/*--------------------------------------------------------------------------
+**
+**  Copyright (c) 2003-2011, Tom Hunter
+**
+**  Name: thread.c
+**
+**  Description:
+**      Place emulator threads on host cores and set their scheduling
+**      policy and priority as configured in the threads section of the
+**      startup file. Each thread applies its own settings when it starts.
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License version 3 as
+**  published by the Free Software Foundation.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License version 3 for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  version 3 along with this program in file "license-gpl-3.0.txt".
+**  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#include "const.h"
+#include "types.h"
+#include "proto.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxThreads          32
+#define MaxCores            64
+#define MaxNodes            64
+
+#define PolicyDefault       0
+#define PolicyOther         1
+#define PolicyBatch         2
+#define PolicyIdle          3
+#define PolicyFifo          4
+#define PolicyRr            5
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct threadConfig
+    {
+    char            name[16];           /* thread name */
+    u64             cores;              /* allowed cores, 0 for any */
+    int             policy;             /* scheduling policy */
+    int             level;              /* nice level or real time priority */
+    } ThreadConfig;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static bool threadParseCores(char *str, u64 *cores);
+static char *threadFormatCores(u64 cores, char *str);
+static void threadSaveOriginal(void);
+static void threadApply(ThreadConfig *tc, char *report);
+static int threadCoresNode(u64 cores);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static ThreadConfig threads[MaxThreads];
+static int threadCount = 0;
+static char *policyNames[] = { "default", "other", "batch", "idle", "fifo", "rr", NULL };
+
+/*
+**  Placement and scheduling of the process before any thread was set up.
+**  New threads inherit the settings of the thread which creates them, so
+**  threads without settings of their own are returned to these.
+*/
+static bool originalSaved = FALSE;
+#if defined(_WIN32)
+static DWORD_PTR originalCores;
+#else
+static int originalPolicy;
+static struct sched_param originalParam;
+#if defined(__linux__)
+static cpu_set_t originalSet;
+static int originalNice;
+#endif
+#endif
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Register the settings of a thread.
+**
+**  Parameters:     Name        Description.
+**                  name        thread name
+**                  cores       core list, e.g. "2", "0-3" or "1+5-7"
+**                  policy      scheduling policy name or NULL
+**                  level       nice level, or priority for fifo and rr
+**
+**  Returns:        ThreadRegOk or an error status.
+**
+**------------------------------------------------------------------------*/
+int threadRegister(char *name, char *cores, char *policy, int level)
+    {
+    ThreadConfig *tc;
+    int i;
+
+    for (i = 0; i < threadCount; i++)
+        {
+        if (strcmp(threads[i].name, name) == 0)
+            {
+            return(ThreadRegDupl);
+            }
+        }
+
+    if (threadCount == MaxThreads || strlen(name) >= sizeof(tc->name))
+        {
+        return(ThreadRegOvfl);
+        }
+
+    tc = threads + threadCount;
+    strcpy(tc->name, name);
+
+    if (!threadParseCores(cores, &tc->cores))
+        {
+        return(ThreadRegCores);
+        }
+
+    tc->policy = PolicyDefault;
+    if (policy != NULL)
+        {
+        for (i = 0; policyNames[i] != NULL; i++)
+            {
+            if (strcmp(policy, policyNames[i]) == 0)
+                {
+                break;
+                }
+            }
+
+        if (policyNames[i] == NULL)
+            {
+            return(ThreadRegPolicy);
+            }
+
+        tc->policy = i;
+        }
+
+    if (tc->policy == PolicyFifo || tc->policy == PolicyRr)
+        {
+        if (level < 1 || level > 99)
+            {
+            return(ThreadRegLevel);
+            }
+        }
+    else if (level < -20 || level > 19)
+        {
+        return(ThreadRegLevel);
+        }
+
+    tc->level = level;
+    threadCount += 1;
+
+    return(ThreadRegOk);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Apply the settings of the calling thread.
+**
+**                  Called by each emulator thread when it starts, by the
+**                  main thread before any other thread is created. Threads
+**                  without an entry, and settings left at their default,
+**                  get the placement the process had at startup rather
+**                  than the one inherited from the creating thread.
+**
+**  Parameters:     Name        Description.
+**                  name        thread name
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void threadSetup(char *name)
+    {
+    static ThreadConfig unconfigured;
+    char report[160];
+    int i;
+
+#if defined(__linux__)
+    /*
+    **  Name the thread for top and ps, but leave the process name alone.
+    */
+    if (strcmp(name, "main") != 0)
+        {
+        prctl(PR_SET_NAME, name, 0, 0, 0);
+        }
+#endif
+
+    if (threadCount == 0)
+        {
+        return;
+        }
+
+    if (!originalSaved)
+        {
+        threadSaveOriginal();
+        }
+
+    for (i = 0; i < threadCount; i++)
+        {
+        if (strcmp(threads[i].name, name) == 0)
+            {
+            threadApply(threads + i, report);
+            printf("Thread %s: %s\n", name, report);
+            return;
+            }
+        }
+
+    strcpy(unconfigured.name, "unconfigured");
+    threadApply(&unconfigured, report);
+    printf("Thread %s: not configured, %s\n", name, report);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the NUMA node the emulation runs on, so the
+**                  emulated memories can be placed next to it.
+**
+**                  The cores of cpu0 are used if configured, otherwise
+**                  those of the main thread, which runs the PPs.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Node number, -1 if the threads are not placed on the
+**                  cores of a single node.
+**
+**------------------------------------------------------------------------*/
+int threadNumaNode(void)
+    {
+    static char *homes[] = { "cpu0", "main", NULL };
+    int i;
+    int j;
+
+    for (i = 0; homes[i] != NULL; i++)
+        {
+        for (j = 0; j < threadCount; j++)
+            {
+            if (strcmp(threads[j].name, homes[i]) == 0 && threads[j].cores != 0)
+                {
+                return(threadCoresNode(threads[j].cores));
+                }
+            }
+        }
+
+    return(-1);
+    }
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Parse a core list.
+**
+**  Parameters:     Name        Description.
+**                  str         core list, "*" for any
+**                  cores       receives core mask
+**
+**  Returns:        TRUE if valid, FALSE otherwise.
+**
+**------------------------------------------------------------------------*/
+static bool threadParseCores(char *str, u64 *cores)
+    {
+    long first;
+    long last;
+    char *end;
+
+    *cores = 0;
+    if (str == NULL || strcmp(str, "*") == 0)
+        {
+        return(TRUE);
+        }
+
+    for (;;)
+        {
+        if (!isdigit(*str))
+            {
+            return(FALSE);
+            }
+
+        first = strtol(str, &end, 10);
+        last = first;
+        if (*end == '-')
+            {
+            str = end + 1;
+            if (!isdigit(*str))
+                {
+                return(FALSE);
+                }
+
+            last = strtol(str, &end, 10);
+            }
+
+        if (first > last || last >= MaxCores)
+            {
+            return(FALSE);
+            }
+
+        while (first <= last)
+            {
+            *cores |= (u64)1 << first++;
+            }
+
+        if (*end == '\0')
+            {
+            return(TRUE);
+            }
+
+        if (*end != '+')
+            {
+            return(FALSE);
+            }
+
+        str = end + 1;
+        }
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Format a core mask for the startup report.
+**
+**  Parameters:     Name        Description.
+**                  cores       core mask, 0 for any
+**                  str         buffer of at least 100 characters
+**
+**  Returns:        Pointer to str.
+**
+**------------------------------------------------------------------------*/
+static char *threadFormatCores(u64 cores, char *str)
+    {
+    int first;
+    int i;
+
+    if (cores == 0)
+        {
+        return(strcpy(str, "any"));
+        }
+
+    *str = '\0';
+    for (i = 0; i < MaxCores; i++)
+        {
+        if ((cores & ((u64)1 << i)) == 0)
+            {
+            continue;
+            }
+
+        first = i;
+        while (i + 1 < MaxCores && (cores & ((u64)1 << (i + 1))) != 0)
+            {
+            i += 1;
+            }
+
+        if (*str != '\0')
+            {
+            strcat(str, "+");
+            }
+
+        if (first == i)
+            {
+            sprintf(str + strlen(str), "%d", i);
+            }
+        else
+            {
+            sprintf(str + strlen(str), "%d-%d", first, i);
+            }
+        }
+
+    return(str);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Save the placement and scheduling of the calling
+**                  thread, which is the main thread before any other
+**                  thread has been created.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void threadSaveOriginal(void)
+    {
+#if defined(_WIN32)
+    DWORD_PTR systemCores;
+
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &originalCores, &systemCores))
+        {
+        originalCores = 0;
+        }
+#else
+    if (pthread_getschedparam(pthread_self(), &originalPolicy, &originalParam) != 0)
+        {
+        originalPolicy = -1;
+        }
+
+#if defined(__linux__)
+    if (sched_getaffinity(0, sizeof(originalSet), &originalSet) != 0)
+        {
+        CPU_ZERO(&originalSet);
+        }
+
+    errno = 0;
+    originalNice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+    if (errno != 0)
+        {
+        originalNice = 0;
+        }
+#endif
+#endif
+
+    originalSaved = TRUE;
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Apply settings to the calling thread and describe what
+**                  was obtained.
+**
+**  Parameters:     Name        Description.
+**                  tc          thread settings
+**                  report      buffer for the description
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+static void threadApply(ThreadConfig *tc, char *report)
+    {
+    char coreList[100];
+    u64 cores = tc->cores;
+
+#if defined(_WIN32)
+    int priority = THREAD_PRIORITY_NORMAL;
+
+    if (cores != 0)
+        {
+        if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cores) == 0)
+            {
+            fprintf(stderr, "Failed to set cores of thread %s\n", tc->name);
+            cores = 0;
+            }
+        }
+    else if (originalCores != 0)
+        {
+        SetThreadAffinityMask(GetCurrentThread(), originalCores);
+        }
+
+    switch (tc->policy)
+        {
+    case PolicyFifo:
+    case PolicyRr:
+        priority = THREAD_PRIORITY_TIME_CRITICAL;
+        break;
+
+    case PolicyIdle:
+        priority = THREAD_PRIORITY_IDLE;
+        break;
+
+    default:
+        if (tc->level < -10)
+            {
+            priority = THREAD_PRIORITY_HIGHEST;
+            }
+        else if (tc->level < 0)
+            {
+            priority = THREAD_PRIORITY_ABOVE_NORMAL;
+            }
+        else if (tc->level > 10)
+            {
+            priority = THREAD_PRIORITY_LOWEST;
+            }
+        else if (tc->level > 0 || tc->policy == PolicyBatch)
+            {
+            priority = THREAD_PRIORITY_BELOW_NORMAL;
+            }
+        break;
+        }
+
+    if (!SetThreadPriority(GetCurrentThread(), priority))
+        {
+        fprintf(stderr, "Failed to set priority of thread %s\n", tc->name);
+        }
+
+    sprintf(report, "cores %s, priority %d", threadFormatCores(cores, coreList), GetThreadPriority(GetCurrentThread()));
+#else
+    struct sched_param param;
+    char *name;
+    int policy = -1;
+    int nice = tc->level;
+    int rc;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    int i;
+
+    if (cores != 0)
+        {
+        CPU_ZERO(&set);
+        for (i = 0; i < MaxCores; i++)
+            {
+            if ((cores & ((u64)1 << i)) != 0)
+                {
+                CPU_SET(i, &set);
+                }
+            }
+
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            {
+            fprintf(stderr, "Failed to set cores of thread %s: %s\n", tc->name, strerror(errno));
+            }
+        }
+    else if (CPU_COUNT(&originalSet) != 0)
+        {
+        sched_setaffinity(0, sizeof(originalSet), &originalSet);
+        }
+
+    cores = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+        for (i = 0; i < MaxCores; i++)
+            {
+            if (CPU_ISSET(i, &set))
+                {
+                cores |= (u64)1 << i;
+                }
+            }
+        }
+#else
+    if (cores != 0)
+        {
+        fprintf(stderr, "Thread %s: core placement not supported on this host\n", tc->name);
+        cores = 0;
+        }
+#endif
+
+    memset(&param, 0, sizeof(param));
+    switch (tc->policy)
+        {
+    case PolicyOther:
+        policy = SCHED_OTHER;
+        break;
+
+    case PolicyBatch:
+#if defined(SCHED_BATCH)
+        policy = SCHED_BATCH;
+#endif
+        break;
+
+    case PolicyIdle:
+#if defined(SCHED_IDLE)
+        policy = SCHED_IDLE;
+#endif
+        break;
+
+    case PolicyFifo:
+        policy = SCHED_FIFO;
+        param.sched_priority = tc->level;
+        break;
+
+    case PolicyRr:
+        policy = SCHED_RR;
+        param.sched_priority = tc->level;
+        break;
+        }
+
+    if (tc->policy != PolicyDefault)
+        {
+        rc = policy < 0 ? ENOTSUP : pthread_setschedparam(pthread_self(), policy, &param);
+        if (rc != 0)
+            {
+            fprintf(stderr, "Failed to set policy %s of thread %s: %s\n", policyNames[tc->policy], tc->name, strerror(rc));
+            }
+        }
+    else if (originalPolicy >= 0)
+        {
+        pthread_setschedparam(pthread_self(), originalPolicy, &originalParam);
+        }
+
+#if defined(__linux__)
+    /*
+    **  On Linux the nice level is a property of each thread. Level 0
+    **  stands for the nice level of the process.
+    */
+    if (tc->policy != PolicyFifo && tc->policy != PolicyRr)
+        {
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), tc->level != 0 ? tc->level : originalNice) != 0 && tc->level != 0)
+            {
+            fprintf(stderr, "Failed to set nice level of thread %s: %s\n", tc->name, strerror(errno));
+            }
+        }
+
+    errno = 0;
+    nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+    if (errno != 0)
+        {
+        nice = tc->level;
+        }
+#endif
+
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+        {
+        policy = -1;
+        }
+
+    name = "unknown";
+    if (policy == SCHED_OTHER)
+        {
+        name = "other";
+        }
+#if defined(SCHED_BATCH)
+    else if (policy == SCHED_BATCH)
+        {
+        name = "batch";
+        }
+#endif
+#if defined(SCHED_IDLE)
+    else if (policy == SCHED_IDLE)
+        {
+        name = "idle";
+        }
+#endif
+    else if (policy == SCHED_FIFO || policy == SCHED_RR)
+        {
+        sprintf(report, "cores %s, policy %s, priority %d",
+            threadFormatCores(cores, coreList), policy == SCHED_FIFO ? "fifo" : "rr", param.sched_priority);
+        return;
+        }
+
+    sprintf(report, "cores %s, policy %s, nice %d", threadFormatCores(cores, coreList), name, nice);
+#endif
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Determine the NUMA node of a set of cores.
+**
+**  Parameters:     Name        Description.
+**                  cores       core mask
+**
+**  Returns:        Node number, -1 if unknown or the cores are spread
+**                  over several nodes.
+**
+**------------------------------------------------------------------------*/
+static int threadCoresNode(u64 cores)
+    {
+#if defined(__linux__)
+    char path[64];
+    int found = -1;
+    int node;
+    int i;
+
+    for (i = 0; i < MaxCores; i++)
+        {
+        if ((cores & ((u64)1 << i)) == 0)
+            {
+            continue;
+            }
+
+        /*
+        **  Sysfs links each core directory to its node.
+        */
+        for (node = 0; node < MaxNodes; node++)
+            {
+            sprintf(path, "/sys/devices/system/cpu/cpu%d/node%d", i, node);
+            if (access(path, F_OK) == 0)
+                {
+                break;
+                }
+            }
+
+        if (node == MaxNodes || (found >= 0 && found != node))
+            {
+            return(-1);
+            }
+
+        found = node;
+        }
+
+    return(found);
+#else
+    (void)cores;
+
+    return(-1);
+#endif
+    }
+
+/*---------------------------  End Of File  ------------------------------*/
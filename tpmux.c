@@ -274,6 +274,7 @@ static u16 telnetConns = 2;
 **  Private Variables
 **  -----------------
 */
+static DevSlot *tpMuxDevice = NULL;
 
 /*
 **--------------------------------------------------------------------------
@@ -318,6 +319,7 @@ void tpMuxInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
         }
 
     dp->context[0] = mp;
+    tpMuxDevice = dp;
 
     /*
     **  Initialise port control blocks.
@@ -342,6 +344,25 @@ void tpMuxInit(u8 eqNo, u8 unitNo, u8 channelNo, char *deviceName)
     printf("Two port MUX initialised on channel %o\n", channelNo);
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Restart the TCP thread in a cloned emulator process on
+**                  a different port.
+**
+**  Parameters:     Name        Description.
+**                  portOffset  offset added to the Telnet port
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void tpMuxClone(u16 portOffset)
+    {
+    if (tpMuxDevice != NULL)
+        {
+        telnetPort += portOffset;
+        tpMuxCreateThread(tpMuxDevice);
+        }
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Execute function code on two-port mux.
 **
@@ -614,6 +635,8 @@ static void *tpMuxThread(void *param)
     socklen_t fromLen;
 #endif
 
+    threadSetup("tpmux");
+
     /*
     **  Create TCP socket and bind to specified port.
     */
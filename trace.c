@@ -437,7 +437,7 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
     /*
     **  Don't trace Scope 3.1 idle loop.
     */
-    if (cpu.regRaCm == 02020 && cpu.regP == 2)
+    if (activeCpu->regRaCm == 02020 && activeCpu->regP == 2)
         {
         if (!oneIdle)
             {
@@ -457,15 +457,15 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
 #if 0
     for (i = 0; i < 8; i++)
         {
-        data = cpu.regX[i];
+        data = activeCpu->regX[i];
         fprintf(cpuF, "        A%d %06.6o  X%d %04.4o %04.4o %04.4o %04.4o %04.4o   B%d %06.6o\n",
-            i, cpu.regA[i], i,
+            i, activeCpu->regA[i], i,
             (PpWord)((data >> 48) & Mask12),
             (PpWord)((data >> 36) & Mask12),
             (PpWord)((data >> 24) & Mask12),
             (PpWord)((data >> 12) & Mask12),
             (PpWord)((data      ) & Mask12),
-            i, cpu.regB[i]);
+            i, activeCpu->regB[i]);
         }
 #endif
 
@@ -490,8 +490,8 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
         {
         sprintf(str, "CRX%o  X%o", opJ, opK);
         fprintf(cpuF, "%-30s", str);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         fprintf(cpuF, "\n");
         return;
         }
@@ -500,8 +500,8 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
         {
         sprintf(str, "CWX%o  X%o", opJ, opK);
         fprintf(cpuF, "%-30s", str);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         fprintf(cpuF, "\n");
         return;
         }
@@ -529,7 +529,7 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
             break;
 
         case CiK:
-            sprintf(str, decode[opFm].mnemonic, cpu.regB[opI] + opAddress);
+            sprintf(str, decode[opFm].mnemonic, activeCpu->regB[opI] + opAddress);
             break;
 
         case CjK:
@@ -584,146 +584,146 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
         break;
 
     case RAA:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RAAB:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RAB:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RABB:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RAX:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RAXB:
-        fprintf(cpuF, "A%d=%06o    ", opI, cpu.regA[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opI, activeCpu->regA[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RBA:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
         break;
 
     case RBAB:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RBB:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
         break;
 
     case RBBB:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RBX:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
         break;
 
     case RBXB:
-        fprintf(cpuF, "B%d=%06o    ", opI, cpu.regB[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "B%d=%06o    ", opI, activeCpu->regB[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
         break;
 
     case RXA: 
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
         break;
 
     case RXAB:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "A%d=%06o    ", opJ, cpu.regA[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "A%d=%06o    ", opJ, activeCpu->regA[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RXB:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
         break;
 
     case RXBB:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RXBX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         break;
 
     case RXX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
         break;
 
     case RXXB:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "B%d=%06o    ", opK, cpu.regB[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opK, activeCpu->regB[opK]);
         break;
 
     case RXXX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         break;
 
     case RZB:
-        fprintf(cpuF, "B%d=%06o    ", opJ, cpu.regB[opJ]);
+        fprintf(cpuF, "B%d=%06o    ", opJ, activeCpu->regB[opJ]);
         break;
 
     case RZX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
         break;
 
     case RXNX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, cpu.regX[opI]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opI, activeCpu->regX[opI]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         break;
 
     case RNXX:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, cpu.regX[opK]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opK, activeCpu->regX[opK]);
         break;
 
     case RNXN:
-        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, cpu.regX[opJ]);
+        fprintf(cpuF, "X%d=" FMT60_020o "   ", opJ, activeCpu->regX[opJ]);
         break;
 
     default:
@@ -734,6 +734,33 @@ void traceCpu(u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
     fprintf(cpuF, "\n");
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Output CPU opcode to a given file, whether or not the
+**                  CPU is traced.
+**
+**  Parameters:     Name        Description.
+**                  f           output file
+**                  opFm        Opcode
+**                  opI         i
+**                  opJ         j
+**                  opK         k
+**                  opAddress   jk
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void traceCpuFile(FILE *f, u32 p, u8 opFm, u8 opI, u8 opJ, u8 opK, u32 opAddress)
+    {
+    FILE *saveF = cpuF;
+    u32 saveMask = traceMask;
+
+    cpuF = f;
+    traceMask |= TraceCpu;
+    traceCpu(p, opFm, opI, opJ, opK, opAddress);
+    traceMask = saveMask;
+    cpuF = saveF;
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Trace a exchange jump.
 **
@@ -793,7 +820,7 @@ void traceExchange(CpuContext *cc, u32 addr, char *title)
     fprintf(cpuF, "B%d %06o", 6, cc->regB[6]);
     fprintf(cpuF, "\n");
                            
-    fprintf(cpuF, "STOP         %d  ", cpuStopped ? 1 : 0);
+    fprintf(cpuF, "STOP         %d  ", cc->isStopped ? 1 : 0);
     fprintf(cpuF, "A%d %06o  ", 7, cc->regA[7]);
     fprintf(cpuF, "B%d %06o  ", 7, cc->regB[7]);
     fprintf(cpuF, "\n");
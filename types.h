@@ -91,6 +91,36 @@
     #include <stdbool.h>
 #endif
 
+/*
+**  Storage class of variables of which each thread has its own copy.
+*/
+#if defined(_WIN32)
+    #define ThreadLocal __declspec(thread)
+#else
+    #define ThreadLocal __thread
+#endif
+
+/*
+**  Alignment of structures which start on their own host cache line, so
+**  state owned by different threads never shares a line.
+*/
+#define CacheLineSize 64
+#if defined(_WIN32)
+    #define CacheAligned __declspec(align(CacheLineSize))
+#else
+    #define CacheAligned __attribute__((aligned(CacheLineSize)))
+#endif
+
+/*
+**  Storage class of functions which are always expanded into their
+**  callers, so each caller gets a copy specialised for its arguments.
+*/
+#if defined(_WIN32)
+    #define ForceInline static __forceinline
+#else
+    #define ForceInline static inline __attribute__((always_inline))
+#endif
+
 typedef u16 PpWord;                     /* 12 bit PP word */
 typedef u8 PpByte;                      /* 6 bit PP word */
 typedef u64 CpWord;                     /* 60 bit CPU word */
@@ -137,12 +167,14 @@ typedef struct devSlot
     } DevSlot;                          
                                         
 /*
-**  Channel control block.
+**  Channel control block. Owned by the main emulation thread; each channel
+**  has a cache line of its own.
 */                                        
-typedef struct chSlot                          
+typedef struct CacheAligned chSlot
     {                                   
-    DevSlot         *firstDevice;       /* linked list of devices attached to this channel */
-    DevSlot         *ioDevice;          /* device which deals with current function */
+    /*
+    **  State tested by every channel instruction.
+    */
     PpWord          data;               /* channel data */
     PpWord          status;             /* channel status */
     bool            active;             /* channel active flag */
@@ -150,32 +182,56 @@ typedef struct chSlot
     bool            discAfterInput;     /* disconnect channel after input flag */
     bool            flag;               /* optional channel flag */
     bool            inputPending;       /* input pending flag */
-    bool            hardwired;          /* hardwired devices */
-    u8              id;                 /* channel number */
     u8              delayStatus;        /* time to delay change of empty/full status */
     u8              delayDisconnect;    /* time to delay disconnect */
+    u8              id;                 /* channel number */
+    DevSlot         *ioDevice;          /* device which deals with current function */
+
+    /*
+    **  Configuration.
+    */
+    DevSlot         *firstDevice;       /* linked list of devices attached to this channel */
+    bool            hardwired;          /* hardwired devices */
     } ChSlot;                           
                                         
 /*
-**  PPU control block.
+**  PPU control block. Owned by the main emulation thread. The registers
+**  share the first cache line, PP memory starts on the next one.
 */                                        
-typedef struct                          
+typedef struct CacheAligned
     {                                   
     u32             regA;               /* register A (18 bit) */
     u32             regR;               /* register R (28 bit) */
     PpWord          regP;               /* program counter (12 bit) */
     PpWord          regQ;               /* register Q (12 bit) */
-    PpWord          mem[PpMemSize];     /* PP memory */
     bool            busy;               /* instruction execution state */
-    u8              id;                 /* PP number */
     PpByte          opF;                /* current opcode */
     PpByte          opD;                /* current opcode */
+    u8              id;                 /* PP number */
+    PpWord          blockDelay;         /* barrel visits left of a block transfer */
+    u32             ioWords;            /* channel words transferred */
+    CacheAligned PpWord mem[PpMemSize]; /* PP memory */
     } PpSlot;                           
 
 /*
-**  CPU control block.
+**  Decode state of the PP being stepped. Owned by the main emulation
+**  thread, the only thread which steps PPs, on a cache line of its own.
+*/
+typedef struct CacheAligned
+    {
+    PpSlot          *ppu;               /* PP being stepped */
+    u32             acc18;              /* 18 bit accumulator of CM access */
+    PpWord          location;           /* operand address */
+    PpByte          opF;                /* current opcode */
+    PpByte          opD;                /* current operand */
+    } PpDecode;
+
+/*
+**  CPU control block. Owned by the thread which runs the CPU and aligned
+**  so the contexts of two CPUs never share a cache line. The first lines
+**  hold the state used by every instruction.
 */                                        
-typedef struct                          
+typedef struct CacheAligned
     {                                   
     CpWord          regX[010];          /* data registers (60 bit) */
     u32             regA[010];          /* address registers (18 bit) */
@@ -183,13 +239,35 @@ typedef struct
     u32             regP;               /* program counter */
     u32             regRaCm;            /* reference address CM */
     u32             regFlCm;            /* field length CM */
+
+    /*
+    **  Job field in host memory, set up whenever RA or FL change.
+    */
+    u32             fieldLength;        /* words addressable without wrap or exit */
+    CpWord          *fieldCm;           /* host address of RA */
+
+    /*
+    **  Instruction word being executed.
+    */
+    CpWord          opWord;             /* current instruction word */
+    u64             instructions;       /* executed instructions */
+    u8              opOffset;           /* bit position of next parcel */
+    u8              iwRank;             /* most recent instruction word stack entry */
+    u8              exitCondition;      /* recorded exit conditions since XJ */
+    bool            monitorMode;        /* monitor mode bit */
+    u32             exitMode;           /* CPU exit mode (24 bit) */
+
+    /*
+    **  State used by exchange jumps and ECS transfers.
+    */
     u32             regRaEcs;           /* reference address ECS */
     u32             regFlEcs;           /* field length ECS */
     u32             regMa;              /* monitor address */
     u32             regSpare;           /* reserved */
-    u32             exitMode;           /* CPU exit mode (24 bit) */
-    bool            monitorMode;        /* monitor mode bit */
-    u8              exitCondition;      /* recorded exit conditions since XJ */
+    int             skipStep;           /* steps to skip after divide break-in */
+    bool            isStopped;          /* CPU stopped */
+    bool            monitorPending;     /* waiting for other CPU to leave monitor mode */
+    u8              id;                 /* CPU number */
 
     /*
     **  Instruction word stack.
@@ -197,7 +275,6 @@ typedef struct
     CpWord          iwStack[MaxIwStack];
     u32             iwAddress[MaxIwStack];
     bool            iwValid[MaxIwStack];
-    u8              iwRank;
     } CpuContext;
 
 /*
@@ -239,6 +316,26 @@ typedef enum
     ModelCyber865,
     } ModelType;
 
+/*
+**  Feature sets of the supported models.
+*/
+#define Features6400        (IsSeries6x00)
+#define FeaturesCyber73     (IsSeries70 | HasInterlockReg | HasCMU)
+#define FeaturesCyber173    (IsSeries170 | HasStatusAndControlReg | HasCMU)
+#define FeaturesCyber175    (IsSeries170 | HasStatusAndControlReg | HasInstructionStack | HasIStackPrefetch | Has175Float)
+#define FeaturesCyber840A   (  IsSeries800 | HasNoCmWrap | HasFullRTC | HasTwoPortMux | HasMaintenanceChannel | HasCMU | HasChannelFlag \
+                             | HasErrorFlag | HasRelocationRegLong | HasMicrosecondClock | HasInstructionStack | HasIStackPrefetch)
+#define FeaturesCyber865    (  IsSeries800 | HasNoCmWrap | HasFullRTC | HasTwoPortMux | HasStatusAndControlReg \
+                             | HasRelocationRegShort | HasMicrosecondClock | HasInstructionStack | HasIStackPrefetch | Has175Float)
+
+/*
+**  Test a feature in code compiled for one model, with mf the feature set
+**  of that model. The compiler folds the test to a constant, except for
+**  HasNoCejMej which the configuration may add and is taken from the
+**  features in effect.
+*/
+#define ModelHas(mf, f)     ((((((f) & HasNoCejMej) == 0) ? (u32)(mf) : (u32)features) & (u32)(f)) != 0)
+
 typedef enum
     {
     ECS,
@@ -263,6 +263,21 @@ void windowGetChar(void)
     {
     }
 
+/*--------------------------------------------------------------------------
+**  Purpose:        Run without console window in a cloned emulator process,
+**                  which does not inherit the window thread.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing.
+**
+**------------------------------------------------------------------------*/
+void windowClone(void)
+    {
+    pthread_mutex_init(&mutexDisplay, NULL);
+    displayActive = FALSE;
+    }
+
 /*--------------------------------------------------------------------------
 **  Purpose:        Terminate console window.
 **
@@ -323,6 +338,8 @@ void *windowThread(void *param)
     unsigned long retLength; 
     int usageDisplayCount = 0;
 
+    threadSetup("window");
+
     /*
     **  Open the X11 display.
     */
@@ -676,7 +693,7 @@ void *windowThread(void *param)
             refreshCount++,
             ppu[0].regP, ppu[1].regP, ppu[2].regP, ppu[3].regP, ppu[4].regP,
             ppu[5].regP, ppu[6].regP, ppu[7].regP, ppu[8].regP, ppu[9].regP,
-            cpu.regP); 
+            cpus[0].regP); 
 
         sprintf(buf + strlen(buf), "   Trace: %c%c%c%c%c%c%c%c%c%c%c%c",
             (traceMask >> 0) & 1 ? '0' : '_',